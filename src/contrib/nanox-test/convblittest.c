@@ -0,0 +1,151 @@
+/*
+ * convblittest - pixel exact check of the convblit row kernels
+ *
+ * Draws random RGB and RGBA images with every convblit_8888.c
+ * conversion blit into memory framebuffers twice, once through the
+ * inline per-pixel loop (no row kernels) and once through the row
+ * kernels selected by convblit_simd_init for this cpu, in each
+ * portrait mode.  Source alpha is mixed between 0, 255 and partial
+ * values and widths cover the vector tails.  The two destination
+ * buffers must match byte for byte.
+ *
+ * Usage: convblittest [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "device.h"
+#include "convblit.h"
+
+#define SIZE	67		/* square screen, odd to exercise tails*/
+
+typedef struct {
+	const char *	name;
+	void		(*blit)(PSD psd, PMWBLITPARMS gc);
+	int		srcsize;	/* source bytes per pixel*/
+	int		dstsize;	/* destination bytes per pixel*/
+} CONVBLIT;
+
+static CONVBLIT convblits[] = {
+	{ "srcover_rgba8888_rgba8888", convblit_srcover_rgba8888_rgba8888, 4, 4 },
+	{ "copy_rgba8888_rgba8888", convblit_copy_rgba8888_rgba8888, 4, 4 },
+	{ "copy_rgb888_rgba8888", convblit_copy_rgb888_rgba8888, 3, 4 },
+	{ "srcover_rgba8888_bgra8888", convblit_srcover_rgba8888_bgra8888, 4, 4 },
+	{ "copy_rgba8888_bgra8888", convblit_copy_rgba8888_bgra8888, 4, 4 },
+	{ "copy_rgb888_bgra8888", convblit_copy_rgb888_bgra8888, 3, 4 },
+	{ "copy_8888_8888", convblit_copy_8888_8888, 4, 4 },
+	{ "srcover_rgba8888_bgr888", convblit_srcover_rgba8888_bgr888, 4, 3 },
+	{ "copy_rgba8888_bgr888", convblit_copy_rgba8888_bgr888, 4, 3 },
+	{ "copy_rgb888_bgr888", convblit_copy_rgb888_bgr888, 3, 3 },
+	{ "copy_888_888", convblit_copy_888_888, 3, 3 },
+	{ "copy_bgra8888_bgr888", convblit_copy_bgra8888_bgr888, 4, 3 },
+	{ "srcover_rgba8888_16bpp", convblit_srcover_rgba8888_16bpp, 4, 2 },
+	{ "copy_rgba8888_16bpp", convblit_copy_rgba8888_16bpp, 4, 2 },
+	{ "copy_rgb888_16bpp", convblit_copy_rgb888_16bpp, 3, 2 },
+	{ "copy_16bpp_16bpp", convblit_copy_16bpp_16bpp, 2, 2 },
+};
+#define NUMBLITS	(sizeof(convblits) / sizeof(convblits[0]))
+
+static const char *portraits[] = { "none", "left", "right", "down" };
+static const int portraitmodes[] = {
+	MWPORTRAIT_NONE, MWPORTRAIT_LEFT, MWPORTRAIT_RIGHT, MWPORTRAIT_DOWN
+};
+
+static unsigned char src[SIZE * SIZE * 4];
+static unsigned char dst_old[SIZE * SIZE * 4];
+static unsigned char dst_new[SIZE * SIZE * 4];
+
+/* fill image with random pixels, alpha mostly 0 or 255 as in icons*/
+static void
+random_image(unsigned char *buf, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = rand();
+	for (i = 3; i < size; i += 4) {
+		switch (rand() % 4) {
+		case 0:
+			buf[i] = 0;
+			break;
+		case 1:
+			buf[i] = 255;
+			break;
+		}
+	}
+}
+
+static void
+blit(CONVBLIT *cb, PSD psd, MWBLITPARMS *parms, unsigned char *dst)
+{
+	MWBLITPARMS gc = *parms;	/* rotation changes dstx/dsty*/
+
+	gc.data_out = dst;
+	cb->blit(psd, &gc);
+}
+
+int
+main(int ac, char **av)
+{
+	int iterations = (ac > 1)? atoi(av[1]): 200;
+	MWROWBLITFUNCS newfuncs;
+	SCREENDEVICE scr;
+	MWBLITPARMS gc;
+	CONVBLIT *cb;
+	int i, p, n, failed = 0;
+
+	convblit_simd_init();
+	newfuncs = convblit_rowfuncs;
+
+	memset(&scr, 0, sizeof(scr));
+	scr.xvirtres = scr.yvirtres = SIZE;
+	srand(1);
+
+	for (cb = convblits; cb < &convblits[NUMBLITS]; cb++) {
+		for (p = 0; p < 4; p++) {
+			scr.portrait = portraitmodes[p];
+			for (n = 0; n < iterations; n++) {
+				memset(&gc, 0, sizeof(gc));
+				gc.width = 1 + rand() % SIZE;
+				gc.height = 1 + rand() % SIZE;
+				gc.srcx = rand() % (SIZE - gc.width + 1);
+				gc.srcy = rand() % (SIZE - gc.height + 1);
+				gc.dstx = rand() % (SIZE - gc.width + 1);
+				gc.dsty = rand() % (SIZE - gc.height + 1);
+				gc.src_pitch = SIZE * cb->srcsize;
+				gc.dst_pitch = SIZE * cb->dstsize;
+				gc.data = src;
+
+				random_image(src, sizeof(src));
+				random_image(dst_old, sizeof(dst_old));
+				memcpy(dst_new, dst_old, sizeof(dst_new));
+
+				/* old path: inline loop only*/
+				memset(&convblit_rowfuncs, 0, sizeof(convblit_rowfuncs));
+				blit(cb, &scr, &gc, dst_old);
+
+				/* new path: row kernels for this cpu*/
+				convblit_rowfuncs = newfuncs;
+				blit(cb, &scr, &gc, dst_new);
+
+				if (memcmp(dst_old, dst_new, sizeof(dst_new)) != 0) {
+					for (i = 0; dst_old[i] == dst_new[i]; i++)
+						continue;
+					printf("FAIL %s portrait %s %dx%d src %d,%d dst %d,%d: byte %d is %d, expected %d\n",
+						cb->name, portraits[p], gc.width, gc.height, gc.srcx, gc.srcy,
+						gc.dstx, gc.dsty, i, dst_new[i], dst_old[i]);
+					failed++;
+					break;
+				}
+			}
+		}
+	}
+
+	if (failed) {
+		printf("convblittest: %d of %d blit/portrait combinations failed\n",
+			failed, (int)NUMBLITS * 4);
+		return 1;
+	}
+	printf("convblittest: %d blits in %d portrait modes match\n", (int)NUMBLITS, 4);
+	return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * drawbench - nano-X batched drawing benchmark
+ *
+ * Draws a frame of small bars, outlines, segments and arcs as in a
+ * chart, first with one request per primitive and then with the
+ * GrFillRects, GrRects, GrSegments and GrArcs table requests, and
+ * reports the primitives per second handled by the server.
+ *
+ * Usage: drawbench [primitives_per_frame]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+#define WIDTH	400
+#define HEIGHT	300
+#define FRAMES	10
+
+static GR_WINDOW_ID	wid;
+static GR_GC_ID		gc;
+static GR_RECT		*rects;
+static GR_SEGMENT	*segs;
+static GR_ARCANGLE	*arcs;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+draw_single(int type, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		switch (type) {
+		case 0:
+			GrFillRect(wid, gc, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+			break;
+		case 1:
+			GrRect(wid, gc, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+			break;
+		case 2:
+			GrLine(wid, gc, segs[i].x1, segs[i].y1, segs[i].x2, segs[i].y2);
+			break;
+		case 3:
+			GrArcAngle(wid, gc, arcs[i].x, arcs[i].y, arcs[i].rx, arcs[i].ry,
+				arcs[i].angle1, arcs[i].angle2, arcs[i].type);
+			break;
+		}
+	}
+}
+
+static void
+draw_table(int type, int count)
+{
+	switch (type) {
+	case 0:
+		GrFillRects(wid, gc, count, rects);
+		break;
+	case 1:
+		GrRects(wid, gc, count, rects);
+		break;
+	case 2:
+		GrSegments(wid, gc, count, segs);
+		break;
+	case 3:
+		GrArcs(wid, gc, count, arcs);
+		break;
+	}
+}
+
+/* draw FRAMES frames, return primitives/sec*/
+static double
+run(int type, int count, int table)
+{
+	GR_SCREEN_INFO si;
+	double start, elapsed;
+	int f;
+
+	GrGetScreenInfo(&si);		/* round trip to drain queue*/
+	start = now();
+	for (f = 0; f < FRAMES; f++) {
+		GrSetGCForeground(gc, (f & 1)? BLUE: GREEN);
+		if (table)
+			draw_table(type, count);
+		else
+			draw_single(type, count);
+	}
+	GrGetScreenInfo(&si);		/* wait for server*/
+	elapsed = now() - start;
+
+	return elapsed > 0? (double)FRAMES * count / elapsed: 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const char *names[] = { "fillrect", "rect", "segment", "arc" };
+	int count = 20000;
+	int i, type;
+	double single, table;
+
+	if (argc > 1)
+		count = atoi(argv[1]);
+	if (count < 1) {
+		fprintf(stderr, "Usage: drawbench [primitives_per_frame]\n");
+		return 1;
+	}
+
+	rects = malloc(count * sizeof(GR_RECT));
+	segs = malloc(count * sizeof(GR_SEGMENT));
+	arcs = malloc(count * sizeof(GR_ARCANGLE));
+	if (!rects || !segs || !arcs) {
+		fprintf(stderr, "drawbench: out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < count; i++) {
+		rects[i].x = (i * 3) % WIDTH;
+		rects[i].y = HEIGHT - 1 - (i * 7) % 100;
+		rects[i].width = 2;
+		rects[i].height = (i * 7) % 100;
+		segs[i].x1 = (i * 3) % WIDTH;
+		segs[i].y1 = (i * 11) % HEIGHT;
+		segs[i].x2 = segs[i].x1 + 3;
+		segs[i].y2 = (i * 13) % HEIGHT;
+		arcs[i].x = (i * 5) % WIDTH;
+		arcs[i].y = (i * 7) % HEIGHT;
+		arcs[i].rx = arcs[i].ry = 3;
+		arcs[i].angle1 = 0;
+		arcs[i].angle2 = 90 * 64;
+		arcs[i].type = GR_PIE;
+	}
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "drawbench: cannot open graphics\n");
+		return 1;
+	}
+
+	wid = GrNewWindowEx(GR_WM_PROPS_APPWINDOW, "drawbench",
+		GR_ROOT_WINDOW_ID, 10, 10, WIDTH, HEIGHT, WHITE);
+	GrMapWindow(wid);
+	gc = GrNewGC();
+
+	printf("%10s %14s %14s\n", "primitive", "single/sec", "table/sec");
+	for (type = 0; type < 4; type++) {
+		single = run(type, count, 0);
+		table = run(type, count, 1);
+		printf("%10s %14.0f %14.0f\n", names[type], single, table);
+	}
+
+	GrClose();
+	return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * pipebench - nano-X request pipelining benchmark
+ *
+ * Simulates an animation client: each frame draws a number of small
+ * rectangles and calls GrFlush, with a single round trip at the end
+ * of the run.  Reports frames per second over the socket, then again
+ * after switching to the GrReqShmCmds shared memory request ring.
+ * Neither transport should stall waiting for the server on each flush.
+ *
+ * Usage: pipebench [frames [rects_per_frame]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+#define SHMSIZE		65536	/* shared memory request ring size*/
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* draw frames of rects each, return frames/sec*/
+static double
+draw_frames(GR_WINDOW_ID wid, GR_GC_ID gc, int frames, int rects)
+{
+	GR_SCREEN_INFO si;
+	double start, elapsed;
+	int f, i;
+
+	GrGetScreenInfo(&si);		/* round trip to drain queue*/
+	start = now();
+	for (f = 0; f < frames; f++) {
+		for (i = 0; i < rects; i++) {
+			GrSetGCForeground(gc, MWRGB(f & 255, i & 255, 128));
+			GrFillRect(wid, gc, (i * 7) % 190, (f + i) % 90, 10, 10);
+		}
+		GrFlush();
+	}
+	GrGetScreenInfo(&si);		/* wait for server to finish*/
+	elapsed = now() - start;
+
+	return elapsed > 0? frames / elapsed: 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	GR_WINDOW_ID wid;
+	GR_GC_ID gc;
+	int frames = 20000;
+	int rects = 16;
+
+	if (argc > 1)
+		frames = atoi(argv[1]);
+	if (argc > 2)
+		rects = atoi(argv[2]);
+	if (frames < 1 || rects < 1) {
+		fprintf(stderr, "Usage: pipebench [frames [rects_per_frame]]\n");
+		return 1;
+	}
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "pipebench: cannot open graphics\n");
+		return 1;
+	}
+
+	wid = GrNewWindowEx(GR_WM_PROPS_APPWINDOW, "pipebench", GR_ROOT_WINDOW_ID,
+		10, 10, 200, 100, WHITE);
+	GrMapWindow(wid);
+	gc = GrNewGC();
+
+	printf("%10s %12s\n", "transport", "frames/sec");
+	printf("%10s %12.0f\n", "socket", draw_frames(wid, gc, frames, rects));
+	fflush(stdout);
+
+	GrReqShmCmds(SHMSIZE);
+	printf("%10s %12.0f\n", "shm", draw_frames(wid, gc, frames, rects));
+
+	GrDestroyGC(gc);
+	GrClose();
+	return 0;
+}
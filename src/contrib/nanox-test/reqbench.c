@@ -0,0 +1,105 @@
+/*
+ * reqbench - nano-X multithreaded request encoding benchmark
+ *
+ * Runs 1, 2, 4 and 8 drawing threads, each setting its own GC
+ * foreground and filling small rectangles in its own window without
+ * waiting for replies, and reports the requests per second sent and
+ * handled by the server.  The library must be built with THREADSAFE=Y
+ * for more than one thread; each thread then queues requests in its
+ * own request buffer, which are merged at flush time.
+ *
+ * Usage: reqbench [requests_per_thread]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+#define MAXTHREADS	8
+
+typedef struct {
+	GR_WINDOW_ID	wid;
+	GR_GC_ID	gc;
+	int		requests;	/* requests to send*/
+} BENCHTHREAD;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void *
+draw_thread(void *arg)
+{
+	BENCHTHREAD *bp = arg;
+	int i;
+
+	/* two requests per loop*/
+	for (i = 0; i < bp->requests; i += 2) {
+		GrSetGCForeground(bp->gc, MWRGB(i & 255, 128, 255 - (i & 255)));
+		GrFillRect(bp->wid, bp->gc, (i * 7) % 90, (i * 3) % 40, 8, 8);
+	}
+	return NULL;
+}
+
+/* run nthreads drawing threads, return requests/sec*/
+static double
+run_threads(BENCHTHREAD *threads, int nthreads)
+{
+	pthread_t tid[MAXTHREADS];
+	GR_SCREEN_INFO si;
+	double start, elapsed;
+	int i;
+
+	GrGetScreenInfo(&si);		/* round trip to drain queue*/
+	start = now();
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&tid[i], NULL, draw_thread, &threads[i]);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(tid[i], NULL);
+	GrGetScreenInfo(&si);		/* flush all threads and wait for server*/
+	elapsed = now() - start;
+
+	return elapsed > 0? nthreads * threads[0].requests / elapsed: 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	BENCHTHREAD threads[MAXTHREADS];
+	int requests = 200000;
+	int i, n;
+
+	if (argc > 1)
+		requests = atoi(argv[1]);
+	if (requests < 2) {
+		fprintf(stderr, "Usage: reqbench [requests_per_thread]\n");
+		return 1;
+	}
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "reqbench: cannot open graphics\n");
+		return 1;
+	}
+
+	for (i = 0; i < MAXTHREADS; i++) {
+		threads[i].wid = GrNewWindowEx(GR_WM_PROPS_APPWINDOW, "reqbench",
+			GR_ROOT_WINDOW_ID, 10 + (i % 4) * 110, 10 + (i / 4) * 70, 100, 50, WHITE);
+		GrMapWindow(threads[i].wid);
+		threads[i].gc = GrNewGC();
+		threads[i].requests = requests;
+	}
+
+	printf("%8s %14s\n", "threads", "requests/sec");
+	for (n = 1; n <= MAXTHREADS; n *= 2)
+		printf("%8d %14.0f\n", n, run_threads(threads, n));
+
+	GrClose();
+	return 0;
+}
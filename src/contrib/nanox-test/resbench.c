@@ -0,0 +1,119 @@
+/*
+ * resbench - nano-X resource lookup benchmark
+ *
+ * Creates increasing numbers of live pixmaps and graphics contexts,
+ * then measures how many drawing requests per second the server
+ * completes while picking drawables and gcs from the whole set.
+ * Each drawing request makes the server look up both ids, so the
+ * rate should stay flat as the resource count grows.
+ *
+ * Usage: resbench [max_resources [requests_per_step]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+#define PIXMAP_SIZE	16
+
+static GR_WINDOW_ID	*pixmaps;
+static GR_GC_ID		*gcs;
+static int		count;
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* grow resource set to n pixmaps and n gcs*/
+static void
+create_resources(int n)
+{
+	while (count < n) {
+		pixmaps[count] = GrNewPixmap(PIXMAP_SIZE, PIXMAP_SIZE, NULL);
+		gcs[count] = GrNewGC();
+		GrSetGCForeground(gcs[count], MWRGB(count & 255, (count >> 8) & 255, 128));
+		count++;
+	}
+}
+
+/* issue reqs drawing requests against random resources, return requests/sec*/
+static double
+draw_requests(GR_WINDOW_ID wid, int reqs)
+{
+	GR_SCREEN_INFO si;
+	double start, elapsed;
+	int i, n;
+
+	GrGetScreenInfo(&si);		/* round trip to drain queue*/
+	start = now();
+	for (i = 0; i < reqs; i++) {
+		n = rand() % count;
+		GrFillRect(pixmaps[n], gcs[rand() % count], 0, 0, PIXMAP_SIZE, PIXMAP_SIZE);
+		if ((i & 63) == 0)
+			GrFillRect(wid, gcs[n], (i >> 6) % 200, 0, 1, 1);
+	}
+	GrGetScreenInfo(&si);		/* wait for server to finish*/
+	elapsed = now() - start;
+
+	return elapsed > 0? reqs / elapsed: 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	GR_WINDOW_ID wid;
+	int maxres = 10000;
+	int reqs = 100000;
+	int n, i;
+
+	if (argc > 1)
+		maxres = atoi(argv[1]);
+	if (argc > 2)
+		reqs = atoi(argv[2]);
+	if (maxres < 1 || reqs < 1) {
+		fprintf(stderr, "Usage: resbench [max_resources [requests_per_step]]\n");
+		return 1;
+	}
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "resbench: cannot open graphics\n");
+		return 1;
+	}
+
+	pixmaps = malloc(maxres * sizeof(GR_WINDOW_ID));
+	gcs = malloc(maxres * sizeof(GR_GC_ID));
+	if (!pixmaps || !gcs) {
+		fprintf(stderr, "resbench: out of memory\n");
+		GrClose();
+		return 1;
+	}
+
+	wid = GrNewWindowEx(GR_WM_PROPS_APPWINDOW, "resbench", GR_ROOT_WINDOW_ID,
+		10, 10, 200, 20, WHITE);
+	GrMapWindow(wid);
+
+	printf("%10s %14s\n", "resources", "requests/sec");
+	for (n = 10; ; n *= 10) {
+		if (n > maxres)
+			n = maxres;
+		create_resources(n);
+		printf("%10d %14.0f\n", n * 2, draw_requests(wid, reqs));
+		fflush(stdout);
+		if (n == maxres)
+			break;
+	}
+
+	/* GrDestroyWindow also destroys pixmaps*/
+	for (i = 0; i < count; i++) {
+		GrDestroyWindow(pixmaps[i]);
+		GrDestroyGC(gcs[i]);
+	}
+	GrClose();
+	return 0;
+}
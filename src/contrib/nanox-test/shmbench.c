@@ -0,0 +1,131 @@
+/*
+ * shmbench - nano-X shared memory pixmap benchmark
+ *
+ * Renders frames on the client and presents them two ways: by
+ * sending the pixels with GrArea, and by drawing into a pixmap
+ * created with GrNewSharedPixmap and presenting it with a single
+ * GrCopyArea.  Prints frames per second for each method.
+ *
+ * Usage: shmbench [width height [frames]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#define MWINCLUDECOLORS
+#include "nano-X.h"
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* draw a moving gradient into a 32bpp pixel buffer*/
+static void
+render(unsigned char *pixels, int width, int height, int pitch, int frame)
+{
+	int x, y;
+
+	for (y = 0; y < height; y++) {
+		GR_PIXELVAL *p = (GR_PIXELVAL *)(pixels + y * pitch);
+		for (x = 0; x < width; x++)
+			*p++ = 0xff000000 | (((x + frame) & 255) << 16) | (((y + frame) & 255) << 8) | (frame & 255);
+	}
+}
+
+static double
+bench_area(GR_WINDOW_ID wid, GR_GC_ID gc, int width, int height, int frames)
+{
+	GR_SCREEN_INFO si;
+	unsigned char *pixels;
+	double start, elapsed;
+	int i;
+
+	pixels = malloc(width * height * sizeof(GR_PIXELVAL));
+	if (!pixels)
+		return 0;
+
+	GrGetScreenInfo(&si);
+	start = now();
+	for (i = 0; i < frames; i++) {
+		render(pixels, width, height, width * sizeof(GR_PIXELVAL), i);
+		GrArea(wid, gc, 0, 0, width, height, pixels, MWPF_TRUECOLOR8888);
+		GrGetScreenInfo(&si);		/* wait for server to finish*/
+	}
+	elapsed = now() - start;
+
+	free(pixels);
+	return elapsed > 0? frames / elapsed: 0;
+}
+
+static double
+bench_shared(GR_WINDOW_ID wid, GR_GC_ID gc, int width, int height, int frames)
+{
+	GR_SCREEN_INFO si;
+	GR_WINDOW_ID pid;
+	void *pixels;
+	double start, elapsed;
+	int i, pitch;
+
+	pid = GrNewSharedPixmap(width, height, MWIF_BGRA8888, &pixels, &pitch);
+	if (!pid)
+		return 0;
+
+	GrGetScreenInfo(&si);
+	start = now();
+	for (i = 0; i < frames; i++) {
+		render(pixels, width, height, pitch, i);
+		GrCopyArea(wid, gc, 0, 0, width, height, pid, 0, 0, MWROP_COPY);
+		GrGetScreenInfo(&si);		/* wait for server before drawing next frame*/
+	}
+	elapsed = now() - start;
+
+	GrDestroyWindow(pid);
+	return elapsed > 0? frames / elapsed: 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	GR_WINDOW_ID wid;
+	GR_GC_ID gc;
+	int width = 320;
+	int height = 240;
+	int frames = 200;
+	double fps;
+
+	if (argc > 2) {
+		width = atoi(argv[1]);
+		height = atoi(argv[2]);
+	}
+	if (argc > 3)
+		frames = atoi(argv[3]);
+	if (width < 1 || height < 1 || frames < 1) {
+		fprintf(stderr, "Usage: shmbench [width height [frames]]\n");
+		return 1;
+	}
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "shmbench: cannot open graphics\n");
+		return 1;
+	}
+
+	wid = GrNewWindowEx(GR_WM_PROPS_APPWINDOW, "shmbench", GR_ROOT_WINDOW_ID,
+		10, 10, width, height, WHITE);
+	gc = GrNewGC();
+	GrMapWindow(wid);
+
+	printf("%dx%d, %d frames\n", width, height, frames);
+	printf("GrArea:            %8.1f frames/sec\n", bench_area(wid, gc, width, height, frames));
+	fps = bench_shared(wid, gc, width, height, frames);
+	if (fps)
+		printf("GrNewSharedPixmap: %8.1f frames/sec\n", fps);
+	else printf("GrNewSharedPixmap: no shared memory support\n");
+
+	GrDestroyGC(gc);
+	GrClose();
+	return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * timeouttest - check GrGetNextEventTimeout returns timeout events
+ *
+ * Waits repeatedly with GrGetNextEventTimeout and checks that each
+ * wait ends with a GR_EVENT_TYPE_TIMEOUT event once the timeout has
+ * passed, not before.  Meant to be linked into the server
+ * (LINK_APP_INTO_SERVER=Y), where the client waits in the server main
+ * loop, in particular with screen drivers that can't block
+ * (PSF_CANTBLOCK) and wait in short slices.  A watchdog fails the test
+ * if no timeout event arrives.
+ *
+ * Usage: timeouttest [timeout_ms [count]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "nano-X.h"
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static void
+watchdog(int sig)
+{
+	printf("FAIL timeouttest: no timeout event\n");
+	exit(1);
+}
+
+int
+main(int ac, char **av)
+{
+	int timeout = (ac > 1)? atoi(av[1]): 100;
+	int count = (ac > 2)? atoi(av[2]): 5;
+	GR_WINDOW_ID wid;
+	GR_EVENT ev;
+	double start, elapsed;
+	int i;
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "Cannot open graphics\n");
+		return 1;
+	}
+
+	wid = GrNewWindow(GR_ROOT_WINDOW_ID, 0, 0, 100, 100, 0, GR_RGB(255, 255, 255), 0);
+	GrSelectEvents(wid, GR_EVENT_MASK_EXPOSURE);
+	GrMapWindow(wid);
+
+	signal(SIGALRM, watchdog);
+	for (i = 0; i < count; i++) {
+		alarm(timeout / 1000 + 5);
+		start = now();
+
+		/* skip other events, such as the initial exposure*/
+		do {
+			GrGetNextEventTimeout(&ev, timeout);
+		} while (ev.type != GR_EVENT_TYPE_TIMEOUT);
+
+		elapsed = now() - start;
+		alarm(0);
+		if (elapsed < timeout - 1) {
+			printf("FAIL timeouttest: timeout event after %.1f ms, expected %d ms\n",
+				elapsed, timeout);
+			return 1;
+		}
+	}
+
+	/* linked server exits from GrClose without flushing stdio*/
+	printf("timeouttest: %d timeout events of %d ms\n", count, timeout);
+	fflush(stdout);
+	GrClose();
+	return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * timertest - engine timer queue check
+ *
+ * Runs the devtimer.c timer functions against a simulated clock:
+ * clock_gettime is replaced below, so the monotonic and wall clocks
+ * only move when the test steps them.  Each test checks that every
+ * timer fires in the first GdTimeout call at or after its expiry,
+ * never earlier, in expiry order, and that GdGetNextTimeout reports
+ * the time until the earliest one.
+ *
+ *	many	thousands of one-shot and periodic timers with random periods
+ *	destroy	callbacks destroying other pending timers and themselves
+ *	clock	wall clock stepped backwards and forwards by hours
+ *
+ * Usage: timertest [timers]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "device.h"
+
+#define STEP_MAX	50		/* max msecs per simulated main loop*/
+#define HOUR		(3600 * 1000LL)
+
+typedef struct {
+	MWTIMER *	timer;
+	uint64_t	due;		/* expected expiry*/
+	MWTIMEOUT	period;		/* 0 for one-shot*/
+	int		live;		/* not yet fired (one-shot) or destroyed*/
+	int		fired;
+	int		destroys;	/* callback destroys other timers*/
+} TIMER;
+
+static long long mono_ms = 1000000;	/* simulated CLOCK_MONOTONIC*/
+static long long wall_ms = 1700000000000LL;	/* simulated CLOCK_REALTIME*/
+static uint64_t prev_now;		/* clock at previous GdTimeout, 0 if none*/
+static uint64_t last_due;		/* expiry of last fired timer this GdTimeout*/
+static TIMER *timers;
+static int ntimers;
+static int errors;
+
+/* replaces libc clock_gettime for devtimer.c*/
+int
+clock_gettime(clockid_t clk, struct timespec *ts)
+{
+	long long ms = (clk == CLOCK_MONOTONIC)? mono_ms: wall_ms;
+
+	ts->tv_sec = ms / 1000;
+	ts->tv_nsec = (ms % 1000) * 1000000;
+	return 0;
+}
+
+/* report error for timer, or timer queue if tp is NULL*/
+static void
+error(const char *test, TIMER *tp, const char *msg)
+{
+	if (++errors > 10)
+		return;
+	if (tp)
+		printf("FAIL %s: timer %d due %llu at %lld: %s\n", test, (int)(tp - timers),
+			(unsigned long long)tp->due, mono_ms, msg);
+	else
+		printf("FAIL %s: at %lld: %s\n", test, mono_ms, msg);
+}
+
+/* destroy a random pending timer other than tp*/
+static void
+destroy_other(TIMER *tp)
+{
+	int i, n = rand() % ntimers;
+
+	for (i = 0; i < ntimers; i++) {
+		TIMER *op = &timers[(n + i) % ntimers];
+
+		if (op != tp && op->live) {
+			GdDestroyTimer(op->timer);
+			op->live = 0;
+			return;
+		}
+	}
+}
+
+static void
+callback(void *arg)
+{
+	TIMER *tp = arg;
+
+	if (!tp->live)
+		error("callback", tp, "destroyed timer fired");
+	if ((uint64_t)mono_ms < tp->due)
+		error("callback", tp, "fired early");
+	if (tp->due <= prev_now)
+		error("callback", tp, "fired late");
+	if (tp->due < last_due)
+		error("callback", tp, "fired out of order");
+	last_due = tp->due;
+	tp->fired++;
+
+	if (tp->period) {
+		/* periodic timers skip missed periods*/
+		tp->due += tp->period;
+		if (tp->due <= (uint64_t)mono_ms)
+			tp->due = mono_ms + tp->period;
+	} else
+		tp->live = 0;
+
+	if (tp->destroys) {
+		if (tp->period && rand() % 4 == 0) {
+			GdDestroyTimer(tp->timer);
+			tp->live = 0;
+		} else
+			destroy_other(tp);
+	}
+}
+
+static void
+add_timers(int count, int maxperiod, int periodic, int destroys)
+{
+	int i;
+
+	ntimers = count;
+	timers = calloc(count, sizeof(TIMER));
+	for (i = 0; i < count; i++) {
+		TIMER *tp = &timers[i];
+		MWTIMEOUT t = rand() % maxperiod;
+
+		if (periodic && i % 10 == 0) {
+			tp->period = t? t: 1;
+			tp->timer = GdAddPeriodicTimer(tp->period, callback, tp);
+			tp->due = mono_ms + tp->period;
+		} else {
+			tp->timer = GdAddTimer(t, callback, tp);
+			tp->due = mono_ms + t;
+		}
+		tp->live = 1;
+		tp->destroys = destroys && rand() % 3 == 0;
+	}
+}
+
+/* step monotonic clock and run expired timers, checking next timeout first*/
+static void
+run(const char *test, int msecs, int wallsteps)
+{
+	long long end = mono_ms + msecs;
+	struct timeval tv;
+	uint64_t next;
+	int i, step;
+
+	prev_now = 0;
+	while (mono_ms < end) {
+		/* next timeout is earliest live timer*/
+		next = 0;
+		for (i = 0; i < ntimers; i++)
+			if (timers[i].live && (!next || timers[i].due < next))
+				next = timers[i].due;
+		if (GdGetNextTimeout(&tv, 0) != (next != 0))
+			error(test, NULL, "wrong GdGetNextTimeout result");
+		else if (next && tv.tv_sec * 1000 + tv.tv_usec / 1000 != (long)(next - mono_ms))
+			error(test, NULL, "wrong GdGetNextTimeout timeval");
+
+		step = rand() % (STEP_MAX + 1);
+		mono_ms += step;
+		wall_ms += step;
+		if (wallsteps)
+			wall_ms += (rand() % 2)? 2 * HOUR: -3 * HOUR;
+		last_due = 0;
+		GdTimeout();
+		prev_now = mono_ms;
+	}
+
+	for (i = 0; i < ntimers; i++) {
+		TIMER *tp = &timers[i];
+
+		if (tp->live && !tp->period)
+			error(test, tp, "never fired");
+		if (tp->live && GdFindTimer(tp) != tp->timer)
+			error(test, tp, "GdFindTimer failed");
+		if (!tp->live && GdFindTimer(tp))
+			error(test, tp, "GdFindTimer found destroyed timer");
+		if (tp->live)
+			GdDestroyTimer(tp->timer);
+	}
+	free(timers);
+	ntimers = 0;
+
+	if (GdGetNextTimeout(&tv, 0))
+		error(test, NULL, "timers left after destroying all");
+	printf("%s: %s\n", test, errors? "failed": "ok");
+}
+
+int
+main(int ac, char **av)
+{
+	int count = (ac > 1)? atoi(av[1]): 5000;
+
+	srand(1);
+
+	/* thousands of timers with random periods*/
+	add_timers(count, 10000, 1, 0);
+	run("many", 12000, 0);
+
+	/* timers destroyed by callbacks*/
+	add_timers(count, 5000, 1, 1);
+	run("destroy", 6000, 0);
+
+	/* wall clock jumps must not fire timers early or stall them*/
+	add_timers(count, 5000, 1, 0);
+	run("clock", 6000, 1);
+
+	return errors? 1: 0;
+}
@@ -14,6 +14,7 @@
  *			added support for 4bpp gray palette (-g)
  *			added support for 2, 4, 15, 16, 24 and 32bpp
  * 5/19/2019 added mouse and keyboard fifo drivers, fix screen draw bugs
+ * 10/18/2026 repaint only areas reported in scr_fbe damage ring instead of polling
  *
  * Original from picoTK project
  * 
@@ -71,6 +72,7 @@
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/select.h>
 #include <sys/mman.h>
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 #include <X11/Xlib.h>
@@ -123,6 +125,8 @@ int repaint;
 Pixmap pixmap;
 int mouse_fd;
 int keyboard_fd;
+int damage_fd = -1;
+MWFBEDAMAGE *damage;
 
 uint32_t crcs[(MAX_CRTX + CHUNKX - 1) / CHUNKX][(MAX_CRTY + CHUNKY - 1) / CHUNKY];
 uint32_t colors_X11[256];	/* contains X11 variants, either 8,16 or 24 bits */
@@ -691,46 +695,17 @@ calc_patch_crc(int ix, int iy)
 	return crc;
 }
 
-void
-check_and_paint(int ix, int iy)
+/* draw framebuffer area into pixmap at 0,0, area must fit in a chunk*/
+static void
+paint_pixels(int x0, int y0, int width, int height)
 {
-	uint32_t crc;
-	int x, y, off;
-	int color;
-
-	crc = calc_patch_crc(ix, iy);
-	if (!repaint && crc == crcs[ix][iy])
-		return;
-	crcs[ix][iy] = crc;
-
-	switch (BITS_PER_PIXEL) {
-	default:
-		off = ix * (CHUNKX / PIXELS_PER_BYTE) + iy * CHUNKY * (CRTX_TOTAL / PIXELS_PER_BYTE);
-		break;
-	case 15:
-	case 16:
-		off = (ix * CHUNKX + iy * CHUNKY * CRTX_TOTAL) * 2;
-		break;
-	case 24:
-		off = (ix * CHUNKX + iy * CHUNKY * CRTX_TOTAL) * 3;
-		break;
-	case 32:
-		off = (ix * CHUNKX + iy * CHUNKY * CRTX_TOTAL) * 4;
-		break;
-	}
-
-	XSetForeground(display, gc, 0x000000);
-	XFillRectangle(display, pixmap, gc, 0, 0, CHUNKX * ZOOM, CHUNKY * ZOOM);
+	int x, y, color;
 
-	for (y = 0; y < CHUNKY; y++) {
-		if (iy == CRTY/CHUNKY && y >= CRTY%CHUNKY)
-			continue;
-		for (x = 0; x < CHUNKX; x++) {
-			if (ix == CRTX/CHUNKX && x >= CRTX%CHUNKX)
-				continue;
+	for (y = y0; y < y0 + height; y++) {
+		for (x = x0; x < x0 + width; x++) {
 			if (BITS_PER_PIXEL <= 8) {
 				unsigned char data =
-					((unsigned char *)crtbuf)[off + x/PIXELS_PER_BYTE + y*(CRTX_TOTAL/PIXELS_PER_BYTE)];
+					((unsigned char *)crtbuf)[x/PIXELS_PER_BYTE + y*(CRTX_TOTAL/PIXELS_PER_BYTE)];
 
 				if (rev_bitorder)
 					color = (data >> 
@@ -746,7 +721,7 @@ check_and_paint(int ix, int iy)
 				
 				switch (BITS_PER_PIXEL) {
 				case 15:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*2;
+					data = ((unsigned char *)crtbuf) + (x + y*CRTX_TOTAL)*2;
 					l = *data++;
 					h = *data;
 					dat = l | (h<<8);
@@ -756,7 +731,7 @@ check_and_paint(int ix, int iy)
 					dat = b | (g<<8) | (r<<16);
 					break;
 				case 16:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*2;
+					data = ((unsigned char *)crtbuf) + (x + y*CRTX_TOTAL)*2;
 					l = *data++;
 					h = *data;
 					dat = l | (h<<8);
@@ -766,14 +741,14 @@ check_and_paint(int ix, int iy)
 					dat = b | (g<<8) | (r<<16);
 					break;
 				case 24:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*3;
+					data = ((unsigned char *)crtbuf) + (x + y*CRTX_TOTAL)*3;
 					b = *data++;
 					g = *data++;
 					r = *data++;
 					dat = b | (g<<8) | (r<<16);
 					break;
 				case 32:
-					data = ((unsigned char *)crtbuf) + off + (x + y*CRTX_TOTAL)*4;
+					data = ((unsigned char *)crtbuf) + (x + y*CRTX_TOTAL)*4;
 #if MWPIXEL_FORMAT == MWPF_TRUECOLORABGR
 					r = *data++;
 					g = *data++;
@@ -791,15 +766,124 @@ check_and_paint(int ix, int iy)
 				XSetForeground(display, gc, dat);
 			}
 			if (ZOOM > 1)
-				XFillRectangle(display, pixmap, gc, x * ZOOM, y * ZOOM, ZOOM, ZOOM);
+				XFillRectangle(display, pixmap, gc, (x - x0) * ZOOM, (y - y0) * ZOOM, ZOOM, ZOOM);
 			else
-				XDrawPoint(display, pixmap, gc, x, y);
+				XDrawPoint(display, pixmap, gc, x - x0, y - y0);
 		}
 	}
+}
+
+void
+check_and_paint(int ix, int iy)
+{
+	uint32_t crc;
+	int w, h;
+
+	crc = calc_patch_crc(ix, iy);
+	if (!repaint && crc == crcs[ix][iy])
+		return;
+	crcs[ix][iy] = crc;
+
+	XSetForeground(display, gc, 0x000000);
+	XFillRectangle(display, pixmap, gc, 0, 0, CHUNKX * ZOOM, CHUNKY * ZOOM);
+
+	w = MWMIN(CHUNKX, CRTX - ix * CHUNKX);
+	h = MWMIN(CHUNKY, CRTY - iy * CHUNKY);
+	paint_pixels(ix * CHUNKX, iy * CHUNKY, w, h);
 	XCopyArea(display, pixmap, window, gc, 0, 0, CHUNKX * ZOOM, CHUNKY * ZOOM,
 		ix * CHUNKX * ZOOM, iy * CHUNKY * ZOOM);
 }
 
+/* repaint a damaged framebuffer area, in chunks that fit the pixmap*/
+static void
+paint_area(int x, int y, int w, int h)
+{
+	int cx, cy, cw, ch;
+
+	/* clip to screen*/
+	if (x < 0) {
+		w += x;
+		x = 0;
+	}
+	if (y < 0) {
+		h += y;
+		y = 0;
+	}
+	w = MWMIN(w, CRTX - x);
+	h = MWMIN(h, CRTY - y);
+
+	for (cy = y; cy < y + h; cy += CHUNKY) {
+		ch = MWMIN(CHUNKY, y + h - cy);
+		for (cx = x; cx < x + w; cx += CHUNKX) {
+			cw = MWMIN(CHUNKX, x + w - cx);
+			paint_pixels(cx, cy, cw, ch);
+			XCopyArea(display, pixmap, window, gc, 0, 0, cw * ZOOM, ch * ZOOM,
+				cx * ZOOM, cy * ZOOM);
+		}
+	}
+}
+
+/*
+ * Repaint the rectangles added to the damage ring by the scr_fbe driver,
+ * or the whole screen if the ring overflowed.
+ */
+static void
+paint_damage(void)
+{
+	uint32_t head, tail;
+	char buf[64];
+
+	/* drain wakeups before reading ring so none are lost*/
+	while (read(damage_fd, buf, sizeof(buf)) > 0)
+		continue;
+
+	if (damage->overflow) {
+		damage->overflow = 0;
+		damage->tail = damage->head;
+		paint_area(0, 0, CRTX, CRTY);
+		return;
+	}
+
+	head = damage->head;
+#if defined(__GNUC__)
+	__sync_synchronize();
+#endif
+	for (tail = damage->tail; tail != head; tail++) {
+		MWFBERECT *rp = &damage->rect[tail & (MWFBE_DAMAGE_RECTS - 1)];
+
+		paint_area(rp->x, rp->y, rp->width, rp->height);
+	}
+#if defined(__GNUC__)
+	__sync_synchronize();
+#endif
+	damage->tail = tail;
+}
+
+/* drop queued damage, called before repainting everything*/
+static void
+discard_damage(void)
+{
+	char buf[64];
+
+	while (read(damage_fd, buf, sizeof(buf)) > 0)
+		continue;
+	damage->overflow = 0;
+	damage->tail = damage->head;
+}
+
+/* return nonzero if a live scr_fbe driver is writing the damage ring*/
+static int
+damage_attached(void)
+{
+	if (!damage || !damage->server)
+		return 0;
+	if (kill(damage->server, 0) < 0 && errno == ESRCH) {
+		damage->server = 0;		/* driver exited without detaching*/
+		return 0;
+	}
+	return 1;
+}
+
 static void
 handle_keyboard(XEvent *ev)
 {
@@ -1082,11 +1166,15 @@ handle_mouse(XEvent *ev)
 static void
 fbe_loop(void)
 {
+	int xfd = ConnectionNumber(display);
+
 	pixmap = XCreatePixmap(display, window, CHUNKX * ZOOM, CHUNKY * ZOOM, depth);
 
 	repaint = 1;
 	while (1) {
-		int x, y;
+		int x, y, attached;
+		fd_set rfds;
+		struct timeval tv;
 
 		/*
 		   Check if to force complete repaint because of window 
@@ -1115,23 +1203,49 @@ fbe_loop(void)
 			}
 		}
 
-		/* 
-		   Sample all chunks for changes in shared memory buffer and
-		   eventually repaint individual chunks. Repaint everything if
-		   repaint is true (see above)
-		 */
-		for (y = 0; y < (CRTY+CHUNKY-1) / CHUNKY; y++)
-			for (x = 0; x < (CRTX+CHUNKX-1) / CHUNKX; x++)
-				check_and_paint(x, y);
-		repaint = 0;
-		usleep(2000);
-
 		/* re-set color map */
 		if (redocmap) {
 			fbe_setcolors();
 			fbe_calcX11colors();
 			redocmap = 0;
+			repaint = 1;
+		}
+
+		/*
+		   With a scr_fbe driver attached to the damage ring repaint
+		   only the areas it reports, otherwise fall back to polling
+		 */
+		attached = damage_attached();
+		if (damage) {
+			if (repaint || !attached)
+				discard_damage();
+			else
+				paint_damage();
 		}
+
+		/* 
+		   Sample all chunks for changes in shared memory buffer and
+		   eventually repaint individual chunks. Repaint everything if
+		   repaint is true (see above)
+		 */
+		if (repaint || !attached) {
+			for (y = 0; y < (CRTY+CHUNKY-1) / CHUNKY; y++)
+				for (x = 0; x < (CRTX+CHUNKX-1) / CHUNKX; x++)
+					check_and_paint(x, y);
+			repaint = 0;
+		}
+		XFlush(display);
+		if (XQLength(display) > 0)
+			continue;
+
+		/* sleep until X events or damage arrive, polling every 2ms if no driver attached*/
+		FD_ZERO(&rfds);
+		FD_SET(xfd, &rfds);
+		if (damage)
+			FD_SET(damage_fd, &rfds);
+		tv.tv_sec = 0;
+		tv.tv_usec = 2000;
+		select(MWMAX(xfd, damage_fd) + 1, &rfds, NULL, NULL, attached? NULL: &tv);
 	}
 }
 
@@ -1292,6 +1406,8 @@ main(int argc, char **argv)
 		unlink(MW_PATH_FBE_COLORMAP);
 		unlink(MW_PATH_FBE_MOUSE);
 		unlink(MW_PATH_FBE_KEYBOARD);
+		unlink(MW_PATH_FBE_DAMAGE);
+		unlink(MW_PATH_FBE_DAMAGEFIFO);
 	}
 
 	/* open and mmap virtual framebuffer, but recreate if missing or wrong size*/
@@ -1339,6 +1455,36 @@ main(int argc, char **argv)
 	if ((keyboard_fd = open(MW_PATH_FBE_KEYBOARD, O_RDWR | O_NONBLOCK)) < 0)
 		fprintf(stderr, PROGNAME ": open %s error %d ('%s')\n", MW_PATH_FBE_KEYBOARD, errno, strerror(errno));
 
+	/* create damage ring and wakeup fifo for scr_fbe, polling is used without them*/
+	fd = -1;
+	if (!stat(MW_PATH_FBE_DAMAGE, &st) && st.st_size == sizeof(MWFBEDAMAGE))
+		fd = open(MW_PATH_FBE_DAMAGE, O_RDWR);
+	if (fd < 0) {
+		if ((fd = open(MW_PATH_FBE_DAMAGE, O_CREAT | O_TRUNC | O_RDWR, 0666)) >= 0
+		    && ftruncate(fd, sizeof(MWFBEDAMAGE)) < 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	if (fd >= 0) {
+		damage = mmap(NULL, sizeof(MWFBEDAMAGE), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (damage == MAP_FAILED)
+			damage = NULL;
+	}
+	if (mkfifo(MW_PATH_FBE_DAMAGEFIFO, 0666) < 0 && errno != EEXIST)
+		fprintf(stderr, PROGNAME ": mkfifo %s error %d ('%s')\n", MW_PATH_FBE_DAMAGEFIFO, errno, strerror(errno));
+	if (damage && (damage_fd = open(MW_PATH_FBE_DAMAGEFIFO, O_RDWR | O_NONBLOCK)) >= 0) {
+		damage->overflow = 0;
+		damage->tail = damage->head;
+		damage->magic = MWFBE_DAMAGE_MAGIC;
+	} else {
+		fprintf(stderr, PROGNAME ": Can't create %s, polling framebuffer\n", MW_PATH_FBE_DAMAGE);
+		if (damage)
+			munmap(damage, sizeof(MWFBEDAMAGE));
+		damage = NULL;
+	}
+
 	X11_init();
 	fbe_setcolors();
 	fbe_calcX11colors();
@@ -46,10 +46,17 @@ getpixmap(void)
 	GrSetGCForeground(gc, GR_COLOR_WHITE);
 	GrFillRect(pixmap, gc, 0, 0, 320, 80);
 
-	// draw dithered pattern in second third
-	for (y = 80; y < 160; y++)
-		for (x = y&1; x < 320; x += 2)
-				GrPoint(pixmap, gc, x, y);
+	// draw dithered pattern in second third, a row of points per request
+	for (y = 80; y < 160; y++) {
+		GR_POINT	points[160];
+		int			n = 0;
+
+		for (x = y&1; x < 320; x += 2) {
+			points[n].x = x;
+			points[n++].y = y;
+		}
+		GrPoints(pixmap, gc, n, points);
+	}
 	// default black in third portion
 
 	GrDestroyGC(gc);
@@ -674,13 +674,22 @@ drawboard(void)
 {
 	GR_COORD	row;
 	GR_COORD	col;
+	GR_SEGMENT	lines[(MAXSIZE - 1) * 2];
+	GR_SEGMENT	*sp = lines;
 
 	for (row = 1; row < size; row++) {
-		GrLine(boardwid, boardgc, 0, row * yp - 1, size * xp - 1,
-			row * yp - 1);
-		GrLine(boardwid, boardgc, row * xp - 1, 0,
-			row * xp - 1, size * yp - 1);
+		sp->x1 = 0;
+		sp->y1 = row * yp - 1;
+		sp->x2 = size * xp - 1;
+		sp->y2 = row * yp - 1;
+		++sp;
+		sp->x1 = row * xp - 1;
+		sp->y1 = 0;
+		sp->x2 = row * xp - 1;
+		sp->y2 = size * yp - 1;
+		++sp;
 	}
+	GrSegments(boardwid, boardgc, sp - lines, lines);
 	for (row = 0; row < FULLSIZE; row++) {
 		for (col = 0; col < FULLSIZE; col++) {
 			drawcell(boardpos(row, col));
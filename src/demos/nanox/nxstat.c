@@ -0,0 +1,128 @@
+/*
+ * nxstat - print nano-X server statistics
+ *
+ * Shows where the server spends its time: each request type with its
+ * count, total and average handling time and latency histogram, sorted
+ * by total time, followed by per-client traffic and engine blit counts.
+ * The server must be built with STATS=Y.
+ *
+ * Usage: nxstat [-r] [interval]
+ *	-r		reset server counters after printing
+ *	interval	print counters collected over each interval seconds
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "nano-X.h"
+
+static GR_SERVER_STATS stats;
+
+/* sort requests by decreasing total time*/
+static int
+cmp_request(const void *a, const void *b)
+{
+	const GR_REQUEST_STAT *ra = a;
+	const GR_REQUEST_STAT *rb = b;
+
+	if (ra->nsecs == rb->nsecs)
+		return ra->opcode - rb->opcode;
+	return ra->nsecs < rb->nsecs? 1: -1;
+}
+
+static void
+print_stats(GR_SERVER_STATS *sp)
+{
+	static const char *buckets[GR_STATS_BUCKETS] = {
+		"<1us", "<4us", "<16us", "<64us", "<256us", "<1ms", "<4ms", ">=4ms"
+	};
+	int i, j;
+
+	printf("%.3fs elapsed, %.1f%% busy, %llu wakeups\n", sp->elapsed / 1e9,
+		sp->elapsed? 100.0 * sp->busy / sp->elapsed: 0.0, (unsigned long long)sp->selects);
+
+	qsort(sp->request, sp->nrequests, sizeof(GR_REQUEST_STAT), cmp_request);
+	printf("\n%-24s %10s %10s %8s %8s", "request", "count", "total ms", "avg us", "max us");
+	for (j = 0; j < GR_STATS_BUCKETS; j++)
+		printf(" %7s", buckets[j]);
+	printf("\n");
+	for (i = 0; i < sp->nrequests; i++) {
+		GR_REQUEST_STAT *rp = &sp->request[i];
+
+		printf("%-24s %10llu %10.3f %8.2f %8.1f", rp->name,
+			(unsigned long long)rp->count, rp->nsecs / 1e6,
+			rp->nsecs / 1e3 / rp->count, rp->maxnsecs / 1e3);
+		for (j = 0; j < GR_STATS_BUCKETS; j++)
+			printf(" %7u", rp->hist[j]);
+		printf("\n");
+	}
+
+	printf("\n%6s %8s %10s %12s %12s\n", "client", "pid", "requests", "bytes in", "bytes out");
+	for (i = 0; i < sp->nclients; i++) {
+		GR_CLIENT_STAT *cp = &sp->client[i];
+
+		printf("%6d %8d %10llu %12llu %12llu\n", cp->id, cp->processid,
+			(unsigned long long)cp->requests, (unsigned long long)cp->bytesin,
+			(unsigned long long)cp->bytesout);
+	}
+
+	printf("\n%-8s %-8s %10s %14s\n", "src fmt", "dst fmt", "blits", "pixels");
+	for (i = 0; i < sp->draw.nblits; i++) {
+		MWBLITSTAT *bp = &sp->draw.blit[i];
+
+		printf("%08x %08x %10llu %14llu\n", bp->srcformat, bp->dstformat,
+			(unsigned long long)bp->count, (unsigned long long)bp->pixels);
+	}
+	printf("%llu clip rects walked, %llu update rects, %llu update pixels\n",
+		(unsigned long long)sp->draw.cliprects, (unsigned long long)sp->draw.updates,
+		(unsigned long long)sp->draw.updatepixels);
+	printf("image cache: %llu hits, %llu misses, %llu evictions, %llu images in %llu bytes\n",
+		(unsigned long long)sp->draw.imagehits, (unsigned long long)sp->draw.imagemisses,
+		(unsigned long long)sp->draw.imageevictions, (unsigned long long)sp->draw.imagecount,
+		(unsigned long long)sp->draw.imagebytes);
+}
+
+int
+main(int argc, char **argv)
+{
+	int reset = 0;
+	int interval = 0;
+
+	while (argc > 1 && argv[1][0] == '-') {
+		if (!strcmp(argv[1], "-r"))
+			reset = 1;
+		else {
+			fprintf(stderr, "Usage: nxstat [-r] [interval]\n");
+			return 1;
+		}
+		argc--;
+		argv++;
+	}
+	if (argc > 1)
+		interval = atoi(argv[1]);
+
+	if (GrOpen() < 0) {
+		fprintf(stderr, "nxstat: cannot open graphics\n");
+		return 1;
+	}
+
+	if (interval > 0) {
+		/* clear counters, then print those of each interval*/
+		GrGetServerStats(&stats, GR_TRUE);
+		for (;;) {
+			sleep(interval);
+			GrGetServerStats(&stats, GR_TRUE);
+			print_stats(&stats);
+			printf("\n");
+			fflush(stdout);
+		}
+	}
+
+	GrGetServerStats(&stats, reset);
+	if (stats.elapsed == 0)
+		fprintf(stderr, "nxstat: server built without STATS=Y\n");
+	else print_stats(&stats);
+
+	GrClose();
+	return 0;
+}
@@ -92,16 +92,25 @@ main(int argc,char **argv)
 			/* no return*/
 		case GR_EVENT_TYPE_EXPOSURE:
 			if (pflag) {
-				int x, y;
+				int x, y, n;
+				GR_RECT *rects;
 				GR_WINDOW_INFO wi;
 
+				/* draw checkerboard in a single table request*/
 				GrGetWindowInfo(window_id, &wi);
-				for (x=0; x<wi.width; x+=CX*2)
-					for (y=0; y<wi.height; y+=CY) {
-						if (y & CY)
-							GrFillRect(window_id, gc_id, x, y, CX, CY);
-						else GrFillRect(window_id, gc_id, x+CX, y, CX, CY); 
-					}
+				n = 0;
+				rects = malloc(((wi.width+CX*2-1)/(CX*2)) * ((wi.height+CY-1)/CY) * sizeof(GR_RECT));
+				if (rects) {
+					for (x=0; x<wi.width; x+=CX*2)
+						for (y=0; y<wi.height; y+=CY) {
+							rects[n].x = (y & CY)? x: x+CX;
+							rects[n].y = y;
+							rects[n].width = CX;
+							rects[n++].height = CY;
+						}
+					GrFillRects(window_id, gc_id, n, rects);
+					free(rects);
+				}
 			}
 			GrDrawImageToFit(window_id, gc_id, 0,0, w,h, image_id);
 			break;
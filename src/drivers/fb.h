@@ -15,8 +15,14 @@
 /* Linux framebuffer critical sections*/
 #if VTSWITCH
 extern volatile int mwdrawing;
+#if MW_FEATURE_BLITTHREADS
+/* banded blits draw on several threads at once*/
+#define DRAWON		__sync_fetch_and_add(&mwdrawing, 1)
+#define DRAWOFF		__sync_fetch_and_sub(&mwdrawing, 1)
+#else
 #define DRAWON		++mwdrawing
 #define DRAWOFF		--mwdrawing
+#endif
 #else
 #define DRAWON
 #define DRAWOFF
@@ -59,6 +59,8 @@ linear16_drawhorzline(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWPIXELVAL c)
 {
 	register unsigned char *addr = psd->addr + y * psd->pitch + (x1 << 1);
 	int width = x2-x1+1;
+	unsigned char pat[MWFILLPATSIZE];
+	MWROWFILLFUNC fill;
 #if DEBUG
 	assert (psd->addr != 0);
 	assert (x1 >= 0 && x1 < psd->xres);
@@ -69,7 +71,9 @@ linear16_drawhorzline(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWPIXELVAL c)
 #endif
 
 	DRAWON;
-	if(gr_mode == MWROP_COPY)
+	if (width >= MWFILLMINPIXELS && (fill = convblit_fill_setup(gr_mode, c, 2, pat)) != NULL)
+		fill(addr, pat, width << 1);
+	else if(gr_mode == MWROP_COPY)
 	{
 		int w = width;
 		while(--w >= 0)
@@ -119,12 +123,48 @@ linear16_drawvertline(PSD psd, MWCOORD x, MWCOORD y1, MWCOORD y2, MWPIXELVAL c)
 		psd->Update(psd, x, y1, 1, height);
 }
 
+/* Fill rectangle from x1,y1 to x2,y2 including final points*/
+static void
+linear16_fillrect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2, MWPIXELVAL c)
+{
+	unsigned char pat[MWFILLPATSIZE];
+	MWROWFILLFUNC fill = convblit_fill_setup(gr_mode, c, 2, pat);
+	int	pitch = psd->pitch;
+	unsigned char *addr = psd->addr + y1 * pitch + (x1 << 1);
+	int len = (x2-x1+1) << 1;
+	int height = y2-y1+1;
+#if DEBUG
+	assert (x1 >= 0 && x2 < psd->xres && x2 >= x1);
+	assert (y1 >= 0 && y2 < psd->yres && y2 >= y1);
+#endif
+	/* rops without a row kernel are drawn by line*/
+	if (!fill) {
+		gen_fillrect(psd, x1, y1, x2, y2, c);
+		return;
+	}
+
+	DRAWON;
+	/* full width rows are contiguous, fill them in one pass*/
+	if (len == pitch) {
+		len *= height;
+		height = 1;
+	}
+	while (--height >= 0) {
+		fill(addr, pat, len);
+		addr += pitch;
+	}
+	DRAWOFF;
+
+	if (psd->Update)
+		psd->Update(psd, x1, y1, x2-x1+1, y2-y1+1);
+}
+
 static SUBDRIVER fblinear16_none = {
 	linear16_drawpixel,
 	linear16_readpixel,
 	linear16_drawhorzline,
 	linear16_drawvertline,
-	gen_fillrect,
+	linear16_fillrect,
 	NULL,			/* no fallback Blit - uses BlitFrameBlit*/
 	frameblit_16bpp,
 	frameblit_stretch_16bpp,
@@ -64,6 +64,8 @@ linear24_drawhorzline(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWPIXELVAL c)
 	MWUCHAR g = PIXEL888GREEN(c);
 	MWUCHAR b = PIXEL888BLUE(c);
 	int w = x2-x1+1;
+	unsigned char pat[MWFILLPATSIZE];
+	MWROWFILLFUNC fill;
 #if DEBUG
 	assert (x1 >= 0 && x1 < psd->xres);
 	assert (x2 >= 0 && x2 < psd->xres);
@@ -71,7 +73,9 @@ linear24_drawhorzline(PSD psd, MWCOORD x1, MWCOORD x2, MWCOORD y, MWPIXELVAL c)
 	assert (y >= 0 && y < psd->yres);
 #endif
 	DRAWON;
-	if(gr_mode == MWROP_COPY)
+	if (w >= MWFILLMINPIXELS && (fill = convblit_fill_setup(gr_mode, c, 3, pat)) != NULL)
+		fill(addr, pat, w * 3);
+	else if(gr_mode == MWROP_COPY)
 	{
 		while(--w >= 0)
 		{
@@ -138,12 +142,48 @@ linear24_drawvertline(PSD psd, MWCOORD x, MWCOORD y1, MWCOORD y2, MWPIXELVAL c)
 		psd->Update(psd, x, y1, 1, y2-y1+1);
 }
 
+/* Fill rectangle from x1,y1 to x2,y2 including final points*/
+static void
+linear24_fillrect(PSD psd, MWCOORD x1, MWCOORD y1, MWCOORD x2, MWCOORD y2, MWPIXELVAL c)
+{
+	unsigned char pat[MWFILLPATSIZE];
+	MWROWFILLFUNC fill = convblit_fill_setup(gr_mode, c, 3, pat);
+	int	pitch = psd->pitch;
+	unsigned char *addr = psd->addr + y1 * pitch + x1 * 3;
+	int len = (x2-x1+1) * 3;
+	int height = y2-y1+1;
+#if DEBUG
+	assert (x1 >= 0 && x2 < psd->xres && x2 >= x1);
+	assert (y1 >= 0 && y2 < psd->yres && y2 >= y1);
+#endif
+	/* rops without a row kernel are drawn by line*/
+	if (!fill) {
+		gen_fillrect(psd, x1, y1, x2, y2, c);
+		return;
+	}
+
+	DRAWON;
+	/* full width rows are contiguous, fill them in one pass*/
+	if (len == pitch) {
+		len *= height;
+		height = 1;
+	}
+	while (--height >= 0) {
+		fill(addr, pat, len);
+		addr += pitch;
+	}
+	DRAWOFF;
+
+	if (psd->Update)
+		psd->Update(psd, x1, y1, x2-x1+1, y2-y1+1);
+}
+
 static SUBDRIVER fblinear24_none = {
 	linear24_drawpixel,
 	linear24_readpixel,
 	linear24_drawhorzline,
 	linear24_drawvertline,
-	gen_fillrect,
+	linear24_fillrect,
 	NULL,			/* no fallback Blit - uses BlitFrameBlit*/
 	frameblit_24bpp,
 	frameblit_stretch_24bpp,
@@ -86,6 +86,7 @@ GdCreatePixmap(PSD rootpsd, MWCOORD width, MWCOORD height, int format, void *pix
 		pixtype = MWPF_TRUECOLOR565;
 		break;
 	case MWIF_RGB888:
+	case MWIF_BGR888:
 		bpp = 24;
 		data_format = format;
 		pixtype = MWPF_TRUECOLOR888;
@@ -4,6 +4,11 @@
  * Microwindows Framebuffer Emulator screen driver
  * Set SCREEN=FBE in config.
  * Also useful as template when developing new screen drivers
+ *
+ * When the fbe viewer has created its damage ring, the aggregate update
+ * region is written to the ring once per select loop and the viewer is
+ * woken through the damage fifo, so it repaints only changed areas
+ * instead of polling the framebuffer.
  */
 
 #include <stdio.h>
@@ -23,8 +28,10 @@
 #define TESTDRIVER	0
 
 #if !TESTDRIVER
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 #if !defined(SCREEN_DEPTH) && (MWPIXEL_FORMAT == MWPF_PALETTE)
@@ -33,6 +40,18 @@
 #endif
 
 static int fb = -1;						/* Framebuffer file handle*/
+#if !TESTDRIVER
+static MWFBEDAMAGE *damage;				/* viewer damage ring or NULL*/
+static int damagefifo = -1;				/* viewer wakeup fifo*/
+
+/* wake viewer, a full fifo already has a wakeup pending*/
+static void
+fbe_wake(void)
+{
+	if (write(damagefifo, "", 1) < 0 && errno != EAGAIN)
+		DPRINTF("fbe: viewer wakeup failed: %m\n");
+}
+#endif
 
 static PSD  fbe_open(PSD psd);
 static void fbe_close(PSD psd);
@@ -51,12 +70,44 @@ SCREENDEVICE scrdev = {
 	gen_mapmemgc,
 	gen_freememgc,
 	gen_setportrait,
-#if TESTDRIVER
 	fbe_update,
 	fbe_preselect
-#endif
 };
 
+#if !TESTDRIVER
+/* attach to the fbe viewer damage ring, returns nonzero if found*/
+static int
+fbe_opendamage(void)
+{
+	struct stat st;
+	int fd;
+
+	if ((fd = open(MW_PATH_FBE_DAMAGE, O_RDWR)) < 0)
+		return 0;
+	if (fstat(fd, &st) < 0 || st.st_size < sizeof(MWFBEDAMAGE)) {
+		close(fd);
+		return 0;
+	}
+	damage = mmap(NULL, sizeof(MWFBEDAMAGE), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (damage == MAP_FAILED || damage->magic != MWFBE_DAMAGE_MAGIC)
+		goto fail;
+
+	/* opened read/write so writes never block or raise SIGPIPE without a viewer*/
+	if ((damagefifo = open(MW_PATH_FBE_DAMAGEFIFO, O_RDWR | O_NONBLOCK)) < 0)
+		goto fail;
+
+	damage->server = getpid();
+	return 1;
+
+fail:
+	if (damage != MAP_FAILED)
+		munmap(damage, sizeof(MWFBEDAMAGE));
+	damage = NULL;
+	return 0;
+}
+#endif
+
 /* open framebuffer mmap'd by FBE*/
 static PSD
 fbe_open(PSD psd)
@@ -99,6 +150,14 @@ fbe_open(PSD psd)
 			close(fb);
 			return NULL;
 		}
+
+		/* report damage to viewer, otherwise it polls the framebuffer*/
+		if (fbe_opendamage())
+			psd->flags |= PSF_DELAYUPDATE;
+		else {
+			psd->Update = NULL;
+			psd->PreSelect = NULL;
+		}
 	}
 	else {
 		EPRINTF("Error opening %s\n", env);
@@ -117,6 +176,15 @@ fbe_close(PSD psd)
 	if (fb >= 0)
 		close(fb);
 	fb = -1;
+	if (damage) {
+		/* wake viewer to notice driver has gone*/
+		damage->server = 0;
+		fbe_wake();
+		close(damagefifo);
+		munmap(damage, sizeof(MWFBEDAMAGE));
+		damage = NULL;
+		damagefifo = -1;
+	}
 #endif
 	if ((psd->flags & PSF_ADDRMALLOC))
 		free (psd->addr);
@@ -128,16 +196,56 @@ fbe_setpalette(PSD psd,int first,int count,MWPALENTRY *pal)
 {
 }
 
-#if TESTDRIVER
+#if !TESTDRIVER
+/* add rectangle to viewer damage ring*/
+static void
+fbe_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	MWFBERECT *rp;
+	uint32_t head = damage->head;
+
+	if (head - damage->tail >= MWFBE_DAMAGE_RECTS) {
+		damage->overflow = 1;
+		return;
+	}
+	rp = &damage->rect[head & (MWFBE_DAMAGE_RECTS - 1)];
+	rp->x = x;
+	rp->y = y;
+	rp->width = width;
+	rp->height = height;
+
+	/* rectangle must be visible before head is advanced*/
+#if defined(__GNUC__)
+	__sync_synchronize();
+#endif
+	damage->head = head + 1;
+}
+
+/* called before select(), returns # pending events*/
+static int
+fbe_preselect(PSD psd)
+{
+	/* send aggregate update region to viewer and wake it*/
+	if (GdFlushUpdateRegion(psd, fbe_draw) > 0)
+		fbe_wake();
+	return 0;
+}
+
+/* called from framebuffer drivers with bounding rect of updated framebuffer region*/
+static void
+fbe_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	/* delay until preselect so the viewer repaints each area once per loop*/
+	GdAddUpdateRect(psd, x, y, width, height);
+}
+
+#else /* TESTDRIVER*/
 /*
  * The following routines are not required for FBE framebuffer, but
  * may be useful when developing a new screen driver.
  * SAMPLE UNWORKING CODE, requires dstpixels and dstpitch initialization below.
  */
 
-/* bounding rectangle for aggregrate screen update*/
-static MWCOORD upminX, upminY, upmaxX, upmaxY;
-
 /* update graphics lib from framebuffer*/
 static void
 fbe_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
@@ -147,22 +255,16 @@ fbe_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 
 	/* assumes destination pixels in same format * as MWPIXEL_FORMAT set in config!*/
 	if (dstpixels)
-		copy_framebuffer(psd, upminX, upminY, upmaxX-upminX+1, upmaxY-upminY+1,
-			dstpixels, dstpitch);
+		copy_framebuffer(psd, x, y, width, height, dstpixels, dstpitch);
 }
 
 /* called before select(), returns # pending events*/
 static int
 fbe_preselect(PSD psd)
 {
-	/* perform single blit update of aggregate update region*/
-	if ((psd->flags & PSF_DELAYUPDATE) && (upmaxX >= 0 || upmaxY >= 0)) {
-		fbe_draw(psd, upminX, upminY, upmaxX-upminX+1, upmaxY-upminY+1);
-
-		/* reset update region*/
-		upminX = upminY = MAX_MWCOORD;
-		upmaxX = upmaxY = MIN_MWCOORD;
-	}
+	/* blit each rectangle of aggregate update region*/
+	if ((psd->flags & PSF_DELAYUPDATE))
+		GdFlushUpdateRegion(psd, fbe_draw);
 
 	/* return nonzero if subsystem events available and driver uses PSF_CANTBLOCK*/
 	return 0;
@@ -173,13 +275,9 @@ static void
 fbe_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 {
 	/* window moves require delaying updates until preselect for speed*/
-	if ((psd->flags & PSF_DELAYUPDATE)) {
-			/* calc aggregate update rectangle*/
-			upminX = MWMIN(x, upminX);
-			upminY = MWMIN(y, upminY);
-			upmaxX = MWMAX(upmaxX, x+width-1);
-			upmaxY = MWMAX(upmaxY, y+height-1);
-	} else
+	if ((psd->flags & PSF_DELAYUPDATE))
+		GdAddUpdateRect(psd, x, y, width, height);
+	else
 		fbe_draw(psd, x, y, width, height);
 }
 #endif /* TESTDRIVER*/
@@ -35,8 +35,6 @@ SCREENDEVICE	scrdev = {
 	sdl_preselect
 };
 
-static MWCOORD upminX, upminY, upmaxX, upmaxY;	/* sdl_preselect and sdl_update*/
-
 static SDL_Window *sdlWindow;
 static SDL_Renderer *sdlRenderer;
 static SDL_Texture *sdlTexture;
@@ -194,6 +192,31 @@ sdl_setpalette(PSD psd,int first,int count,MWPALENTRY *pal)
 {
 }
 
+/* copy a rectangle of the Microwindows framebuffer into the SDL texture*/
+static void
+sdl_texture(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	/* set region to update*/
+	SDL_Rect r;
+	r.x = x;
+	r.y = y;
+	r.w = width;
+	r.h = height;
+
+	unsigned char *pixels = psd->addr + y * psd->pitch + x * (psd->bpp >> 3);
+	SDL_UpdateTexture(sdlTexture, &r, pixels, psd->pitch);
+}
+
+/* copy texture to display*/
+static void
+sdl_present(void)
+{
+	SDL_SetRenderDrawColor(sdlRenderer, 0x00, 0x00, 0x00, 0x00);
+	SDL_RenderClear(sdlRenderer);
+	SDL_RenderCopy(sdlRenderer, sdlTexture, NULL, NULL);
+	SDL_RenderPresent(sdlRenderer);
+}
+
 /* update SDL from Microwindows framebuffer*/
 static void
 sdl_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
@@ -212,21 +235,8 @@ sdl_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 		SDL_UnlockSurface(screen);
 	SDL_UpdateWindowSurface(sdlWindow);
 #else
-	/* set region to update*/
-	SDL_Rect r;
-	r.x = x;
-	r.y = y;
-	r.w = width;
-	r.h = height;
-
-	unsigned char *pixels = psd->addr + y * psd->pitch + x * (psd->bpp >> 3);
-	SDL_UpdateTexture(sdlTexture, &r, pixels, psd->pitch);
-
-	/* copy texture to display*/
-	SDL_SetRenderDrawColor(sdlRenderer, 0x00, 0x00, 0x00, 0x00);
-	SDL_RenderClear(sdlRenderer);
-	SDL_RenderCopy(sdlRenderer, sdlTexture, NULL, NULL);
-	SDL_RenderPresent(sdlRenderer);
+	sdl_texture(psd, x, y, width, height);
+	sdl_present();
 #endif
 }
 
@@ -234,14 +244,9 @@ sdl_draw(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 static int
 sdl_preselect(PSD psd)
 {
-	/* perform single blit update of aggregate update region to SDL server*/
-	if ((psd->flags & PSF_DELAYUPDATE) && (upmaxX >= 0 || upmaxY >= 0)) {
-		sdl_draw(psd, upminX, upminY, upmaxX-upminX+1, upmaxY-upminY+1);
-
-		/* reset update region*/
-		upminX = upminY = MAX_MWCOORD;
-		upmaxX = upmaxY = MIN_MWCOORD;
-	}
+	/* update texture from each damaged rectangle, then present once*/
+	if ((psd->flags & PSF_DELAYUPDATE) && GdFlushUpdateRegion(psd, sdl_texture) > 0)
+		sdl_present();
 
 	/* return nonzero if SDL event available*/
 	return sdl_pollevents();
@@ -251,12 +256,8 @@ static void
 sdl_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 {
 	/* window moves require delaying updates until preselect for speed*/
-	if ((psd->flags & PSF_DELAYUPDATE)) {
-			/* calc aggregate update rectangle*/
-			upminX = MWMIN(x, upminX);
-			upminY = MWMIN(y, upminY);
-			upmaxX = MWMAX(upmaxX, x+width-1);
-			upmaxY = MWMAX(upmaxY, y+height-1);
-	} else
+	if ((psd->flags & PSF_DELAYUPDATE))
+		GdAddUpdateRect(psd, x, y, width, height);
+	else
 		sdl_draw(psd, x, y, width, height);
 }
@@ -15,8 +15,14 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 //#include <X11/extensions/xf86dga.h>
+#if HAVE_MITSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
 #include <assert.h>
 #include "device.h"
+#include "swap.h"
 #include "fb.h"
 #include "genmem.h"
 #include "genfont.h"
@@ -81,7 +87,14 @@ static int x11_colormap_installed = 0;
 static XColor x11_palette[256];
 static int x11_pal_max = 0;
 
-static MWCOORD upminX, upminY, upmaxX, upmaxY;
+#if HAVE_MITSHM
+static XShmSegmentInfo x11_shminfo;
+static XImage *x11_shmimg;	/* persistent screen sized shared memory image*/
+static int x11_shm_tried;	/* nonzero once MIT-SHM setup attempted*/
+static int x11_shm_error;	/* set by error handler during XShmAttach*/
+static void x11_shm_close(void);
+#endif
+
 /* called from mou_x11.c*/
 void x11_handle_event(XEvent * ev);
 int x11_setup_display(void);
@@ -587,6 +600,9 @@ X11_close(PSD psd)
 	/* free framebuffer memory */
 	free(psd->addr);
 
+#if HAVE_MITSHM
+	x11_shm_close();
+#endif
 	XCloseDisplay(x11_dpy);
 }
 
@@ -627,90 +643,223 @@ X11_setpalette(PSD psd, int first, int count, MWPALENTRY * pal)
 		x11_pal_max = n;
 }
 
+#if HAVE_MITSHM
+/* catch XShmAttach failure, e.g. remote display*/
+static int
+x11_shm_errhandler(Display * dpy, XErrorEvent * ev)
+{
+	x11_shm_error = 1;
+	return 0;
+}
+
+/* create persistent shared memory XImage for screen updates, fail silently*/
 static void
-update_from_savebits(PSD psd, unsigned int destx, unsigned int desty, int w, int h)
+x11_shm_setup(PSD psd)
 {
+	int (*oldhandler)(Display *, XErrorEvent *);
 	XImage *img;
-	unsigned int x, y;
-	char *data;
 
-	/* allocate buffer */
-	if (x11_depth >= 24)
-		data = malloc(w * 4 * h);
-	else if (x11_depth > 8)	/* 15, 16 */
-		data = malloc(w * 2 * h);
-	else			/* 1,2,4,8 */
-		data = malloc((w * x11_depth + 7) / 8 * h);
+	x11_shm_tried = 1;
+	if (!XShmQueryExtension(x11_dpy))
+		return;
 
-	/* copy from offscreen to screen */
-	img = XCreateImage(x11_dpy, x11_vis, x11_depth, ZPixmap, 0, data, w, h, 8, 0);
+	img = XShmCreateImage(x11_dpy, x11_vis, x11_depth, ZPixmap, NULL, &x11_shminfo,
+		psd->xres, psd->yres);
+	if (!img)
+		return;
 
-	/* Use optimized loops for most common framebuffer modes */
+	x11_shminfo.shmid = shmget(IPC_PRIVATE, img->bytes_per_line * img->height, IPC_CREAT|0600);
+	if (x11_shminfo.shmid < 0) {
+		XDestroyImage(img);
+		return;
+	}
+	x11_shminfo.shmaddr = img->data = shmat(x11_shminfo.shmid, NULL, 0);
+	x11_shminfo.readOnly = False;
+	if (x11_shminfo.shmaddr == (char *)-1) {
+		shmctl(x11_shminfo.shmid, IPC_RMID, NULL);
+		XDestroyImage(img);
+		return;
+	}
 
-#if MWPIXEL_FORMAT == MWPF_TRUECOLOR332
-	{
-		unsigned char *addr = psd->addr + desty * psd->pitch + destx;
-		for (y = 0; y < h; y++) {
-			for (x = 0; x < w; x++) {
-				MWPIXELVAL c = addr[x];
-				unsigned long pixel = PIXELVAL_to_pixel(c);
-				XPutPixel(img, x, y, pixel);
-			}
-			addr += psd->pitch;
-		}
+	/* attach synchronously so a failure can be detected*/
+	x11_shm_error = 0;
+	oldhandler = XSetErrorHandler(x11_shm_errhandler);
+	XShmAttach(x11_dpy, &x11_shminfo);
+	XSync(x11_dpy, False);
+	XSetErrorHandler(oldhandler);
+
+	/* segment is freed automatically after last detach*/
+	shmctl(x11_shminfo.shmid, IPC_RMID, NULL);
+
+	if (x11_shm_error) {
+		shmdt(x11_shminfo.shmaddr);
+		img->data = NULL;
+		XDestroyImage(img);
+		DPRINTF("X11: MIT-SHM attach failed, using XPutImage\n");
+		return;
+	}
+	x11_shmimg = img;
+}
+
+static void
+x11_shm_close(void)
+{
+	if (x11_shmimg) {
+		XShmDetach(x11_dpy, &x11_shminfo);
+		shmdt(x11_shminfo.shmaddr);
+		x11_shmimg->data = NULL;
+		XDestroyImage(x11_shmimg);
+		x11_shmimg = NULL;
+	}
+}
+#endif /* HAVE_MITSHM*/
+
+/* framebuffer bytes per pixel and pixel fetch for current MWPIXEL_FORMAT*/
+#if (MWPIXEL_FORMAT == MWPF_TRUECOLOR565) || (MWPIXEL_FORMAT == MWPF_TRUECOLOR555)
+#define FB_BYTES		2
+#define FB_PIXEL(addr,x)	(((ADDR16)(addr))[x])
+#elif MWPIXEL_FORMAT == MWPF_TRUECOLORRGB
+#define FB_BYTES		3
+#define FB_PIXEL(addr,x)	RGB2PIXEL888((addr)[(x)*3+2], (addr)[(x)*3+1], (addr)[(x)*3])
+#elif (MWPIXEL_FORMAT == MWPF_TRUECOLORARGB) || (MWPIXEL_FORMAT == MWPF_TRUECOLORABGR)
+#define FB_BYTES		4
+#define FB_PIXEL(addr,x)	(((ADDR32)(addr))[x])
+#else /* MWPF_TRUECOLOR332, MWPF_PALETTE*/
+#define FB_BYTES		1
+#define FB_PIXEL(addr,x)	((addr)[x])
+#endif
+
+/* XImage row conversion methods*/
+#define ROW_PUTPIXEL	0	/* XPutPixel per pixel, any visual*/
+#define ROW_COPY		1	/* visual matches framebuffer, memcpy rows*/
+#define ROW_32BPP		2	/* store converted pixels as 32 bit words*/
+#define ROW_16BPP		3	/* store converted pixels as 16 bit words*/
+
+/* return fastest conversion method from framebuffer to XImage layout*/
+static int
+x11_rowmode(PSD psd, XImage *img)
+{
+	int native;
+
+	if (x11_is_palette)
+		return ROW_PUTPIXEL;
+
+#if MW_CPU_BIG_ENDIAN
+	native = (img->byte_order == MSBFirst);
+#else
+	native = (img->byte_order == LSBFirst);
+#endif
+	if (!native)
+		return ROW_PUTPIXEL;
+
+	if (img->bits_per_pixel == psd->bpp) {
+#if (MWPIXEL_FORMAT == MWPF_TRUECOLORARGB) || (MWPIXEL_FORMAT == MWPF_TRUECOLORRGB)
+		if (x11_r_mask == 0xff0000 && x11_g_mask == 0x00ff00 && x11_b_mask == 0x0000ff)
+			return ROW_COPY;
+#elif MWPIXEL_FORMAT == MWPF_TRUECOLORABGR
+		if (x11_r_mask == 0x0000ff && x11_g_mask == 0x00ff00 && x11_b_mask == 0xff0000)
+			return ROW_COPY;
+#elif MWPIXEL_FORMAT == MWPF_TRUECOLOR565
+		if (x11_r_mask == 0xf800 && x11_g_mask == 0x07e0 && x11_b_mask == 0x001f)
+			return ROW_COPY;
+#elif MWPIXEL_FORMAT == MWPF_TRUECOLOR555
+		if (x11_r_mask == 0x7c00 && x11_g_mask == 0x03e0 && x11_b_mask == 0x001f)
+			return ROW_COPY;
+#endif
 	}
-#elif (MWPIXEL_FORMAT == MWPF_TRUECOLOR565) || (MWPIXEL_FORMAT == MWPF_TRUECOLOR555)
-	{
-		unsigned char *addr = psd->addr + desty * psd->pitch + (destx << 1);
+	if (img->bits_per_pixel == 32)
+		return ROW_32BPP;
+	if (img->bits_per_pixel == 16)
+		return ROW_16BPP;
+	return ROW_PUTPIXEL;
+}
+
+/* copy framebuffer area into XImage at imgx, imgy*/
+static void
+x11_convert(PSD psd, XImage *img, int imgx, int imgy, MWCOORD destx, MWCOORD desty,
+	MWCOORD w, MWCOORD h)
+{
+	unsigned char *addr = psd->addr + desty * psd->pitch + destx * FB_BYTES;
+	int x, y;
+
+	switch (x11_rowmode(psd, img)) {
+	case ROW_COPY:
 		for (y = 0; y < h; y++) {
-			for (x = 0; x < w; x++) {
-				MWPIXELVAL c = ((ADDR16)addr)[x];
-				unsigned long pixel = PIXELVAL_to_pixel(c);
-				XPutPixel(img, x, y, pixel);
-			}
+			memcpy(img->data + (imgy + y) * img->bytes_per_line + imgx * FB_BYTES, addr, w * FB_BYTES);
 			addr += psd->pitch;
 		}
-	}
-#elif MWPIXEL_FORMAT == MWPF_TRUECOLORRGB
-	{
-		unsigned char *addr = psd->addr + desty * psd->pitch + destx * 3;
-		unsigned int extra = psd->pitch - w * 3;
+		break;
+
+	case ROW_32BPP:
 		for (y = 0; y < h; y++) {
+			uint32_t *dst = (uint32_t *)(img->data + (imgy + y) * img->bytes_per_line) + imgx;
 			for (x = 0; x < w; x++) {
-				MWPIXELVAL c = RGB2PIXEL888(addr[2], addr[1], addr[0]);
-				unsigned long pixel = PIXELVAL_to_pixel(c);
-				XPutPixel(img, x, y, pixel);
-				addr += 3;
+				MWPIXELVAL c = FB_PIXEL(addr, x);
+				dst[x] = PIXELVAL_to_pixel(c);
 			}
-			addr += extra;
+			addr += psd->pitch;
 		}
-	}
-#elif (MWPIXEL_FORMAT == MWPF_TRUECOLORARGB) || (MWPIXEL_FORMAT == MWPF_TRUECOLORABGR)
-	{
-		unsigned char *addr = psd->addr + desty * psd->pitch + (destx << 2);
+		break;
+
+	case ROW_16BPP:
 		for (y = 0; y < h; y++) {
+			unsigned short *dst = (unsigned short *)(img->data + (imgy + y) * img->bytes_per_line) + imgx;
 			for (x = 0; x < w; x++) {
-				MWPIXELVAL c = ((ADDR32)addr)[x];
-				unsigned long pixel = PIXELVAL_to_pixel(c);
-				XPutPixel(img, x, y, pixel);
+				MWPIXELVAL c = FB_PIXEL(addr, x);
+				dst[x] = PIXELVAL_to_pixel(c);
 			}
 			addr += psd->pitch;
 		}
-	}
-#else /* MWPF_PALETTE*/
-	{
-		unsigned char *addr = psd->addr + desty * psd->pitch + destx;
+		break;
+
+	default:
 		for (y = 0; y < h; y++) {
 			for (x = 0; x < w; x++) {
-				MWPIXELVAL c = addr[x];
+				MWPIXELVAL c = FB_PIXEL(addr, x);
 				unsigned long pixel = PIXELVAL_to_pixel(c);
-				XPutPixel(img, x, y, pixel);
+				XPutPixel(img, imgx + x, imgy + y, pixel);
 			}
 			addr += psd->pitch;
 		}
+		break;
+	}
+}
+
+static void
+update_from_savebits(PSD psd, MWCOORD destx, MWCOORD desty, MWCOORD w, MWCOORD h)
+{
+	XImage *img;
+	char *data;
+
+#if HAVE_MITSHM
+	if (!x11_shm_tried)
+		x11_shm_setup(psd);
+
+	/*
+	 * Convert into the persistent shared image at the same position and
+	 * let the server read it directly. No sync is required before the next
+	 * conversion, as any pixels overwritten early are newer and will be
+	 * sent again by a subsequent update.
+	 */
+	if (x11_shmimg && destx + w <= x11_shmimg->width && desty + h <= x11_shmimg->height) {
+		x11_convert(psd, x11_shmimg, destx, desty, destx, desty, w, h);
+		XShmPutImage(x11_dpy, x11_win, x11_gc, x11_shmimg, destx, desty, destx, desty, w, h, False);
+		return;
 	}
 #endif
 
+	/* allocate buffer */
+	if (x11_depth >= 24)
+		data = malloc(w * 4 * h);
+	else if (x11_depth > 8)	/* 15, 16 */
+		data = malloc(w * 2 * h);
+	else			/* 1,2,4,8 */
+		data = malloc((w * x11_depth + 7) / 8 * h);
+
+	/* copy from offscreen to screen */
+	img = XCreateImage(x11_dpy, x11_vis, x11_depth, ZPixmap, 0, data, w, h, 8, 0);
+	x11_convert(psd, img, 0, 0, destx, desty, w, h);
+
 	XPutImage(x11_dpy, x11_win, x11_gc, img, 0, 0, destx, desty, w, h);
 	XDestroyImage(img);
 }
@@ -719,14 +868,9 @@ update_from_savebits(PSD psd, unsigned int destx, unsigned int desty, int w, int
 static int
 X11_preselect(PSD psd)
 {
-	/* perform single blit update of aggregate update region to X11 server*/
-	if ((psd->flags & PSF_DELAYUPDATE) && (upmaxX >= 0 || upmaxY >= 0)) {
-		update_from_savebits(psd, upminX, upminY, upmaxX-upminX+1, upmaxY-upminY+1);
-
-		/* reset update region*/
-		upminX = upminY = MAX_MWCOORD;
-		upmaxX = upmaxY = MIN_MWCOORD;
-	}
+	/* blit each rectangle of the aggregate update region to X11 server*/
+	if ((psd->flags & PSF_DELAYUPDATE))
+		GdFlushUpdateRegion(psd, update_from_savebits);
 
 	XFlush(x11_dpy);
 	return XPending(x11_dpy);
@@ -736,12 +880,8 @@ static void
 X11_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
 {
 	/* window moves require delaying updates until preselect for speed*/
-	if ((psd->flags & PSF_DELAYUPDATE)) {
-			/* calc aggregate update rectangle*/
-			upminX = MWMIN(x, upminX);
-			upminY = MWMIN(y, upminY);
-			upmaxX = MWMAX(upmaxX, x+width-1);
-			upmaxY = MWMAX(upmaxY, y+height-1);
-	} else
+	if ((psd->flags & PSF_DELAYUPDATE))
+		GdAddUpdateRect(psd, x, y, width, height);
+	else
 		update_from_savebits(psd, x, y, width, height);
 }
@@ -62,6 +62,9 @@ static void	 (*_FillRect)(PSD psd,MWCOORD x1,MWCOORD y1,MWCOORD x2,
                 MWCOORD y2,MWPIXELVAL c);
 static void	 (*_Blit)(PSD destpsd, MWCOORD destx, MWCOORD desty, MWCOORD w,
                 MWCOORD h,PSD srcpsd,MWCOORD srcx,MWCOORD srcy,long op);
+static void	 (*_Update)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
+                MWCOORD height);
+static int	 (*_PreSelect)(PSD psd);
 
 static void UndrawCursor(void)
 {
@@ -152,6 +155,36 @@ static void stubStretchBlitEx(PSD dstpsd, PSD srcpsd, MWCOORD dest_x_start, int
 }
 #endif
 
+/* add blit updates to the engine damage region, marked modified in stubPreSelect*/
+static void stubUpdate(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+        GdAddUpdateRect(psd, x, y, width, height);
+
+        /* delayed updates are flushed to the screen driver by its PreSelect*/
+        if ( _Update && !(psd->flags & PSF_DELAYUPDATE) )
+                _Update(psd, x, y, width, height);
+}
+
+static int stubPreSelect(PSD psd)
+{
+        MWCLIPREGION *rgn = GdGetUpdateRegion();
+        MWRECT *rc;
+        int n, ret = 0;
+
+        /* mark each damaged rectangle individually*/
+        if ( rgn ) {
+                for ( n = rgn->numRects, rc = rgn->rects; --n >= 0; rc++ )
+                        MarkRect( rc->left, rc->top, rc->right - 1, rc->bottom - 1 );
+        }
+
+        if ( _PreSelect )
+                ret = _PreSelect(psd);
+
+        /* empty region even if screen driver PreSelect doesn't flush it*/
+        GdFlushUpdateRegion(psd, NULL);
+        return ret;
+}
+
 static void clientgone(rfbClientPtr cl)
 {
         clients_connected--;
@@ -558,6 +591,8 @@ int GdOpenVNC( PSD psd, int argc, char *argv[] )
    _DrawHorzLine = psd->DrawHorzLine;
    _DrawVertLine = psd->DrawVertLine;
    _FillRect = psd->FillRect;
+   _Update = psd->Update;
+   _PreSelect = psd->PreSelect;
 //   _Blit = psd->Blit;
 //   _DrawArea = psd->DrawArea;
 //   _StretchBlitEx = psd->StretchBlitEx;
@@ -569,6 +604,8 @@ int GdOpenVNC( PSD psd, int argc, char *argv[] )
    psd->DrawHorzLine = stubDrawHorzLine;
    psd->DrawVertLine = stubDrawVertLine;
    psd->FillRect = stubFillRect;
+   psd->Update = stubUpdate;
+   psd->PreSelect = stubPreSelect;
 //   psd->Blit = stubBlit;
 //   psd->DrawArea = stubDrawArea;
 //   psd->StretchBlit = stubStretchBlit;
@@ -12,6 +12,7 @@
  * overwriting checks, but instead draw directly to the
  * data_out memory buffer specified in the passed BLITPARMS struct.
  */
+#include <stdlib.h>
 #include "device.h"
 #include "convblit.h"
 #include "../drivers/fb.h"		// DRAWON macro
@@ -39,10 +40,14 @@
  * and will be optimized out.  Thus, the inner loops run very fast!
  * This is also true for the copy vs srcover.  When COPY is specified,
  * no blending code will be included.
+ *
+ * When rowblit is non-NULL and no rotation is required, each line is
+ * handed to that SIMD row kernel (convblit_simd.c) instead, which
+ * produces pixel-identical results to the inline loop below.
  */
 static inline void ALWAYS_INLINE convblit_8888(PSD psd, PMWBLITPARMS gc, int mode,
 	int SSZ, int SR, int SG, int SB, int SA,
-	int DSZ, int DR, int DG, int DB, int DA, int PORTRAIT)
+	int DSZ, int DR, int DG, int DB, int DA, int PORTRAIT, MWROWBLITFUNC rowblit)
 {
 	unsigned char *src, *dst;
 	int dsz, dst_pitch;
@@ -95,6 +100,16 @@ static inline void ALWAYS_INLINE convblit_8888(PSD psd, PMWBLITPARMS gc, int mod
 
 	DRAWON;
 	height = gc->height;
+	if (rowblit && PORTRAIT == NONE)
+	{
+		while (--height >= 0)
+		{
+			rowblit(dst, src, gc->width);
+			src += src_pitch;
+			dst += dst_pitch;
+		}
+		height = 0;
+	}
 	while (--height >= 0)
 	{
 		register unsigned char *d = dst;
@@ -188,19 +203,22 @@ static inline void ALWAYS_INLINE convblit_8888(PSD psd, PMWBLITPARMS gc, int mod
 /* Conversion blit srcover 32bpp RGBA image to 32bpp RGBA image*/
 void convblit_srcover_rgba8888_rgba8888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 4, R,G,B,A, psd->portrait);
+	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 4, R,G,B,A, psd->portrait,
+		convblit_rowfuncs.srcover_rgba8888_rgba8888);
 }
 
 /* Conversion blit copy 32bpp RGBA image to 32bpp RGBA image*/
 void convblit_copy_rgba8888_rgba8888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 4, R,G,B,A, psd->portrait);
+	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 4, R,G,B,A, psd->portrait,
+		convblit_rowfuncs.copy_32bpp);
 }
 
 /* Conversion blit copy 24bpp RGB image to 32bpp RGBA image*/
 void convblit_copy_rgb888_rgba8888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 4, R,G,B,A, psd->portrait);
+	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 4, R,G,B,A, psd->portrait,
+		convblit_rowfuncs.copy_rgb888_rgba8888);
 }
 
 /* MWPF_TRUECOLOR8888*/
@@ -208,26 +226,30 @@ void convblit_copy_rgb888_rgba8888(PSD psd, PMWBLITPARMS gc)
 /* Conversion blit srcover 32bpp RGBA image to 32bpp BGRA image*/
 void convblit_srcover_rgba8888_bgra8888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 4, B,G,R,A, psd->portrait);
+	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 4, B,G,R,A, psd->portrait,
+		convblit_rowfuncs.srcover_rgba8888_bgra8888);
 }
 
 /* Conversion blit copy 32bpp RGBA image to 32bpp BGRA image*/
 void convblit_copy_rgba8888_bgra8888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 4, B,G,R,A, psd->portrait);
+	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 4, B,G,R,A, psd->portrait,
+		convblit_rowfuncs.copy_rgba8888_bgra8888);
 }
 
 /* Conversion blit copy 24bpp RGB image to 32bpp BGRA image*/
 void convblit_copy_rgb888_bgra8888(PSD psd, PMWBLITPARMS gc)
 {
 	// -1 forces 255 alpha in destination
-	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 4, B,G,R,A, psd->portrait);
+	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 4, B,G,R,A, psd->portrait,
+		convblit_rowfuncs.copy_rgb888_bgra8888);
 }
 
 /* Copy 32bpp XXXX image to 32bpp XXXX image*/
 void convblit_copy_8888_8888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 4, R,G,B,A, psd->portrait);
+	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 4, R,G,B,A, psd->portrait,
+		convblit_rowfuncs.copy_32bpp);
 }
 
 /*---------- 24bpp BGR output ----------*/
@@ -235,31 +257,32 @@ void convblit_copy_8888_8888(PSD psd, PMWBLITPARMS gc)
 /* Conversion blit srcover 32bpp RGBA image to 24bpp BGR image*/
 void convblit_srcover_rgba8888_bgr888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 3, B,G,R,-1, psd->portrait);
+	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 3, B,G,R,-1, psd->portrait, NULL);
 }
 
 /* Conversion blit copy 32bpp RGBA image to 24bpp BGR image*/
 void convblit_copy_rgba8888_bgr888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 3, B,G,R,-1, psd->portrait);
+	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 3, B,G,R,-1, psd->portrait, NULL);
 }
 
 /* Conversion blit copy 24bpp RGB image to 24bpp BGR image*/
 void convblit_copy_rgb888_bgr888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 3, B,G,R,-1, psd->portrait);
+	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 3, B,G,R,-1, psd->portrait, NULL);
 }
 
 /* Copy 24bpp XXX image to 24bpp XXX image*/
 void convblit_copy_888_888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 3, R,G,B,-1, psd->portrait);
+	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 3, R,G,B,-1, psd->portrait,
+		convblit_rowfuncs.copy_24bpp);
 }
 
 /* Copy 32bpp BGRA image to 24bpp BGR image (GdArea MWPF_PIXELVAL)*/
 void convblit_copy_bgra8888_bgr888(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 4, B,G,R,A, 3, B,G,R,-1, psd->portrait);
+	convblit_8888(psd, gc, COPY, 4, B,G,R,A, 3, B,G,R,-1, psd->portrait, NULL);
 }
 
 /*---------- 16bpp BGR output ----------*/
@@ -267,23 +290,27 @@ void convblit_copy_bgra8888_bgr888(PSD psd, PMWBLITPARMS gc)
 /* Conversion blit srcover 32bpp RGBA image to 16bpp image*/
 void convblit_srcover_rgba8888_16bpp(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 2, 0,0,0,-1, psd->portrait);
+	convblit_8888(psd, gc, SRCOVER, 4, R,G,B,A, 2, 0,0,0,-1, psd->portrait,
+		convblit_rowfuncs.srcover_rgba8888_16bpp);
 }
 
 /* Conversion blit copy 32bpp RGBA image to 16bpp image*/
 void convblit_copy_rgba8888_16bpp(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 2, 0,0,0,-1, psd->portrait);
+	convblit_8888(psd, gc, COPY, 4, R,G,B,A, 2, 0,0,0,-1, psd->portrait,
+		convblit_rowfuncs.copy_rgba8888_16bpp);
 }
 
 /* Conversion blit copy 24bpp RGB image to 16bpp image*/
 void convblit_copy_rgb888_16bpp(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 2, 0,0,0,-1, psd->portrait);
+	convblit_8888(psd, gc, COPY, 3, R,G,B,-1, 2, 0,0,0,-1, psd->portrait,
+		convblit_rowfuncs.copy_rgb888_16bpp);
 }
 
 /* Copy 16bpp image to 16bpp image*/
 void convblit_copy_16bpp_16bpp(PSD psd, PMWBLITPARMS gc)
 {
-	convblit_8888(psd, gc, COPY, 2, 0,0,0,-1, 2, 0,0,0,-1, psd->portrait);
+	convblit_8888(psd, gc, COPY, 2, 0,0,0,-1, 2, 0,0,0,-1, psd->portrait,
+		convblit_rowfuncs.copy_16bpp);
 }
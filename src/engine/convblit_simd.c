@@ -0,0 +1,970 @@
+/*
+ * SIMD row kernels for the unrotated convblit_8888.c conversion blits
+ *
+ * Each kernel converts or blends one horizontal line and must produce
+ * exactly the same pixels as the inline loop in convblit_8888(), including
+ * the approximate muldiv255() rounding.  The blend is computed as
+ *
+ *	d + muldiv255(a, s - d) == ((a+1)*s + (255-a)*d) >> 8
+ *
+ * which stays within unsigned 16 bits, so 8 (SSE2/NEON) or 16 (AVX2)
+ * channels are blended per instruction.  Alpha 0 leaves the destination
+ * untouched, as in the scalar code.
+ *
+ * x86 kernels are selected at runtime by cpu feature, NEON at compile time.
+ * When no vector unit is available the kernels are left NULL and
+ * convblit_8888() runs its normal per-pixel loop.
+ *
+ * The fill kernels combine a row of the fblin16/24/32 framebuffer with a
+ * repeating pixel pattern for solid COPY, XOR, AND and OR fills.  The
+ * pattern holds whole pixels and vectors of any size, so each kernel
+ * stores vectors as far as possible then finishes with 64 bit words and
+ * bytes.  The 64 bit word versions are used on any cpu.
+ */
+#include <string.h>
+#include "device.h"
+#include "convblit.h"
+
+MWROWBLITFUNCS convblit_rowfuncs;
+
+/* straight line copies, any cpu*/
+static void
+copy_row_32bpp(unsigned char *dst, const unsigned char *src, int width)
+{
+	memcpy(dst, src, width * 4);
+}
+
+static void
+copy_row_24bpp(unsigned char *dst, const unsigned char *src, int width)
+{
+	memcpy(dst, src, width * 3);
+}
+
+static void
+copy_row_16bpp(unsigned char *dst, const unsigned char *src, int width)
+{
+	memcpy(dst, src, width * 2);
+}
+
+/* fill rops*/
+#define FILL_COPY	0
+#define FILL_XOR	1
+#define FILL_AND	2
+#define FILL_OR		3
+
+static inline uint64_t ALWAYS_INLINE
+fill_op64(uint64_t d, uint64_t s, int OP)
+{
+	switch (OP) {
+	case FILL_XOR:
+		return d ^ s;
+	case FILL_AND:
+		return d & s;
+	case FILL_OR:
+		return d | s;
+	}
+	return s;
+}
+
+/* fill len bytes using 64 bit words of a 48 byte pattern period, then bytes*/
+static inline void ALWAYS_INLINE
+fill_row_words(unsigned char *dst, const unsigned char *pat, int len, int OP)
+{
+	uint64_t w[6], d;
+	int i;
+
+	memcpy(w, pat, sizeof(w));
+	for (; len >= 48; len -= 48, dst += 48) {
+		for (i = 0; i < 6; i++) {
+			if (OP == FILL_COPY)
+				d = w[i];
+			else {
+				memcpy(&d, dst + i*8, 8);
+				d = fill_op64(d, w[i], OP);
+			}
+			memcpy(dst + i*8, &d, 8);
+		}
+	}
+	for (i = 0; len >= 8; len -= 8, dst += 8, i++) {
+		if (OP == FILL_COPY)
+			d = w[i];
+		else {
+			memcpy(&d, dst, 8);
+			d = fill_op64(d, w[i], OP);
+		}
+		memcpy(dst, &d, 8);
+	}
+	for (i *= 8; len > 0; --len, ++dst, ++i)
+		*dst = (unsigned char)fill_op64(*dst, pat[i], OP);
+}
+
+static void
+fill_row_copy(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_words(dst, pat, len, FILL_COPY);
+}
+
+static void
+fill_row_xor(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_words(dst, pat, len, FILL_XOR);
+}
+
+static void
+fill_row_and(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_words(dst, pat, len, FILL_AND);
+}
+
+static void
+fill_row_or(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_words(dst, pat, len, FILL_OR);
+}
+
+/* set portable kernels, vector kernels replace them in convblit_simd_init*/
+static void
+fill_init(void)
+{
+	convblit_rowfuncs.fill_copy = fill_row_copy;
+	convblit_rowfuncs.fill_xor = fill_row_xor;
+	convblit_rowfuncs.fill_and = fill_row_and;
+	convblit_rowfuncs.fill_or = fill_row_or;
+}
+
+/**
+ * Select the fill kernel for a raster op and build its repeating pixel pattern.
+ *
+ * @param op MWROP_ raster op.
+ * @param c Pixel value.
+ * @param bytesperpixel 2, 3 or 4.
+ * @param pat Returned pattern of MWFILLPATSIZE bytes in framebuffer byte order.
+ * @return Fill kernel, or NULL if the op has none and must be drawn per pixel.
+ */
+MWROWFILLFUNC
+convblit_fill_setup(int op, MWPIXELVAL c, int bytesperpixel, unsigned char *pat)
+{
+	MWROWFILLFUNC fill;
+	int i;
+
+	switch (op) {
+	case MWROP_COPY:
+	case MWROP_SRC_OVER:		/* same as copy in APPLYOP*/
+	case MWROP_SRC_IN:
+	case MWROP_SRC_ATOP:
+		fill = convblit_rowfuncs.fill_copy;
+		break;
+	case MWROP_CLEAR:
+	case MWROP_SRC_OUT:
+	case MWROP_DST_OUT:
+		c = 0;
+		fill = convblit_rowfuncs.fill_copy;
+		break;
+	case MWROP_SET:
+		c = ~0;
+		fill = convblit_rowfuncs.fill_copy;
+		break;
+	case MWROP_XOR_FGBG:
+	case MWROP_PORTERDUFF_XOR:
+		/* 24bpp APPLYOP xors each byte with the low background byte*/
+		if (bytesperpixel == 3)
+			return NULL;
+		c ^= gr_background;
+		/* fall through*/
+	case MWROP_XOR:
+		fill = convblit_rowfuncs.fill_xor;
+		break;
+	case MWROP_AND:
+		fill = convblit_rowfuncs.fill_and;
+		break;
+	case MWROP_OR:
+		fill = convblit_rowfuncs.fill_or;
+		break;
+	default:
+		return NULL;
+	}
+
+	switch (bytesperpixel) {
+	case 2:
+		{
+			uint16_t v = (uint16_t)c;
+			for (i = 0; i < MWFILLPATSIZE; i += 2)
+				memcpy(pat + i, &v, 2);
+		}
+		break;
+	case 3:
+		for (i = 0; i < MWFILLPATSIZE; i += 3) {
+			pat[i] = PIXEL888BLUE(c);
+			pat[i+1] = PIXEL888GREEN(c);
+			pat[i+2] = PIXEL888RED(c);
+		}
+		break;
+	case 4:
+		{
+			uint32_t v = (uint32_t)c;
+			for (i = 0; i < MWFILLPATSIZE; i += 4)
+				memcpy(pat + i, &v, 4);
+		}
+		break;
+	default:
+		return NULL;
+	}
+	return fill;
+}
+
+#if MW_FEATURE_SIMD
+
+/* 16bpp vector kernels only for 565 and 555, matching RGB2PIXEL/muldiv255_16bpp*/
+#if MWPIXEL_FORMAT == MWPF_TRUECOLOR565
+#define SIMD_16BPP	1
+#define RSHIFT		11
+#define GSHIFT		5
+#define GBITS		6
+#elif MWPIXEL_FORMAT == MWPF_TRUECOLOR555
+#define SIMD_16BPP	1
+#define RSHIFT		10
+#define GSHIFT		5
+#define GBITS		5
+#else
+#define SIMD_16BPP	0
+#endif
+
+/*
+ * Scalar versions of the convblit_8888() inner loop for kernel tails.
+ * DR/DG/DB are destination byte offsets, source is always RGBA or RGB.
+ */
+static inline void ALWAYS_INLINE
+srcover_pixel_8888(unsigned char *d, const unsigned char *s, int DR, int DG, int DB)
+{
+	unsigned int alpha = s[3];
+
+	if (alpha == 255) {
+		d[3] = 255;
+		d[DR] = s[0];
+		d[DG] = s[1];
+		d[DB] = s[2];
+	} else if (alpha != 0) {
+		d[DR] += muldiv255(alpha, s[0] - d[DR]);
+		d[DG] += muldiv255(alpha, s[1] - d[DG]);
+		d[DB] += muldiv255(alpha, s[2] - d[DB]);
+		d[3] += muldiv255(alpha, 255 - d[3]);
+	}
+}
+
+static inline void ALWAYS_INLINE
+copy_pixel_8888(unsigned char *d, const unsigned char *s, int SSZ, int DR, int DG, int DB)
+{
+	d[3] = (SSZ == 4)? s[3]: 255;
+	d[DR] = s[0];
+	d[DG] = s[1];
+	d[DB] = s[2];
+}
+
+#if SIMD_16BPP
+static inline void ALWAYS_INLINE
+srcover_pixel_16bpp(unsigned char *d, const unsigned char *s)
+{
+	unsigned int alpha = s[3];
+
+	if (alpha == 255)
+		((unsigned short *)d)[0] = RGB2PIXEL(s[0], s[1], s[2]);
+	else if (alpha != 0) {
+		unsigned short sr = RED2PIXEL(s[0]);
+		unsigned short sg = GREEN2PIXEL(s[1]);
+		unsigned short sb = BLUE2PIXEL(s[2]);
+		alpha = 255 - alpha + 1;
+		((unsigned short *)d)[0] = muldiv255_16bpp(((unsigned short *)d)[0], sr, sg, sb, alpha);
+	}
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define TARGET(isa)		__attribute__ ((target(isa)))
+
+/* blend 4 RGBA source pixels over 4 dest pixels, SWAP for BGRA dest*/
+static inline __m128i ALWAYS_INLINE TARGET("sse2")
+srcover4_sse2(__m128i s, __m128i d, int SWAP)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i one = _mm_set1_epi16(1);
+	__m128i c255 = _mm_set1_epi16(255);
+	__m128i amask = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	__m128i slo = _mm_unpacklo_epi8(s, zero);
+	__m128i shi = _mm_unpackhi_epi8(s, zero);
+	__m128i dlo = _mm_unpacklo_epi8(d, zero);
+	__m128i dhi = _mm_unpackhi_epi8(d, zero);
+	__m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, 0xFF), 0xFF);
+	__m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, 0xFF), 0xFF);
+	__m128i rlo, rhi, z;
+
+	if (SWAP) {
+		slo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+		shi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+	}
+	/* dest alpha blends towards 255*/
+	slo = _mm_or_si128(slo, amask);
+	shi = _mm_or_si128(shi, amask);
+
+	rlo = _mm_add_epi16(_mm_mullo_epi16(slo, _mm_add_epi16(alo, one)),
+		_mm_mullo_epi16(dlo, _mm_sub_epi16(c255, alo)));
+	rhi = _mm_add_epi16(_mm_mullo_epi16(shi, _mm_add_epi16(ahi, one)),
+		_mm_mullo_epi16(dhi, _mm_sub_epi16(c255, ahi)));
+	rlo = _mm_packus_epi16(_mm_srli_epi16(rlo, 8), _mm_srli_epi16(rhi, 8));
+
+	/* alpha 0 leaves dest unchanged*/
+	z = _mm_cmpeq_epi32(_mm_and_si128(s, _mm_set1_epi32((int)0xff000000)), zero);
+	return _mm_or_si128(_mm_and_si128(z, d), _mm_andnot_si128(z, rlo));
+}
+
+/* swap R and B in 4 32bpp pixels*/
+static inline __m128i ALWAYS_INLINE TARGET("sse2")
+swaprb4_sse2(__m128i s)
+{
+	__m128i mask = _mm_set1_epi32(0xff);
+
+	return _mm_or_si128(_mm_and_si128(s, _mm_set1_epi32((int)0xff00ff00)),
+		_mm_or_si128(_mm_slli_epi32(_mm_and_si128(s, mask), 16),
+			_mm_and_si128(_mm_srli_epi32(s, 16), mask)));
+}
+
+static void TARGET("sse2")
+srcover_row_rgba8888_rgba8888_sse2(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 4; width -= 4, src += 16, dst += 16) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		__m128i d = _mm_loadu_si128((__m128i *)dst);
+		_mm_storeu_si128((__m128i *)dst, srcover4_sse2(s, d, 0));
+	}
+	for (; width > 0; --width, src += 4, dst += 4)
+		srcover_pixel_8888(dst, src, 0, 1, 2);
+}
+
+static void TARGET("sse2")
+srcover_row_rgba8888_bgra8888_sse2(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 4; width -= 4, src += 16, dst += 16) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		__m128i d = _mm_loadu_si128((__m128i *)dst);
+		_mm_storeu_si128((__m128i *)dst, srcover4_sse2(s, d, 1));
+	}
+	for (; width > 0; --width, src += 4, dst += 4)
+		srcover_pixel_8888(dst, src, 2, 1, 0);
+}
+
+static void TARGET("sse2")
+copy_row_rgba8888_bgra8888_sse2(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 4; width -= 4, src += 16, dst += 16)
+		_mm_storeu_si128((__m128i *)dst, swaprb4_sse2(_mm_loadu_si128((const __m128i *)src)));
+	for (; width > 0; --width, src += 4, dst += 4)
+		copy_pixel_8888(dst, src, 4, 2, 1, 0);
+}
+
+/* RGB to RGBA/BGRA via byte shuffle, 16 byte load needs 6 pixels remaining*/
+static inline void ALWAYS_INLINE TARGET("ssse3")
+copy_row_rgb888_8888_ssse3(unsigned char *dst, const unsigned char *src, int width, int SWAP)
+{
+	__m128i shuf = SWAP?
+		_mm_setr_epi8(2,1,0,-1, 5,4,3,-1, 8,7,6,-1, 11,10,9,-1):
+		_mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+	__m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+	for (; width >= 6; width -= 4, src += 12, dst += 16) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		_mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_shuffle_epi8(s, shuf), alpha));
+	}
+	for (; width > 0; --width, src += 3, dst += 4)
+		copy_pixel_8888(dst, src, 3, SWAP? 2: 0, 1, SWAP? 0: 2);
+}
+
+static void TARGET("ssse3")
+copy_row_rgb888_rgba8888_ssse3(unsigned char *dst, const unsigned char *src, int width)
+{
+	copy_row_rgb888_8888_ssse3(dst, src, width, 0);
+}
+
+static void TARGET("ssse3")
+copy_row_rgb888_bgra8888_ssse3(unsigned char *dst, const unsigned char *src, int width)
+{
+	copy_row_rgb888_8888_ssse3(dst, src, width, 1);
+}
+
+static inline __m256i ALWAYS_INLINE TARGET("avx2")
+srcover8_avx2(__m256i s, __m256i d, int SWAP)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i one = _mm256_set1_epi16(1);
+	__m256i c255 = _mm256_set1_epi16(255);
+	__m256i amask = _mm256_set_epi16(255,0,0,0, 255,0,0,0, 255,0,0,0, 255,0,0,0);
+	__m256i slo = _mm256_unpacklo_epi8(s, zero);
+	__m256i shi = _mm256_unpackhi_epi8(s, zero);
+	__m256i dlo = _mm256_unpacklo_epi8(d, zero);
+	__m256i dhi = _mm256_unpackhi_epi8(d, zero);
+	__m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(slo, 0xFF), 0xFF);
+	__m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(shi, 0xFF), 0xFF);
+	__m256i rlo, rhi, z;
+
+	if (SWAP) {
+		slo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(slo, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+		shi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(shi, _MM_SHUFFLE(3,0,1,2)), _MM_SHUFFLE(3,0,1,2));
+	}
+	slo = _mm256_or_si256(slo, amask);
+	shi = _mm256_or_si256(shi, amask);
+
+	rlo = _mm256_add_epi16(_mm256_mullo_epi16(slo, _mm256_add_epi16(alo, one)),
+		_mm256_mullo_epi16(dlo, _mm256_sub_epi16(c255, alo)));
+	rhi = _mm256_add_epi16(_mm256_mullo_epi16(shi, _mm256_add_epi16(ahi, one)),
+		_mm256_mullo_epi16(dhi, _mm256_sub_epi16(c255, ahi)));
+	/* unpack and pack are both per 128 bit lane, so pixel order is preserved*/
+	rlo = _mm256_packus_epi16(_mm256_srli_epi16(rlo, 8), _mm256_srli_epi16(rhi, 8));
+
+	z = _mm256_cmpeq_epi32(_mm256_and_si256(s, _mm256_set1_epi32((int)0xff000000)), zero);
+	return _mm256_blendv_epi8(rlo, d, z);
+}
+
+static void TARGET("avx2")
+srcover_row_rgba8888_rgba8888_avx2(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 8; width -= 8, src += 32, dst += 32) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)src);
+		__m256i d = _mm256_loadu_si256((__m256i *)dst);
+		_mm256_storeu_si256((__m256i *)dst, srcover8_avx2(s, d, 0));
+	}
+	srcover_row_rgba8888_rgba8888_sse2(dst, src, width);
+}
+
+static void TARGET("avx2")
+srcover_row_rgba8888_bgra8888_avx2(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 8; width -= 8, src += 32, dst += 32) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)src);
+		__m256i d = _mm256_loadu_si256((__m256i *)dst);
+		_mm256_storeu_si256((__m256i *)dst, srcover8_avx2(s, d, 1));
+	}
+	srcover_row_rgba8888_bgra8888_sse2(dst, src, width);
+}
+
+static void TARGET("avx2")
+copy_row_rgba8888_bgra8888_avx2(unsigned char *dst, const unsigned char *src, int width)
+{
+	__m256i mask = _mm256_set1_epi32(0xff);
+	__m256i ga = _mm256_set1_epi32((int)0xff00ff00);
+
+	for (; width >= 8; width -= 8, src += 32, dst += 32) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)src);
+		s = _mm256_or_si256(_mm256_and_si256(s, ga),
+			_mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(s, mask), 16),
+				_mm256_and_si256(_mm256_srli_epi32(s, 16), mask)));
+		_mm256_storeu_si256((__m256i *)dst, s);
+	}
+	copy_row_rgba8888_bgra8888_sse2(dst, src, width);
+}
+
+/* combine 16 bytes at dst with pattern vector*/
+static inline void ALWAYS_INLINE TARGET("sse2")
+fill16_sse2(unsigned char *dst, __m128i p, int OP)
+{
+	__m128i d;
+
+	if (OP == FILL_COPY)
+		d = p;
+	else {
+		d = _mm_loadu_si128((const __m128i *)dst);
+		if (OP == FILL_XOR)
+			d = _mm_xor_si128(d, p);
+		else if (OP == FILL_AND)
+			d = _mm_and_si128(d, p);
+		else d = _mm_or_si128(d, p);
+	}
+	_mm_storeu_si128((__m128i *)dst, d);
+}
+
+static inline void ALWAYS_INLINE TARGET("sse2")
+fill_row_sse2(unsigned char *dst, const unsigned char *pat, int len, int OP)
+{
+	__m128i p0 = _mm_loadu_si128((const __m128i *)pat);
+	__m128i p1 = _mm_loadu_si128((const __m128i *)(pat + 16));
+	__m128i p2 = _mm_loadu_si128((const __m128i *)(pat + 32));
+
+	for (; len >= 48; len -= 48, dst += 48) {
+		fill16_sse2(dst, p0, OP);
+		fill16_sse2(dst + 16, p1, OP);
+		fill16_sse2(dst + 32, p2, OP);
+	}
+	fill_row_words(dst, pat, len, OP);
+}
+
+static void TARGET("sse2")
+fill_row_copy_sse2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_sse2(dst, pat, len, FILL_COPY);
+}
+
+static void TARGET("sse2")
+fill_row_xor_sse2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_sse2(dst, pat, len, FILL_XOR);
+}
+
+static void TARGET("sse2")
+fill_row_and_sse2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_sse2(dst, pat, len, FILL_AND);
+}
+
+static void TARGET("sse2")
+fill_row_or_sse2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_sse2(dst, pat, len, FILL_OR);
+}
+
+/* combine 32 bytes at dst with pattern vector*/
+static inline void ALWAYS_INLINE TARGET("avx2")
+fill32_avx2(unsigned char *dst, __m256i p, int OP)
+{
+	__m256i d;
+
+	if (OP == FILL_COPY)
+		d = p;
+	else {
+		d = _mm256_loadu_si256((const __m256i *)dst);
+		if (OP == FILL_XOR)
+			d = _mm256_xor_si256(d, p);
+		else if (OP == FILL_AND)
+			d = _mm256_and_si256(d, p);
+		else d = _mm256_or_si256(d, p);
+	}
+	_mm256_storeu_si256((__m256i *)dst, d);
+}
+
+static inline void ALWAYS_INLINE TARGET("avx2")
+fill_row_avx2(unsigned char *dst, const unsigned char *pat, int len, int OP)
+{
+	__m256i p0 = _mm256_loadu_si256((const __m256i *)pat);
+	__m256i p1 = _mm256_loadu_si256((const __m256i *)(pat + 32));
+	__m256i p2 = _mm256_loadu_si256((const __m256i *)(pat + 64));
+
+	for (; len >= 96; len -= 96, dst += 96) {
+		fill32_avx2(dst, p0, OP);
+		fill32_avx2(dst + 32, p1, OP);
+		fill32_avx2(dst + 64, p2, OP);
+	}
+	fill_row_sse2(dst, pat, len, OP);
+}
+
+static void TARGET("avx2")
+fill_row_copy_avx2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_avx2(dst, pat, len, FILL_COPY);
+}
+
+static void TARGET("avx2")
+fill_row_xor_avx2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_avx2(dst, pat, len, FILL_XOR);
+}
+
+static void TARGET("avx2")
+fill_row_and_avx2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_avx2(dst, pat, len, FILL_AND);
+}
+
+static void TARGET("avx2")
+fill_row_or_avx2(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_avx2(dst, pat, len, FILL_OR);
+}
+
+#if SIMD_16BPP
+/* split 8 RGBA pixels into 16 bit lanes per channel*/
+#define SPLIT8_SSE2(s0, s1, r, g, b, a) do { \
+	__m128i m = _mm_set1_epi32(0xff); \
+	r = _mm_packs_epi32(_mm_and_si128(s0, m), _mm_and_si128(s1, m)); \
+	g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 8), m), \
+		_mm_and_si128(_mm_srli_epi32(s1, 8), m)); \
+	b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 16), m), \
+		_mm_and_si128(_mm_srli_epi32(s1, 16), m)); \
+	a = _mm_packs_epi32(_mm_srli_epi32(s0, 24), _mm_srli_epi32(s1, 24)); \
+} while (0)
+
+/* RGB2PIXEL of 8 pixels from 16 bit channel lanes*/
+static inline __m128i ALWAYS_INLINE TARGET("sse2")
+rgb2pixel8_sse2(__m128i r, __m128i g, __m128i b)
+{
+	return _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(r, 3), RSHIFT),
+		_mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(g, 8 - GBITS), GSHIFT),
+			_mm_srli_epi16(b, 3)));
+}
+
+/*
+ * muldiv255_16bpp reduces to ((256-a)*dc + a*sc) >> 8 per truncated channel,
+ * with the alpha 255 case being a straight RGB2PIXEL copy.
+ */
+static void TARGET("sse2")
+srcover_row_rgba8888_16bpp_sse2(unsigned char *dst, const unsigned char *src, int width)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i c255 = _mm_set1_epi16(255);
+	__m128i c256 = _mm_set1_epi16(256);
+	__m128i m5 = _mm_set1_epi16(0x1f);
+	__m128i mg = _mm_set1_epi16((1 << GBITS) - 1);
+
+	for (; width >= 8; width -= 8, src += 32, dst += 16) {
+		__m128i s0 = _mm_loadu_si128((const __m128i *)src);
+		__m128i s1 = _mm_loadu_si128((const __m128i *)(src + 16));
+		__m128i d = _mm_loadu_si128((__m128i *)dst);
+		__m128i r, g, b, a, ia, dr, dg, db, copy, blend, z, o;
+
+		SPLIT8_SSE2(s0, s1, r, g, b, a);
+		copy = rgb2pixel8_sse2(r, g, b);
+
+		ia = _mm_sub_epi16(c256, a);
+		r = _mm_srli_epi16(r, 3);
+		g = _mm_srli_epi16(g, 8 - GBITS);
+		b = _mm_srli_epi16(b, 3);
+		dr = _mm_and_si128(_mm_srli_epi16(d, RSHIFT), m5);
+		dg = _mm_and_si128(_mm_srli_epi16(d, GSHIFT), mg);
+		db = _mm_and_si128(d, m5);
+		dr = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dr, ia), _mm_mullo_epi16(r, a)), 8);
+		dg = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dg, ia), _mm_mullo_epi16(g, a)), 8);
+		db = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(db, ia), _mm_mullo_epi16(b, a)), 8);
+		blend = _mm_or_si128(_mm_slli_epi16(dr, RSHIFT),
+			_mm_or_si128(_mm_slli_epi16(dg, GSHIFT), db));
+
+		o = _mm_cmpeq_epi16(a, c255);
+		z = _mm_cmpeq_epi16(a, zero);
+		blend = _mm_or_si128(_mm_and_si128(o, copy), _mm_andnot_si128(o, blend));
+		blend = _mm_or_si128(_mm_and_si128(z, d), _mm_andnot_si128(z, blend));
+		_mm_storeu_si128((__m128i *)dst, blend);
+	}
+	for (; width > 0; --width, src += 4, dst += 2)
+		srcover_pixel_16bpp(dst, src);
+}
+
+static void TARGET("sse2")
+copy_row_rgba8888_16bpp_sse2(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 8; width -= 8, src += 32, dst += 16) {
+		__m128i s0 = _mm_loadu_si128((const __m128i *)src);
+		__m128i s1 = _mm_loadu_si128((const __m128i *)(src + 16));
+		__m128i r, g, b, a;
+
+		SPLIT8_SSE2(s0, s1, r, g, b, a);
+		(void)a;
+		_mm_storeu_si128((__m128i *)dst, rgb2pixel8_sse2(r, g, b));
+	}
+	for (; width > 0; --width, src += 4, dst += 2)
+		((unsigned short *)dst)[0] = RGB2PIXEL(src[0], src[1], src[2]);
+}
+
+static void TARGET("ssse3")
+copy_row_rgb888_16bpp_ssse3(unsigned char *dst, const unsigned char *src, int width)
+{
+	__m128i shuf = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+
+	/* second 16 byte load at src+12 needs 10 pixels remaining*/
+	for (; width >= 10; width -= 8, src += 24, dst += 16) {
+		__m128i s0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), shuf);
+		__m128i s1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 12)), shuf);
+		__m128i r, g, b, a;
+
+		SPLIT8_SSE2(s0, s1, r, g, b, a);
+		(void)a;
+		_mm_storeu_si128((__m128i *)dst, rgb2pixel8_sse2(r, g, b));
+	}
+	for (; width > 0; --width, src += 3, dst += 2)
+		((unsigned short *)dst)[0] = RGB2PIXEL(src[0], src[1], src[2]);
+}
+#endif /* SIMD_16BPP*/
+
+void
+convblit_simd_init(void)
+{
+	convblit_rowfuncs.copy_32bpp = copy_row_32bpp;
+	convblit_rowfuncs.copy_24bpp = copy_row_24bpp;
+	convblit_rowfuncs.copy_16bpp = copy_row_16bpp;
+	fill_init();
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		convblit_rowfuncs.fill_copy = fill_row_copy_sse2;
+		convblit_rowfuncs.fill_xor = fill_row_xor_sse2;
+		convblit_rowfuncs.fill_and = fill_row_and_sse2;
+		convblit_rowfuncs.fill_or = fill_row_or_sse2;
+		convblit_rowfuncs.srcover_rgba8888_rgba8888 = srcover_row_rgba8888_rgba8888_sse2;
+		convblit_rowfuncs.srcover_rgba8888_bgra8888 = srcover_row_rgba8888_bgra8888_sse2;
+		convblit_rowfuncs.copy_rgba8888_bgra8888 = copy_row_rgba8888_bgra8888_sse2;
+#if SIMD_16BPP
+		convblit_rowfuncs.srcover_rgba8888_16bpp = srcover_row_rgba8888_16bpp_sse2;
+		convblit_rowfuncs.copy_rgba8888_16bpp = copy_row_rgba8888_16bpp_sse2;
+#endif
+	}
+	if (__builtin_cpu_supports("ssse3")) {
+		convblit_rowfuncs.copy_rgb888_rgba8888 = copy_row_rgb888_rgba8888_ssse3;
+		convblit_rowfuncs.copy_rgb888_bgra8888 = copy_row_rgb888_bgra8888_ssse3;
+#if SIMD_16BPP
+		convblit_rowfuncs.copy_rgb888_16bpp = copy_row_rgb888_16bpp_ssse3;
+#endif
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		convblit_rowfuncs.fill_copy = fill_row_copy_avx2;
+		convblit_rowfuncs.fill_xor = fill_row_xor_avx2;
+		convblit_rowfuncs.fill_and = fill_row_and_avx2;
+		convblit_rowfuncs.fill_or = fill_row_or_avx2;
+		convblit_rowfuncs.srcover_rgba8888_rgba8888 = srcover_row_rgba8888_rgba8888_avx2;
+		convblit_rowfuncs.srcover_rgba8888_bgra8888 = srcover_row_rgba8888_bgra8888_avx2;
+		convblit_rowfuncs.copy_rgba8888_bgra8888 = copy_row_rgba8888_bgra8888_avx2;
+	}
+}
+
+#else /* NEON*/
+#include <arm_neon.h>
+
+/* ((a+1)*s + (255-a)*d) >> 8 on 8 channels*/
+static inline uint8x8_t ALWAYS_INLINE
+blend8_neon(uint8x8_t s, uint8x8_t d, uint8x8_t a, uint8x8_t ia)
+{
+	return vshrn_n_u16(vaddw_u8(vmlal_u8(vmull_u8(s, a), d, ia), s), 8);
+}
+
+static inline void ALWAYS_INLINE
+srcover_row_8888_neon(unsigned char *dst, const unsigned char *src, int width, int SWAP)
+{
+	uint8x8_t c255 = vdup_n_u8(255);
+
+	for (; width >= 8; width -= 8, src += 32, dst += 32) {
+		uint8x8x4_t s = vld4_u8(src);
+		uint8x8x4_t d = vld4_u8(dst);
+		uint8x8_t a = s.val[3];
+		uint8x8_t ia = vmvn_u8(a);
+		uint8x8_t z = vceq_u8(a, vdup_n_u8(0));
+		uint8x8x4_t o;
+		int dr = SWAP? 2: 0;
+		int db = SWAP? 0: 2;
+
+		o.val[dr] = vbsl_u8(z, d.val[dr], blend8_neon(s.val[0], d.val[dr], a, ia));
+		o.val[1] = vbsl_u8(z, d.val[1], blend8_neon(s.val[1], d.val[1], a, ia));
+		o.val[db] = vbsl_u8(z, d.val[db], blend8_neon(s.val[2], d.val[db], a, ia));
+		o.val[3] = vbsl_u8(z, d.val[3], blend8_neon(c255, d.val[3], a, ia));
+		vst4_u8(dst, o);
+	}
+	for (; width > 0; --width, src += 4, dst += 4)
+		srcover_pixel_8888(dst, src, SWAP? 2: 0, 1, SWAP? 0: 2);
+}
+
+static void
+srcover_row_rgba8888_rgba8888_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	srcover_row_8888_neon(dst, src, width, 0);
+}
+
+static void
+srcover_row_rgba8888_bgra8888_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	srcover_row_8888_neon(dst, src, width, 1);
+}
+
+static void
+copy_row_rgba8888_bgra8888_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 8; width -= 8, src += 32, dst += 32) {
+		uint8x8x4_t s = vld4_u8(src);
+		uint8x8_t t = s.val[0];
+
+		s.val[0] = s.val[2];
+		s.val[2] = t;
+		vst4_u8(dst, s);
+	}
+	for (; width > 0; --width, src += 4, dst += 4)
+		copy_pixel_8888(dst, src, 4, 2, 1, 0);
+}
+
+static inline void ALWAYS_INLINE
+copy_row_rgb888_8888_neon(unsigned char *dst, const unsigned char *src, int width, int SWAP)
+{
+	for (; width >= 8; width -= 8, src += 24, dst += 32) {
+		uint8x8x3_t s = vld3_u8(src);
+		uint8x8x4_t o;
+
+		o.val[SWAP? 2: 0] = s.val[0];
+		o.val[1] = s.val[1];
+		o.val[SWAP? 0: 2] = s.val[2];
+		o.val[3] = vdup_n_u8(255);
+		vst4_u8(dst, o);
+	}
+	for (; width > 0; --width, src += 3, dst += 4)
+		copy_pixel_8888(dst, src, 3, SWAP? 2: 0, 1, SWAP? 0: 2);
+}
+
+static void
+copy_row_rgb888_rgba8888_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	copy_row_rgb888_8888_neon(dst, src, width, 0);
+}
+
+static void
+copy_row_rgb888_bgra8888_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	copy_row_rgb888_8888_neon(dst, src, width, 1);
+}
+
+static inline void ALWAYS_INLINE
+fill16_neon(unsigned char *dst, uint8x16_t p, int OP)
+{
+	uint8x16_t d;
+
+	if (OP == FILL_COPY)
+		d = p;
+	else {
+		d = vld1q_u8(dst);
+		if (OP == FILL_XOR)
+			d = veorq_u8(d, p);
+		else if (OP == FILL_AND)
+			d = vandq_u8(d, p);
+		else d = vorrq_u8(d, p);
+	}
+	vst1q_u8(dst, d);
+}
+
+static inline void ALWAYS_INLINE
+fill_row_neon(unsigned char *dst, const unsigned char *pat, int len, int OP)
+{
+	uint8x16_t p0 = vld1q_u8(pat);
+	uint8x16_t p1 = vld1q_u8(pat + 16);
+	uint8x16_t p2 = vld1q_u8(pat + 32);
+
+	for (; len >= 48; len -= 48, dst += 48) {
+		fill16_neon(dst, p0, OP);
+		fill16_neon(dst + 16, p1, OP);
+		fill16_neon(dst + 32, p2, OP);
+	}
+	fill_row_words(dst, pat, len, OP);
+}
+
+static void
+fill_row_copy_neon(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_neon(dst, pat, len, FILL_COPY);
+}
+
+static void
+fill_row_xor_neon(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_neon(dst, pat, len, FILL_XOR);
+}
+
+static void
+fill_row_and_neon(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_neon(dst, pat, len, FILL_AND);
+}
+
+static void
+fill_row_or_neon(unsigned char *dst, const unsigned char *pat, int len)
+{
+	fill_row_neon(dst, pat, len, FILL_OR);
+}
+
+#if SIMD_16BPP
+static inline uint16x8_t ALWAYS_INLINE
+rgb2pixel8_neon(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	return vorrq_u16(vshlq_n_u16(vmovl_u8(vshr_n_u8(r, 3)), RSHIFT),
+		vorrq_u16(vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 8 - GBITS)), GSHIFT),
+			vmovl_u8(vshr_n_u8(b, 3))));
+}
+
+static void
+srcover_row_rgba8888_16bpp_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	uint16x8_t c256 = vdupq_n_u16(256);
+	uint16x8_t m5 = vdupq_n_u16(0x1f);
+	uint16x8_t mg = vdupq_n_u16((1 << GBITS) - 1);
+
+	for (; width >= 8; width -= 8, src += 32, dst += 16) {
+		uint8x8x4_t s = vld4_u8(src);
+		uint16x8_t d = vld1q_u16((uint16_t *)dst);
+		uint16x8_t a = vmovl_u8(s.val[3]);
+		uint16x8_t ia = vsubq_u16(c256, a);
+		uint16x8_t r = vmovl_u8(vshr_n_u8(s.val[0], 3));
+		uint16x8_t g = vmovl_u8(vshr_n_u8(s.val[1], 8 - GBITS));
+		uint16x8_t b = vmovl_u8(vshr_n_u8(s.val[2], 3));
+		uint16x8_t dr = vandq_u16(vshrq_n_u16(d, RSHIFT), m5);
+		uint16x8_t dg = vandq_u16(vshrq_n_u16(d, GSHIFT), mg);
+		uint16x8_t db = vandq_u16(d, m5);
+		uint16x8_t o;
+
+		dr = vshrq_n_u16(vmlaq_u16(vmulq_u16(dr, ia), r, a), 8);
+		dg = vshrq_n_u16(vmlaq_u16(vmulq_u16(dg, ia), g, a), 8);
+		db = vshrq_n_u16(vmlaq_u16(vmulq_u16(db, ia), b, a), 8);
+		o = vorrq_u16(vshlq_n_u16(dr, RSHIFT), vorrq_u16(vshlq_n_u16(dg, GSHIFT), db));
+
+		o = vbslq_u16(vceqq_u16(a, vdupq_n_u16(255)), rgb2pixel8_neon(s.val[0], s.val[1], s.val[2]), o);
+		o = vbslq_u16(vceqq_u16(a, vdupq_n_u16(0)), d, o);
+		vst1q_u16((uint16_t *)dst, o);
+	}
+	for (; width > 0; --width, src += 4, dst += 2)
+		srcover_pixel_16bpp(dst, src);
+}
+
+static void
+copy_row_rgba8888_16bpp_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 8; width -= 8, src += 32, dst += 16) {
+		uint8x8x4_t s = vld4_u8(src);
+		vst1q_u16((uint16_t *)dst, rgb2pixel8_neon(s.val[0], s.val[1], s.val[2]));
+	}
+	for (; width > 0; --width, src += 4, dst += 2)
+		((unsigned short *)dst)[0] = RGB2PIXEL(src[0], src[1], src[2]);
+}
+
+static void
+copy_row_rgb888_16bpp_neon(unsigned char *dst, const unsigned char *src, int width)
+{
+	for (; width >= 8; width -= 8, src += 24, dst += 16) {
+		uint8x8x3_t s = vld3_u8(src);
+		vst1q_u16((uint16_t *)dst, rgb2pixel8_neon(s.val[0], s.val[1], s.val[2]));
+	}
+	for (; width > 0; --width, src += 3, dst += 2)
+		((unsigned short *)dst)[0] = RGB2PIXEL(src[0], src[1], src[2]);
+}
+#endif /* SIMD_16BPP*/
+
+void
+convblit_simd_init(void)
+{
+	convblit_rowfuncs.copy_32bpp = copy_row_32bpp;
+	convblit_rowfuncs.copy_24bpp = copy_row_24bpp;
+	convblit_rowfuncs.copy_16bpp = copy_row_16bpp;
+
+	convblit_rowfuncs.fill_copy = fill_row_copy_neon;
+	convblit_rowfuncs.fill_xor = fill_row_xor_neon;
+	convblit_rowfuncs.fill_and = fill_row_and_neon;
+	convblit_rowfuncs.fill_or = fill_row_or_neon;
+	convblit_rowfuncs.srcover_rgba8888_rgba8888 = srcover_row_rgba8888_rgba8888_neon;
+	convblit_rowfuncs.srcover_rgba8888_bgra8888 = srcover_row_rgba8888_bgra8888_neon;
+	convblit_rowfuncs.copy_rgba8888_bgra8888 = copy_row_rgba8888_bgra8888_neon;
+	convblit_rowfuncs.copy_rgb888_rgba8888 = copy_row_rgb888_rgba8888_neon;
+	convblit_rowfuncs.copy_rgb888_bgra8888 = copy_row_rgb888_bgra8888_neon;
+#if SIMD_16BPP
+	convblit_rowfuncs.srcover_rgba8888_16bpp = srcover_row_rgba8888_16bpp_neon;
+	convblit_rowfuncs.copy_rgba8888_16bpp = copy_row_rgba8888_16bpp_neon;
+	convblit_rowfuncs.copy_rgb888_16bpp = copy_row_rgb888_16bpp_neon;
+#endif
+}
+#endif /* x86 / NEON*/
+
+#else /* !MW_FEATURE_SIMD*/
+
+void
+convblit_simd_init(void)
+{
+	convblit_rowfuncs.copy_32bpp = copy_row_32bpp;
+	convblit_rowfuncs.copy_24bpp = copy_row_24bpp;
+	convblit_rowfuncs.copy_16bpp = copy_row_16bpp;
+	fill_init();
+}
+#endif /* MW_FEATURE_SIMD*/
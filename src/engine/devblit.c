@@ -287,6 +287,12 @@ GdStretchBlit(PSD dstpsd, MWCOORD dx1, MWCOORD dy1, MWCOORD dx2,
 	int clipresult;
 	MWBLITFUNC convblit;
 	MWBLITPARMS parms;
+#if MW_FEATURE_BLITTHREADS
+	int nbands;
+#endif
+#if MW_FEATURE_STATS
+	long pixels = 0;
+#endif
 #if DYNAMICREGIONS
 	int 		count;
 	MWRECT *	prc;
@@ -502,6 +508,7 @@ GdStretchBlit(PSD dstpsd, MWCOORD dx1, MWCOORD dy1, MWCOORD dx2,
 	prc = cliprects;
 	count = clipcount;
 #endif
+	GDSTAT_ADD(cliprects, count);
 	while (--count >= 0) {
 		int rx1, rx2, ry1, ry2;
 #if DYNAMICREGIONS
@@ -556,13 +563,24 @@ GdStretchBlit(PSD dstpsd, MWCOORD dx1, MWCOORD dy1, MWCOORD dx2,
 			parms.src_y_step_one = MWSIGN(y_numerator);
 			parms.err_y_step = MWABS(y_numerator) - MWABS(parms.src_y_step) * y_denominator;
 
+#if MW_FEATURE_BLITTHREADS
+			if ((nbands = GdBandCount(parms.width, parms.height)) > 1)
+				GdBandedBlit(dstpsd, &parms, convblit, nbands, 1);
+			else
+#endif
 			convblit(dstpsd, &parms);
+#if MW_FEATURE_STATS
+			pixels += (long)parms.width * parms.height;
+#endif
 		}
 		++prc;
 	}
 	GdFixCursor(dstpsd);
 	if (srcpsd != dstpsd)
 		GdFixCursor(srcpsd);
+#if MW_FEATURE_STATS
+	GdStatBlit(srcpsd->data_format, dstpsd->data_format, pixels);
+#endif
 }
 
 /* call conversion blit with clipping and cursor fix*/
@@ -581,6 +599,16 @@ GdConvBlitInternal(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit)
 #else
 	MWCLIPRECT *prc;
 #endif
+#if MW_FEATURE_STATS
+	/* frame blits pass destination format in data_format*/
+	int srcformat = gc->srcpsd? gc->srcpsd->data_format: gc->data_format;
+	long pixels = 0;
+#endif
+#if MW_FEATURE_BLITTHREADS
+	/* bands can't be drawn in parallel if src and dst share memory*/
+	int overlap = (gc->data == gc->data_out);
+	int nbands;
+#endif
 
 	/* check clipping region*/
 	clipresult = GdClipArea(psd, dstx, dsty, dstx + width - 1, dsty + height - 1);
@@ -599,11 +627,19 @@ GdSetMode(MWROP_COPY);
 GdSetForegroundColor(psd, MWRGB(128,64,0));	/* brown*/
 GdFillRect(psd, gc->dstx, gc->dsty, gc->width, gc->height);
 usleep(200000);
+#endif
+#if MW_FEATURE_BLITTHREADS
+		if (!overlap && (nbands = GdBandCount(width, height)) > 1)
+			GdBandedBlit(psd, gc, convblit, nbands, 0);
+		else
 #endif
 		convblit(psd, gc);
 		GdFixCursor(psd);
 		if (checksrc)
 			GdFixCursor(gc->srcpsd);
+#if MW_FEATURE_STATS
+		GdStatBlit(srcformat, psd->data_format, (long)width * height);
+#endif
 		return;
 	} else	/* partially clipped, check cursor in dst region once*/
 		GdCheckCursor(psd, dstx, dsty, dstx + width - 1, dsty + height - 1);
@@ -616,6 +652,7 @@ usleep(200000);
 	prc = cliprects;
 	count = clipcount;
 #endif
+	GDSTAT_ADD(cliprects, count);
 
 	while (count-- > 0) {
 		MWCOORD rx1, rx2, ry1, ry2, rw, rh;
@@ -653,14 +690,25 @@ GdSetMode(MWROP_COPY);
 GdSetForegroundColor(psd, MWRGB(128,64,0));	/* brown*/
 GdFillRect(psd, gc->dstx, gc->dsty, gc->width, gc->height);
 usleep(200000);
+#endif
+#if MW_FEATURE_BLITTHREADS
+			if (!overlap && (nbands = GdBandCount(rw, rh)) > 1)
+				GdBandedBlit(psd, gc, convblit, nbands, 0);
+			else
 #endif
 			convblit(psd, gc);
+#if MW_FEATURE_STATS
+			pixels += (long)rw * rh;
+#endif
 		}
 		prc++;
 	}
 	GdFixCursor(psd);
 	if (checksrc)
 		GdFixCursor(gc->srcpsd);
+#if MW_FEATURE_STATS
+	GdStatBlit(srcformat, psd->data_format, pixels);
+#endif
 
 	/* Reset everything, in case the caller re-uses it. */
 	gc->dstx = dstx;
@@ -0,0 +1,250 @@
+/*
+ * Banded blit worker pool
+ *
+ * When MW_FEATURE_BLITTHREADS is set to the number of worker threads,
+ * conversion blits and image stretches covering at least
+ * BLITTHREAD_MINPIXELS pixels are split into horizontal bands which
+ * are drawn in parallel by the pool and the calling thread. Smaller
+ * blits, and blits whose source and destination share memory, stay
+ * on the calling thread.
+ *
+ * Each band draws through a private copy of the screen device whose
+ * Update entry point only records the area drawn. After all bands have
+ * joined, the real driver Update is called once with the union, so
+ * drivers never see concurrent Update calls.  The band blits do run
+ * DRAWON/DRAWOFF concurrently, so with VTSWITCH those update mwdrawing
+ * atomically (see drivers/fb.h).
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "device.h"
+
+#if MW_FEATURE_BLITTHREADS /* whole file*/
+#include <pthread.h>
+#include <signal.h>
+
+#define MAX_BANDS	(MW_FEATURE_BLITTHREADS + 1)	/* workers plus calling thread*/
+
+/* per-band blit state*/
+typedef struct {
+	SCREENDEVICE	sd;			/* private screen device copy, must be first*/
+	MWBLITPARMS		parms;		/* band blit parameters*/
+	MWBLITFUNC		convblit;
+	MWCOORD			x1, y1, x2, y2;	/* physical area passed to Update*/
+} MWBLITBAND;
+
+/* banded blit job passed to band_blit*/
+typedef struct {
+	MWBLITBAND		band[MAX_BANDS];
+} MWBLITJOB;
+
+static pthread_mutex_t	poolmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	workcond = PTHREAD_COND_INITIALIZER;	/* new bands queued*/
+static pthread_cond_t	donecond = PTHREAD_COND_INITIALIZER;	/* last band finished*/
+static int				poolthreads = -1;	/* running workers, -1 before startup*/
+static MWBANDFUNC		jobfunc;			/* current job*/
+static void *			jobarg;
+static int				jobbands;			/* bands in current job*/
+static int				nextband;			/* next band to be taken*/
+static int				bandsleft;			/* bands not yet finished*/
+
+/* take and draw bands of the current job until none are left, called locked*/
+static void
+run_bands(void)
+{
+	while (nextband < jobbands) {
+		MWBANDFUNC func = jobfunc;
+		void *arg = jobarg;
+		int nbands = jobbands;
+		int band = nextband++;
+
+		pthread_mutex_unlock(&poolmutex);
+		func(arg, band, nbands);
+		pthread_mutex_lock(&poolmutex);
+
+		if (--bandsleft == 0)
+			pthread_cond_signal(&donecond);
+	}
+}
+
+static void *
+band_worker(void *arg)
+{
+	pthread_mutex_lock(&poolmutex);
+	for (;;) {
+		while (nextband >= jobbands)
+			pthread_cond_wait(&workcond, &poolmutex);
+		run_bands();
+	}
+	return NULL;
+}
+
+/* start worker threads on first use, returns number running*/
+static int
+start_pool(void)
+{
+	pthread_t thread;
+	pthread_attr_t attr;
+	sigset_t all, old;
+	int i;
+
+	if (poolthreads >= 0)
+		return poolthreads;
+	poolthreads = 0;
+
+	/* workers inherit a blocked signal mask so signals go to the server thread*/
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (i = 0; i < MW_FEATURE_BLITTHREADS; i++) {
+		if (pthread_create(&thread, &attr, band_worker, NULL) != 0) {
+			EPRINTF("GdBandCount: can't start blit thread %d\n", i);
+			break;
+		}
+		poolthreads++;
+	}
+	pthread_attr_destroy(&attr);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	return poolthreads;
+}
+
+/**
+ * Return the number of bands an area should be drawn in.
+ * Returns 1 when the area is below the threshold or no workers could be started.
+ *
+ * @param width Width of area.
+ * @param height Height of area.
+ * @return Number of bands, at most one per worker plus the calling thread.
+ */
+int
+GdBandCount(MWCOORD width, MWCOORD height)
+{
+	int nbands;
+
+	if ((long)width * height < BLITTHREAD_MINPIXELS)
+		return 1;
+
+	nbands = start_pool() + 1;
+	return MWMIN(nbands, height);
+}
+
+/**
+ * Run func once for each band, spread over the worker threads and the
+ * calling thread, and return when all bands have finished.
+ *
+ * @param func Band routine, passed arg, band number and band count.
+ * @param arg Argument for band routine.
+ * @param nbands Number of bands, from GdBandCount.
+ */
+void
+GdRunBands(MWBANDFUNC func, void *arg, int nbands)
+{
+	pthread_mutex_lock(&poolmutex);
+	jobfunc = func;
+	jobarg = arg;
+	jobbands = nbands;
+	nextband = 0;
+	bandsleft = nbands;
+	pthread_cond_broadcast(&workcond);
+
+	/* calling thread draws bands too*/
+	run_bands();
+	while (bandsleft > 0)
+		pthread_cond_wait(&donecond, &poolmutex);
+
+	jobbands = nextband = 0;
+	pthread_mutex_unlock(&poolmutex);
+}
+
+/* band screen device Update entry point, records physical area only*/
+static void
+band_update(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	MWBLITBAND *bp = (MWBLITBAND *)psd;
+
+	bp->x1 = x;
+	bp->y1 = y;
+	bp->x2 = x + width;
+	bp->y2 = y + height;
+}
+
+static void
+band_blit(void *arg, int band, int nbands)
+{
+	MWBLITBAND *bp = &((MWBLITJOB *)arg)->band[band];
+
+	bp->convblit(&bp->sd, &bp->parms);
+}
+
+/**
+ * Draw a conversion blit in horizontal bands on the worker pool, then
+ * call the driver Update once for the whole area.
+ * The blit must already be clipped to a single visible rectangle and
+ * the source must not overlap the destination.
+ *
+ * @param psd Drawing surface.
+ * @param gc Blit parameters, unchanged on return.
+ * @param convblit Conversion blit routine.
+ * @param nbands Number of bands, from GdBandCount.
+ * @param stretch Nonzero for stretch blits, whose source rows are
+ *		stepped using the gc error terms set by GdStretchBlit.
+ */
+void
+GdBandedBlit(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit, int nbands, int stretch)
+{
+	MWBLITJOB job;
+	MWBLITBAND *bp;
+	MWCOORD x1, y1, x2, y2;
+	int band, dy;
+
+	if (nbands > MAX_BANDS)
+		nbands = MAX_BANDS;
+
+	for (band = 0; band < nbands; band++) {
+		bp = &job.band[band];
+		bp->sd = *psd;
+		bp->sd.Update = band_update;
+		bp->parms = *gc;
+		bp->convblit = convblit;
+		bp->x1 = bp->y1 = bp->x2 = bp->y2 = 0;
+
+		/* split rows evenly, earlier bands get the remainder*/
+		dy = band * (gc->height / nbands) + MWMIN(band, gc->height % nbands);
+		bp->parms.dsty = gc->dsty + dy;
+		bp->parms.height = gc->height / nbands + (band < gc->height % nbands);
+		if (stretch) {
+			/* advance dy rows as the stretch blitter does, one error
+			 * overflow at most per row keeps err_y in [-y_denominator, 0)
+			 */
+			long err = gc->err_y + (long)dy * gc->err_y_step;
+			long carry = (err + gc->y_denominator) / gc->y_denominator;
+
+			bp->parms.srcy = gc->srcy + dy * gc->src_y_step + carry * gc->src_y_step_one;
+			bp->parms.err_y = err - carry * gc->y_denominator;
+		} else
+			bp->parms.srcy = gc->srcy + dy;
+	}
+
+	GdRunBands(band_blit, &job, nbands);
+
+	if (!psd->Update)
+		return;
+
+	/* join band areas into a single update*/
+	x1 = y1 = MAX_MWCOORD;
+	x2 = y2 = MIN_MWCOORD;
+	for (band = 0; band < nbands; band++) {
+		bp = &job.band[band];
+		if (bp->x1 >= bp->x2 || bp->y1 >= bp->y2)
+			continue;
+		x1 = MWMIN(x1, bp->x1);
+		y1 = MWMIN(y1, bp->y1);
+		x2 = MWMAX(x2, bp->x2);
+		y2 = MWMAX(y2, bp->y2);
+	}
+	if (x1 < x2 && y1 < y2)
+		psd->Update(psd, x1, y1, x2 - x1, y2 - y1);
+}
+#endif /* MW_FEATURE_BLITTHREADS*/
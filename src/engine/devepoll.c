@@ -0,0 +1,192 @@
+/*
+ * epoll main loop support for Linux
+ *
+ * When HAVE_EPOLL is set, GsSelect and MwSelect wait on an epoll set
+ * instead of rebuilding fd_sets for select on every main loop pass.
+ * File descriptors stay registered from GdPollSet until they are
+ * removed, so a wakeup costs only the number of ready descriptors.
+ * The main loop timeout, usually from GdGetNextTimeout, arms a
+ * timerfd on the monotonic clock kept in the same epoll set, which
+ * is reported as a MWPOLL_TIMER event alongside any ready input.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include "device.h"
+
+#if HAVE_EPOLL /* whole file*/
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define MAXALWAYSREADY	8		/* regular files registered*/
+
+static int pollfd = -1;			/* epoll set*/
+static int timerfd = -1;		/* main loop timeout timer*/
+static uint64_t timerarmed;		/* msecs timerfd is armed for, 0 if disarmed*/
+static int alwaysready[MAXALWAYSREADY];	/* fds epoll can't watch, always readable*/
+static int nalwaysready;
+
+/* create epoll set and timerfd on first use*/
+static int
+poll_open(void)
+{
+	struct epoll_event ev;
+
+	if (pollfd >= 0)
+		return 0;
+
+	if ((pollfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		EPRINTF("GdPollSet: can't create epoll set (%d)\n", errno);
+		return -1;
+	}
+
+	timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timerfd >= 0) {
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = timerfd;
+		epoll_ctl(pollfd, EPOLL_CTL_ADD, timerfd, &ev);
+	}
+	return 0;
+}
+
+/**
+ * Register, change or remove a file descriptor in the main loop epoll set.
+ *
+ * @param fd File descriptor, ignored if negative.
+ * @param events MWPOLL_READ, MWPOLL_WRITE and MWPOLL_EXCEPT flags, 0 to remove.
+ * @return 0 on success, -1 on error.
+ */
+int
+GdPollSet(int fd, int events)
+{
+	struct epoll_event ev;
+	int i;
+
+	if (fd < 0 || poll_open() < 0)
+		return -1;
+
+	for (i = 0; i < nalwaysready; i++) {
+		if (alwaysready[i] == fd) {
+			alwaysready[i] = alwaysready[--nalwaysready];
+			break;
+		}
+	}
+
+	if (!events) {
+		epoll_ctl(pollfd, EPOLL_CTL_DEL, fd, NULL);
+		return 0;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = ((events & MWPOLL_READ)? EPOLLIN: 0) |
+		((events & MWPOLL_WRITE)? EPOLLOUT: 0) |
+		((events & MWPOLL_EXCEPT)? EPOLLPRI: 0);
+	ev.data.fd = fd;
+	if (epoll_ctl(pollfd, EPOLL_CTL_ADD, fd, &ev) == 0)
+		return 0;
+	if (errno == EEXIST && epoll_ctl(pollfd, EPOLL_CTL_MOD, fd, &ev) == 0)
+		return 0;
+
+	/* regular files are always ready for select, but can't be in an epoll set*/
+	if (errno == EPERM && (events & MWPOLL_READ) && nalwaysready < MAXALWAYSREADY) {
+		alwaysready[nalwaysready++] = fd;
+		return 0;
+	}
+	EPRINTF("GdPollSet: can't register fd %d (%d)\n", fd, errno);
+	return -1;
+}
+
+/* arm timerfd to expire after tv, skipping the system call when unchanged*/
+static void
+poll_settimer(struct timeval *tv)
+{
+	struct itimerspec its;
+	struct timespec now;
+	uint64_t expiry;
+
+	memset(&its, 0, sizeof(its));
+	if (tv) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		expiry = (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000 +
+			tv->tv_sec * 1000 + tv->tv_usec / 1000;
+		if (expiry == timerarmed)
+			return;
+		timerarmed = expiry;
+		its.it_value.tv_sec = expiry / 1000;
+		its.it_value.tv_nsec = (expiry % 1000) * 1000000;
+		if (!its.it_value.tv_sec && !its.it_value.tv_nsec)
+			its.it_value.tv_nsec = 1;
+	} else {
+		if (!timerarmed)
+			return;
+		timerarmed = 0;
+	}
+	timerfd_settime(timerfd, tv? TFD_TIMER_ABSTIME: 0, &its, NULL);
+}
+
+/**
+ * Wait for input on the registered file descriptors or a timeout.
+ *
+ * @param events Returned ready file descriptors and their MWPOLL flags.
+ *		An expired timeout is returned as fd -1 with MWPOLL_TIMER.
+ * @param maxevents Size of events array.
+ * @param tv Timeout, NULL to block until input, zero to poll.
+ * @return Number of events returned, 0 if polling found no input, -1 on error.
+ */
+int
+GdPollWait(MWPOLLEVENT *events, int maxevents, struct timeval *tv)
+{
+	struct epoll_event ev[MAXPOLLEVENTS];
+	uint64_t expirations;
+	int i, n, timeout, count = 0;
+	int polling = (tv && !tv->tv_sec && !tv->tv_usec) || nalwaysready;
+
+	if (poll_open() < 0)
+		return -1;
+	if (maxevents > MAXPOLLEVENTS)
+		maxevents = MAXPOLLEVENTS;
+
+	if (polling)
+		timeout = 0;
+	else if (timerfd >= 0) {
+		poll_settimer(tv);
+		timeout = -1;
+	} else	/* without a timerfd, fall back to a millisecond epoll timeout*/
+		timeout = tv? (int)(tv->tv_sec * 1000 + (tv->tv_usec + 999) / 1000): -1;
+
+	n = epoll_wait(pollfd, ev, maxevents, timeout);
+	if (n < 0)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		if (ev[i].data.fd == timerfd) {
+			/* clear expiration and report timeout*/
+			if (read(timerfd, &expirations, sizeof(expirations)) > 0)
+				timerarmed = 0;
+			events[count].fd = -1;
+			events[count++].events = MWPOLL_TIMER;
+			continue;
+		}
+		events[count].fd = ev[i].data.fd;
+		events[count++].events = ((ev[i].events & (EPOLLIN|EPOLLHUP|EPOLLERR))? MWPOLL_READ: 0) |
+			((ev[i].events & EPOLLOUT)? MWPOLL_WRITE: 0) |
+			((ev[i].events & EPOLLPRI)? MWPOLL_EXCEPT: 0);
+	}
+
+	for (i = 0; i < nalwaysready && count < maxevents; i++) {
+		events[count].fd = alwaysready[i];
+		events[count++].events = MWPOLL_READ;
+	}
+
+	/* timeout expired without timerfd*/
+	if (count == 0 && !polling && tv && timerfd < 0) {
+		events[0].fd = -1;
+		events[0].events = MWPOLL_TIMER;
+		count = 1;
+	}
+	return count;
+}
+#endif /* HAVE_EPOLL*/
@@ -28,6 +28,9 @@ extern MWCOREFONT *user_builtin_fonts;
 
 static int utf8_to_utf16(const unsigned char *utf8, int cc, unsigned short *unicode16);
 int uc16_to_utf8(const unsigned short *us, int cc, unsigned char *s);
+#if MW_FEATURE_GLYPHCACHE
+static void gen_flushfontglyphs(PMWFONT pfont);
+#endif
 
 #if HAVE_FILEIO
 #include <stdio.h>
@@ -451,6 +454,9 @@ GdSetFontAttr(PMWFONT pfont, int setflags, int clrflags)
 void
 GdDestroyFont(PMWFONT pfont)
 {
+#if MW_FEATURE_GLYPHCACHE
+	gen_flushfontglyphs(pfont);
+#endif
 	if (pfont->fontprocs->DestroyFont)
 		pfont->fontprocs->DestroyFont(pfont);
 }
@@ -471,6 +477,87 @@ GdGetFontInfo(PMWFONT pfont, PMWFONTINFO pfontinfo)
 	return pfont->fontprocs->GetFontInfo(pfont, pfontinfo);
 }
 
+/* set ink extents of character from its glyph bitmap*/
+static void
+gen_inkextents(PMWFONT pfont, int ch, PMWCHARMETRICS mp)
+{
+	const MWIMAGEBITS *bitmap;
+	MWCOORD width, height, base;
+	int x, y, words;
+	int minx, maxx, miny, maxy;
+
+	pfont->fontprocs->GetTextBits(pfont, ch, &bitmap, &width, &height, &base);
+	if (!bitmap || width <= 0 || height <= 0)
+		return;
+
+	words = MWIMAGE_WORDS(width);
+	minx = width;
+	miny = height;
+	maxx = maxy = -1;
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			if (bitmap[y*words + (x >> 4)] & (MWIMAGE_FIRSTBIT >> (x & 15))) {
+				if (x < minx) minx = x;
+				if (x > maxx) maxx = x;
+				if (y < miny) miny = y;
+				maxy = y;
+			}
+		}
+	}
+
+	/* blank glyph has no ink*/
+	if (maxx < 0) {
+		mp->lbearing = mp->rbearing = mp->ascent = mp->descent = 0;
+		return;
+	}
+	mp->lbearing = minx;
+	mp->rbearing = maxx + 1;
+	mp->ascent = base - miny;
+	mp->descent = maxy + 1 - base;
+}
+
+/**
+ * Return the advance width and ink extents of a range of characters,
+ * allowing clients to measure text without a request per string.
+ * Ink extents are taken from the glyph bitmaps when the font renderer
+ * returns them, otherwise the advance width and font ascent and
+ * descent are used.  Kerning is not included.
+ *
+ * @param pfont The font to query.
+ * @param firstchar First character, as a unicode value.
+ * @param count Number of characters.
+ * @param metrics Receives count entries.
+ */
+void
+GdGetFontMetrics(PMWFONT pfont, int firstchar, int count, PMWCHARMETRICS metrics)
+{
+	MWFONTINFO	fi;
+	MWCOORD		width, height, base;
+	uint32_t	ch;
+	int			i;
+
+	if (!GdGetFontInfo(pfont, &fi)) {
+		memset(metrics, 0, count * sizeof(MWCHARMETRICS));
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		PMWCHARMETRICS mp = &metrics[i];
+
+		ch = firstchar + i;
+		GdGetTextSize(pfont, &ch, 1, &width, &height, &base, MWTF_UC32);
+		mp->width = width;
+		mp->lbearing = 0;
+		mp->rbearing = width;
+		mp->ascent = fi.baseline;
+		mp->descent = fi.descent;
+
+		/* glyph bitmaps are indexed in font encoding*/
+		if (pfont->fontprocs->GetTextBits && (ch < 256 || pfont->fontprocs->encoding != MWTF_ASCII))
+			gen_inkextents(pfont, ch, mp);
+	}
+}
+
 /**
  * Draws text onto a drawing surface (e.g. the screen or a double-buffer).
  * Uses the current font, current foreground color, and possibly the
@@ -560,6 +647,263 @@ GdText(PSD psd, PMWFONT pfont, MWCOORD x, MWCOORD y, const void *str, int cc,MWT
 		FREEA(buf);
 }
 
+#if MW_FEATURE_GLYPHCACHE
+/*
+ * Glyph cache for fonts drawn by gen_drawtext.
+ *
+ * Glyph bitmaps are copied once into a shared atlas, keyed by font,
+ * size, attributes and character, so that font drivers returning
+ * their bits in a static buffer (HBF, EUCJP) or decoding them on each
+ * call are only asked once.  A string is then assembled into a single
+ * 1bpp run bitmap and drawn with one clipped conversion blit, which
+ * also results in one screen driver Update for the whole string.
+ * Atlas rows are stored as 32 bit msb first values for fast packing.
+ * When the atlas or entry table fills up the entire cache is emptied.
+ */
+#define GLYPHCACHE_ENTRIES	1024		/* max cached glyphs*/
+#define GLYPHCACHE_HASH		256			/* hash buckets, must be power of 2*/
+#define GLYPHCACHE_ATLAS	(32*1024)	/* atlas size in 32 bit words*/
+
+typedef struct {
+	PMWFONT		pfont;		/* key: font, size, attributes and character*/
+	MWCOORD		fontsize;
+	MWCOORD		fontwidth;
+	int			fontattr;
+	int			ch;
+	int			next;		/* next glyph in hash chain or -1*/
+	MWCOORD		width;		/* glyph metrics from GetTextBits*/
+	MWCOORD		height;
+	int			pitch;		/* 32 bit words per glyph row*/
+	uint32_t *	bits;		/* glyph rows in atlas*/
+} MWGLYPH;
+
+static MWGLYPH *	glyphs;		/* glyph entries*/
+static int			glyphcount;
+static int			glyphhash[GLYPHCACHE_HASH];
+static int			glyphgen;	/* incremented each time cache is emptied*/
+static uint32_t *	glyphatlas;	/* packed glyph bitmaps*/
+static int			atlasused;
+static MWIMAGEBITS *runbits;	/* string bitmap for gen_drawtext*/
+static int			runsize;
+
+#define GLYPHHASH(pfont,ch)	((((uintptr_t)(pfont) >> 4) ^ (ch) ^ ((ch) >> 8)) & (GLYPHCACHE_HASH-1))
+
+/* empty the glyph cache*/
+static void
+gen_flushglyphs(void)
+{
+	int i;
+
+	for (i = 0; i < GLYPHCACHE_HASH; i++)
+		glyphhash[i] = -1;
+	glyphcount = 0;
+	atlasused = 0;
+	glyphgen++;
+}
+
+/* remove cached glyphs of a font that's being destroyed*/
+static void
+gen_flushfontglyphs(PMWFONT pfont)
+{
+	int i;
+
+	for (i = 0; i < glyphcount; i++) {
+		if (glyphs[i].pfont == pfont) {
+			gen_flushglyphs();
+			return;
+		}
+	}
+}
+
+/* return cached glyph for character, adding it to the atlas if required*/
+static MWGLYPH *
+gen_getglyph(PMWFONT pfont, int ch)
+{
+	MWGLYPH *gp;
+	const MWIMAGEBITS *bitmap;
+	MWCOORD width, height, base;
+	uint32_t *dst;
+	int n, h, pitch, words, srcwords;
+
+	if (!glyphs) {
+		glyphs = malloc(GLYPHCACHE_ENTRIES * sizeof(MWGLYPH));
+		glyphatlas = malloc(GLYPHCACHE_ATLAS * sizeof(uint32_t));
+		if (!glyphs || !glyphatlas) {
+			free(glyphs);
+			free(glyphatlas);
+			glyphs = NULL;
+			glyphatlas = NULL;
+			return NULL;
+		}
+		gen_flushglyphs();
+	}
+
+	h = GLYPHHASH(pfont, ch);
+	for (n = glyphhash[h]; n >= 0; n = gp->next) {
+		gp = &glyphs[n];
+		if (gp->pfont == pfont && gp->ch == ch && gp->fontsize == pfont->fontsize &&
+			gp->fontwidth == pfont->fontwidth && gp->fontattr == pfont->fontattr)
+				return gp;
+	}
+
+	pfont->fontprocs->GetTextBits(pfont, ch, &bitmap, &width, &height, &base);
+	if (width <= 0 || height <= 0)
+		width = height = 0;
+	pitch = (width + 31) >> 5;
+	words = pitch * height;
+	if (words > GLYPHCACHE_ATLAS)
+		return NULL;
+
+	/* start over when full*/
+	if (glyphcount >= GLYPHCACHE_ENTRIES || atlasused + words > GLYPHCACHE_ATLAS)
+		gen_flushglyphs();
+
+	gp = &glyphs[glyphcount];
+	gp->pfont = pfont;
+	gp->fontsize = pfont->fontsize;
+	gp->fontwidth = pfont->fontwidth;
+	gp->fontattr = pfont->fontattr;
+	gp->ch = ch;
+	gp->width = width;
+	gp->height = height;
+	gp->pitch = pitch;
+	gp->bits = dst = &glyphatlas[atlasused];
+	atlasused += words;
+
+	/* convert 16 bit image rows to 32 bit rows, clearing padding bits*/
+	srcwords = MWIMAGE_WORDS(width);
+	for (n = 0; n < height; n++) {
+		int i;
+
+		for (i = 0; i < srcwords; i += 2) {
+			uint32_t bits = (uint32_t)bitmap[i] << 16;
+
+			if (i + 1 < srcwords)
+				bits |= bitmap[i+1];
+			if (width - i*16 < 32)
+				bits &= ~(0xffffffffU >> (width - i*16));
+			*dst++ = bits;
+		}
+		bitmap += srcwords;
+	}
+
+	gp->next = glyphhash[h];
+	glyphhash[h] = glyphcount++;
+	return gp;
+}
+
+/*
+ * Assemble the glyphs of a string into one 1bpp bitmap and draw it with
+ * a single conversion blit.  Returns the x coordinate after the last
+ * character, or -1 if the string couldn't be handled here.
+ */
+static MWCOORD
+gen_drawglyphrun(PMWFONT pfont, PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
+	MWCOORD height, const void *text, int cc, int clip, MWBLITFUNC convblit,
+	PMWBLITPARMS parms)
+{
+	const unsigned char *str = text;
+	const unsigned short *istr = text;
+	int			uc16 = (pfont->fontprocs->encoding == MWTF_UC16);
+	int			pitch = MWIMAGE_WORDS(width);	/* run bitmap words per line*/
+	int			gen = glyphgen;
+	MWCOORD		runx = 0;
+	MWCOORD		drawwidth, bitx;
+	MWGLYPH **	run;
+	MWIMAGEBITS *dst;
+	int			used, count, row, i;
+
+	/* look up all glyphs first, the run ends at the text or screen width*/
+	run = ALLOCA(cc * sizeof(MWGLYPH *));
+	count = 0;
+	for (used = 0; used < cc && runx < width && x + runx < psd->xvirtres; used++) {
+		MWGLYPH *gp = gen_getglyph(pfont, uc16? *istr++: *str++);
+		if (!gp) {
+			FREEA(run);
+			return -1;
+		}
+		/* check bad return from GetTextBits*/
+		if (gp->width == 0)
+			continue;
+		run[count++] = gp;
+		runx += gp->width;
+	}
+	/* cache emptied while looking up glyphs, earlier entries were reused*/
+	if (gen != glyphgen) {
+		FREEA(run);
+		return -1;
+	}
+	drawwidth = MWMIN(runx, width);
+
+	if (pitch * height + 2 > runsize) {
+		MWIMAGEBITS *bits = realloc(runbits, (pitch * height + 2) * sizeof(MWIMAGEBITS));
+		if (!bits) {
+			FREEA(run);
+			return -1;
+		}
+		runbits = bits;
+		runsize = pitch * height + 2;
+	}
+
+	/*
+	 * OR each glyph into the run bitmap at its bit offset.  Rows are
+	 * independent so the loop pipelines well.  Stores may spill zero
+	 * bits into the next line, runbits has 2 words slack for the last.
+	 */
+	memset(runbits, 0, pitch * height * sizeof(MWIMAGEBITS));
+	bitx = 0;
+	for (i = 0; i < count && bitx < drawwidth; i++) {
+		MWGLYPH *gp = run[i];
+		int w = MWMIN(gp->width, drawwidth - bitx);
+		int h = MWMIN(gp->height, height);
+		int shift = bitx & 15;
+		int k;
+
+		for (k = 0; k < gp->pitch && k * 32 < w; k++) {
+			const uint32_t *src = gp->bits + k;
+			uint32_t mask = (w - k*32 < 32)? ~(0xffffffffU >> (w - k*32)): 0xffffffffU;
+
+			dst = runbits + ((bitx + k*32) >> 4);
+			for (row = 0; row < h; row++) {
+				uint64_t bits = ((uint64_t)(*src & mask) << 32) >> shift;
+
+				dst[0] |= bits >> 48;
+				dst[1] |= bits >> 32;
+				dst[2] |= bits >> 16;
+				src += gp->pitch;
+				dst += pitch;
+			}
+		}
+		bitx += gp->width;
+	}
+
+	parms->dstx = x;
+	parms->dsty = y;
+	parms->width = drawwidth;
+	parms->height = height;
+	parms->src_pitch = pitch * sizeof(MWIMAGEBITS);
+	parms->data = (char *)runbits;
+	/* skip clipping checks if fully visible*/
+	if (drawwidth > 0) {
+		if (clip == CLIP_VISIBLE)
+			convblit(psd, parms);
+		else
+			GdConversionBlit(psd, parms);
+	}
+
+	/* advance over characters not drawn to return same end as per-glyph loop*/
+	cc -= used;
+	while (--cc >= 0 && x + runx < psd->xvirtres) {
+		MWGLYPH *gp = gen_getglyph(pfont, uc16? *istr++: *str++);
+		if (!gp)
+			break;
+		runx += gp->width;
+	}
+	FREEA(run);
+	return x + runx;
+}
+#endif /* MW_FEATURE_GLYPHCACHE*/
+
 /*
  * Draw ASCII or MWTF_UC16 text using COREFONT type font (buitin, PCF, FNT)
  */
@@ -626,6 +970,18 @@ gen_drawtext(PMWFONT pfont, PSD psd, MWCOORD x, MWCOORD y,
 		return;
 	}
 
+#if MW_FEATURE_GLYPHCACHE
+	/* draw whole string with one blit using cached glyphs*/
+	if (convblit && !(flags & MWTF_DBCSMASK)) {
+		MWCOORD endx = gen_drawglyphrun(pfont, psd, x, y, width, height, text, cc,
+			clip, convblit, &parms);
+		if (endx >= 0) {
+			x = endx;
+			goto done;
+		}
+	}
+#endif
+
 	/*
 	 * Get the bitmap for each character individually, and then display
 	 * them possibly using clipping for each one.
@@ -676,6 +1032,9 @@ gen_drawtext(PMWFONT pfont, PSD psd, MWCOORD x, MWCOORD y,
 		x += width;
 	}
 
+#if MW_FEATURE_GLYPHCACHE
+done:
+#endif
 	if (pfont->fontattr & MWTF_UNDERLINE)
 		GdLine(psd, startx, starty, x, starty, FALSE);
 
@@ -1014,6 +1373,112 @@ GdDuplicateFont(PSD psd, PMWFONT psrcfont, MWCOORD height, MWCOORD width)
 	return psrcfont;
 }
 
+/*
+ * Loaded font data registry.
+ *
+ * Font renderers register the data parsed from a font file, keyed by
+ * file path and whatever size and attributes the data depends on, so
+ * that every client creating the same font shares one copy.  Each
+ * GdCreateFont still returns its own font header, so per-font size,
+ * rotation and attribute changes don't affect other users of the data.
+ */
+typedef struct _mwfontdata {
+	struct _mwfontdata *next;
+	char *		path;			/* font file path*/
+	MWCOORD		height;			/* key size and attributes*/
+	MWCOORD		width;
+	int			attr;
+	int			refcount;		/* fonts using data*/
+	void *		data;			/* renderer font data*/
+	void		(*freedata)(void *data);
+} MWFONTDATA;
+
+static MWFONTDATA *fontdatalist;
+
+/**
+ * Find loaded font data and add a reference to it.
+ *
+ * @param path   Full path of font file.
+ * @param height Height the data was loaded at, 0 if independent of size.
+ * @param width  Width the data was loaded at, 0 if independent of size.
+ * @param attr   Attributes the data was loaded with, 0 if independent.
+ * @return       Font data, or NULL if not loaded.
+ */
+void *
+GdFindFontData(const char *path, MWCOORD height, MWCOORD width, int attr)
+{
+	MWFONTDATA *fdp;
+
+	for (fdp = fontdatalist; fdp; fdp = fdp->next) {
+		if (fdp->height == height && fdp->width == width && fdp->attr == attr &&
+		    !strcmp(fdp->path, path)) {
+			fdp->refcount++;
+			DPRINTF("GdFindFontData: sharing %s (%d)\n", path, fdp->refcount);
+			return fdp->data;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Register newly loaded font data with a reference count of one.
+ *
+ * @param path     Full path of font file.
+ * @param height   Key height, see GdFindFontData.
+ * @param width    Key width.
+ * @param attr     Key attributes.
+ * @param data     Font data.
+ * @param freedata Routine to free data when the last reference is released.
+ * @return         TRUE on success, FALSE if out of memory.
+ */
+MWBOOL
+GdAddFontData(const char *path, MWCOORD height, MWCOORD width, int attr,
+	void *data, void (*freedata)(void *data))
+{
+	MWFONTDATA *fdp = malloc(sizeof(MWFONTDATA));
+
+	if (!fdp)
+		return FALSE;
+	fdp->path = strdup(path);
+	if (!fdp->path) {
+		free(fdp);
+		return FALSE;
+	}
+	fdp->height = height;
+	fdp->width = width;
+	fdp->attr = attr;
+	fdp->refcount = 1;
+	fdp->data = data;
+	fdp->freedata = freedata;
+	fdp->next = fontdatalist;
+	fontdatalist = fdp;
+	return TRUE;
+}
+
+/**
+ * Release a reference to font data, freeing it when no fonts use it.
+ *
+ * @param data Font data from GdFindFontData or GdAddFontData.
+ */
+void
+GdReleaseFontData(void *data)
+{
+	MWFONTDATA *fdp, **link;
+
+	for (link = &fontdatalist; (fdp = *link) != NULL; link = &fdp->next) {
+		if (fdp->data == data) {
+			if (--fdp->refcount > 0)
+				return;
+			*link = fdp->next;
+			DPRINTF("GdReleaseFontData: freeing %s\n", fdp->path);
+			fdp->freedata(fdp->data);
+			free(fdp->path);
+			free(fdp);
+			return;
+		}
+	}
+}
+
 /**
  * UTF-8 to UTF-16 conversion.  Surrogates are handeled properly, e.g.
  * a single 4-byte UTF-8 character is encoded into a surrogate pair.
@@ -34,7 +34,10 @@
 
 #if MW_FEATURE_IMAGES /* whole file */
 
-static PSD GdDecodeImage(buffer_t *src, char *path, int flags);
+static PSD GdDecodeImage(buffer_t *src, char *path, int flags, MWCOORD width, MWCOORD height);
+#if HAVE_FILEIO
+static PSD GdLoadImageToFit(char *path, int flags, MWCOORD width, MWCOORD height);
+#endif
 
 /*
  * Buffered input functions to replace stdio functions
@@ -110,6 +113,192 @@ GdImageBufferEOF(buffer_t *buffer)
 }
  
 
+#if HAVE_FILEIO && IMAGECACHE_SIZE
+/*
+ * Decoded image cache.
+ *
+ * Images drawn or loaded from files are kept decoded at their drawn
+ * size, keyed by path, file modification time and size, draw size,
+ * load flags and screen format, so redrawing the same file is a single
+ * blit.  The least recently used images are freed to keep the pixel
+ * memory within the budget set by IMAGECACHE_SIZE or GdSetImageCacheSize.
+ */
+typedef struct imagecache {
+	struct imagecache *next;	/* LRU list, most recently used first*/
+	struct imagecache *prev;
+	PSD		pmd;			/* decoded image*/
+	long	bytes;			/* memory used by image*/
+	time_t	mtime;			/* file modification time*/
+	off_t	filesize;		/* file size*/
+	MWCOORD	width;			/* drawn size, -1 for image size*/
+	MWCOORD	height;
+	int		flags;			/* load flags*/
+	int		data_format;	/* screen format decoded for*/
+	char	path[1];		/* file name, allocated with entry*/
+} IMAGECACHE;
+
+static IMAGECACHE *imagecache_head;	/* most recently used*/
+static IMAGECACHE *imagecache_tail;	/* least recently used*/
+static long	imagecache_bytes;		/* memory used by cached images*/
+static long	imagecache_max = IMAGECACHE_SIZE * 1024L;	/* memory budget*/
+
+/* unlink and free a cached image*/
+static void
+imagecache_free(IMAGECACHE *ip)
+{
+	if (ip->prev)
+		ip->prev->next = ip->next;
+	else imagecache_head = ip->next;
+	if (ip->next)
+		ip->next->prev = ip->prev;
+	else imagecache_tail = ip->prev;
+
+	imagecache_bytes -= ip->bytes;
+	GDSTAT_ADD(imagebytes, -ip->bytes);
+	GDSTAT_ADD(imagecount, -1);
+	GdFreePixmap(ip->pmd);
+	free(ip);
+}
+
+/* free least recently used images until bytes more will fit in budget*/
+static void
+imagecache_trim(long bytes)
+{
+	while (imagecache_tail && imagecache_bytes + bytes > imagecache_max) {
+		imagecache_free(imagecache_tail);
+		GDSTAT_ADD(imageevictions, 1);
+	}
+}
+
+/* find cached image and make it most recently used, freeing out of date copies*/
+static IMAGECACHE *
+imagecache_find(char *path, struct stat *st, int flags, MWCOORD width, MWCOORD height)
+{
+	IMAGECACHE *ip;
+
+	for (ip = imagecache_head; ip; ip = ip->next) {
+		if (ip->width != width || ip->height != height || ip->flags != flags ||
+		    ip->data_format != scrdev.data_format || strcmp(ip->path, path) != 0)
+			continue;
+
+		if (ip->mtime != st->st_mtime || ip->filesize != st->st_size) {
+			imagecache_free(ip);		/* file changed*/
+			break;
+		}
+
+		/* move to front of LRU list*/
+		if (ip != imagecache_head) {
+			ip->prev->next = ip->next;
+			if (ip->next)
+				ip->next->prev = ip->prev;
+			else imagecache_tail = ip->prev;
+			ip->prev = NULL;
+			ip->next = imagecache_head;
+			imagecache_head->prev = ip;
+			imagecache_head = ip;
+		}
+		GDSTAT_ADD(imagehits, 1);
+		return ip;
+	}
+	GDSTAT_ADD(imagemisses, 1);
+	return NULL;
+}
+
+/* add decoded image to cache, returns NULL if too large and not cached*/
+static IMAGECACHE *
+imagecache_add(char *path, struct stat *st, int flags, MWCOORD width, MWCOORD height, PSD pmd)
+{
+	IMAGECACHE *ip;
+	long bytes = pmd->size + pmd->palsize * sizeof(MWPALENTRY) + sizeof(SCREENDEVICE);
+
+	if (bytes > imagecache_max)
+		return NULL;
+	if ((ip = malloc(sizeof(IMAGECACHE) + strlen(path))) == NULL)
+		return NULL;
+	imagecache_trim(bytes);
+
+	strcpy(ip->path, path);
+	ip->pmd = pmd;
+	ip->bytes = bytes;
+	ip->mtime = st->st_mtime;
+	ip->filesize = st->st_size;
+	ip->width = width;
+	ip->height = height;
+	ip->flags = flags;
+	ip->data_format = scrdev.data_format;
+
+	ip->prev = NULL;
+	ip->next = imagecache_head;
+	if (imagecache_head)
+		imagecache_head->prev = ip;
+	else imagecache_tail = ip;
+	imagecache_head = ip;
+
+	imagecache_bytes += bytes;
+	GDSTAT_ADD(imagebytes, bytes);
+	GDSTAT_ADD(imagecount, 1);
+	return ip;
+}
+
+/* create empty image of same format as pmd with copy of its palette*/
+static PSD
+GdCreateImageLike(PSD pmd, MWCOORD width, MWCOORD height)
+{
+	PSD pmd2;
+
+	pmd2 = GdCreatePixmap(&scrdev, width, height,
+		(pmd->data_format == scrdev.data_format)? 0: pmd->data_format, NULL, pmd->palsize);
+	if (!pmd2)
+		return NULL;
+
+	pmd2->transcolor = pmd->transcolor;
+	if (pmd->palsize && pmd->palette)
+		memcpy(pmd2->palette, pmd->palette, pmd->palsize * sizeof(MWPALENTRY));
+	return pmd2;
+}
+
+/* return image stretched to drawn size, freeing original, or NULL if no memory*/
+static PSD
+GdResizeImage(PSD pmd, MWCOORD width, MWCOORD height)
+{
+	MWCLIPRECT	rcDst;
+	PSD pmd2;
+
+	if (width < 0)
+		width = pmd->xvirtres;
+	if (height < 0)
+		height = pmd->yvirtres;
+	if (width == pmd->xvirtres && height == pmd->yvirtres)
+		return pmd;
+
+	if ((pmd2 = GdCreateImageLike(pmd, width, height)) == NULL)
+		return NULL;
+
+	rcDst.x = 0;
+	rcDst.y = 0;
+	rcDst.width = width;
+	rcDst.height = height;
+	GdStretchImage((PMWIMAGEHDR)pmd, NULL, (PMWIMAGEHDR)pmd2, &rcDst);	// FIXME casting MWIMAGEHDR
+	GdFreePixmap(pmd);
+	return pmd2;
+}
+#endif /* HAVE_FILEIO && IMAGECACHE_SIZE*/
+
+/**
+ * Set the memory budget for decoded image files kept by
+ * GdDrawImageFromFile and GdLoadImageFromFile.
+ *
+ * @param bytes Maximum memory used by cached images, 0 to free all and disable.
+ */
+void
+GdSetImageCacheSize(long bytes)
+{
+#if HAVE_FILEIO && IMAGECACHE_SIZE
+	imagecache_max = bytes;
+	imagecache_trim(0);
+#endif
+}
+
 /**
  * Load an image from a memory buffer.
  *
@@ -123,7 +312,7 @@ GdLoadImageFromBuffer(void *buffer, int size, int flags)
 	buffer_t src;
 
 	GdImageBufferInit(&src, buffer, size);
-	return GdDecodeImage(&src, NULL, flags);
+	return GdDecodeImage(&src, NULL, flags, -1, -1);
 }
 
 /**
@@ -148,7 +337,7 @@ GdDrawImageFromBuffer(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
 	buffer_t src;
 
 	GdImageBufferInit(&src, buffer, size);
-	pmd = GdDecodeImage(&src, NULL, flags);
+	pmd = GdDecodeImage(&src, NULL, flags, width, height);
 
 	if (pmd) {
 		GdDrawImagePartToFit(psd, x, y, width, height, 0, 0, 0, 0, pmd);
@@ -175,8 +364,30 @@ GdDrawImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height
 	char *path, int flags)
 {
 	PSD	pmd;
+#if IMAGECACHE_SIZE
+	PSD pmd2;
+	struct stat st;
+	IMAGECACHE *ip;
+
+	if (imagecache_max && stat(path, &st) == 0) {
+		/* draw cached image with a single blit*/
+		if ((ip = imagecache_find(path, &st, flags, width, height)) != NULL) {
+			GdDrawImage(psd, x, y, (PMWIMAGEHDR)ip->pmd);	// FIXME casting MWIMAGEHDR
+			return;
+		}
 
-	pmd = GdLoadImageFromFile(path, flags);
+		/* decode and stretch to drawn size once, then cache*/
+		if ((pmd = GdLoadImageToFit(path, flags, width, height)) == NULL)
+			return;
+		if ((pmd2 = GdResizeImage(pmd, width, height)) != NULL) {
+			GdDrawImage(psd, x, y, (PMWIMAGEHDR)pmd2);
+			if (!imagecache_add(path, &st, flags, width, height, pmd2))
+				GdFreePixmap(pmd2);
+			return;
+		}
+	} else
+#endif
+	pmd = GdLoadImageToFit(path, flags, width, height);
 	if (pmd) {
 		GdDrawImagePartToFit(psd, x, y, width, height, 0, 0, 0, 0, pmd);
 		pmd->FreeMemGC(pmd);
@@ -191,6 +402,34 @@ GdDrawImageFromFile(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height
  */
 PSD
 GdLoadImageFromFile(char *path, int flags)
+{
+#if IMAGECACHE_SIZE
+	PSD	pmd, pmd2;
+	struct stat st;
+	IMAGECACHE *ip;
+
+	/* return copy of cached image, caller frees it*/
+	if (imagecache_max && stat(path, &st) == 0) {
+		if ((ip = imagecache_find(path, &st, flags, -1, -1)) == NULL) {
+			if ((pmd = GdLoadImageToFit(path, flags, -1, -1)) == NULL)
+				return NULL;
+			if ((ip = imagecache_add(path, &st, flags, -1, -1, pmd)) == NULL)
+				return pmd;
+		}
+		if ((pmd2 = GdCreateImageLike(ip->pmd, ip->pmd->xvirtres, ip->pmd->yvirtres)) != NULL)
+			memcpy(pmd2->addr, ip->pmd->addr, pmd2->size);
+		return pmd2;
+	}
+#endif
+	return GdLoadImageToFit(path, flags, -1, -1);
+}
+
+/*
+ * Load an image from a file, decoding JPEG images at the
+ * smallest size at or above width x height, if >= 0.
+ */
+static PSD
+GdLoadImageToFit(char *path, int flags, MWCOORD width, MWCOORD height)
 {
 	int fd;
 	PSD	pmd;
@@ -227,7 +466,7 @@ GdLoadImageFromFile(char *path, int flags)
 #endif
 
 	GdImageBufferInit(&src, buffer, s.st_size);
-	pmd = GdDecodeImage(&src, path, flags);
+	pmd = GdDecodeImage(&src, path, flags, width, height);
 	if (!pmd)
 		EPRINTF("GdLoadImageFromFile: No decoder for image: %s\n", path);
 
@@ -420,11 +659,13 @@ DPRINTF("Converting %dbpp image to RGBA\n", pmd->bpp);
  * GdDecodeImage:
  * @src: The image data.
  * @flags: If nonzero, JPEG images will be loaded as grayscale.  Yuck!
+ * @width, @height: If >= 0, size image will be drawn at, JPEG images
+ *	are downscaled while decoding when larger.
  *
  * Load an image into a pixmap.
  */
 static PSD
-GdDecodeImage(buffer_t *src, char *path, int flags)
+GdDecodeImage(buffer_t *src, char *path, int flags, MWCOORD width, MWCOORD height)
 {
 	PSD	pmd = NULL;
 	int	op;
@@ -444,7 +685,7 @@ GdDecodeImage(buffer_t *src, char *path, int flags)
 		break;
 #endif
 #if HAVE_JPEG_SUPPORT
-	if ((pmd = GdDecodeJPEG(src, flags)) != NULL)
+	if ((pmd = GdDecodeJPEG(src, flags, width, height)) != NULL)
 		break;
 #endif
 #if HAVE_PNG_SUPPORT
@@ -64,6 +64,79 @@ static void copy_row3(unsigned char *src, int src_w, unsigned char *dst,
 	}
 }
 
+/* stretch blit parameters, shared by all row bands*/
+typedef struct {
+	PMWIMAGEHDR		src;
+	MWCLIPRECT *	srcrect;
+	PMWIMAGEHDR		dst;
+	MWCLIPRECT *	dstrect;
+	int				bytesperpixel;
+	int				inc;		/* source rows per dest row, 16.16*/
+} STRETCHPARMS;
+
+/* stretch dest rows first through first+count-1*/
+static void
+stretch_rows(STRETCHPARMS *sp, int first, int count)
+{
+	PMWIMAGEHDR src = sp->src;
+	PMWIMAGEHDR dst = sp->dst;
+	MWCLIPRECT *srcrect = sp->srcrect;
+	MWCLIPRECT *dstrect = sp->dstrect;
+	int bytesperpixel = sp->bytesperpixel;
+	int pos;
+	int dst_maxrow;
+	int src_row, dst_row;
+	MWUCHAR *srcp = 0;
+	MWUCHAR *dstp;
+
+	/* Set up the data, starting first rows down... */
+	pos = 0x10000 + first * sp->inc;
+	src_row = srcrect->y + (pos >> 16) - 1;
+	pos &= 0xffff;
+	pos += 0x10000;
+	dst_row = dstrect->y + first;
+
+	/* Perform the stretch blit */
+	for ( dst_maxrow = dst_row+count; dst_row<dst_maxrow; ++dst_row ) {
+		dstp = (MWUCHAR *)dst->imagebits + (dst_row*dst->pitch) + (dstrect->x*bytesperpixel);
+		while ( pos >= 0x10000L ) {
+			srcp = (MWUCHAR *)src->imagebits + (src_row*src->pitch) + (srcrect->x*bytesperpixel);
+			++src_row;
+			pos -= 0x10000L;
+		}
+
+		switch (bytesperpixel) {
+		case 1:
+			copy_row1(srcp, srcrect->width, dstp, dstrect->width);
+			break;
+		case 2:
+			copy_row2((unsigned short *)srcp, srcrect->width, (unsigned short *)dstp, dstrect->width);
+			break;
+		case 3:
+			copy_row3(srcp, srcrect->width, dstp, dstrect->width);
+			break;
+		case 4:
+			copy_row4((uint32_t *)srcp, srcrect->width, (uint32_t *)dstp, dstrect->width);
+			break;
+		}
+
+		pos += sp->inc;
+	}
+}
+
+#if MW_FEATURE_BLITTHREADS
+static void
+stretch_band(void *arg, int band, int nbands)
+{
+	STRETCHPARMS *sp = arg;
+	int height = sp->dstrect->height;
+
+	/* split rows evenly, earlier bands get the remainder*/
+	stretch_rows(sp, band * (height / nbands) + MWMIN(band, height % nbands),
+		height / nbands + (band < height % nbands));
+}
+#endif
+
 /**
  * Perform a stretch blit between two image structs of the same format.
  *
@@ -75,15 +148,14 @@ static void copy_row3(unsigned char *src, int src_w, unsigned char *dst,
 void
 GdStretchImage(PMWIMAGEHDR src, MWCLIPRECT *srcrect, PMWIMAGEHDR dst, MWCLIPRECT *dstrect)
 {
-	int pos, inc;
-	int dst_maxrow;
-	int src_row, dst_row;
-	MWUCHAR *srcp = 0;
-	MWUCHAR *dstp;
+	STRETCHPARMS parms;
 	MWCLIPRECT full_src;
 	MWCLIPRECT full_dst;
 	int srcbytesperpixel = (src->bpp + 7) / 8;
 	int bytesperpixel = (dst->bpp + 7) / 8;
+#if MW_FEATURE_BLITTHREADS
+	int nbands;
+#endif
 
 	if ( bytesperpixel != srcbytesperpixel ) {
 		EPRINTF("GdStretchImage: bytesperpixel mismatch\n");
@@ -123,37 +195,20 @@ GdStretchImage(PMWIMAGEHDR src, MWCLIPRECT *srcrect, PMWIMAGEHDR dst, MWCLIPRECT
 		dstrect = &full_dst;
 	}
 
-	/* Set up the data... */
-	pos = 0x10000;
-	inc = (srcrect->height << 16) / dstrect->height;
-	src_row = srcrect->y;
-	dst_row = dstrect->y;
-
-	/* Perform the stretch blit */
-	for ( dst_maxrow = dst_row+dstrect->height; dst_row<dst_maxrow; ++dst_row ) {
-		dstp = (MWUCHAR *)dst->imagebits + (dst_row*dst->pitch) + (dstrect->x*bytesperpixel);
-		while ( pos >= 0x10000L ) {
-			srcp = (MWUCHAR *)src->imagebits + (src_row*src->pitch) + (srcrect->x*bytesperpixel);
-			++src_row;
-			pos -= 0x10000L;
-		}
-
-		switch (bytesperpixel) {
-		case 1:
-			copy_row1(srcp, srcrect->width, dstp, dstrect->width);
-			break;
-		case 2:
-			copy_row2((unsigned short *)srcp, srcrect->width, (unsigned short *)dstp, dstrect->width);
-			break;
-		case 3:
-			copy_row3(srcp, srcrect->width, dstp, dstrect->width);
-			break;
-		case 4:
-			copy_row4((uint32_t *)srcp, srcrect->width, (uint32_t *)dstp, dstrect->width);
-			break;
-		}
+	parms.src = src;
+	parms.srcrect = srcrect;
+	parms.dst = dst;
+	parms.dstrect = dstrect;
+	parms.bytesperpixel = bytesperpixel;
+	parms.inc = (srcrect->height << 16) / dstrect->height;
 
-		pos += inc;
+#if MW_FEATURE_BLITTHREADS
+	/* rows are independent, draw large images in bands*/
+	if ((nbands = GdBandCount(dstrect->width, dstrect->height)) > 1) {
+		GdRunBands(stretch_band, &parms, nbands);
+		return;
 	}
+#endif
+	stretch_rows(&parms, 0, dstrect->height);
 }
 #endif /* MW_FEATURE_IMAGES*/
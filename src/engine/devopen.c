@@ -13,6 +13,9 @@
  */
 #include <stdlib.h>
 #include "device.h"
+#if !SWIEROS
+#include "convblit.h"
+#endif
 
 #if MSDOS | ELKS
 #define NOSTDPAL8
@@ -60,6 +63,11 @@ GdOpenScreenExt(MWBOOL clearflag)
 	if (!psd)
 		return NULL;
 
+#if !SWIEROS
+	/* select SIMD convblit row kernels for this cpu*/
+	convblit_simd_init();
+#endif
+
 #if MW_FEATURE_PALETTE
 	/* assume no user changable palette entries*/
 	gr_firstuserpalentry = (int)psd->ncolors;
@@ -0,0 +1,62 @@
+/*
+ * Engine drawing statistics
+ *
+ * When MW_FEATURE_STATS is set, conversion and stretch blits count the
+ * pixels they draw for each source and destination format pair along
+ * with the clip rectangles they walk, and delayed update drivers count
+ * the screen area flushed in GdFlushUpdateRegion. The nano-X server
+ * returns these with its own counters through GrGetServerStats.
+ */
+#include <string.h>
+#include "device.h"
+
+#if MW_FEATURE_STATS /* whole file*/
+MWDRAWSTATS	gddrawstats;			/* accumulated drawing statistics*/
+
+/**
+ * Count a blit of pixels from one image format to another.
+ * Format pairs past MWSTATS_MAXBLITS are not counted.
+ *
+ * @param srcformat MWIF_ source data format.
+ * @param dstformat MWIF_ destination screen format.
+ * @param pixels Number of pixels drawn after clipping.
+ */
+void
+GdStatBlit(int srcformat, int dstformat, long pixels)
+{
+	MWBLITSTAT *bp = gddrawstats.blit;
+	int n;
+
+	for (n = gddrawstats.nblits; --n >= 0; bp++)
+		if (bp->srcformat == srcformat && bp->dstformat == dstformat)
+			goto found;
+
+	if (gddrawstats.nblits >= MWSTATS_MAXBLITS)
+		return;
+	bp = &gddrawstats.blit[gddrawstats.nblits++];
+	bp->srcformat = srcformat;
+	bp->dstformat = dstformat;
+found:
+	bp->count++;
+	bp->pixels += pixels;
+}
+
+/**
+ * Copy the drawing statistics and optionally start counting again.
+ *
+ * @param sp Returned statistics.
+ * @param reset Nonzero to clear the counters after copying.
+ */
+void
+GdGetDrawStats(MWDRAWSTATS *sp, int reset)
+{
+	*sp = gddrawstats;
+	if (reset) {
+		memset(&gddrawstats, 0, sizeof(gddrawstats));
+
+		/* keep image cache usage*/
+		gddrawstats.imagebytes = sp->imagebytes;
+		gddrawstats.imagecount = sp->imagecount;
+	}
+}
+#endif /* MW_FEATURE_STATS*/
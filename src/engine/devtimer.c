@@ -31,14 +31,13 @@
  * GdGetNextTimeout(). GdGetNextTimeout() is called with the event loop
  * timeout in ms, and fills in the specified timeout structure, which should
  * be used as the argument to the select() call. The timeout returned by the
- * GdGetNextTimeout() call is decided by looking through the timer list for
- * the timer with the shortest amount of time remaining, and also at the
- * maximum delay parameter. If there are no timers on the timer list and the
+ * GdGetNextTimeout() call is decided by the timer with the shortest amount
+ * of time remaining, and also by the maximum delay parameter. If there are no timers on the timer list and the
  * timeout argument is 0, it will return FALSE, otherwise it will return TRUE.
  *
  * When the main select() loop times out, the GdTimeout() function should be
- * called. This will go through the timer list and call the callback functions
- * of all timers which have expired, then remove them from the timer list. At
+ * called. This will call the callback functions of all timers which have
+ * expired, removing one-shot timers and rescheduling periodic ones. At
  * the same time, you should check the value of the maximum timeout parameter
  * to see if it has expired (in which case you can then return to the client
  * with a timeout event). This function returns TRUE if the timeout specified in
@@ -50,50 +49,163 @@
  * complete. Especially in the case where the client is linked into the server,
  * the client must call into the server on a regular basis, otherwise the
  * timers may run late.
+ *
+ * Timers are kept in a binary min-heap ordered by expiry time, so adding,
+ * destroying and running a timer take O(log n) and finding the next one
+ * O(1), and in a hash table on the callback argument for GdFindTimer.
+ * Expiry times are taken from the monotonic clock, so timers are not
+ * affected by changes to the wall clock time.
  */
 #include <stdlib.h>
+#include <time.h>
 #include "device.h"
 
 #if MW_FEATURE_TIMERS
 
-static MWTIMER *timerlist = NULL;
-static struct timeval mainloop_timeout;
-static struct timeval current_time;
+#define TIMERHASH	64		/* GdFindTimer hash buckets, power of 2*/
+#define HASHARG(arg)	((((unsigned long)(arg)) >> 4) & (TIMERHASH-1))
 
-static void calculate_timeval(struct timeval *tv, MWTIMEOUT to); 
-static long time_to_expiry(struct timeval *t);
+static MWTIMER **timerheap;		/* min-heap of timers by expiry*/
+static int ntimers;			/* timers in heap*/
+static int heapsize;			/* allocated heap entries*/
+static MWTIMER *timerhash[TIMERHASH];	/* timers by callback arg*/
+static uint64_t mainloop_expiry;	/* GdGetNextTimeout expiry, 0 if none*/
 
-/**
- * Create a new one-shot timer.
- *
- * @param timeout number of milliseconds before the timer should activate
- * @param callback Callback function to call when timer fires.
- * @param arg Opaque argument to pass to callback function.
- * @return Timer handle.  NOTE that this is automatically destroyed
- * after the callback function has been called.
- */
-MWTIMER *GdAddTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
+/* return msecs from the monotonic clock*/
+static uint64_t
+current_time(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+/* store timer at heap position i*/
+static void
+heap_set(int i, MWTIMER *t)
+{
+	timerheap[i] = t;
+	t->index = i;
+}
+
+/* move timer at position i towards the root while earlier than its parent*/
+static void
+heap_up(int i)
+{
+	MWTIMER *t = timerheap[i];
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (timerheap[parent]->expiry <= t->expiry)
+			break;
+		heap_set(i, timerheap[parent]);
+		i = parent;
+	}
+	heap_set(i, t);
+}
+
+/* move timer at position i towards the leaves while later than a child*/
+static void
+heap_down(int i)
+{
+	MWTIMER *t = timerheap[i];
+
+	for (;;) {
+		int child = 2 * i + 1;
+
+		if (child >= ntimers)
+			break;
+		if (child + 1 < ntimers && timerheap[child + 1]->expiry < timerheap[child]->expiry)
+			child++;
+		if (t->expiry <= timerheap[child]->expiry)
+			break;
+		heap_set(i, timerheap[child]);
+		i = child;
+	}
+	heap_set(i, t);
+}
+
+/* remove timer from heap and hash table*/
+static void
+remove_timer(MWTIMER *timer)
+{
+	int i = timer->index;
+
+	if (--ntimers > i) {
+		/* fill hole with last timer, which can move either way*/
+		heap_set(i, timerheap[ntimers]);
+		heap_up(i);
+		heap_down(i);
+	}
+
+	if (timer->hashnext)
+		timer->hashnext->hashprev = timer->hashprev;
+	if (timer->hashprev)
+		timer->hashprev->hashnext = timer->hashnext;
+	else timerhash[HASHARG(timer->arg)] = timer->hashnext;
+}
+
+/* create a timer and add it to heap and hash table*/
+static MWTIMER *
+add_timer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg, int type)
 {
 	MWTIMER *newtimer;
+	MWTIMER **bucket;
 
-	if(!(newtimer = malloc(sizeof(MWTIMER)))) return NULL;
+	if (ntimers >= heapsize) {
+		int newsize = heapsize? heapsize * 2: 32;
+		MWTIMER **newheap = realloc(timerheap, newsize * sizeof(MWTIMER *));
 
-	gettimeofday(&current_time, NULL);
+		if (!newheap)
+			return NULL;
+		timerheap = newheap;
+		heapsize = newsize;
+	}
 
-	if(timerlist) timerlist->prev = newtimer;
+	if(!(newtimer = malloc(sizeof(MWTIMER)))) return NULL;
 
-	calculate_timeval(&newtimer->timeout, timeout);
+	newtimer->expiry = current_time() + timeout;
 	newtimer->callback = callback;
 	newtimer->arg = arg;
-	newtimer->next = timerlist;
-	newtimer->prev = NULL;
-	newtimer->type   = MWTIMER_ONESHOT;
+	newtimer->type = type;
 	newtimer->period = timeout;
-	timerlist = newtimer;
+
+	bucket = &timerhash[HASHARG(arg)];
+	newtimer->hashprev = NULL;
+	newtimer->hashnext = *bucket;
+	if (*bucket)
+		(*bucket)->hashprev = newtimer;
+	*bucket = newtimer;
+
+	heap_set(ntimers, newtimer);
+	heap_up(ntimers++);
 
 	return newtimer;
 }
 
+/**
+ * Create a new one-shot timer.
+ *
+ * @param timeout number of milliseconds before the timer should activate
+ * @param callback Callback function to call when timer fires.
+ * @param arg Opaque argument to pass to callback function.
+ * @return Timer handle.  NOTE that this is automatically destroyed
+ * after the callback function has been called.
+ */
+MWTIMER *GdAddTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
+{
+	return add_timer(timeout, callback, arg, MWTIMER_ONESHOT);
+}
+
 /**
  * Create a new periodic (repeating) timer.
  *
@@ -104,24 +216,7 @@ MWTIMER *GdAddTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
  */
 MWTIMER *GdAddPeriodicTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
 {
-    MWTIMER *newtimer;
-
-    if(!(newtimer = malloc(sizeof(MWTIMER)))) return NULL;
-
-    gettimeofday (&current_time, NULL);
-    
-    if (timerlist) timerlist->prev = newtimer;
-    
-    calculate_timeval (&newtimer->timeout, timeout);
-    newtimer->callback = callback;
-    newtimer->arg      = arg;
-    newtimer->next     = timerlist;
-    newtimer->prev     = NULL;
-    newtimer->type     = MWTIMER_PERIODIC;
-    newtimer->period   = timeout;
-    timerlist          = newtimer;
-    
-    return newtimer;
+	return add_timer(timeout, callback, arg, MWTIMER_PERIODIC);
 }
 
 /**
@@ -131,12 +226,7 @@ MWTIMER *GdAddPeriodicTimer(MWTIMEOUT timeout, MWTIMERCB callback, void *arg)
  */
 void GdDestroyTimer(MWTIMER *timer)
 {
-	if(timer->next) timer->next->prev = timer->prev;
-	if(timer->prev) timer->prev->next = timer->next;
-	if(timer == timerlist) {
-		if(timer->next) timerlist = timer->next;
-		else timerlist = timer->prev;
-	}
+	remove_timer(timer);
 	free(timer);
 }
 
@@ -148,11 +238,11 @@ void GdDestroyTimer(MWTIMER *timer)
  */
 MWTIMER *GdFindTimer(void *arg)
 {
-	MWTIMER *t = timerlist;
+	MWTIMER *t = timerhash[HASHARG(arg)];
 
 	while(t) {
 		if(t->arg == arg) break;
-		t = t->next;
+		t = t->hashnext;
 	}
 
 	return t;
@@ -161,98 +251,64 @@ MWTIMER *GdFindTimer(void *arg)
 /**
  * Check timer list for pending timeout
  *
- * @param tv 
- * @param timeout 
- * @return
+ * @param tv Returned time until the earliest timer or main loop timeout.
+ * @param timeout Main loop timeout in milliseconds, 0 for none.
+ * @return FALSE if there is no timer and no main loop timeout.
  */
 MWBOOL GdGetNextTimeout(struct timeval *tv, MWTIMEOUT timeout)
 {
-	signed long i, lowest_timeout;
-	MWTIMER *t = timerlist;
+	uint64_t now, expiry;
+	long lowest_timeout;
 
-	if(!timeout && !timerlist) return FALSE;
+	if(!timeout && !ntimers) return FALSE;
 
-	gettimeofday(&current_time, NULL);
+	now = current_time();
+	mainloop_expiry = timeout? now + timeout: 0;
 
-	if(timeout) {
-		calculate_timeval(&mainloop_timeout, timeout);
-		lowest_timeout = time_to_expiry(&mainloop_timeout);
-	} else {
-		lowest_timeout = time_to_expiry(&t->timeout);
-		mainloop_timeout.tv_sec = -1;
-		t = t->next;
-	}
+	expiry = mainloop_expiry;
+	if (ntimers && (!expiry || timerheap[0]->expiry < expiry))
+		expiry = timerheap[0]->expiry;
+	lowest_timeout = (expiry > now)? (long)(expiry - now): 0;
 
-	while(t) {
-		i = time_to_expiry(&t->timeout);
-		if( i>0 && i>t->period ) {
-			calculate_timeval (&t->timeout, t->period);
-			i = t->period;
-		}
-		if(i < lowest_timeout) lowest_timeout = i;
-		t = t->next;
-	}
-
-	if(lowest_timeout <= 0) {
-		tv->tv_sec = 0;
-		tv->tv_usec = 0;
-	} else {
-		tv->tv_sec = lowest_timeout / 1000;
-		tv->tv_usec = (lowest_timeout % 1000) * 1000;
-	}
+	tv->tv_sec = lowest_timeout / 1000;
+	tv->tv_usec = (lowest_timeout % 1000) * 1000;
 
 	return TRUE;
 }
 
 /**
- * Check timer list for pending timeout
+ * Run callbacks of expired timers
+ *
+ * @return TRUE if the main loop timeout of the last GdGetNextTimeout has expired.
  */
 MWBOOL GdTimeout(void)
 {
-	MWTIMER *n, *t = timerlist;
-	signed long tempTimeout = 0;
+	uint64_t now = current_time();
+	int count = ntimers;
 
-	gettimeofday(&current_time, NULL);
+	/* timers added by callbacks run on the next call*/
+	while (count-- > 0 && ntimers && timerheap[0]->expiry <= now) {
+		MWTIMER *t = timerheap[0];
 
-	while(t) {
-		n = t->next;
-		tempTimeout = time_to_expiry(&t->timeout);
-		if( tempTimeout<= 0) {
+		if (t->type == MWTIMER_ONESHOT) {
+			/* One shot timer, is finished delete it now */
+			remove_timer(t);
 			t->callback(t->arg);
-			if (t->type == MWTIMER_ONESHOT)
-				GdDestroyTimer(t); 		/* One shot timer, is finished delete it now */
-			else
-				calculate_timeval (&t->timeout, t->period); /* Periodic timer needs to be reset */
+			free(t);
 		} else {
-			if( tempTimeout>0 && tempTimeout>t->period )
-				calculate_timeval (&t->timeout, t->period);
+			/* Periodic timer needs to be reset, skipping missed periods*/
+			t->expiry += t->period;
+			if (t->expiry <= now)
+				t->expiry = now + (t->period? t->period: 1);
+			heap_down(0);
+			t->callback(t->arg);
 		}
-		t = n;
 	}
 
-	if(mainloop_timeout.tv_sec > 0 || mainloop_timeout.tv_usec > 0)
-		if(time_to_expiry(&mainloop_timeout) <= 0)
-			return TRUE;
+	if(mainloop_expiry && mainloop_expiry <= now)
+		return TRUE;
 
 	return FALSE;
 }
 
-static void calculate_timeval(struct timeval *tv, MWTIMEOUT to)
-{
-	tv->tv_sec = current_time.tv_sec + (to / 1000);
-	tv->tv_usec = current_time.tv_usec + ((to % 1000) * 1000);
-	if(tv->tv_usec > 1000000) {
-		tv->tv_sec++;
-		tv->tv_usec -= 1000000;
-	}
-}
-
-static long time_to_expiry(struct timeval *t)
-{
-	long ret = (((t->tv_sec - current_time.tv_sec) * 1000) +
-			((t->tv_usec - current_time.tv_usec) / 1000));
-
-	return ret;
-}
-
 #endif /* MW_FEATURE_TIMERS */
@@ -0,0 +1,91 @@
+/*
+ * Device-independent screen update (damage) region
+ *
+ * Screen drivers that set PSF_DELAYUPDATE add each Update() rectangle
+ * to a single coalesced MWCLIPREGION here instead of growing one
+ * bounding box, then flush it as a list of rectangles once per
+ * GsSelect/MwSelect iteration from their PreSelect entry point.
+ * Small changes in opposite corners thus repaint two small areas
+ * rather than the whole screen.
+ */
+#include <stdlib.h>
+#include "device.h"
+
+/* past this many rectangles the region is collapsed to its bounding box*/
+#define MAX_UPDATE_RECTS	32
+
+static MWCLIPREGION *updateregion;	/* accumulated screen damage*/
+
+/**
+ * Add a rectangle in physical screen coordinates to the update region.
+ *
+ * @param psd Screen device.
+ * @param x Left edge.
+ * @param y Top edge.
+ * @param width Width of area.
+ * @param height Height of area.
+ */
+void
+GdAddUpdateRect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+	MWRECT rc;
+
+	if (!updateregion && (updateregion = GdAllocRegion()) == NULL)
+		return;
+
+	/* clip to physical screen*/
+	rc.left = MWMAX(x, 0);
+	rc.top = MWMAX(y, 0);
+	rc.right = MWMIN(x + width, psd->xres);
+	rc.bottom = MWMIN(y + height, psd->yres);
+	if (rc.left >= rc.right || rc.top >= rc.bottom)
+		return;
+
+	GdUnionRectWithRegion(&rc, updateregion);
+
+	/* keep region unions cheap for pathological update patterns*/
+	if (updateregion->numRects > MAX_UPDATE_RECTS)
+		GdSetRectRegionIndirect(updateregion, &updateregion->extents);
+}
+
+/**
+ * Return the pending update region, or NULL if nothing was added yet.
+ * Used by drivers that need to look at the damage without consuming it.
+ */
+MWCLIPREGION *
+GdGetUpdateRegion(void)
+{
+	return updateregion;
+}
+
+/**
+ * Pass each rectangle in the update region to a driver draw routine,
+ * then empty the region.
+ *
+ * @param psd Screen device.
+ * @param draw Driver routine to copy an area to the display, may be NULL.
+ * @return Number of rectangles flushed.
+ */
+int
+GdFlushUpdateRegion(PSD psd, MWUPDATEFUNC draw)
+{
+	MWRECT *rc;
+	int n, count;
+
+	if (!updateregion || (count = updateregion->numRects) == 0)
+		return 0;
+
+	if (draw) {
+		for (n = count, rc = updateregion->rects; --n >= 0; rc++)
+			draw(psd, rc->left, rc->top, rc->right - rc->left, rc->bottom - rc->top);
+	}
+#if MW_FEATURE_STATS
+	gddrawstats.updates += count;
+	for (n = count, rc = updateregion->rects; --n >= 0; rc++)
+		gddrawstats.updatepixels += (long)(rc->right - rc->left) * (rc->bottom - rc->top);
+#endif
+
+	/* empty region*/
+	GdSetRectRegion(updateregion, 0, 0, 0, 0);
+	return count;
+}
@@ -11,6 +11,7 @@
 #include "device.h"
 #include "devfont.h"
 #include "genfont.h"
+#include "swap.h"
 
 /*
  * .fnt loadable font file format definition
@@ -57,10 +58,32 @@
 #define FCLOSE(file)                fclose(file)
 #endif
 
+/* uncompressed files are mapped and their data used in place on little endian cpus*/
+#if HAVE_MMAP && !MW_CPU_BIG_ENDIAN
+#define HAVE_FNT_MMAP	1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FNT_HEADERSIZE	356		/* bytes before imagebits data*/
+
+/* incore font with data in mapped file*/
+typedef struct {
+	MWCFONT		cfont;			/* must be first*/
+	void *		map;
+	size_t		mapsize;
+} MWMAPPEDFONT;
+#endif
+
 /* Handling routines for FNT fonts, use MWCOREFONT structure */
 PMWFONT fnt_createfont(const char *filename, MWCOORD height, MWCOORD width, int attr);
 static void fnt_unloadfont(PMWFONT font);
 static PMWCFONT fnt_load_font(const char *path);
+static void fnt_free_font(void *data);
+#if HAVE_FNT_MMAP
+static PMWCFONT fnt_map_font(const char *path);
+static void fnt_unmap_font(void *data);
+#endif
 
 /* these procs used when font ASCII indexed*/
 MWFONTPROCS fnt_fontprocs = {
@@ -96,21 +119,40 @@ static MWFONTPROCS fnt_fontprocs16 = {
 	NULL			/* duplicate not supported */
 };
 
-/* load font and allocate MWCOREFONT structure*/
+/* load font and allocate MWCOREFONT structure, sharing loaded font data*/
 PMWFONT
 fnt_createfont(const char *name, MWCOORD height, MWCOORD width, int attr)
 {
 	PMWCOREFONT	pf;
 	PMWCFONT	cfont;
 	int		uc16;
+	char *	path = mwfont_findpath(name, FNT_FONT_DIR, ".fnt");
 
-	/* try to open file and read in font data*/
-	cfont = fnt_load_font(name);
-	if (!cfont)
+	if (!path)
 		return NULL;
 
+	/* try cached font data, else open file and read in font data*/
+	cfont = GdFindFontData(path, 0, 0, 0);
+	if (!cfont) {
+		void (*freefont)(void *data) = fnt_free_font;
+
+#if HAVE_FNT_MMAP
+		cfont = fnt_map_font(path);
+		if (cfont)
+			freefont = fnt_unmap_font;
+		else
+#endif
+		cfont = fnt_load_font(path);
+		if (!cfont)
+			return NULL;
+		if (!GdAddFontData(path, 0, 0, 0, cfont, freefont)) {
+			freefont(cfont);
+			return NULL;
+		}
+	}
+
 	if (!(pf = (MWCOREFONT *) malloc(sizeof(MWCOREFONT)))) {
-		free(cfont);
+		GdReleaseFontData(cfont);
 		return NULL;
 	}
 
@@ -118,34 +160,144 @@ fnt_createfont(const char *name, MWCOORD height, MWCOORD width, int attr)
 	uc16 = cfont->firstchar > 255 || (cfont->firstchar + cfont->size) > 255;
 	pf->fontprocs = uc16? &fnt_fontprocs16: &fnt_fontprocs;
 
-	pf->fontsize = pf->fontrotation = pf->fontattr = 0;
+	pf->fontsize = pf->fontwidth = pf->fontrotation = pf->fontattr = 0;
 	pf->name = "FNT";
 	pf->cfont = cfont;
 	return (PMWFONT)pf;
 }
 
-void
+static void
 fnt_unloadfont(PMWFONT font)
 {
 	PMWCOREFONT pf = (PMWCOREFONT)font;
-	PMWCFONT    pfc = pf->cfont;
-
-	if (pfc) {
-		if (pfc->width)
-			free((char *)pf->cfont->width);
-		if (pfc->offset)
-			free((char *)pf->cfont->offset);
-		if (pfc->bits)
-			free((char *)pf->cfont->bits);
-		if (pfc->name)
-			free(pf->cfont->name);
-
-		free(pfc);
-	}
 
+	GdReleaseFontData(pf->cfont);
 	free(font);
 }
 
+/* free incore font structure, called when last font using it is destroyed*/
+static void
+fnt_free_font(void *data)
+{
+	PMWCFONT pfc = data;
+
+	if (pfc->width)
+		free((char *)pfc->width);
+	if (pfc->offset)
+		free((char *)pfc->offset);
+	if (pfc->bits)
+		free((char *)pfc->bits);
+	if (pfc->name)
+		free(pfc->name);
+	free(pfc);
+}
+
+#if HAVE_FNT_MMAP
+/* little endian 16 and 32 bit values from mapped file*/
+#define GET16(p)	((p)[0] | ((p)[1] << 8))
+#define GET32(p)	((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | \
+					 ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+/*
+ * Map uncompressed font file and return incore font structure using
+ * the file's image bits, offsets and widths in place.
+ * Returns NULL if the file is compressed or can't be mapped.
+ */
+static PMWCFONT
+fnt_map_font(const char *path)
+{
+	MWMAPPEDFONT *mf;
+	unsigned char *map, *p;
+	struct stat st;
+	uint32_t nbits, noffset, nwidth;
+	size_t need;
+	char *name;
+	int fd, n;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || st.st_size < FNT_HEADERSIZE) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	/* check magic and variable data sizes*/
+	if (strncmp((char *)map, VERSION, 4) != 0)
+		goto errout;
+	p = map + FNT_HEADERSIZE - 12;
+	nbits = GET32(p);
+	noffset = GET32(p + 4);
+	nwidth = GET32(p + 8);
+	need = FNT_HEADERSIZE + ((nbits * sizeof(MWIMAGEBITS) + 3) & ~3) +
+		noffset * sizeof(uint32_t) + nwidth;
+	if (need > (size_t)st.st_size)
+		goto errout;
+
+	mf = (MWMAPPEDFONT *)calloc(1, sizeof(MWMAPPEDFONT));
+	if (!mf)
+		goto errout;
+	mf->map = map;
+	mf->mapsize = st.st_size;
+
+	/* internal font name, blank padded*/
+	for (n = 64; n > 0 && (map[4+n-1] == ' ' || map[4+n-1] == 0); n--)
+		continue;
+	name = malloc(n + 1);
+	if (!name) {
+		free(mf);
+		goto errout;
+	}
+	memcpy(name, map + 4, n);
+	name[n] = 0;
+	mf->cfont.name = name;
+
+	/* font info*/
+	p = map + 4 + 64 + 256;
+	mf->cfont.maxwidth = GET16(p);
+	mf->cfont.height = GET16(p + 2);
+	mf->cfont.ascent = GET16(p + 4);
+	mf->cfont.firstchar = GET32(p + 8);
+	mf->cfont.defaultchar = GET32(p + 12);
+	mf->cfont.size = GET32(p + 16);
+	if ((noffset && noffset < mf->cfont.size) || (nwidth && nwidth < mf->cfont.size)) {
+		fnt_unmap_font(mf);
+		return NULL;
+	}
+
+	/* variable font data, offsets are longword aligned after bits*/
+	p = map + FNT_HEADERSIZE;
+	mf->cfont.bits = (MWIMAGEBITS *)p;
+	mf->cfont.bits_size = nbits;
+	p += (nbits * sizeof(MWIMAGEBITS) + 3) & ~3;
+	if (noffset)
+		mf->cfont.offset = (uint32_t *)p;
+	p += noffset * sizeof(uint32_t);
+	if (nwidth)
+		mf->cfont.width = p;
+	return &mf->cfont;
+
+errout:
+	munmap(map, st.st_size);
+	return NULL;
+}
+
+/* unmap font file, called when last font using it is destroyed*/
+static void
+fnt_unmap_font(void *data)
+{
+	MWMAPPEDFONT *mf = data;
+
+	munmap(mf->map, mf->mapsize);
+	free(mf->cfont.name);
+	free(mf);
+}
+#endif /* HAVE_FNT_MMAP*/
+
 static int
 READBYTE(FILEP fp, unsigned char *cp)
 {
@@ -240,9 +392,9 @@ READSTRPAD(FILEP fp, char *buf, int totlen)
 	return totlen;
 }
 
-/* read and load font, return incore font structure*/
+/* read and load font file, return incore font structure*/
 static PMWCFONT
-fnt_load_font(const char *filename)
+fnt_load_font(const char *path)
 {
 	FILEP ifp;
 	PMWCFONT pf = NULL;
@@ -254,9 +406,6 @@ fnt_load_font(const char *filename)
 	char copyright[256+1];
 	char name[64+1];
 
-	char *path = mwfont_findpath(filename, FNT_FONT_DIR, ".fnt");
-	if (!path)
-		return NULL;
 	ifp = FOPEN(path, "rb");
 	if (!ifp)
 		return NULL;
@@ -45,6 +45,7 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "uni_std.h"
 #include "device.h"
 #include "devfont.h"
@@ -55,19 +56,49 @@
 /* space.  The following defines make life much easier          */
 #if HAVE_PCFGZ_SUPPORT
 #include <zlib.h>
-#define FILEP gzFile
-#define FOPEN(path, mode)           gzopen(path, mode)
-#define FREAD(file, buffer, size)   gzread(file, buffer, size)
-#define FSEEK(file, offset, whence) gzseek(file, offset, whence)
-#define FCLOSE(file)                gzclose(file)
+#define STREAM gzFile
+#define SOPEN(path, mode)           gzopen(path, mode)
+#define SREAD(file, buffer, size)   gzread(file, buffer, size)
+#define SSEEK(file, offset, whence) gzseek(file, offset, whence)
+#define SCLOSE(file)                gzclose(file)
 #else
-#define FILEP  FILE *
-#define FOPEN(path, mode)           fopen(path, mode)
-#define FREAD(file, buffer, size)   fread(buffer, 1, size, file)
-#define FSEEK(file, offset, whence) fseek(file, offset, whence)
-#define FCLOSE(file)                fclose(file)
+#define STREAM  FILE *
+#define SOPEN(path, mode)           fopen(path, mode)
+#define SREAD(file, buffer, size)   fread(buffer, 1, size, file)
+#define SSEEK(file, offset, whence) fseek(file, offset, whence)
+#define SCLOSE(file)                fclose(file)
 #endif
 
+#if HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*
+ * Font file.  Uncompressed files are mapped and read in place,
+ * compressed files are read through a stream.
+ */
+typedef struct {
+	STREAM			stream;		/* stream if not mapped*/
+	unsigned char *	map;		/* mapped file*/
+	long			size;		/* mapped file size*/
+	long			pos;		/* mapped read position*/
+} PCFFILE, *FILEP;
+
+static FILEP pcf_fopen(const char *path);
+static int pcf_fread(FILEP file, void *buffer, long size);
+static void pcf_fseek(FILEP file, long offset, int whence);
+static void pcf_fclose(FILEP file);
+#define FOPEN(path, mode)           pcf_fopen(path)
+#define FREAD(file, buffer, size)   pcf_fread(file, buffer, size)
+#define FSEEK(file, offset, whence) pcf_fseek(file, offset, whence)
+#define FCLOSE(file)                pcf_fclose(file)
+
+/* true if ptr is within mapped file*/
+#define INMAP(file, ptr)	((file)->map && (unsigned char *)(ptr) >= (file)->map && \
+							 (unsigned char *)(ptr) < (file)->map + (file)->size)
+
 typedef	unsigned char (*FP_READ8)(FILEP file);
 typedef	unsigned short (*FP_READ16)(FILEP file);
 typedef	uint32_t 		(*FP_READ32)(FILEP file);
@@ -75,6 +106,8 @@ typedef	uint32_t 		(*FP_READ32)(FILEP file);
 /* Handling routines for PCF fonts, use MWCOREFONT structure */
 PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int attr);
 static void pcf_unloadfont(PMWFONT font);
+static PMWCFONT pcf_load_font(const char *path);
+static void pcf_free_font(void *data);
 
 static void	get_endian_read_funcs(uint32_t format, FP_READ8 *p_fp_read8,
 	FP_READ16 *p_fp_read16, FP_READ32 *p_fp_read32);
@@ -263,12 +296,96 @@ four_byte_swap(unsigned char *buf, int nbytes)
 	}
 }
 
+/* open font file, mapping it if uncompressed*/
+static FILEP
+pcf_fopen(const char *path)
+{
+	FILEP file = calloc(1, sizeof(PCFFILE));
+
+	if (!file)
+		return NULL;
+
+#if HAVE_MMAP
+	{
+		int fd = open(path, O_RDONLY);
+		struct stat st;
+
+		if (fd >= 0) {
+			if (fstat(fd, &st) == 0 && st.st_size >= 4) {
+				file->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (file->map == MAP_FAILED)
+					file->map = NULL;
+				else file->size = st.st_size;
+			}
+			close(fd);
+		}
+
+		/* stream compressed files*/
+		if (file->map && file->map[0] == 0x1f && file->map[1] == 0x8b) {
+			munmap(file->map, file->size);
+			file->map = NULL;
+		}
+		if (file->map)
+			return file;
+	}
+#endif
+
+	file->stream = SOPEN(path, "rb");
+	if (!file->stream) {
+		free(file);
+		return NULL;
+	}
+	return file;
+}
+
+static int
+pcf_fread(FILEP file, void *buffer, long size)
+{
+	if (!file->map)
+		return SREAD(file->stream, buffer, size);
+
+	if (size > file->size - file->pos)
+		size = file->size - file->pos;
+	if (size <= 0)
+		return 0;
+	memcpy(buffer, file->map + file->pos, size);
+	file->pos += size;
+	return size;
+}
+
+static void
+pcf_fseek(FILEP file, long offset, int whence)
+{
+	if (!file->map) {
+		SSEEK(file->stream, offset, whence);
+		return;
+	}
+	if (whence == SEEK_CUR)
+		offset += file->pos;
+	file->pos = (offset >= 0 && offset <= file->size)? offset: file->size;
+}
+
+static void
+pcf_fclose(FILEP file)
+{
+#if HAVE_MMAP
+	if (file->map)
+		munmap(file->map, file->size);
+#endif
+	if (file->stream)
+		SCLOSE(file->stream);
+	free(file);
+}
+
 /* read an 8 bit byte*/
 static unsigned short
 readINT8(FILEP file)
 {
 	unsigned char b;
 
+	if (file->map)
+		return (file->pos < file->size)? file->map[file->pos++]: 0;
+
 	FREAD(file, &b, sizeof(b));
 	return b;
 }
@@ -352,7 +469,8 @@ pcf_readprops(FILEP file, struct prop_entry **prop, struct string_table **string
 
 /* Read the actual bitmaps into memory */
 static int
-pcf_readbitmaps(FILEP file, unsigned char **bits, int *bits_size, int *glyph_pad, uint32_t **offsets)
+pcf_readbitmaps(FILEP file, unsigned char **bits, int *bits_size, int *glyph_pad, uint32_t **offsets,
+	int *byteswap, int *bitswap)
 {
 	long offset;
 	uint32_t format;
@@ -420,6 +538,17 @@ pcf_readbitmaps(FILEP file, unsigned char **bits, int *bits_size, int *glyph_pad
 	*glyph_pad = (1 << pad_index);
 	*bits_size = bmsize[pad_index]? bmsize[pad_index] : 1;
 
+	/* use mapped bitmap data in place, conversion is done while reading glyphs*/
+	*byteswap = *bitswap = 0;
+	if (file->map && file->pos + *bits_size <= file->size &&
+	    (need_byte_reverse < 2 || (*bits_size % need_byte_reverse) == 0)) {
+		*bits = file->map + file->pos;
+		if (need_byte_reverse == 2 || need_byte_reverse == 4)
+			*byteswap = need_byte_reverse - 1;
+		*bitswap = need_bit_reverse;
+		return num_glyphs;
+	}
+
 	/* alloc and read bitmap data*/
 	b = *bits = (unsigned char *)malloc(*bits_size);
 	if (!b)
@@ -569,11 +698,12 @@ pcf_read_toc(FILEP file, struct toc_entry **toc, uint32_t *size)
 	return 0;
 }
 
-/* create font and allocate MWCOREFONT struct*/
-PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int attr)
+/* read and convert PCF file, return incore font structure*/
+static PMWCFONT
+pcf_load_font(const char *path)
 {
 	FILEP file = NULL;
-	MWCOREFONT *pf = NULL;
+	PMWCFONT cf = NULL;
 	uint32_t i, count, offset;
 	int bsize;
 	int bwidth;
@@ -588,20 +718,14 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 	unsigned int glyph_count;
 	uint32_t *goffset = NULL;
 	unsigned char *gwidth = NULL;
-	int uc16;
 	int glyph_pad;
+	int byteswap, bitswap;
 
-	char *path = mwfont_findpath(filename, PCF_FONT_DIR, ".pcf");
-	if (!path)
-        return NULL;
 	file = FOPEN(path, "rb");
 	if (!file)
 		return NULL;
 
-	if (!(pf = (MWCOREFONT *)malloc(sizeof(MWCOREFONT))))
-		goto err_exit;
-
-	if (!(pf->cfont = (PMWCFONT)calloc(sizeof(MWCFONT), 1)))
+	if (!(cf = (PMWCFONT)calloc(sizeof(MWCFONT), 1)))
 		goto err_exit;
 
 
@@ -610,7 +734,7 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 		goto err_exit;
 
 	/* Now, read in the bitmaps */
-	result = pcf_readbitmaps(file, &glyphs, &bsize, &glyph_pad, &glyphs_offsets);
+	result = pcf_readbitmaps(file, &glyphs, &bsize, &glyph_pad, &glyphs_offsets, &byteswap, &bitswap);
 	if (result == -1)
 		goto err_exit;
 
@@ -620,10 +744,10 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 	if (pcf_read_encoding(file, &encoding) == -1)
 		goto err_exit;
 
-	pf->cfont->firstchar = encoding->min_byte2 * (encoding->min_byte1 + 1);
-	pf->cfont->defaultchar = encoding->defaultchar;
-	/*DPRINTF("firstchar %d\n", pf->cfont->firstchar);*/
-	/*DPRINTF("default char %d (%x)\n", pf->cfont->defaultchar, pf->cfont->defaultchar);*/
+	cf->firstchar = encoding->min_byte2 * (encoding->min_byte1 + 1);
+	cf->defaultchar = encoding->defaultchar;
+	/*DPRINTF("firstchar %d\n", cf->firstchar);*/
+	/*DPRINTF("default char %d (%x)\n", cf->defaultchar, cf->defaultchar);*/
 
 	/* Read in the metrics */
 	count = pcf_readmetrics(file, &metrics);
@@ -649,15 +773,15 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 	}
 	max_height = max_ascent + max_descent;
 
-	pf->cfont->maxwidth = max_width;
-	pf->cfont->height = max_height;
-	pf->cfont->ascent = max_ascent;
+	cf->maxwidth = max_width;
+	cf->height = max_height;
+	cf->ascent = max_ascent;
 
 	/* Allocate enough room to hold all of the bits and the offsets */
 	bwidth = (max_width + 15) / 16;
 
-	pf->cfont->bits = (MWIMAGEBITS *)calloc((max_height * (sizeof(MWIMAGEBITS) * bwidth)), glyph_count);
-	if (!pf->cfont->bits)
+	cf->bits = (MWIMAGEBITS *)calloc((max_height * (sizeof(MWIMAGEBITS) * bwidth)), glyph_count);
+	if (!cf->bits)
 		goto err_exit;
 
 	goffset = (uint32_t *)malloc(glyph_count * sizeof(uint32_t));
@@ -668,7 +792,7 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 	if (!gwidth)
 		goto err_exit;
 
-	output = (MWIMAGEBITS *) pf->cfont->bits;
+	output = (MWIMAGEBITS *) cf->bits;
 	offset = 0;
 
 	/* copy and convert from packed BDF format to MWCFONT format*/
@@ -733,7 +857,19 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 				for (w = 0; w < lwidth; w++) {
 					if (w < xwidth) {
 						p8 = p_glyph_in_rowbits + (w * sizeof(unsigned short));
-						val16 = ((((unsigned short)p8[0]) << 8) | p8[1]);
+						if (byteswap | bitswap) {
+							/* mapped bitmap not in MSB bit and byte order*/
+							long n = p8 - glyphs;
+							unsigned char b0 = glyphs[n ^ byteswap];
+							unsigned char b1 = glyphs[(n + 1) ^ byteswap];
+
+							if (bitswap) {
+								b0 = _reverse_byte[b0];
+								b1 = _reverse_byte[b1];
+							}
+							val16 = (b0 << 8) | b1;
+						} else
+							val16 = ((((unsigned short)p8[0]) << 8) | p8[1]);
 					} else {
 						val16 = 0;
 					}
@@ -755,12 +891,12 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 	}
 
 	/* reorder offsets and width according to encoding map */
-	pf->cfont->offset = (uint32_t *)malloc(encoding->count * sizeof(uint32_t));
-	if (!pf->cfont->offset)
+	cf->offset = (uint32_t *)malloc(encoding->count * sizeof(uint32_t));
+	if (!cf->offset)
 		goto err_exit;
 
-	pf->cfont->width = (unsigned char *)malloc(encoding->count * sizeof(unsigned char));
-	if (!pf->cfont->width)
+	cf->width = (unsigned char *)malloc(encoding->count * sizeof(unsigned char));
+	if (!cf->width)
 		goto err_exit;
 
 	for (i = 0; i < encoding->count; ++i) {
@@ -768,26 +904,21 @@ PMWFONT pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int
 
 		if (n == 0xffff) {	/* map non-existent chars to default char */
 			/* get default char map index*/
-			n = encoding->map[encoding->defaultchar - pf->cfont->firstchar];
+			n = encoding->map[encoding->defaultchar - cf->firstchar];
 
 			/* if default is non-existent then char is empty */
 			if (n == 0xffff) {
 				/* casts necessary to remove const*/
-				((uint32_t *)pf->cfont->offset)[i] = 0;
-				((unsigned char *)pf->cfont->width)[i] = 0;
+				((uint32_t *)cf->offset)[i] = 0;
+				((unsigned char *)cf->width)[i] = 0;
 				continue;
 			}
 		}
 		/* casts necessary to remove const*/
-		((uint32_t *)pf->cfont->offset)[i] = goffset[n];
-		((unsigned char *)pf->cfont->width)[i] = gwidth[n];
+		((uint32_t *)cf->offset)[i] = goffset[n];
+		((unsigned char *)cf->width)[i] = gwidth[n];
 	}
-	pf->cfont->size = encoding->count;
-
-	uc16 = pf->cfont->firstchar > 255 || (pf->cfont->firstchar + pf->cfont->size) > 255;
-	pf->fontprocs = uc16? &pcf_fontprocs16: &pcf_fontprocs;
-	pf->fontsize = pf->fontrotation = pf->fontattr = 0;
-	pf->name = "PCF";
+	cf->size = encoding->count;
 	err = 0;
 
 err_exit:
@@ -802,7 +933,7 @@ err_exit:
 	}
 	if (metrics)
 		free(metrics);
-	if (glyphs)
+	if (glyphs && !INMAP(file, glyphs))
 		free(glyphs);
 	if (glyphs_offsets)
 		free(glyphs_offsets);
@@ -815,30 +946,74 @@ err_exit:
 	if (file)
 		FCLOSE(file);
 
-	if (err == 0 && pf)
-		return (PMWFONT)pf;
+	if (err == 0)
+		return cf;
 
-	pcf_unloadfont((PMWFONT)pf);
-	return 0;
+	pcf_free_font(cf);
+	return NULL;
 }
 
-void
-pcf_unloadfont(PMWFONT font)
+/* free incore font structure, called when last font using it is destroyed*/
+static void
+pcf_free_font(void *data)
 {
-	PMWCOREFONT pf = (PMWCOREFONT) font;
-	PMWCFONT    pfc = pf->cfont;
+	PMWCFONT pfc = data;
 
 	if (pfc) {
 		if (pfc->width)
-			free((char *)pf->cfont->width);
+			free((char *)pfc->width);
 		if (pfc->offset)
-			free((char *)pf->cfont->offset);
+			free((char *)pfc->offset);
 		if (pfc->bits)
-			free((char *)pf->cfont->bits);
+			free((char *)pfc->bits);
+
+		free(pfc);
+	}
+}
+
+/* create font and allocate MWCOREFONT struct, sharing loaded font data*/
+PMWFONT
+pcf_createfont(const char *filename, MWCOORD height, MWCOORD width, int attr)
+{
+	PMWCOREFONT pf;
+	PMWCFONT cfont;
+	int uc16;
+
+	char *path = mwfont_findpath(filename, PCF_FONT_DIR, ".pcf");
+	if (!path)
+		return NULL;
 
-		free(pf->cfont);
+	/* glyph data doesn't depend on requested size or attributes*/
+	cfont = GdFindFontData(path, 0, 0, 0);
+	if (!cfont) {
+		cfont = pcf_load_font(path);
+		if (!cfont)
+			return NULL;
+		if (!GdAddFontData(path, 0, 0, 0, cfont, pcf_free_font)) {
+			pcf_free_font(cfont);
+			return NULL;
+		}
+	}
+
+	if (!(pf = (MWCOREFONT *)malloc(sizeof(MWCOREFONT)))) {
+		GdReleaseFontData(cfont);
+		return NULL;
 	}
 
+	uc16 = cfont->firstchar > 255 || (cfont->firstchar + cfont->size) > 255;
+	pf->fontprocs = uc16? &pcf_fontprocs16: &pcf_fontprocs;
+	pf->fontsize = pf->fontwidth = pf->fontrotation = pf->fontattr = 0;
+	pf->name = "PCF";
+	pf->cfont = cfont;
+	return (PMWFONT)pf;
+}
+
+static void
+pcf_unloadfont(PMWFONT font)
+{
+	PMWCOREFONT pf = (PMWCOREFONT) font;
+
+	GdReleaseFontData(pf->cfont);
 	free(font);
 }
 
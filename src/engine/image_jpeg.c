@@ -11,11 +11,17 @@
  * components (usually 24bpp), unless running in palette mode,
  * where a pal8 image is forced.
  *
+ * When a target size is passed, libjpeg's DCT scaling is used to decode
+ * at the smallest scale at or above that size, which is much faster than
+ * decoding full size and shrinking afterwards.  On 24bpp and 16bpp
+ * displays, libjpeg-turbo's extended color spaces are used to decode
+ * straight into the framebuffer data format.  Scanlines are read several
+ * at a time.
+ *
  * SOME FINE POINTS: (from libjpeg)
- * In the below code, we ignored the return value of jpeg_read_scanlines,
- * which is the number of scanlines actually read.  We could get away with
- * this because we asked for only one line at a time and we weren't using
- * a suspending data source.  See libjpeg.doc for more info.
+ * We check the return value of jpeg_read_scanlines, which is the number
+ * of scanlines actually read, only to stop on a truncated image, since
+ * we aren't using a suspending data source.  See libjpeg.doc for more info.
  *
  * We cheated a bit by calling alloc_sarray() after jpeg_start_decompress();
  * we should have done it beforehand to ensure that the space would be
@@ -45,6 +51,8 @@
 
 #include "jpeglib.h"
 
+#define MAXSCANLINES		16		/* max scanlines read per jpeg_read_scanlines call*/
+
 static buffer_t *inptr;
 
 static void
@@ -81,13 +89,43 @@ term_source(j_decompress_ptr cinfo)
 	return;
 }
 
+/* pick smallest DCT scale that keeps output at or above width x height*/
+static void
+scale_to_fit(j_decompress_ptr cinfo, MWCOORD width, MWCOORD height)
+{
+	unsigned int num;
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	for (num = 1; num < 8; num++) {
+#if !defined(LIBJPEG_TURBO_VERSION) && JPEG_LIB_VERSION < 70
+		if (num & (num - 1))	/* libjpeg 6b only scales by 1/8, 1/4 and 1/2*/
+			continue;
+#endif
+		if ((cinfo->image_width * num + 7) / 8 >= (unsigned int)width &&
+		    (cinfo->image_height * num + 7) / 8 >= (unsigned int)height)
+			break;
+	}
+	cinfo->scale_num = num;
+	cinfo->scale_denom = 8;
+}
+
+/**
+ * Decode JPEG image into a pixmap.
+ *
+ * @param src Image data.
+ * @param fast_grayscale Decode to 256 shade grayscale.
+ * @param width Target width, image may be decoded smaller but not below it. <= 0 for full size.
+ * @param height Target height.
+ */
 PSD
-GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale)
+GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale, MWCOORD width, MWCOORD height)
 {
 	int i;
 	unsigned char magic[8];
 	PSD pmd = NULL;
-	int bpp, data_format, palsize;
+	int bpp, data_format = 0, palsize;
 	struct jpeg_source_mgr smgr;
 	struct jpeg_decompress_struct cinfo;
 	struct jpeg_error_mgr jerr;
@@ -133,6 +171,7 @@ GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale)
 	/* Step 4: set parameters for decompression */
 	cinfo.out_color_space = fast_grayscale? JCS_GRAYSCALE: JCS_RGB;
 	cinfo.quantize_colors = FALSE;
+	scale_to_fit(&cinfo, width, height);
 
 	if (!fast_grayscale) {
 		/* if running in palette mode, force pal8 output*/
@@ -163,6 +202,27 @@ GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale)
 #endif
 			}
 		}
+#ifdef JCS_ALPHA_EXTENSIONS
+		else {
+			/*
+			 * Decode directly to framebuffer format, drawn with a straight copy.
+			 * 32bpp displays keep RGB888, as their image formats have alpha
+			 * and would be drawn with srcover.
+			 */
+			switch (scrdev.data_format) {
+			case MWIF_BGR888:
+				cinfo.out_color_space = JCS_EXT_BGR;
+				data_format = MWIF_BGR888;
+				break;
+#if LIBJPEG_TURBO_VERSION_NUMBER >= 1005000 && !MW_CPU_BIG_ENDIAN
+			case MWIF_RGB565:
+				cinfo.out_color_space = JCS_RGB565;
+				data_format = MWIF_RGB565;
+				break;
+#endif
+			}
+		}
+#endif /* JCS_ALPHA_EXTENSIONS*/
 	} else {
 		/* 256 shade grayscale output*/
 		cinfo.quantize_colors = TRUE;
@@ -172,25 +232,27 @@ GdDecodeJPEG(buffer_t * src, MWBOOL fast_grayscale)
 	jpeg_calc_output_dimensions(&cinfo);
 
 	bpp = cinfo.output_components*8;
-	switch (bpp) {
-	case 24:
-		data_format = MWIF_RGB888;
-		break;
-	case 8:
-		data_format = MWIF_PAL8;
-		break;
-	default:
-		EPRINTF("GdDecodeJPEG: can't handled %dbpp image\n", bpp);
-		goto err;
+	if (!data_format) {
+		switch (bpp) {
+		case 24:
+			data_format = MWIF_RGB888;
+			break;
+		case 8:
+			data_format = MWIF_PAL8;
+			break;
+		default:
+			EPRINTF("GdDecodeJPEG: can't handled %dbpp image\n", bpp);
+			goto err;
+		}
 	}
-	palsize = (bpp == 8)? 256: 0;
+	palsize = (data_format == MWIF_PAL8)? 256: 0;
 
 	pmd = GdCreatePixmap(&scrdev, cinfo.output_width, cinfo.output_height, data_format, NULL, palsize);
 	if (!pmd)
 		goto err;
 DPRINTF("jpeg bpp %d\n", bpp);
 
-	if(bpp == 8) {
+	if(palsize) {
 		if (fast_grayscale) {
 			/* use 256 shade linear palette*/
 			for (i=0; i<256; ++i) {
@@ -215,16 +277,24 @@ DPRINTF("jpeg bpp %d\n", bpp);
 	/* Step 5: Start decompressor */
 	jpeg_start_decompress (&cinfo);
 
-	/* Step 6: while (scan lines remain to be read) */
+	/* Step 6: while (scan lines remain to be read), read directly into pixmap*/
 	while(cinfo.output_scanline < cinfo.output_height) {
-		JSAMPROW rowptr[1];
-		rowptr[0] = (JSAMPROW)(pmd->addr + cinfo.output_scanline * pmd->pitch);
-		jpeg_read_scanlines (&cinfo, rowptr, 1);
+		JSAMPROW rowptr[MAXSCANLINES];
+		int n = cinfo.output_height - cinfo.output_scanline;
+
+		if (n > MAXSCANLINES)
+			n = MAXSCANLINES;
+		for (i = 0; i < n; i++)
+			rowptr[i] = (JSAMPROW)(pmd->addr + (cinfo.output_scanline + i) * pmd->pitch);
+		if (jpeg_read_scanlines (&cinfo, rowptr, n) == 0)
+			break;		/* truncated image*/
 	}
 
 err:
-	/* Step 7: Finish decompression */
-	jpeg_finish_decompress (&cinfo);
+	/* Step 7: Finish decompression, abort if not started or truncated*/
+	if (cinfo.output_scanline < cinfo.output_height)
+		jpeg_abort_decompress (&cinfo);
+	else jpeg_finish_decompress (&cinfo);
 
 	/* Step 8: Release JPEG decompression object */
 	jpeg_destroy_decompress (&cinfo);
@@ -32,6 +32,37 @@ void convblit_copy_rgb888_16bpp(PSD psd, PMWBLITPARMS gc);
 
 void convblit_copy_16bpp_16bpp(PSD psd, PMWBLITPARMS gc);			// 16bpp to 16bpp copy
 
+/* convblit_simd.c*/
+/* row kernels for unrotated convblit_8888 blits, NULL if not available on this cpu*/
+typedef void (*MWROWBLITFUNC)(unsigned char *dst, const unsigned char *src, int width);
+
+/* solid fill row kernel, combines len bytes at dst with repeating pixel pattern*/
+typedef void (*MWROWFILLFUNC)(unsigned char *dst, const unsigned char *pat, int len);
+#define MWFILLPATSIZE	96		/* pattern bytes, whole 2, 3 and 4 byte pixels and vectors*/
+#define MWFILLMINPIXELS	32		/* shortest horizontal line filled by row kernel*/
+
+typedef struct {
+	MWROWBLITFUNC	srcover_rgba8888_rgba8888;
+	MWROWBLITFUNC	copy_rgb888_rgba8888;
+	MWROWBLITFUNC	srcover_rgba8888_bgra8888;
+	MWROWBLITFUNC	copy_rgba8888_bgra8888;
+	MWROWBLITFUNC	copy_rgb888_bgra8888;
+	MWROWBLITFUNC	srcover_rgba8888_16bpp;
+	MWROWBLITFUNC	copy_rgba8888_16bpp;
+	MWROWBLITFUNC	copy_rgb888_16bpp;
+	MWROWBLITFUNC	copy_32bpp;				/* straight row copies*/
+	MWROWBLITFUNC	copy_24bpp;
+	MWROWBLITFUNC	copy_16bpp;
+	MWROWFILLFUNC	fill_copy;				/* fblin16/24/32 solid fills, any cpu*/
+	MWROWFILLFUNC	fill_xor;
+	MWROWFILLFUNC	fill_and;
+	MWROWFILLFUNC	fill_or;
+} MWROWBLITFUNCS;
+
+extern MWROWBLITFUNCS convblit_rowfuncs;
+void convblit_simd_init(void);								// select row kernels by cpu features
+MWROWFILLFUNC convblit_fill_setup(int op, MWPIXELVAL c, int bytesperpixel, unsigned char *pat);
+
 /* convblit_mask.c*/
 /* 1bpp and 8bpp (alphablend) mask conversion blits - for font display*/
 
@@ -28,6 +28,31 @@ extern "C" {
 #define MW_PATH_FBE_COLORMAP		"/tmp/fbe-cmap"				/* framebuffer colormap for mmap()*/
 #define MW_PATH_FBE_MOUSE			"/tmp/fbe-mouse"			/* mouse fifo*/
 #define MW_PATH_FBE_KEYBOARD		"/tmp/fbe-keyboard"			/* keyboard fifo*/
+#define MW_PATH_FBE_DAMAGE			"/tmp/fbe-damage"			/* damage rectangle ring for mmap()*/
+#define MW_PATH_FBE_DAMAGEFIFO		"/tmp/fbe-damagefifo"		/* damage wakeup fifo*/
+
+/*
+ * FBE damage ring, created by the fbe viewer and filled by scr_fbe.
+ * The driver adds each flushed update rectangle at head and writes a
+ * byte to the damage fifo, the viewer repaints rectangles up to head
+ * and advances tail. When the ring is full the driver sets overflow
+ * and the viewer repaints the whole screen.
+ */
+#define MWFBE_DAMAGE_MAGIC			0x44454246					/* 'FBED'*/
+#define MWFBE_DAMAGE_RECTS			256							/* ring size, power of two*/
+
+typedef struct {
+	int32_t		x, y, width, height;
+} MWFBERECT;
+
+typedef struct {
+	uint32_t			magic;
+	volatile int32_t	server;		/* pid of attached driver, 0 if none*/
+	volatile uint32_t	head;		/* rectangles written by driver*/
+	volatile uint32_t	tail;		/* rectangles repainted by viewer*/
+	volatile uint32_t	overflow;	/* rectangles dropped, repaint all*/
+	MWFBERECT			rect[MWFBE_DAMAGE_RECTS];
+} MWFBEDAMAGE;
 
 /* path for GR_WM_PROPS_BUFFER_MMAP mmap'd window*/
 #define MW_PATH_BUFFER_MMAP			"/tmp/.nano-fb%d"			/* window buffer file for mmap, %d=window id*/
@@ -269,6 +294,7 @@ int		GdSetFontRotation(PMWFONT pfont, int tenthdegrees);
 int		GdSetFontAttr(PMWFONT pfont, int setflags, int clrflags);
 void	GdDestroyFont(PMWFONT pfont);
 MWBOOL	GdGetFontInfo(PMWFONT pfont, PMWFONTINFO pfontinfo);
+void	GdGetFontMetrics(PMWFONT pfont, int firstchar, int count, PMWCHARMETRICS metrics);
 int		GdConvertEncoding(const void *istr, MWTEXTFLAGS iflags, int cc, void *ostr, MWTEXTFLAGS oflags);
 void	GdGetTextSize(PMWFONT pfont, const void *str, int cc, MWCOORD *pwidth,
 			MWCOORD *pheight, MWCOORD *pbase, MWTEXTFLAGS flags);
@@ -280,6 +306,10 @@ PMWFONT	GdCreateFontFromBuffer(PSD psd, const unsigned char *buffer,
 			unsigned length, const char *format, MWCOORD height, MWCOORD width);
 PMWFONT	GdDuplicateFont(PSD psd, PMWFONT psrcfont, MWCOORD height, MWCOORD width);
 char *mwfont_findpath(const char *filename, const char *defpath, const char *extension);
+void *	GdFindFontData(const char *path, MWCOORD height, MWCOORD width, int attr);
+MWBOOL	GdAddFontData(const char *path, MWCOORD height, MWCOORD width, int attr,
+			void *data, void (*freedata)(void *data));
+void	GdReleaseFontData(void *data);
 char *mwfont_findalias(const char *fontname, int *height, int *width);
 
 
@@ -327,6 +357,28 @@ MWCLIPREGION *GdAllocBitmapRegion(MWIMAGEBITS *bitmap, MWCOORD width, MWCOORD he
 MWCLIPREGION *GdAllocPolygonRegion(MWPOINT *points, int count, int mode);
 MWCLIPREGION *GdAllocPolyPolygonRegion(MWPOINT *points, int *count, int nbpolygons, int mode);
 
+/* devupdate.c - coalesced screen update region for PSF_DELAYUPDATE drivers*/
+typedef void (*MWUPDATEFUNC)(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+void	GdAddUpdateRect(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height);
+MWCLIPREGION *GdGetUpdateRegion(void);
+int		GdFlushUpdateRegion(PSD psd, MWUPDATEFUNC draw);
+
+/* devblitpool.c - banded blits on worker threads, MW_FEATURE_BLITTHREADS only*/
+typedef void (*MWBANDFUNC)(void *arg, int band, int nbands);
+int		GdBandCount(MWCOORD width, MWCOORD height);
+void	GdRunBands(MWBANDFUNC func, void *arg, int nbands);
+void	GdBandedBlit(PSD psd, PMWBLITPARMS gc, MWBLITFUNC convblit, int nbands, int stretch);
+
+/* devstats.c - drawing statistics, MW_FEATURE_STATS only*/
+#if MW_FEATURE_STATS
+extern MWDRAWSTATS gddrawstats;
+#define GDSTAT_ADD(field,n)	(gddrawstats.field += (n))
+#else
+#define GDSTAT_ADD(field,n)
+#endif
+void	GdStatBlit(int srcformat, int dstformat, long pixels);
+void	GdGetDrawStats(MWDRAWSTATS *sp, int reset);
+
 /* devmouse.c*/
 int	GdOpenMouse(void);
 void	GdCloseMouse(void);
@@ -370,6 +422,7 @@ void	GdDrawImageFromBuffer(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width,
 void	GdDrawImagePartToFit(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height,
 			MWCOORD sx, MWCOORD sy, MWCOORD swidth, MWCOORD sheight, PSD pmd);
 MWBOOL	GdGetImageInfo(PSD pmd, PMWIMAGEINFO pii);
+void	GdSetImageCacheSize(long bytes);
 void	GdStretchImage(PMWIMAGEHDR src, MWCLIPRECT *srcrect, PMWIMAGEHDR dst, MWCLIPRECT *dstrect);
 
 /* Buffered input functions to replace stdio functions*/
@@ -394,7 +447,7 @@ PSD		GdConvertImageRGBA(PSD pmd);		/* convert palettized image to RGBA*/
 PSD	GdDecodeBMP(buffer_t *src, MWBOOL readfilehdr);
 #endif
 #if HAVE_JPEG_SUPPORT
-PSD	GdDecodeJPEG(buffer_t *src, MWBOOL fast_grayscale);
+PSD	GdDecodeJPEG(buffer_t *src, MWBOOL fast_grayscale, MWCOORD width, MWCOORD height);
 #endif
 #if HAVE_PNG_SUPPORT
 PSD	GdDecodePNG(buffer_t *src);
@@ -439,11 +492,12 @@ void	set_ts_origin(int x, int y);
 typedef void (*MWTIMERCB)(void *);
 typedef struct mw_timer MWTIMER;
 struct mw_timer {
-	struct timeval	timeout;
+	uint64_t	expiry;		/* monotonic msecs when timer fires*/
 	MWTIMERCB	callback;
 	void		*arg;
-	MWTIMER		*next;
-	MWTIMER		*prev;
+	int		index;		/* position in timer heap*/
+	MWTIMER		*hashnext;	/* timers with same arg hash*/
+	MWTIMER		*hashprev;
     int         type;     /* MWTIMER_ONESHOT or MWTIMER_PERIODIC */
     MWTIMEOUT   period;
 };
@@ -456,6 +510,23 @@ MWBOOL		GdGetNextTimeout(struct timeval *tv, MWTIMEOUT timeout);
 MWBOOL		GdTimeout(void);
 #endif /* MW_FEATURE_TIMERS */
 
+#if HAVE_EPOLL
+/* devepoll.c - main loop epoll set*/
+#define MWPOLL_READ		0x01	/* fd readable*/
+#define MWPOLL_WRITE	0x02	/* fd writable*/
+#define MWPOLL_EXCEPT	0x04	/* fd has urgent data*/
+#define MWPOLL_TIMER	0x08	/* main loop timeout expired*/
+#define MAXPOLLEVENTS	64		/* max events returned by GdPollWait*/
+
+typedef struct {
+	int		fd;				/* ready fd, -1 for MWPOLL_TIMER*/
+	int		events;			/* MWPOLL flags*/
+} MWPOLLEVENT;
+
+int		GdPollSet(int fd, int events);
+int		GdPollWait(MWPOLLEVENT *events, int maxevents, struct timeval *tv);
+#endif /* HAVE_EPOLL*/
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
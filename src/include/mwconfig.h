@@ -73,12 +73,42 @@
 #ifndef MW_FEATURE_PORTRAIT
 #define MW_FEATURE_PORTRAIT 1	/* =1 for portrait support */
 #endif
+#ifndef MW_FEATURE_SIMD
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__) || defined(__ARM_NEON))
+#define MW_FEATURE_SIMD	1		/* =1 for SSE2/AVX2/NEON convblit row kernels*/
+#else
+#define MW_FEATURE_SIMD	0
+#endif
+#endif
+#ifndef MW_FEATURE_GLYPHCACHE
+#define MW_FEATURE_GLYPHCACHE 1	/* =1 to cache core font glyphs and blit text strings at once*/
+#endif
+#ifndef MW_FEATURE_BLITTHREADS
+#define MW_FEATURE_BLITTHREADS 0	/* >0 for number of threads drawing large blits in bands*/
+#endif
+#ifndef BLITTHREAD_MINPIXELS
+#define BLITTHREAD_MINPIXELS 65536	/* blits smaller than this stay on one thread*/
+#endif
+#ifndef MW_FEATURE_STATS
+#define MW_FEATURE_STATS 0		/* =1 to collect request latency and drawing statistics*/
+#endif
+#ifndef IMAGECACHE_SIZE
+#define IMAGECACHE_SIZE	4096	/* kbytes of decoded image files cached, 0 for no cache*/
+#endif
 
 /* the following defines are set=0 in Arch.rules based on ARCH= setting*/
 #ifndef HAVE_SELECT
 #define HAVE_SELECT		1		/* =1 has select system call*/
 #endif
 
+#ifndef HAVE_EPOLL
+#if LINUX && HAVE_SELECT && !HAVE_VNCSERVER
+#define HAVE_EPOLL		1		/* =1 main loop waits with epoll and timerfd instead of select*/
+#else
+#define HAVE_EPOLL		0
+#endif
+#endif
+
 #ifndef HAVE_SIGNAL
 #define HAVE_SIGNAL		1		/* =1 has signal system call*/
 #endif
@@ -342,6 +342,29 @@ typedef struct {
 	int	ws_height;
 } MWSCREENINFO, *PMWSCREENINFO;
 
+/* drawing statistics collected by the engine when MW_FEATURE_STATS is set*/
+#define MWSTATS_MAXBLITS	24		/* conversion blit format pairs tracked*/
+
+typedef struct {
+	int		srcformat;	/* MWIF_ source data format*/
+	int		dstformat;	/* MWIF_ destination screen format*/
+	uint64_t count;		/* conversion blits*/
+	uint64_t pixels;	/* pixels drawn after clipping*/
+} MWBLITSTAT;
+
+typedef struct {
+	uint64_t cliprects;	/* clip rectangles walked by conversion blits*/
+	uint64_t updates;	/* rectangles flushed to delayed update drivers*/
+	uint64_t updatepixels;	/* area flushed to delayed update drivers*/
+	uint64_t imagehits;	/* image file draws and loads found in image cache*/
+	uint64_t imagemisses;	/* image file draws and loads decoded*/
+	uint64_t imageevictions;/* cached images freed to stay within budget*/
+	uint64_t imagebytes;	/* memory used by cached images, not reset*/
+	uint64_t imagecount;	/* images in image cache, not reset*/
+	int		nblits;		/* entries used in blit[]*/
+	MWBLITSTAT blit[MWSTATS_MAXBLITS];
+} MWDRAWSTATS;
+
 /* builtin C-based proportional/fixed font structure*/
 typedef struct {
 	char *			name;		/* font name*/
@@ -546,6 +569,15 @@ typedef struct _mwfontinfo {
 	MWUCHAR widths[256];
 } MWFONTINFO;
 
+/* Character advance width and ink extents returned by GdGetFontMetrics, in pixels*/
+typedef struct {
+	short	width;		/* advance width*/
+	short	lbearing;	/* left edge of ink from origin*/
+	short	rbearing;	/* right edge of ink from origin*/
+	short	ascent;		/* ink above baseline*/
+	short	descent;	/* ink below baseline*/
+} MWCHARMETRICS, *PMWCHARMETRICS;
+
 
 /* GetFontList structure */
 typedef struct {
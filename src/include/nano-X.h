@@ -29,6 +29,7 @@ typedef MWSCANCODE	GR_SCANCODE;	/* oem keystroke scancode value */
 typedef MWKEYMOD	GR_KEYMOD;	/* keystroke modifiers */
 typedef MWSCREENINFO	GR_SCREEN_INFO;	/* screen information */
 typedef MWFONTINFO	GR_FONT_INFO;	/* font information */
+typedef MWCHARMETRICS	GR_CHAR_METRICS;/* character advance and ink extents */
 typedef MWIMAGEINFO	GR_IMAGE_INFO;	/* image information */
 typedef MWIMAGEHDR	GR_IMAGE_HDR;	/* multicolor image representation */
 typedef MWLOGFONT	GR_LOGFONT;	/* logical font descriptor */
@@ -72,6 +73,25 @@ typedef struct {
 	GR_SIZE  height;	/**< rectangle height*/
 } GR_RECT;
 
+/** Nano-X line segment, for GrSegments */
+typedef struct {
+	GR_COORD x1;		/**< start x coordinate*/
+	GR_COORD y1;		/**< start y coordinate*/
+	GR_COORD x2;		/**< end x coordinate*/
+	GR_COORD y2;		/**< end y coordinate*/
+} GR_SEGMENT;
+
+/** Nano-X arc by angle, for GrArcs */
+typedef struct {
+	GR_COORD x;		/**< center x coordinate*/
+	GR_COORD y;		/**< center y coordinate*/
+	GR_SIZE  rx;		/**< x radius*/
+	GR_SIZE  ry;		/**< y radius*/
+	GR_COORD angle1;	/**< start angle in 1/64 degrees*/
+	GR_COORD angle2;	/**< end angle in 1/64 degrees*/
+	int	 type;		/**< GR_ARC, GR_ARCOUTLINE or GR_PIE*/
+} GR_ARCANGLE;
+
 /* The root window id. */
 #define	GR_ROOT_WINDOW_ID	((GR_WINDOW_ID) 1)
 
@@ -253,6 +273,52 @@ typedef struct {
   GR_LENGTH bufsize;		/**< mmaped buffer size if GR_WM_PROPS_BUFFER_MMAP*/
 } GR_WINDOW_INFO;
 
+/* Server statistics returned by the GrGetServerStats() call.*/
+#define GR_STATS_BUCKETS	8	/* latency histogram buckets*/
+#define GR_STATS_MAXREQUESTS	160	/* request types reported*/
+#define GR_STATS_MAXCLIENTS	32	/* clients reported*/
+
+/**
+ * Per request type counters.  Bucket n of the latency histogram counts
+ * requests that took less than 4^n microseconds, with the last bucket
+ * counting all longer requests.
+ */
+typedef struct {
+  GR_FUNC_NAME name;		/**< request name*/
+  int opcode;			/**< request number*/
+  uint64_t count;		/**< requests handled*/
+  uint64_t nsecs;		/**< total handling time in nanoseconds*/
+  uint64_t maxnsecs;		/**< longest request in nanoseconds*/
+  uint32_t hist[GR_STATS_BUCKETS];/**< latency histogram*/
+} GR_REQUEST_STAT;
+
+/**
+ * Per client counters.
+ */
+typedef struct {
+  int id;			/**< client socket descriptor*/
+  int processid;		/**< client process id*/
+  uint64_t requests;		/**< requests received*/
+  uint64_t bytesin;		/**< bytes read from client*/
+  uint64_t bytesout;		/**< bytes written to client*/
+} GR_CLIENT_STAT;
+
+/**
+ * Server statistics since server start or the last reset.
+ * All zero if the server was built without MW_FEATURE_STATS.
+ */
+typedef struct {
+  uint64_t elapsed;		/**< nanoseconds since start or reset*/
+  uint64_t idle;		/**< nanoseconds blocked waiting for input*/
+  uint64_t busy;		/**< nanoseconds handling input, requests and timers*/
+  uint64_t selects;		/**< main loop wakeups*/
+  int nrequests;		/**< entries used in request[], used types only*/
+  int nclients;			/**< entries used in client[]*/
+  GR_REQUEST_STAT request[GR_STATS_MAXREQUESTS];
+  GR_CLIENT_STAT client[GR_STATS_MAXCLIENTS];
+  MWDRAWSTATS draw;		/**< engine drawing counters*/
+} GR_SERVER_STATS;
+
 /**
  * Direct client-mmaped window buffer or framebuffer info returned by GrGetWindowFBInfo() call.
  */
@@ -763,6 +829,10 @@ GR_WINDOW_ID	GrNewWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height, GR_SIZE bordersize,
 				GR_COLOR background, GR_COLOR bordercolor);
 GR_WINDOW_ID    GrNewPixmapEx(GR_SIZE width, GR_SIZE height, int format, void *pixels);
+GR_WINDOW_ID	GrNewSharedPixmap(GR_SIZE width, GR_SIZE height, int format,
+				void **pixels, int *pitch);
+GR_WINDOW_ID	GrAttachSharedPixmap(GR_SIZE width, GR_SIZE height, int format,
+				int shmid, int offset, int pitch);
 GR_WINDOW_ID	GrNewInputWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height);
 void		GrDestroyWindow(GR_WINDOW_ID wid);
@@ -809,6 +879,8 @@ void		GrSetFontRotation(GR_FONT_ID fontid, int tenthsdegrees);
 void		GrSetFontAttr(GR_FONT_ID fontid, int setflags, int clrflags);
 void		GrDestroyFont(GR_FONT_ID fontid);
 void		GrGetFontInfo(GR_FONT_ID font, GR_FONT_INFO *fip);
+void		GrGetFontMetrics(GR_FONT_ID font, int firstchar, int count,
+				GR_CHAR_METRICS *metrics);
 GR_WINDOW_ID	GrGetFocus(void);
 void		GrSetFocus(GR_WINDOW_ID wid);
 void		GrClearArea(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y,
@@ -833,6 +905,9 @@ void		GrPoints(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 void		GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height);
 void		GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 				GR_SIZE width, GR_SIZE height);
+void		GrRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable);
+void		GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable);
+void		GrSegments(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_SEGMENT *segtable);
 void		GrPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
 void		GrFillPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable);
 void		GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry);
@@ -841,6 +916,7 @@ void		GrArc(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_S
 				GR_COORD ax, GR_COORD ay, GR_COORD bx, GR_COORD by, int type);
 void		GrArcAngle(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry,
 				GR_COORD angle1, GR_COORD angle2, int type); /* floating point required*/
+void		GrArcs(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_ARCANGLE *arctable);
 void		GrSetGCForeground(GR_GC_ID gc, GR_COLOR foreground);
 void		GrSetGCForegroundPixelVal(GR_GC_ID gc, GR_PIXELVAL foreground);
 void		GrSetGCBackground(GR_GC_ID gc, GR_COLOR background);
@@ -889,6 +965,7 @@ GR_CURSOR_ID GrNewCursor(GR_SIZE width, GR_SIZE height, GR_COORD hotx, GR_COORD
 void		GrDestroyCursor(GR_CURSOR_ID cid);
 void		GrSetWindowCursor(GR_WINDOW_ID wid, GR_CURSOR_ID cid);
 void		GrSetWindowRegion(GR_WINDOW_ID wid, GR_REGION_ID rid, int type);
+void		GrSetWindowOpacity(GR_WINDOW_ID wid, int opacity);
 void		GrMoveCursor(GR_COORD x, GR_COORD y);
 void		GrGetSystemPalette(GR_PALETTE *pal);
 void		GrSetSystemPalette(GR_COUNT first, GR_PALETTE *pal);
@@ -908,6 +985,7 @@ void		GrSendClientData(GR_WINDOW_ID wid, GR_WINDOW_ID did,
 				GR_SERIALNO serial, GR_LENGTH len, GR_LENGTH thislen, void *data);
 void		GrBell(void);
 void		GrSetBackgroundPixmap(GR_WINDOW_ID wid, GR_WINDOW_ID pixmap, int flags);
+void		GrGetServerStats(GR_SERVER_STATS *stats, GR_BOOL reset);
 void		GrQueryPointer(GR_WINDOW_ID *mwin, GR_COORD *x, GR_COORD *y, GR_BUTTON *bmask);
 void		GrQueryTree(GR_WINDOW_ID wid, GR_WINDOW_ID *parentid,
 				GR_WINDOW_ID **children, GR_COUNT *nchildren);
@@ -1019,6 +1097,8 @@ typedef struct {
 	unsigned char *bufptr;		/* next unused buffer location*/
 	unsigned char *bufmax;		/* max buffer location*/
 	unsigned char *buffer;		/* request buffer*/
+	unsigned int	nreqs;		/* requests queued since last flush time check*/
+	unsigned long	flushtime;	/* msecs of last flush*/
 } REQBUF;
 
 /*
@@ -1075,6 +1155,8 @@ extern int     ecos_nanox_client_data_index;
         dptr->_reqbuf.bufptr = NULL;                                            \
         dptr->_reqbuf.bufmax = NULL;                                            \
         dptr->_reqbuf.buffer = NULL;                                            \
+        dptr->_reqbuf.nreqs = 0;                                                \
+        dptr->_reqbuf.flushtime = 0;                                            \
         dptr->_evlist = NULL;                                                   \
         cyg_thread_set_data(ecos_nanox_client_data_index,(CYG_ADDRWORD)dptr);   \
     }
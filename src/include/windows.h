@@ -171,12 +171,17 @@ struct hwnd {
 	struct hwnd	*children;	/* first child window */
 	struct hwnd	*siblings;	/* next sibling window */
 	struct hwnd	*next;		/* next window in complete list */
+	struct hwnd	*hashnext;	/* next window in IsWindow hash chain*/
 	struct hcursor	*cursor;	/* cursor for this window */
 	struct hdc *	owndc;		/* owndc if CS_OWNDC*/
 	int		unmapcount;	/* count of reasons not really mapped */
 	int		id;		/* window id */
 	LPTSTR		szTitle;	/* window title*/
 	int		gotPaintMsg;	/* window had WM_PAINT PostMessage*/
+	int		paintQueued;	/* on needs paint list, 1 toplevel 2 child*/
+	MWLIST		paintlink;	/* needs paint list link*/
+	MWLISTHEAD	msgq;		/* posted msgs for this window*/
+	MSG *		mouseMsg;	/* queued WM_MOUSEMOVE for coalescing*/
 	int		paintSerial;	/* experimental serial # for alphblend*/
 	int		paintNC;	/* experimental NC paint handling*/
 	int		nEraseBkGnd;	/* for InvalidateXX erase bkgnd flag */
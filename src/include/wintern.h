@@ -21,6 +21,8 @@ HWND		MwGetTopWindow(HWND hwnd);
 void		MwCalcClientRect(HWND hwnd);
 void		MwSendSizeMove(HWND hwnd, BOOL bSize, BOOL bMove);
 void		MwSetCursor(HWND wp, PMWCURSOR pcursor);
+void		MwAddWindowHash(HWND hwnd);
+void		MwSetNeedsPaint(HWND hwnd);
 
 /* wingdi.c*/
 #define MwIsClientDC(hdc)	(((hdc)->flags & DCX_WINDOW) == 0)
@@ -288,7 +288,7 @@ DefWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				 */
 				for(wp=listwp; wp; wp=wp->next)
 					if(wp->gotPaintMsg == PAINT_DELAYPAINT)
-					    wp->gotPaintMsg = PAINT_NEEDSPAINT;
+					    MwSetNeedsPaint(wp);
 			} else {
 				POINTSTOPOINT(curpt, lParam);
 				x = curpt.x - startpt.x;
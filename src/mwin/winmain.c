@@ -96,12 +96,26 @@ typedef struct {
 static WNDUSERFD userregfd[FD_SETSIZE];
 static int       userregfd_head;
 
+#if HAVE_EPOLL
+/* update epoll set from registered hwnds for fd*/
+static void
+MwPollFd(int fd)
+{
+	GdPollSet(fd, (userregfd[fd].read? MWPOLL_READ: 0) |
+		(userregfd[fd].write? MWPOLL_WRITE: 0) |
+		(userregfd[fd].except? MWPOLL_EXCEPT: 0));
+}
+#else
+#define MwPollFd(fd)
+#endif
+
 void WINAPI
 MwRegisterFdInput(HWND hwnd, int fd)
 {
 	if (fd < FD_SETSIZE && fd != mouse_fd && fd != keyb_fd) {
 		if (!userregfd[fd].read) {
 			userregfd[fd].read = hwnd;
+			MwPollFd(fd);
 			if (userregfd[fd].next == -1 && !userregfd[fd].write && !userregfd[fd].except) {
 				userregfd[fd].next = userregfd_head;
 				userregfd_head = fd;
@@ -116,6 +130,7 @@ MwUnregisterFdInput(HWND hwnd, int fd)
 	if (fd < FD_SETSIZE && fd != mouse_fd && fd != keyb_fd) {
 		if (userregfd[fd].read == hwnd) {
 			userregfd[fd].read = NULL;
+			MwPollFd(fd);
 			if (!userregfd[fd].write && !userregfd[fd].except) {
 				int *listfd = &userregfd_head;
 				while (*listfd != -1) {
@@ -138,6 +153,7 @@ MwRegisterFdOutput(HWND hwnd, int fd)
 	if (fd < FD_SETSIZE && fd != mouse_fd && fd != keyb_fd) {
 		if (!userregfd[fd].write) {
 			userregfd[fd].write = hwnd;
+			MwPollFd(fd);
 			if (userregfd[fd].next == -1 && !userregfd[fd].read && !userregfd[fd].except) {
 				userregfd[fd].next = userregfd_head;
 				userregfd_head = fd;
@@ -152,6 +168,7 @@ MwUnregisterFdOutput(HWND hwnd, int fd)
 	if (fd < FD_SETSIZE && fd != mouse_fd && fd != keyb_fd) {
 		if (userregfd[fd].write == hwnd) {
 			userregfd[fd].write = NULL;
+			MwPollFd(fd);
 			if (!userregfd[fd].read && !userregfd[fd].except) {
 				int *listfd = &userregfd_head;
 				while (*listfd != -1) {
@@ -174,6 +191,7 @@ MwRegisterFdExcept(HWND hwnd, int fd)
 	if (fd < FD_SETSIZE && fd != mouse_fd && fd != keyb_fd) {
 		if (!userregfd[fd].except) {
 			userregfd[fd].except = hwnd;
+			MwPollFd(fd);
 			if (userregfd[fd].next == -1 && !userregfd[fd].read && !userregfd[fd].write) {
 				userregfd[fd].next = userregfd_head;
 				userregfd_head = fd;
@@ -188,6 +206,7 @@ MwUnregisterFdExcept(HWND hwnd, int fd)
 	if (fd < FD_SETSIZE && fd != mouse_fd && fd != keyb_fd) {
 		if (userregfd[fd].except == hwnd) {
 			userregfd[fd].except = NULL;
+			MwPollFd(fd);
 			if (!userregfd[fd].read && !userregfd[fd].write) {
 				int *listfd = &userregfd_head;
 				while (*listfd != -1) {
@@ -209,6 +228,127 @@ MwUnregisterFdExcept(HWND hwnd, int fd)
 /********************************************************************************/
 #if UNIX && HAVE_SELECT
 
+#if HAVE_EPOLL
+/* Linux epoll version, fds stay registered in the epoll set between calls*/
+void
+MwSelect(BOOL canBlock)
+{
+	MWPOLLEVENT events[MAXPOLLEVENTS];
+	int 	i, n, fd;
+	int	timedout;
+	MWTIMEOUT	timeout;
+	struct timeval tout, *to;
+
+	/* x11/sdl update screen & flush buffers*/
+	if(scrdev.PreSelect)
+	{
+		/* returns # pending events*/
+		if (scrdev.PreSelect(&scrdev))
+		{
+			/* poll for mouse data and service if found*/
+			while (MwCheckMouseEvent())
+				continue;
+
+			/* poll for keyboard data and service if found*/
+			while (MwCheckKeyboardEvent())
+				continue;
+
+			/* events found, return with no sleep*/
+			return;
+		}
+	}
+
+	/*
+	 * Setup timeval struct for block or poll.
+	 * If we're moving a window, poll quickly to allow other windows
+	 * to repaint while checking for more event input.
+	 */
+	timeout = tout.tv_sec = tout.tv_usec = 0L;
+	to = &tout;
+	int poll = (!canBlock || dragwp);		/* just poll if can't block or window move in progress*/
+	if (!poll)
+	{
+		if ((timeout = MwGetNextTimeoutValue()) == (MWTIMEOUT) -1L)	/* get next mwin timer*/
+			timeout = 0;											/* no mwin timers*/
+#if MW_FEATURE_TIMERS
+		/* get next timer or use passed timeout and convert to timeval struct*/
+		if (!GdGetNextTimeout(&tout, timeout))		/* no VTSWITCH timer?*/
+#else
+		if (timeout)								/* setup mwin poll timer*/
+		{
+			/* convert wait timeout to timeval struct*/
+			tout.tv_sec = timeout / 1000;
+			tout.tv_usec = (timeout % 1000) * 1000;
+		}
+		else
+#endif
+		{
+			to = NULL;								/* no timers, block*/
+		}
+	}
+
+	/* some drivers can't block as backend is poll based (SDL)*/
+	if (scrdev.flags & PSF_CANTBLOCK)
+	{
+#define WAITTIME	100
+		/* check if would block permanently or timeout > WAITTIME*/
+		if (to == NULL || tout.tv_sec != 0 || tout.tv_usec > WAITTIME)
+		{
+			/* override timeouts and wait for max WAITTIME ms*/
+			to = &tout;
+			tout.tv_sec = 0;
+			tout.tv_usec = WAITTIME;
+		}
+	}
+
+	/* Wait for some input on any registered fd or a timeout*/
+	if ((n = GdPollWait(events, MAXPOLLEVENTS, to)) < 0)
+	{
+		if (errno != EINTR)
+			EPRINTF("epoll_wait call in main failed. Errno=%d\n", errno);
+		return;
+	}
+
+	timedout = (n == 0);
+	for (i = 0; i < n; i++)
+	{
+		fd = events[i].fd;
+
+		if (events[i].events & MWPOLL_TIMER)
+			timedout = 1;
+
+		/* service mouse file descriptor*/
+		else if (fd == mouse_fd)
+			while (MwCheckMouseEvent())
+				continue;
+
+		/* service keyboard file descriptor*/
+		else if (fd == keyb_fd)
+			while (MwCheckKeyboardEvent())
+				continue;
+
+		/* If registered descriptor, handle it */
+		else if (fd < FD_SETSIZE)
+		{
+			if (userregfd[fd].read && (events[i].events & MWPOLL_READ))
+				PostMessage(userregfd[fd].read, WM_FDINPUT, fd, 0);
+			if (userregfd[fd].write && (events[i].events & MWPOLL_WRITE))
+				PostMessage(userregfd[fd].write, WM_FDOUTPUT, fd, 0);
+			if (userregfd[fd].except && (events[i].events & MWPOLL_EXCEPT))
+				PostMessage(userregfd[fd].except, WM_FDEXCEPT, fd, 0);
+		}
+	}
+
+	if (timedout)
+	{
+#if MW_FEATURE_TIMERS
+		/* check for timer timeouts and service if found*/
+		GdTimeout();
+#endif
+	}
+}
+
+#else /* !HAVE_EPOLL*/
 void
 MwSelect(BOOL canBlock)
 {
@@ -349,6 +489,7 @@ MwSelect(BOOL canBlock)
 	} else if(errno != EINTR)
 		EPRINTF("Select() call in main failed. Errno=%d\n", errno);
 }
+#endif /* HAVE_EPOLL*/
 
 /********************************************************************************/
 #elif RTEMS | __ECOS
@@ -523,6 +664,12 @@ MwInitialize(void)
 		return -1;
 	}
 
+#if HAVE_EPOLL
+	/* wait for mouse and keyboard input in the epoll set*/
+	GdPollSet(mouse_fd, MWPOLL_READ);
+	GdPollSet(keyb_fd, MWPOLL_READ);
+#endif
+
 	/*
 	 * Initialize the root window.
 	 */
@@ -580,6 +727,7 @@ MwInitialize(void)
 
 	listwp = wp;
 	rootwp = wp;
+	MwAddWindowHash(wp);
 	focuswp = wp;
 	mousewp = wp;
 
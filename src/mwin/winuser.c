@@ -29,7 +29,25 @@
 #define PAINTONCE	1	/* =1 to queue paint msgs only once*/
 #define MOUSETEST	1
 
+/* posted msg, queued in posting order and on its window's queue*/
+typedef struct {
+	MSG	msg;		/* msg.link in application queue, must be first*/
+	MWLIST	wlink;		/* link in window or thread msg queue*/
+	DWORD	serial;		/* posting order across window queues*/
+} MWQMSG;
+
+/* msg filter match, no filter if both zero*/
+#define MSGINRANGE(msg,first,last)	(((first) == 0 && (last) == 0) || \
+					((msg) >= (first) && (msg) <= (last)))
+
+#define HWND_HASHSIZE	256
+#define HWND_HASH(hwnd)	(((UINT_PTR)(hwnd) >> 4) & (HWND_HASHSIZE - 1))
+
 MWLISTHEAD mwMsgHead;		/* application msg queue*/
+static MWLISTHEAD mwThreadMsgHead;	/* msgs posted without window*/
+static MWLISTHEAD mwPaintHead[2];	/* toplevel and child windows needing paint*/
+static DWORD mwMsgSerial;	/* posted msg serial number*/
+static HWND mwHashWnd[HWND_HASHSIZE];	/* all windows, for IsWindow*/
 MWLISTHEAD mwClassHead;		/* register class list*/
 MWLISTHEAD mwHotkeyHead={0};/* Hotkey table list */
 
@@ -79,6 +97,7 @@ typedef struct {
 static void MwOffsetChildren(HWND hwnd, int offx, int offy);
 static void MwRemoveWndFromTimers(HWND hwnd);
 static BOOL MwRemoveWndFromHotkeys (HWND hWnd);
+static void MwRemoveWindowHash(HWND hwnd);
 
 LRESULT WINAPI
 CallWindowProc(WNDPROC lpPrevWndFunc, HWND hwnd, UINT Msg, WPARAM wParam,
@@ -97,38 +116,124 @@ SendMessage(HWND hwnd, UINT Msg,WPARAM wParam,LPARAM lParam)
 	return 0;
 }
 
+/* mark window as needing WM_PAINT and add it to windows checked by PeekMessage*/
+void
+MwSetNeedsPaint(HWND hwnd)
+{
+	hwnd->gotPaintMsg = PAINT_NEEDSPAINT;
+	if(!hwnd->paintQueued) {
+		hwnd->paintQueued = (hwnd->style & WS_CHILD)? 2: 1;
+		GdListAdd(&mwPaintHead[hwnd->paintQueued-1], &hwnd->paintlink);
+	}
+}
+
+static void
+MwRemovePaint(HWND hwnd)
+{
+	if(hwnd->paintQueued) {
+		GdListRemove(&mwPaintHead[hwnd->paintQueued-1], &hwnd->paintlink);
+		hwnd->paintQueued = 0;
+	}
+}
+
+/* remove posted msg from application and window queues and free it*/
+static void
+MwRemoveMsg(MWQMSG *pQMsg)
+{
+	HWND	hwnd = pQMsg->msg.hwnd;
+
+	GdListRemove(&mwMsgHead, &pQMsg->msg.link);
+	if(hwnd) {
+		GdListRemove(&hwnd->msgq, &pQMsg->wlink);
+		if(hwnd->mouseMsg == &pQMsg->msg)
+			hwnd->mouseMsg = NULL;
+	} else
+		GdListRemove(&mwThreadMsgHead, &pQMsg->wlink);
+	GdItemFree(pQMsg);
+}
+
+/* return first msg in range posted to window or its children*/
+static MWQMSG *
+MwFindWindowMsg(HWND hwnd, UINT first, UINT last, MWQMSG *pBest)
+{
+	PMWLIST	p;
+	MWQMSG *pQMsg;
+	HWND	cp;
+
+	for(p=hwnd->msgq.head; p; p=p->next) {
+		pQMsg = MwItemAddr(p, MWQMSG, wlink);
+		if(MSGINRANGE(pQMsg->msg.message, first, last)) {
+			if(!pBest || (long)(pQMsg->serial - pBest->serial) < 0)
+				pBest = pQMsg;
+			break;
+		}
+	}
+	for(cp=hwnd->children; cp; cp=cp->siblings)
+		pBest = MwFindWindowMsg(cp, first, last, pBest);
+	return pBest;
+}
+
+/*
+ * Return first queued msg matching PeekMessage filter.  A window filter
+ * only looks at the queues of that window and its children, and no
+ * filter takes the head of the application queue.
+ */
+static MWQMSG *
+MwFindMsg(HWND hwnd, UINT first, UINT last)
+{
+	PMWLIST	p;
+	MWQMSG *pQMsg;
+
+	if(hwnd == (HWND)-1) {		/* thread msgs only*/
+		for(p=mwThreadMsgHead.head; p; p=p->next) {
+			pQMsg = MwItemAddr(p, MWQMSG, wlink);
+			if(MSGINRANGE(pQMsg->msg.message, first, last))
+				return pQMsg;
+		}
+		return NULL;
+	}
+	if(hwnd)
+		return IsWindow(hwnd)? MwFindWindowMsg(hwnd, first, last, NULL): NULL;
+
+	for(p=mwMsgHead.head; p; p=p->next) {
+		pQMsg = (MWQMSG *)MwItemAddr(p, MSG, link);
+		if(MSGINRANGE(pQMsg->msg.message, first, last))
+			return pQMsg;
+	}
+	return NULL;
+}
+
 BOOL WINAPI
 PostMessage(HWND hwnd, UINT Msg, WPARAM wParam, LPARAM lParam)
 {
+	MWQMSG *pQMsg;
 	MSG *	pMsg;
 
+	if(hwnd && !IsWindow(hwnd))
+		return FALSE;
 #if PAINTONCE
 	/* don't queue paint msgs, set window paint status instead*/
 	if(Msg == WM_PAINT) {
-		hwnd->gotPaintMsg = PAINT_NEEDSPAINT;
+		MwSetNeedsPaint(hwnd);
 		return TRUE;
 	}
 #endif
 #if MOUSETEST
 	/* replace multiple mouse messages with one for better mouse handling*/
-	if(Msg == WM_MOUSEMOVE) {
-		PMWLIST	p;
-		for(p=mwMsgHead.head; p; p=p->next) {
-			pMsg = MwItemAddr(p, MSG, link);
-			if(pMsg->hwnd == hwnd && pMsg->message == Msg) {
-				pMsg->wParam = wParam;
-				pMsg->lParam = lParam;
-				pMsg->time = GetTickCount();
-				pMsg->pt.x = cursorx;
-				pMsg->pt.y = cursory;
-				return TRUE;
-			}
-		}
+	if(Msg == WM_MOUSEMOVE && hwnd && hwnd->mouseMsg) {
+		pMsg = hwnd->mouseMsg;
+		pMsg->wParam = wParam;
+		pMsg->lParam = lParam;
+		pMsg->time = GetTickCount();
+		pMsg->pt.x = cursorx;
+		pMsg->pt.y = cursory;
+		return TRUE;
 	}
 #endif
-	pMsg = GdItemNew(MSG);
-	if(!pMsg)
+	pQMsg = GdItemNew(MWQMSG);
+	if(!pQMsg)
 		return FALSE;
+	pMsg = &pQMsg->msg;
 	pMsg->hwnd = hwnd;
 	pMsg->message = Msg;
 	pMsg->wParam = wParam;
@@ -136,7 +241,14 @@ PostMessage(HWND hwnd, UINT Msg, WPARAM wParam, LPARAM lParam)
 	pMsg->time = GetTickCount();
 	pMsg->pt.x = cursorx;
 	pMsg->pt.y = cursory;
+	pQMsg->serial = mwMsgSerial++;
 	GdListAdd(&mwMsgHead, &pMsg->link);
+	if(hwnd) {
+		GdListAdd(&hwnd->msgq, &pQMsg->wlink);
+		if(Msg == WM_MOUSEMOVE)
+			hwnd->mouseMsg = pMsg;
+	} else
+		GdListAdd(&mwThreadMsgHead, &pQMsg->wlink);
 	return TRUE;
 }
 
@@ -184,42 +296,66 @@ chkPaintMsg(HWND wp, LPMSG lpMsg)
 	return FALSE;
 }
 
+/* check windows needing paint matching PeekMessage filter, toplevel windows first*/
+static BOOL
+MwCheckPaintMsg(LPMSG lpMsg, HWND hwnd, UINT first, UINT last)
+{
+	PMWLIST	p, next;
+	HWND	wp, pp;
+	int	i;
+
+	if(hwnd == (HWND)-1 || !MSGINRANGE(WM_PAINT, first, last))
+		return FALSE;
+
+	for(i=0; i<2; i++) {
+		for(p=mwPaintHead[i].head; p; p=next) {
+			next = p->next;
+			wp = MwItemAddr(p, struct hwnd, paintlink);
+
+			/* already painted by UpdateWindow or validated*/
+			if(wp->gotPaintMsg != PAINT_NEEDSPAINT) {
+				MwRemovePaint(wp);
+				continue;
+			}
+			if(hwnd) {
+				for(pp=wp; pp && pp != hwnd; pp=pp->parent)
+					continue;
+				if(!pp)
+					continue;
+			}
+			if(chkPaintMsg(wp, lpMsg)) {
+				MwRemovePaint(wp);
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
 BOOL WINAPI
 PeekMessage(LPMSG lpMsg, HWND hwnd, UINT uMsgFilterMin, UINT uMsgFilterMax,
 	UINT wRemoveMsg)
 {
-	HWND	wp;
-	PMSG	pNxtMsg;
+	MWQMSG *pNxtMsg;
 
-	/* check if no messages in queue*/
-	if(mwMsgHead.head == NULL) {
+	/* check if no matching messages in queue*/
+	pNxtMsg = MwFindMsg(hwnd, uMsgFilterMin, uMsgFilterMax);
+	if(pNxtMsg == NULL) {
 #if PAINTONCE
-		/* check all windows for pending paint messages*/
-		for(wp=listwp; wp; wp=wp->next) {
-			if(!(wp->style & WS_CHILD)) {
-				if(chkPaintMsg(wp, lpMsg))
-					return TRUE;
-			}
-		}
-		for(wp=listwp; wp; wp=wp->next) {
-			if(wp->style & WS_CHILD) {
-				if(chkPaintMsg(wp, lpMsg))
-					return TRUE;
-			}
-		}
+		/* check windows with pending paint messages*/
+		if(MwCheckPaintMsg(lpMsg, hwnd, uMsgFilterMin, uMsgFilterMax))
+			return TRUE;
 #endif
 		MwSelect(FALSE);
-	}
 
-	if(mwMsgHead.head == NULL)
-		return FALSE;
+		pNxtMsg = MwFindMsg(hwnd, uMsgFilterMin, uMsgFilterMax);
+		if(pNxtMsg == NULL)
+			return FALSE;
+	}
 
-	pNxtMsg = (PMSG)mwMsgHead.head;
-	if(wRemoveMsg & PM_REMOVE)
-		GdListRemove(&mwMsgHead, &pNxtMsg->link);
-	*lpMsg = *pNxtMsg;
+	*lpMsg = pNxtMsg->msg;
 	if(wRemoveMsg & PM_REMOVE)
-		GdItemFree(pNxtMsg);
+		MwRemoveMsg(pNxtMsg);
 	return TRUE;
 }
 
@@ -505,6 +641,7 @@ CreateWindowEx(DWORD dwExStyle, LPCSTR lpClassName, LPCSTR lpWindowName,
 		strcpy(wp->szTitle, lpWindowName);
 	else
 		wp->szTitle[0] = '\0';
+	MwAddWindowHash(wp);
 
 #if UPDATEREGIONS
 	wp->update = GdAllocRegion();
@@ -564,7 +701,6 @@ MwDestroyWindow(HWND hwnd,BOOL bSendMsg)
 	HWND	wp = hwnd;
 	HWND	prevwp;
 	PMWLIST	p;
-	PMSG	pmsg;
 
 	if (wp == rootwp || !IsWindow (hwnd))
 		return;
@@ -642,15 +778,10 @@ MwDestroyWindow(HWND hwnd,BOOL bSendMsg)
 	 */
 
 	/* Remove all messages from msg queue for this window*/
-	for(p=mwMsgHead.head; p; ) {
-		pmsg = MwItemAddr(p, MSG, link);
-		if(pmsg->hwnd == wp) {
-			p = p->next;
-			GdListRemove(&mwMsgHead, &pmsg->link);
-			GdItemFree(pmsg);
-		} else
-			p = p->next;
-	}
+	while(wp->msgq.head)
+		MwRemoveMsg(MwItemAddr(wp->msgq.head, MWQMSG, wlink));
+	MwRemovePaint(wp);
+	MwRemoveWindowHash(wp);
 
 	/*
 	 * Remove all properties from this window.
@@ -694,12 +825,34 @@ MwDestroyWindow(HWND hwnd,BOOL bSendMsg)
 	GdItemFree(wp);
 }
 
+/* add new window to IsWindow hash table*/
+void
+MwAddWindowHash(HWND hwnd)
+{
+	hwnd->hashnext = mwHashWnd[HWND_HASH(hwnd)];
+	mwHashWnd[HWND_HASH(hwnd)] = hwnd;
+}
+
+static void
+MwRemoveWindowHash(HWND hwnd)
+{
+	HWND *	pwp;
+
+	for(pwp=&mwHashWnd[HWND_HASH(hwnd)]; *pwp; pwp=&(*pwp)->hashnext) {
+		if(*pwp == hwnd) {
+			*pwp = hwnd->hashnext;
+			break;
+		}
+	}
+	hwnd->hashnext = NULL;
+}
+
 BOOL WINAPI
 IsWindow(HWND hwnd)
 {
 	HWND	wp;
 
-	for(wp=listwp; wp; wp=wp->next)
+	for(wp=mwHashWnd[HWND_HASH(hwnd)]; wp; wp=wp->hashnext)
 		if(wp == hwnd)
 			return TRUE;
 	return FALSE;
@@ -781,7 +934,7 @@ InvalidateRect(HWND hwnd, CONST RECT *lpRect, BOOL bErase)
 #endif
 
 			if(hwnd->gotPaintMsg == PAINT_PAINTED)
-				hwnd->gotPaintMsg = PAINT_NEEDSPAINT;
+				MwSetNeedsPaint(hwnd);
 		if( bErase )
 			hwnd->nEraseBkGnd++;
 	}
@@ -809,7 +962,7 @@ InvalidateRgn(HWND hwnd, HRGN hrgn, BOOL bErase)
 		/* if update region not empty, mark as needing painting*/
 		if(hwnd->update->numRects != 0)
 			if(hwnd->gotPaintMsg == PAINT_PAINTED)
-				hwnd->gotPaintMsg = PAINT_NEEDSPAINT;
+				MwSetNeedsPaint(hwnd);
 		if( bErase )
 			hwnd->nEraseBkGnd++;
 	}
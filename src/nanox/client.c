@@ -84,6 +84,14 @@ LOCK_DECLARE(nxGlobalLock);	/* global lock for threads safety*/
 #if HAVE_SHAREDMEM_SUPPORT
 char *	   nxSharedMem = 0;	/* Address of shared memory segment*/
 static int nxSharedMemSize;	/* Size in bytes of shared mem segment*/
+
+/* shared memory pixmaps attached by this client*/
+typedef struct nxsharedpixmap {
+	struct nxsharedpixmap *next;
+	GR_WINDOW_ID	id;		/* pixmap id*/
+	void *		addr;		/* attached pixels*/
+} nxSharedPixmap;
+static nxSharedPixmap *nxSharedPixmaps;
 #endif
 
 static int regfdmax = -1;	/* GrRegisterInput globals*/
@@ -554,6 +562,28 @@ GrGetScreenInfo(GR_SCREEN_INFO *sip)
 	UNLOCK(&nxGlobalLock);
 }
 
+/**
+ * Fills in the specified GR_SERVER_STATS structure with the server's
+ * request latency, client traffic and drawing statistics.  The server
+ * must be built with MW_FEATURE_STATS, otherwise all values are zero.
+ *
+ * @param stats Pointer to a GR_SERVER_STATS structure.
+ * @param reset TRUE to clear the server counters after reading them.
+ *
+ * @ingroup nanox_general
+ */
+void
+GrGetServerStats(GR_SERVER_STATS *stats, GR_BOOL reset)
+{
+	nxGetServerStatsReq *req;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(GetServerStats);
+	req->reset = reset;
+	TypedReadBlock(stats, sizeof(GR_SERVER_STATS), GrNumGetServerStats);
+	UNLOCK(&nxGlobalLock);
+}
+
 /**
  * Returns the colour at the specified index into the server's color look
  * up table. The colours in the table are those with names like
@@ -600,6 +630,36 @@ GrGetFontInfo(GR_FONT_ID font, GR_FONT_INFO *fip)
 	UNLOCK(&nxGlobalLock);
 }
 
+/**
+ * Gets the advance width and ink extents of a range of characters,
+ * allowing text to be measured without a server round trip per string.
+ * Ink extents are the advance width and font ascent and descent when the
+ * font renderer can't return glyph bitmaps.  Kerning is not included.
+ *
+ * @param font The font ID to query.
+ * @param firstchar First character, as a unicode value.
+ * @param count Number of characters.
+ * @param metrics Array of count GR_CHAR_METRICS to store the result.
+ *
+ * @ingroup nanox_font
+ */
+void
+GrGetFontMetrics(GR_FONT_ID font, int firstchar, int count, GR_CHAR_METRICS *metrics)
+{
+	nxGetFontMetricsReq *req;
+
+	if (count <= 0)
+		return;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(GetFontMetrics);
+	req->fontid = font;
+	req->firstchar = firstchar;
+	req->count = count;
+	TypedReadBlock(metrics, count * sizeof(GR_CHAR_METRICS),GrNumGetFontMetrics);
+	UNLOCK(&nxGlobalLock);
+}
+
 /**
  * Fills in the specified GR_GC_INFO structure with information regarding the
  * specified graphics context.
@@ -1276,11 +1336,11 @@ GrSelectEvents(GR_WINDOW_ID wid, GR_EVENT_MASK eventmask)
 {
 	nxSelectEventsReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SelectEvents);
 	req->windowid = wid;
 	req->eventmask = eventmask;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1354,6 +1414,141 @@ GrNewPixmapEx(GR_SIZE width, GR_SIZE height, int format, void *pixels)
 	return wid;
 }
 
+/**
+ * Create a new server side pixmap whose pixels are placed in memory
+ * shared with the client.  The application draws directly into the
+ * returned pixel buffer and presents it with a single GrCopyArea,
+ * avoiding the copy of every pixel through the request stream that
+ * GrArea requires.  The pixel layout is that of a GrNewPixmapEx pixmap
+ * of the same format.  Since requests are buffered, the pixels should
+ * not be changed again until the server has processed the GrCopyArea,
+ * for instance after a round trip call like GrGetScreenInfo.
+ *
+ * Use GrDestroyWindow to free the pixmap.  If the server was built without
+ * shared memory support, 0 is returned and the caller should fall back
+ * to GrNewPixmapEx and GrArea.
+ *
+ * @param width  The width of the pixmap.
+ * @param height The height of the pixmap.
+ * @param format The MWIF image format for the pixmap, 0 for screen format.
+ * @param pixels Returns the address of the shared pixel buffer.
+ * @param pitch  Returns the number of bytes per pixmap line.
+ * @return       The ID of the newly created pixmap, or 0 on failure.
+ *
+ * @ingroup nanox_window
+ */
+GR_WINDOW_ID
+GrNewSharedPixmap(GR_SIZE width, GR_SIZE height, int format, void **pixels,
+	int *pitch)
+{
+	GR_WINDOW_ID	wid = 0;
+#if HAVE_SHAREDMEM_SUPPORT
+	nxNewSharedPixmapReq *req;
+	nxSharedPixmap	*sp;
+	int		key, size, shmid;
+	void *		addr;
+#endif
+
+	*pixels = NULL;
+	*pitch = 0;
+#if HAVE_SHAREDMEM_SUPPORT
+	LOCK(&nxGlobalLock);
+	req = AllocReq(NewSharedPixmap);
+	req->width = width;
+	req->height = height;
+	req->format = format;
+	if(TypedReadBlock(&wid, sizeof(wid), GrNumNewSharedPixmap) == -1) {
+		UNLOCK(&nxGlobalLock);
+		return 0;
+	}
+	ReadBlock(&key, sizeof(key));
+	ReadBlock(&size, sizeof(size));
+	ReadBlock(pitch, sizeof(*pitch));
+
+	if (!wid || !key)
+		goto fail;
+
+	shmid = shmget(key, size, 0);
+	if (shmid == -1) {
+		EPRINTF("nxclient: Can't shmget key %d: %d\n", key, errno);
+		goto fail;
+	}
+	addr = shmat(shmid, 0, 0);
+	shmctl(shmid, IPC_RMID, 0);	/* Prevent other from attaching */
+	if (addr == (void *)-1)
+		goto fail;
+
+	if ((sp = malloc(sizeof(nxSharedPixmap))) == NULL) {
+		shmdt(addr);
+		goto fail;
+	}
+	sp->id = wid;
+	sp->addr = addr;
+	sp->next = nxSharedPixmaps;
+	nxSharedPixmaps = sp;
+
+	*pixels = addr;
+	UNLOCK(&nxGlobalLock);
+	return wid;
+
+fail:
+	if (wid) {
+		nxDestroyWindowReq *dreq = AllocReq(DestroyWindow);
+		dreq->windowid = wid;
+	}
+	*pitch = 0;
+	UNLOCK(&nxGlobalLock);
+#endif /* HAVE_SHAREDMEM_SUPPORT*/
+	return 0;
+}
+
+/**
+ * Create a new server side pixmap whose pixels are in a SysV shared memory
+ * segment created by the application, for instance an MIT-SHM image.
+ * Drawing into the segment changes the pixmap, which is presented with a
+ * single GrCopyArea.  GrCopyArea into the pixmap followed by a round trip
+ * call like GrGetScreenInfo reads a drawable into the segment.  The pixel
+ * layout is that of a GrNewPixmapEx pixmap of the same format, except
+ * that lines are pitch bytes apart.
+ *
+ * The segment remains owned by the application, which must destroy the
+ * pixmap with GrDestroyWindow before removing it.  The server must be
+ * able to attach the segment for reading and writing.  If the server
+ * was built without shared memory support, 0 is returned and the caller
+ * should fall back to GrArea.
+ *
+ * @param width  The width of the pixmap.
+ * @param height The height of the pixmap.
+ * @param format The MWIF image format for the pixmap, 0 for screen format.
+ * @param shmid  The shared memory segment id.
+ * @param offset The offset of the first pixel in the segment.
+ * @param pitch  The number of bytes per pixmap line, at least that of a
+ *		 GrNewPixmapEx pixmap.
+ * @return       The ID of the newly created pixmap, or 0 on failure.
+ *
+ * @ingroup nanox_window
+ */
+GR_WINDOW_ID
+GrAttachSharedPixmap(GR_SIZE width, GR_SIZE height, int format, int shmid,
+	int offset, int pitch)
+{
+	nxAttachSharedPixmapReq *req;
+	GR_WINDOW_ID	wid;
+
+	LOCK(&nxGlobalLock);
+	req = AllocReq(AttachSharedPixmap);
+	req->width = width;
+	req->height = height;
+	req->format = format;
+	req->shmid = shmid;
+	req->offset = offset;
+	req->pitch = pitch;
+	if(TypedReadBlock(&wid, sizeof(wid), GrNumAttachSharedPixmap) == -1)
+		wid = 0;
+	UNLOCK(&nxGlobalLock);
+	return wid;
+}
+
 /**
  * Create a new input-only window with the specified dimensions which is a
  * child of the specified parent window.
@@ -1405,6 +1600,21 @@ GrDestroyWindow(GR_WINDOW_ID wid)
 	LOCK(&nxGlobalLock);
 	req = AllocReq(DestroyWindow);
 	req->windowid = wid;
+#if HAVE_SHAREDMEM_SUPPORT
+	if (nxSharedPixmaps) {
+		nxSharedPixmap **spp, *sp;
+
+		/* detach shared pixels, server still holds its own mapping*/
+		for (spp = &nxSharedPixmaps; (sp = *spp) != NULL; spp = &sp->next) {
+			if (sp->id == wid) {
+				*spp = sp->next;
+				shmdt(sp->addr);
+				free(sp);
+				break;
+			}
+		}
+	}
+#endif
 	UNLOCK(&nxGlobalLock);
 }
 
@@ -1485,10 +1695,10 @@ GrDestroyGC(GR_GC_ID gc)
 {
 	nxDestroyGCReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(DestroyGC);
 	req->gcid = gc;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1524,10 +1734,10 @@ GrDestroyRegion(GR_REGION_ID region)
 {
 	nxDestroyRegionReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(DestroyRegion);
 	req->regionid = region;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1544,12 +1754,12 @@ GrUnionRectWithRegion(GR_REGION_ID region, GR_RECT *rect)
 {
 	nxUnionRectWithRegionReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
  	req = AllocReq(UnionRectWithRegion);
  	if(rect)
  		memcpy(&req->rect, rect, sizeof(*rect));
  	req->regionid = region;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1568,12 +1778,12 @@ GrUnionRegion(GR_REGION_ID dst_rgn, GR_REGION_ID src_rgn1,
 {
 	nxUnionRegionReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
  	req = AllocReq(UnionRegion);
  	req->regionid = dst_rgn;
  	req->srcregionid1 = src_rgn1;
  	req->srcregionid2 = src_rgn2;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1592,12 +1802,12 @@ GrSubtractRegion(GR_REGION_ID dst_rgn, GR_REGION_ID src_rgn1,
 {
 	nxSubtractRegionReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
  	req = AllocReq(SubtractRegion);
  	req->regionid = dst_rgn;
  	req->srcregionid1 = src_rgn1;
  	req->srcregionid2 = src_rgn2;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1617,12 +1827,12 @@ GrXorRegion(GR_REGION_ID dst_rgn, GR_REGION_ID src_rgn1,
 {
 	nxXorRegionReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
  	req = AllocReq(XorRegion);
  	req->regionid = dst_rgn;
  	req->srcregionid1 = src_rgn1;
  	req->srcregionid2 = src_rgn2;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1642,12 +1852,12 @@ GrIntersectRegion(GR_REGION_ID dst_rgn, GR_REGION_ID src_rgn1,
 {
 	nxIntersectRegionReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
  	req = AllocReq(IntersectRegion);
  	req->regionid = dst_rgn;
  	req->srcregionid1 = src_rgn1;
  	req->srcregionid2 = src_rgn2;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1666,11 +1876,11 @@ GrSetGCRegion(GR_GC_ID gc, GR_REGION_ID region)
 {
 	nxSetGCRegionReq *req;
 	
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCRegion);
 	req->gcid = gc;
 	req->regionid = region;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1688,12 +1898,12 @@ GrSetGCClipOrigin(GR_GC_ID gc, int xoff, int yoff)
 {
 	nxSetGCClipOriginReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCClipOrigin);
 	req->gcid = gc;
 	req->xoff = xoff;
 	req->yoff = yoff;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1710,11 +1920,11 @@ GrSetGCGraphicsExposure(GR_GC_ID gc, GR_BOOL exposure)
 {
 	nxSetGCGraphicsExposureReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCGraphicsExposure);
 	req->gcid = gc;
 	req->exposure = exposure;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1847,12 +2057,12 @@ GrOffsetRegion(GR_REGION_ID region, GR_SIZE dx, GR_SIZE dy)
 {
 	nxOffsetRegionReq *req;
 	
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(OffsetRegion);
 	req->region = region;
 	req->dx = dx;
 	req->dy = dy;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1942,10 +2152,10 @@ GrMapWindow(GR_WINDOW_ID wid)
 {
 	nxMapWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(MapWindow);
 	req->windowid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1961,10 +2171,10 @@ GrUnmapWindow(GR_WINDOW_ID wid)
 {
 	nxUnmapWindowReq *req;
 	
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(UnmapWindow);
 	req->windowid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1980,10 +2190,10 @@ GrRaiseWindow(GR_WINDOW_ID wid)
 {
 	nxRaiseWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(RaiseWindow);
 	req->windowid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -1999,10 +2209,10 @@ GrLowerWindow(GR_WINDOW_ID wid)
 {
 	nxLowerWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(LowerWindow);
 	req->windowid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2020,12 +2230,12 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 {
 	nxMoveWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(MoveWindow);
 	req->windowid = wid;
 	req->x = x;
 	req->y = y;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2042,12 +2252,12 @@ GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
 {
 	nxResizeWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(ResizeWindow);
 	req->windowid = wid;
 	req->width = width;
 	req->height = height;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2067,13 +2277,13 @@ GrReparentWindow(GR_WINDOW_ID wid, GR_WINDOW_ID pwid, GR_COORD x, GR_COORD y)
 {
 	nxReparentWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(ReparentWindow);
 	req->windowid = wid;
 	req->parentid = pwid;
 	req->x = x;
 	req->y = y;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2099,7 +2309,7 @@ GrClearArea(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y, GR_SIZE width,
 {
 	nxClearAreaReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(ClearArea);
 	req->windowid = wid;
 	req->x = x;
@@ -2107,7 +2317,7 @@ GrClearArea(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y, GR_SIZE width,
 	req->width = width;
 	req->height = height;
 	req->exposeflag = exposeflag;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2142,10 +2352,10 @@ GrSetFocus(GR_WINDOW_ID wid)
 {
 	nxSetFocusReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetFocus);
 	req->windowid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2165,11 +2375,11 @@ GrSetWindowCursor(GR_WINDOW_ID wid, GR_CURSOR_ID cid)
 {
 	nxSetWindowCursorReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetWindowCursor);
 	req->windowid = wid;
 	req->cursorid = cid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2233,11 +2443,11 @@ GrMoveCursor(GR_COORD x, GR_COORD y)
 {
 	nxMoveCursorReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(MoveCursor);
 	req->x = x;
 	req->y = y;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2254,11 +2464,11 @@ GrSetGCForeground(GR_GC_ID gc, GR_COLOR foreground)
 {
 	nxSetGCForegroundReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCForeground);
 	req->gcid = gc;
 	req->color = foreground;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2275,11 +2485,11 @@ GrSetGCBackground(GR_GC_ID gc, GR_COLOR background)
 {
 	nxSetGCBackgroundReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCBackground);
 	req->gcid = gc;
 	req->color = background;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2297,11 +2507,11 @@ GrSetGCForegroundPixelVal(GR_GC_ID gc, GR_PIXELVAL foreground)
 {
 	nxSetGCForegroundPixelValReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCForegroundPixelVal);
 	req->gcid = gc;
 	req->pixelval = foreground;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2319,11 +2529,11 @@ GrSetGCBackgroundPixelVal(GR_GC_ID gc, GR_PIXELVAL background)
 {
 	nxSetGCBackgroundPixelValReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCBackgroundPixelVal);
 	req->gcid = gc;
 	req->pixelval = background;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2340,11 +2550,11 @@ GrSetGCMode(GR_GC_ID gc, int mode)
 {
 	nxSetGCModeReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCMode);
 	req->gcid = gc;
 	req->mode = mode;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2360,11 +2570,11 @@ GrSetGCLineAttributes(GR_GC_ID gc, int linestyle)
 {
 	nxSetGCLineAttributesReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCLineAttributes);
 	req->gcid = gc;
 	req->linestyle = linestyle;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2385,12 +2595,12 @@ GrSetGCDash(GR_GC_ID gc, char *dashes, int count)
 	int size;
 
 	size = count * sizeof(char);
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReqExtra(SetGCDash, size);
 	req->gcid = gc;
 	req->count = count;
 	memcpy(GetReqData(req), dashes, size);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2408,11 +2618,11 @@ GrSetGCFillMode(GR_GC_ID gc, int fillmode)
 {
   	nxSetGCFillModeReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCFillMode);
 	req->gcid = gc;
 	req->fillmode = fillmode;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2434,13 +2644,13 @@ GrSetGCStipple(GR_GC_ID gc, GR_BITMAP *bitmap, int width, int height)
 	int size;
 
 	size = GR_BITMAP_SIZE(width, height) * sizeof(GR_BITMAP);
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReqExtra(SetGCStipple, size);
 	req->gcid = gc;
 	req->width = width;
 	req->height = height;
 	memcpy(GetReqData(req), bitmap, size);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2460,13 +2670,13 @@ GrSetGCTile(GR_GC_ID gc, GR_WINDOW_ID pixmap, int width, int height)
 {
 	nxSetGCTileReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCTile);
 	req->gcid = gc;
 	req->pixmap = pixmap;
 	req->width = width;
 	req->height = height;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2485,12 +2695,12 @@ GrSetGCTSOffset(GR_GC_ID gc, int xoff, int yoff)
 {
 	nxSetGCTSOffsetReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCTSOffset);
 	req->gcid = gc;
 	req->xoffset = xoff;
 	req->yoffset = yoff;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2508,11 +2718,11 @@ GrSetGCUseBackground(GR_GC_ID gc, GR_BOOL flag)
 {
 	nxSetGCUseBackgroundReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCUseBackground);
 	req->gcid = gc;
 	req->flag = flag;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2662,12 +2872,12 @@ GrSetFontSizeEx(GR_FONT_ID fontid, GR_SIZE height, GR_SIZE width)
 {
 	nxSetFontSizeExReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetFontSizeEx);
 	req->fontid = fontid;
 	req->height = height;
 	req->width = width;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2683,11 +2893,11 @@ GrSetFontRotation(GR_FONT_ID fontid, int tenthdegrees)
 {
 	nxSetFontRotationReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetFontRotation);
 	req->fontid = fontid;
 	req->tenthdegrees = tenthdegrees;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2705,12 +2915,12 @@ GrSetFontAttr(GR_FONT_ID fontid, int setflags, int clrflags)
 {
 	nxSetFontAttrReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetFontAttr);
 	req->fontid = fontid;
 	req->setflags = setflags;
 	req->clrflags = clrflags;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2727,10 +2937,10 @@ GrDestroyFont(GR_FONT_ID fontid)
 {
 	nxDestroyFontReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(DestroyFont);
 	req->fontid = fontid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2747,11 +2957,39 @@ GrSetGCFont(GR_GC_ID gc, GR_FONT_ID font)
 {
 	nxSetGCFontReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetGCFont);
 	req->gcid = gc;
 	req->fontid = font;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
+}
+
+/*
+ * Send a table of drawing primitives, breaking it into MAXREQUESTSZ
+ * size requests.  Table drawing requests share the nxPointsReq layout.
+ */
+static void
+SendDrawTable(int type, GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, void *table,
+	int itemsize)
+{
+	nxPointsReq *req;
+	GR_COUNT chunk;
+	int32_t	size;
+
+	REQ_LOCK();
+	while (count > 0) {
+		chunk = (MAXREQUESTSZ - sizeof(nxPointsReq)) / itemsize;
+		if (chunk > count)
+			chunk = count;
+		size = (int32_t)chunk * itemsize;
+		req = nxAllocReq(type, sizeof(nxPointsReq), size);
+		req->drawid = id;
+		req->gcid = gc;
+		memcpy(GetReqData(req), table, size);
+		table = (void *)(((char *)table) + size);
+		count -= chunk;
+	}
+	REQ_UNLOCK();
 }
 
 /**
@@ -2773,7 +3011,7 @@ GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2,
 {
 	nxLineReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(Line);
 	req->drawid = id;
 	req->gcid = gc;
@@ -2781,7 +3019,25 @@ GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2,
 	req->y1 = y1;
 	req->x2 = x2;
 	req->y2 = y2;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
+}
+
+/**
+ * Draws a table of unconnected lines using the specified graphics context
+ * on the specified drawable, preparing the drawable and graphics context
+ * once for the whole table.  Each line is drawn as with GrLine().
+ *
+ * @param id  the ID of the drawable to draw the lines on
+ * @param gc  the ID of the graphics context to use when drawing the lines
+ * @param count  the number of lines in the segment table
+ * @param segtable  pointer to a GR_SEGMENT array which lists the lines to draw
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrSegments(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_SEGMENT *segtable)
+{
+	SendDrawTable(GrNumSegments, id, gc, count, segtable, sizeof(GR_SEGMENT));
 }
 
 /**
@@ -2803,7 +3059,7 @@ GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 {
 	nxRectReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(Rect);
 	req->drawid = id;
 	req->gcid = gc;
@@ -2811,7 +3067,7 @@ GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 	req->y = y;
 	req->width = width;
 	req->height = height;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2833,7 +3089,7 @@ GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 {
 	nxFillRectReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(FillRect);
 	req->drawid = id;
 	req->gcid = gc;
@@ -2841,7 +3097,43 @@ GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	req->y = y;
 	req->width = width;
 	req->height = height;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
+}
+
+/**
+ * Draws the boundaries of a table of rectangles on the specified drawable
+ * using the specified graphics context, preparing the drawable and graphics
+ * context once for the whole table.  Each rectangle is drawn as with GrRect().
+ *
+ * @param id  the ID of the drawable to draw the rectangles on
+ * @param gc  the ID of the graphics context to use when drawing the rectangles
+ * @param count  the number of rectangles in the rectangle table
+ * @param recttable  pointer to a GR_RECT array which lists the rectangles to draw
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	SendDrawTable(GrNumRects, id, gc, count, recttable, sizeof(GR_RECT));
+}
+
+/**
+ * Draws a table of filled rectangles on the specified drawable using the
+ * specified graphics context, preparing the drawable and graphics context
+ * once for the whole table.  Each rectangle is drawn as with GrFillRect().
+ *
+ * @param id  the ID of the drawable to draw the rectangles on
+ * @param gc  the ID of the graphics context to use when drawing the rectangles
+ * @param count  the number of rectangles in the rectangle table
+ * @param recttable  pointer to a GR_RECT array which lists the rectangles to fill
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	SendDrawTable(GrNumFillRects, id, gc, count, recttable, sizeof(GR_RECT));
 }
 
 /**
@@ -2863,7 +3155,7 @@ GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx,
 {
 	nxEllipseReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(Ellipse);
 	req->drawid = id;
 	req->gcid = gc;
@@ -2871,7 +3163,7 @@ GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx,
 	req->y = y;
 	req->rx = rx;
 	req->ry = ry;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2893,7 +3185,7 @@ GrFillEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 {
 	nxFillEllipseReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(FillEllipse);
 	req->drawid = id;
 	req->gcid = gc;
@@ -2901,7 +3193,7 @@ GrFillEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	req->y = y;
 	req->rx = rx;
 	req->ry = ry;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2931,7 +3223,7 @@ GrArc(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 {
 	nxArcReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(Arc);
 	req->drawid = id;
 	req->gcid = gc;
@@ -2944,7 +3236,7 @@ GrArc(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	req->bx = bx;
 	req->by = by;
 	req->type = type;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -2972,7 +3264,7 @@ GrArcAngle(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 {
 	nxArcAngleReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(ArcAngle);
 	req->drawid = id;
 	req->gcid = gc;
@@ -2983,7 +3275,25 @@ GrArcAngle(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	req->angle1 = angle1;
 	req->angle2 = angle2;
 	req->type = type;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
+}
+
+/**
+ * Draws a table of arcs or pies on the specified drawable using the
+ * specified graphics context, preparing the drawable and graphics context
+ * once for the whole table.  Each arc is drawn as with GrArcAngle().
+ *
+ * @param id  the ID of the drawable to draw the arcs on
+ * @param gc  the ID of the graphics context to use when drawing the arcs
+ * @param count  the number of arcs in the arc table
+ * @param arctable  pointer to a GR_ARCANGLE array which lists the arcs to draw
+ *
+ * @ingroup nanox_draw
+ */
+void
+GrArcs(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_ARCANGLE *arctable)
+{
+	SendDrawTable(GrNumArcs, id, gc, count, arctable, sizeof(GR_ARCANGLE));
 }
 
 /**
@@ -3019,7 +3329,7 @@ GrBitmap(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 		bitmapsize = (int32_t)GR_BITMAP_SIZE(width, chunk_y) * sizeof(GR_BITMAP);
 		}
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	/* Break request into MAXREQUESTSZ size packets */
 	while(height > 0) {
 		if(chunk_y > height) {
@@ -3038,7 +3348,7 @@ GrBitmap(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 		y += chunk_y;
 		height -= chunk_y;
 	}
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -3079,7 +3389,7 @@ GrDrawImageBits(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 		    step = rest;
 		blocksize = pimage->pitch * step;
 
-		LOCK(&nxGlobalLock);
+		REQ_LOCK();
 		req = AllocReqExtra(DrawImageBits, blocksize + palsize);
 		req->drawid = id;
 		req->gcid = gc;
@@ -3098,7 +3408,7 @@ GrDrawImageBits(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 		addr = GetReqData(req);
 		memcpy(addr, bits, blocksize);
 		memcpy(addr+imagesize, pimage->palette, palsize);
-		UNLOCK(&nxGlobalLock);
+		REQ_UNLOCK();
 
 		y += step;
 		rest -= step;
@@ -3136,7 +3446,7 @@ GrDrawImageFromFile(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 {
 	nxDrawImageFromFileReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReqExtra(DrawImageFromFile, strlen(path)+1);
 	req->drawid = id;
 	req->gcid = gc;
@@ -3146,7 +3456,7 @@ GrDrawImageFromFile(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	req->height = height;
 	req->flags = flags;
 	memcpy(GetReqData(req), path, strlen(path)+1);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -3229,7 +3539,7 @@ GrDrawImagePartToFit(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD dx, GR_COORD dy,
 	GR_SIZE swidth, GR_SIZE sheight, GR_IMAGE_ID imageid)
 {
 	nxDrawImagePartToFitReq *req;
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(DrawImagePartToFit);
 	req->drawid = id;
 	req->gcid = gc;
@@ -3242,7 +3552,7 @@ GrDrawImagePartToFit(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD dx, GR_COORD dy,
 	req->swidth = swidth;
 	req->sheight = sheight;
 	req->imageid = imageid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 
 }
 
@@ -3258,10 +3568,10 @@ GrFreeImage(GR_IMAGE_ID id)
 {
 	nxFreeImageReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(FreeImage);
 	req->id = id;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -3561,7 +3871,7 @@ GrCopyArea(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 {
 	nxCopyAreaReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
         req = AllocReq(CopyArea);
         req->drawid = id;
         req->gcid = gc;
@@ -3573,7 +3883,7 @@ GrCopyArea(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
         req->srcx = srcx;
         req->srcy = srcy;
         req->op = op;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
    
 /**
@@ -3628,13 +3938,13 @@ GrPoint(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y)
 {
 	nxPointReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(Point);
 	req->drawid = id;
 	req->gcid = gc;
 	req->x = x;
 	req->y = y;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -3651,16 +3961,7 @@ GrPoint(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y)
 void
 GrPoints(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 {
-	nxPointsReq *req;
-	int32_t	size;
-
-	size = (int32_t)count * sizeof(GR_POINT);
-	LOCK(&nxGlobalLock);
-	req = AllocReqExtra(Points, size);
-	req->drawid = id;
-	req->gcid = gc;
-	memcpy(GetReqData(req), (void *)pointtable, size);
-	UNLOCK(&nxGlobalLock);
+	SendDrawTable(GrNumPoints, id, gc, count, pointtable, sizeof(GR_POINT));
 }
 
 /**
@@ -3682,13 +3983,13 @@ GrPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 	nxPolyReq *req;
 	int32_t       size;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	size = (int32_t)count * sizeof(GR_POINT);
 	req = AllocReqExtra(Poly, size);
 	req->drawid = id;
 	req->gcid = gc;
 	memcpy(GetReqData(req), pointtable, size);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -3710,13 +4011,13 @@ GrFillPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count,GR_POINT *pointtable)
 	nxFillPolyReq *req;
 	int32_t           size;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	size = (int32_t)count * sizeof(GR_POINT);
 	req = AllocReqExtra(FillPoly, size);
 	req->drawid = id;
 	req->gcid = gc;
 	memcpy(GetReqData(req), pointtable, size);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -3747,7 +4048,7 @@ GrText(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, void *str,
 
 	size = nxCalcStringBytes(str, count, flags);
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReqExtra(Text, size);
 	req->drawid = id;
 	req->gcid = gc;
@@ -3756,7 +4057,7 @@ GrText(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, void *str,
 	req->count = count;
 	req->flags = flags;
 	memcpy(GetReqData(req), str, size);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 
@@ -3791,12 +4092,12 @@ GrSetSystemPalette(GR_COUNT first, GR_PALETTE *pal)
 {
 	nxSetSystemPaletteReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetSystemPalette);
 	req->first = first;
 	req->count = pal->count;
 	memcpy(req->palette, pal->palette, sizeof(GR_PALENTRY) * pal->count);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -3881,7 +4182,7 @@ GrReqShmCmds(long shmsize)
 	}
 
 	nxSharedMemSize = shmsize;
-	nxAssignReqbuffer(nxSharedMem, shmsize);
+	nxAssignShmCmds(nxSharedMem, shmsize);
 	UNLOCK(&nxGlobalLock);
 #endif /* HAVE_SHAREDMEM_SUPPORT*/
 }
@@ -3969,14 +4270,14 @@ GrSetWMProperties(GR_WINDOW_ID wid, GR_WM_PROPERTIES *props)
 		s = strlen(props->title) + 1;
 	else s = 0;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReqExtra(SetWMProperties, s + sizeof(GR_WM_PROPERTIES));
 	req->windowid = wid;
 	addr = GetReqData(req);
 	memcpy(addr, props, sizeof(GR_WM_PROPERTIES));
 	if (s)
 		memcpy(addr + sizeof(GR_WM_PROPERTIES), props->title, s);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4034,10 +4335,10 @@ GrCloseWindow(GR_WINDOW_ID wid)
 {
 	nxCloseWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(CloseWindow);
 	req->windowid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4054,10 +4355,10 @@ GrKillWindow(GR_WINDOW_ID wid)
 {
 	nxKillWindowReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(KillWindow);
 	req->windowid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4075,10 +4376,10 @@ GrSetScreenSaverTimeout(GR_TIMEOUT timeout)
 {
 	nxSetScreenSaverTimeoutReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetScreenSaverTimeout);
 	req->timeout = timeout;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4106,7 +4407,7 @@ GrSetSelectionOwner(GR_WINDOW_ID wid, const char *typelist)
 	char *p;
 	int len;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	if(wid) {
 		len = strlen(typelist) + 1;
 		req = AllocReqExtra(SetSelectionOwner, len);
@@ -4117,7 +4418,7 @@ GrSetSelectionOwner(GR_WINDOW_ID wid, const char *typelist)
 	}
 
 	req->wid = wid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4190,13 +4491,13 @@ GrRequestClientData(GR_WINDOW_ID wid, GR_WINDOW_ID rid, GR_SERIALNO serial,
 {
 	nxRequestClientDataReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(RequestClientData);
 	req->wid = wid;
 	req->rid = rid;
 	req->serial = serial;
 	req->mimetype = mimetype;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4226,7 +4527,7 @@ GrSendClientData(GR_WINDOW_ID wid, GR_WINDOW_ID did, GR_SERIALNO serial,
 	char *p;
 	GR_LENGTH l, pos = 0;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	while(pos < len) {
 		l = MAXREQUESTSZ - sizeof(nxSendClientDataReq);
 		if(l > (len - pos)) l = len - pos;
@@ -4239,7 +4540,7 @@ GrSendClientData(GR_WINDOW_ID wid, GR_WINDOW_ID did, GR_SERIALNO serial,
 		memcpy(p, ((char *)data + pos), l);
 		pos += l;
 	}
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4252,9 +4553,9 @@ GrSendClientData(GR_WINDOW_ID wid, GR_WINDOW_ID did, GR_SERIALNO serial,
 void
 GrBell(void)
 {
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	AllocReq(Bell);
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4275,12 +4576,12 @@ GrSetBackgroundPixmap(GR_WINDOW_ID wid, GR_WINDOW_ID pixmap, int flags)
 {
 	nxSetBackgroundPixmapReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetBackgroundPixmap);
 	req->wid = wid;
 	req->pixmap = pixmap;
 	req->flags = flags;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4296,10 +4597,10 @@ GrDestroyCursor(GR_CURSOR_ID cid)
 {
 	nxDestroyCursorReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(DestroyCursor);
 	req->cursorid = cid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4418,10 +4719,10 @@ GrDestroyTimer (GR_TIMER_ID tid)
 {
 	nxDestroyTimerReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(DestroyTimer);
 	req->timerid = tid;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 #endif /* MW_FEATURE_TIMERS */
 
@@ -4437,10 +4738,10 @@ GrSetPortraitMode(int portraitmode)
 {
 	nxSetPortraitModeReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetPortraitMode);
 	req->portraitmode = portraitmode;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4562,12 +4863,38 @@ GrSetWindowRegion(GR_WINDOW_ID wid, GR_REGION_ID rid, int type)
 {
 	nxSetWindowRegionReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(SetWindowRegion);
 	req->wid = wid;
 	req->rid = rid;
 	req->type = type;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
+}
+
+/**
+ * Sets the opacity of a buffered window (GR_WM_PROPS_BUFFERED). At 255,
+ * the default, the window buffer is copied to the screen. Lower values
+ * blend the buffer over the windows below it using the buffer alpha
+ * channel scaled by the opacity; the buffer must be RGBA or BGRA.
+ * The server rebuilds the area beneath from the buffers of buffered
+ * windows and the backgrounds of unbuffered ones, so no expose events
+ * are generated.
+ *
+ * @param wid  the ID of the window
+ * @param opacity  0 (transparent) to 255 (opaque)
+ *
+ * @ingroup nanox_window
+ */
+void
+GrSetWindowOpacity(GR_WINDOW_ID wid, int opacity)
+{
+	nxSetWindowOpacityReq *req;
+
+	REQ_LOCK();
+	req = AllocReq(SetWindowOpacity);
+	req->windowid = wid;
+	req->opacity = opacity;
+	REQ_UNLOCK();
 }
 
 /**
@@ -4608,7 +4935,7 @@ GrStretchArea(GR_DRAW_ID dstid, GR_GC_ID gc,
 {
 	nxStretchAreaReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(StretchArea);
 	req->drawid = dstid;
 	req->gcid = gc;
@@ -4622,7 +4949,7 @@ GrStretchArea(GR_DRAW_ID dstid, GR_GC_ID gc,
 	req->sx2 = sx2;
 	req->sy2 = sy2;
 	req->op = op;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4691,12 +5018,12 @@ GrUngrabKey(GR_WINDOW_ID id, GR_KEY key)
 {
 	nxGrabKeyReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 	req = AllocReq(GrabKey);
 	req->wid = id;
 	req->type = GR_GRAB_MAX + 1;
 	req->key = key;
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 /**
@@ -4712,7 +5039,7 @@ GrSetTransform(GR_TRANSFORM *trans)
 {
 	nxSetTransformReq *req;
 
-	LOCK(&nxGlobalLock);
+	REQ_LOCK();
 
 	req = AllocReq(SetTransform);
 	req->mode = trans? 1: 0;
@@ -4727,7 +5054,7 @@ GrSetTransform(GR_TRANSFORM *trans)
 		req->trans_s = trans->s;
 	}
 
-	UNLOCK(&nxGlobalLock);
+	REQ_UNLOCK();
 }
 
 #if HAVE_FREETYPE_2_SUPPORT
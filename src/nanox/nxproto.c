@@ -2,24 +2,91 @@
  * Copyright (c) 1999, 2002 Greg Haerr <greg@censoft.com>
  *
  * Nano-X Core Protocol Client Request Handling Routines
+ *
+ * Requests are queued in a request buffer which grows for clients
+ * that fill it quickly, and is flushed when full, when a reply is
+ * needed, or when requests have been queued longer than REQFLUSHTIME.
+ *
+ * In threadsafe builds each thread queues requests in its own buffer,
+ * locking only that buffer while encoding a request without a reply
+ * (REQ_LOCK).  A flush takes nxGlobalLock and first sends the requests
+ * queued by all other threads, then those of the flushing thread, so
+ * that requests issued before a thread waits for a reply or event
+ * reach the server first.
  */ 
 #include "uni_std.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/time.h>
 #include "serv.h"
 #include "nxproto.h"
 #include "lock.h"
 
 #define SZREQBUF	2048	/* initial request buffer size*/
+#define SZREQBUFMAX	32768	/* request buffer size for busy clients*/
+#define SZREQBUFWAIT	262144	/* max size queued by a thread while nxGlobalLock busy*/
+#define REQFLUSHTIME	20	/* msecs before queued requests are flushed*/
+#define REQTIMECHECK	32	/* requests queued between flush time checks*/
 
 #if !__ECOS
 static REQBUF	reqbuf;		/* request buffer*/
 extern int 	nxSocket;
 extern char *	nxSharedMem;
 LOCK_EXTERN(nxGlobalLock);	/* global lock for threads safety*/
+#if HAVE_SHAREDMEM_SUPPORT
+static nxShmCmdsHeader *shmhdr;	/* shared memory request ring header*/
+static unsigned char *	shmring;	/* ring of requests following header*/
+static UINT32		shmringsize;	/* ring size in bytes*/
+static UINT32		shmsent;	/* bytes of ring used up to reqbuf.buffer, only counts up*/
+#endif
 #endif
 
+#if HAVE_SHAREDMEM_SUPPORT
+#define SHMCMDS		(nxSharedMem != 0)	/* requests queued in shared memory ring*/
+#else
+#define SHMCMDS		0
+#endif
+
+#if NXTHREADREQ
+/* per-thread request buffer*/
+typedef struct threadreq {
+	REQBUF		rb;		/* queued requests of this thread*/
+	pthread_mutex_t	mutex;		/* held while encoding or sending rb*/
+	int		encoding;	/* mutex held by REQ_LOCK*/
+	struct threadreq *next;		/* next thread, list locked by nxGlobalLock*/
+} THREADREQ;
+
+static THREADREQ *	threadreqs;	/* request buffers of all threads*/
+static pthread_key_t	threadreqkey;
+static pthread_once_t	threadreqonce = PTHREAD_ONCE_INIT;
+static THREADREQ *	nxThreadReq(void);
+
+/* the shared memory ring is shared by all threads using nxGlobalLock*/
+#define ACCESS_REQBUF()	THREADREQ *tr = nxThreadReq(); \
+			REQBUF *rb = SHMCMDS? &reqbuf: &tr->rb
+#else
+#define ACCESS_REQBUF()	REQBUF *rb = &reqbuf
+#endif
+
+/* return msecs from a monotonic clock*/
+static unsigned long
+nxReqTime(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
 /* Allocate a request buffer of passed size and fill in header fields*/
 void *
 nxAllocReq(int type, long size, long extra)
@@ -27,6 +94,7 @@ nxAllocReq(int type, long size, long extra)
 	nxReq *	req;
 	long	aligned_len;
         ACCESS_PER_THREAD_DATA();
+	ACCESS_REQBUF();
 
 	/* variable size requests must be hand-padded*/
 	if(extra)
@@ -39,45 +107,136 @@ nxAllocReq(int type, long size, long extra)
 	assert(aligned_len <= MAXREQUESTSZ);
 
 	/* flush buffer if required, and allocate larger one if required*/
-	if(reqbuf.bufptr + aligned_len >= reqbuf.bufmax)
+	if(rb->bufptr + aligned_len >= rb->bufmax)
 		nxFlushReq(aligned_len,1);
+	else if(++rb->nreqs >= REQTIMECHECK) {
+		/* flush requests waiting longer than flush time*/
+		rb->nreqs = 0;
+		if(nxReqTime() - rb->flushtime >= REQFLUSHTIME)
+			nxFlushReq(0L,1);
+	}
 
 	/* fill in request header*/
-	req = (nxReq *)reqbuf.bufptr;
+	req = (nxReq *)rb->bufptr;
 	req->reqType = (BYTE8)type;
 	req->hilength = (BYTE8)((size + extra) >> 16);
 	req->length = (UINT16)(size + extra);
-	reqbuf.bufptr += aligned_len;
+	rb->bufptr += aligned_len;
 	return req;
 }
 
-static void nxAllocReqbuffer(long newsize)
+static void nxAllocReqbuffer(REQBUF *rb, long newsize)
 {
-        ACCESS_PER_THREAD_DATA();
-
 	if(newsize < (long)SZREQBUF)
 		newsize = SZREQBUF;
-	reqbuf.buffer = malloc(newsize);
-	if(!reqbuf.buffer) {
+	rb->buffer = malloc(newsize);
+	if(!rb->buffer) {
 		EPRINTF("nxFlushReq: Can't allocate initial request buffer\n");
 		exit(1);
 	}
-	reqbuf.bufptr = reqbuf.buffer;
-	reqbuf.bufmax = reqbuf.buffer + newsize;
+	rb->bufptr = rb->buffer;
+	rb->bufmax = rb->buffer + newsize;
+	rb->nreqs = 0;
+	rb->flushtime = nxReqTime();
+}
+
+/* Make room for newsize more bytes in request buffer, keeping queued requests*/
+static void
+nxGrowReqbuffer(REQBUF *rb, long newsize)
+{
+	long	used = rb->bufptr - rb->buffer;
+
+	if(rb->bufptr + newsize >= rb->bufmax) {
+		rb->buffer = REALLOC(rb->buffer, rb->bufmax - rb->buffer, used + newsize);
+		if(!rb->buffer) {
+		       EPRINTF("nxFlushReq: Can't reallocate request buffer\n");
+			exit(1);
+		}
+		rb->bufptr = rb->buffer + used;
+		rb->bufmax = rb->buffer + used + newsize;
+	}
 }
 
 void
 nxAssignReqbuffer(char *buffer, long size)
 {
         ACCESS_PER_THREAD_DATA();
+	ACCESS_REQBUF();
+
+	if ( rb->buffer != 0 )
+		free(rb->buffer);
+	rb->buffer = (unsigned char *)buffer;
+	rb->bufptr = rb->buffer;
+	rb->bufmax = rb->buffer + size;
+}
+
+#if HAVE_SHAREDMEM_SUPPORT
+/*
+ * Point the request buffer at the free ring space following shmsent.
+ * Requests are never split across the end of the ring, a tail too
+ * small for newsize bytes is skipped.  Only when the server hasn't yet
+ * run enough of the ring do we wait for it, using a flush with reply,
+ * and only if 'wait' is set: a caller about to read a request reply
+ * must read that first, and gets whatever space is free instead.
+ */
+static void
+nxReserveShmCmds(long newsize, int wait)
+{
+	UINT32	offset, used, avail;
+	char	c;
+
+	if (newsize >= (long)shmringsize) {
+		/* Shared memory too small, critical */
+		EPRINTF("nxFlushReq: shm region too small\n");
+		exit(1);
+	}
 
-	if ( reqbuf.buffer != 0 )
-		free(reqbuf.buffer);
-	reqbuf.buffer = (unsigned char *)buffer;
-	reqbuf.bufptr = reqbuf.buffer;
-	reqbuf.bufmax = reqbuf.buffer + size;
+	/* next requests follow those just flushed*/
+	offset = reqbuf.bufptr - shmring;
+	if (offset + newsize >= shmringsize) {
+		shmsent += shmringsize - offset;
+		offset = 0;
+	}
+
+	/* skipping the tail can leave more than the ring in use*/
+	used = shmsent - shmhdr->done;
+	avail = (used < shmringsize)? shmringsize - used: 0;
+	if (avail <= (UINT32)newsize && wait) {
+		nxShmCmdsFlushReq req;
+
+		/* ring full, wait until server has run everything sent*/
+		req.reqType = GrNumShmCmdsFlush;
+		req.hilength = 0;
+		req.length = sizeof(req);
+		req.size = 0;
+		req.reply = 1;
+		req.offset = offset;
+		req.end = shmsent;
+		nxWriteSocket((char *)&req,sizeof(req));
+		while ( read(nxSocket, &c, 1) != 1 )
+			;
+		avail = shmringsize;
+	}
+
+	reqbuf.buffer = reqbuf.bufptr = shmring + offset;
+	reqbuf.bufmax = reqbuf.buffer + MWMIN(avail, shmringsize - offset);
 }
 
+/* Switch request buffer to a ring in the GrReqShmCmds shared memory segment*/
+void
+nxAssignShmCmds(char *shm, long size)
+{
+	/* shared by all threads from now on*/
+	free(reqbuf.buffer);
+	shmhdr = (nxShmCmdsHeader *)shm;
+	shmring = (unsigned char *)shm + sizeof(nxShmCmdsHeader);
+	shmringsize = size - sizeof(nxShmCmdsHeader);
+	shmsent = shmhdr->done;
+	reqbuf.bufptr = shmring;
+	nxReserveShmCmds(0, 1);
+}
+#endif /* HAVE_SHAREDMEM_SUPPORT*/
+
 /* Write a block of data on the socket to the nano-X server */
 void
 nxWriteSocket(char *buf, int todo)
@@ -98,96 +257,219 @@ nxWriteSocket(char *buf, int todo)
 	} while ( todo > 0 );
 }
 
+/* Send requests queued in a socket request buffer*/
+static void
+nxWriteReqbuffer(REQBUF *rb)
+{
+	if(rb->bufptr > rb->buffer) {
+		nxWriteSocket((char *)rb->buffer, rb->bufptr - rb->buffer);
+		rb->bufptr = rb->buffer;
+	}
+	rb->nreqs = 0;
+	rb->flushtime = nxReqTime();
+}
+
+#if NXTHREADREQ
+/* Send requests of an exiting thread and free its request buffer*/
+static void
+nxFreeThreadReq(void *arg)
+{
+	THREADREQ *	tr = arg;
+	THREADREQ **	trp;
+
+	LOCK(&nxGlobalLock);
+	if(nxSocket >= 0)
+		nxWriteReqbuffer(&tr->rb);
+	for(trp = &threadreqs; *trp; trp = &(*trp)->next) {
+		if(*trp == tr) {
+			*trp = tr->next;
+			break;
+		}
+	}
+	UNLOCK(&nxGlobalLock);
+
+	pthread_mutex_destroy(&tr->mutex);
+	free(tr->rb.buffer);
+	free(tr);
+}
+
+static void
+nxInitThreadReq(void)
+{
+	pthread_key_create(&threadreqkey, nxFreeThreadReq);
+}
+
+/* Return request buffer of calling thread, allocated on first use*/
+static THREADREQ *
+nxThreadReq(void)
+{
+	THREADREQ *	tr;
+
+	pthread_once(&threadreqonce, nxInitThreadReq);
+	tr = pthread_getspecific(threadreqkey);
+	if(tr)
+		return tr;
+
+	tr = calloc(1, sizeof(THREADREQ));
+	if(!tr) {
+		EPRINTF("nxFlushReq: Can't allocate thread request buffer\n");
+		exit(1);
+	}
+	nxAllocReqbuffer(&tr->rb, SZREQBUF);
+	pthread_mutex_init(&tr->mutex, NULL);
+	pthread_setspecific(threadreqkey, tr);
+
+	LOCK(&nxGlobalLock);
+	tr->next = threadreqs;
+	threadreqs = tr;
+	UNLOCK(&nxGlobalLock);
+	return tr;
+}
+
+/*
+ * Lock calling thread's request buffer for encoding a request
+ * without a reply.  Other threads keep encoding in their own
+ * buffers, and only wait for this one while flushing it.
+ */
+void
+nxLockReq(void)
+{
+	THREADREQ *	tr = nxThreadReq();
+
+	if(SHMCMDS) {
+		LOCK(&nxGlobalLock);
+		return;
+	}
+	pthread_mutex_lock(&tr->mutex);
+	tr->encoding = 1;
+}
+
+void
+nxUnlockReq(void)
+{
+	THREADREQ *	tr = pthread_getspecific(threadreqkey);
+
+	if(!tr->encoding) {
+		UNLOCK(&nxGlobalLock);
+		return;
+	}
+	tr->encoding = 0;
+	pthread_mutex_unlock(&tr->mutex);
+}
+
+/* Send requests queued by other threads, called with nxGlobalLock held*/
+static void
+nxFlushThreadReqs(THREADREQ *self)
+{
+	THREADREQ *	tr;
+
+	for(tr = threadreqs; tr; tr = tr->next) {
+		if(tr == self || tr->rb.bufptr == tr->rb.buffer)
+			continue;
+		pthread_mutex_lock(&tr->mutex);
+		nxWriteReqbuffer(&tr->rb);
+		pthread_mutex_unlock(&tr->mutex);
+	}
+}
+#endif /* NXTHREADREQ*/
+
 /* Flush request buffer if required, possibly reallocate buffer size*/
 void
 nxFlushReq(long newsize, int reply_needed)
 {
+	long	size;
+	int	busy;
         ACCESS_PER_THREAD_DATA();
+	ACCESS_REQBUF();
+
+#if NXTHREADREQ
+	/*
+	 * When encoding under REQ_LOCK this thread holds only its own
+	 * buffer, and must not wait for nxGlobalLock, which another
+	 * thread flushing all buffers may hold while waiting for ours.
+	 * Keep queueing requests while another thread holds the lock,
+	 * it is also held while waiting for replies or events.
+	 */
+	if(tr->encoding && pthread_mutex_trylock(&nxGlobalLock) != 0) {
+		if(newsize == 0)
+			return;
+		size = rb->bufmax - rb->buffer;
+		if(rb->bufptr - rb->buffer + newsize < SZREQBUFWAIT) {
+			nxGrowReqbuffer(rb, MWMAX(newsize, size));
+			return;
+		}
+		/* queued too much, buffer is between requests and can be unlocked*/
+		pthread_mutex_unlock(&tr->mutex);
+		LOCK(&nxGlobalLock);
+		pthread_mutex_lock(&tr->mutex);
+	} else if(!tr->encoding)
+		LOCK(&nxGlobalLock);
+
+	/* send earlier requests of other threads first*/
+	nxFlushThreadReqs(tr);
+#else
 	LOCK(&nxGlobalLock);
+#endif
 
 	/* handle one-time initialization case*/
-	if(reqbuf.buffer == NULL) {
-		nxAllocReqbuffer(newsize);
+	if(rb->buffer == NULL) {
+		nxAllocReqbuffer(rb, newsize);
 		UNLOCK(&nxGlobalLock);
 		return;
 	}
 
-	/* flush buffer if required*/
-	if(reqbuf.bufptr > reqbuf.buffer) {
-		char *	buf = (char *)reqbuf.buffer;
-		int	todo = reqbuf.bufptr - reqbuf.buffer;
-
 #if HAVE_SHAREDMEM_SUPPORT
-		if ( nxSharedMem != 0 ) {
-			/* There is a shared memory segment used for the
-			 * request buffer.  Make up a flush command and
-			 * send it over the socket, to tell the server to
-			 * process the shared memory segment.
-			 * The 'reply_needed' argument should be non-zero
-			 * when a confirmation is needed that all commands
-			 * are flushed, so new ones can be filled into the
-			 * request buffer.  NOTE:  This is *only* needed
-			 * when explicitely flushing the request buffer, or
-			 * when flushing it to make space for new commands.
-			 * DO NOT REQUEST A REPLY when flushing the request
-			 * buffer because the last command in the buffer
-			 * will send a response:  This response would be
-			 * queued up first and had to be drained before the
-			 * response to the flush command itsel....
-			 * So the GrReadBlock used to read replys to commands
-			 * must not specify a nonzero 'reply_needed'.
-			 * Not requesting a reply in this case is
-			 * safe, since the command executed will wait for
-			 * the reply *it* is waiting for, and thus make
-			 * sure the request buffer is flushed before
-			 * continuing.
-			 *
-			 * We have to make the protocol request by hand,
-			 * as it has to be sent over the socket to wake
-			 * up the Nano-X server.
-			 */
-			char c;
+	if ( nxSharedMem != 0 ) {
+		/* There is a shared memory segment used as a ring of
+		 * requests.  Make up a flush command for the requests
+		 * queued since the last flush and send it over the socket,
+		 * to wake up the Nano-X server.  We don't wait for the
+		 * server to run them, but continue queueing requests in
+		 * the free part of the ring; the server marks ring space
+		 * free as it goes.  Requests that need a reply synchronize
+		 * by reading it, so 'reply_needed' only allows waiting
+		 * for the server when the ring is full, see nxReserveShmCmds.
+		 * It must be zero when flushing before reading a reply,
+		 * which has to be read before any flush confirmation.
+		 *
+		 * We have to make the protocol request by hand,
+		 * as it has to be sent over the socket to wake
+		 * up the Nano-X server.
+		 */
+		UINT32 todo = reqbuf.bufptr - reqbuf.buffer;
+
+		if ( todo ) {
 			nxShmCmdsFlushReq req;
 
 			req.reqType = GrNumShmCmdsFlush;
 			req.hilength = 0;
 			req.length = sizeof(req);
 			req.size = todo;
-			req.reply = reply_needed;
-
+			req.reply = 0;
+			req.offset = reqbuf.buffer - shmring;
+			req.end = shmsent + todo;
 			nxWriteSocket((char *)&req,sizeof(req));
-
-			if ( reply_needed )
-				while ( read(nxSocket, &c, 1) != 1 )
-					;
-
-			reqbuf.bufptr = reqbuf.buffer;
-
-			if ( reqbuf.buffer + newsize > reqbuf.bufmax ) {
-				/* Shared memory too small, critical */
-				EPRINTF("nxFlushReq: shm region too small\n");
-				exit(1);
-			}
-			UNLOCK(&nxGlobalLock);
-			return;
+			shmsent += todo;
 		}
+		reqbuf.nreqs = 0;
+		reqbuf.flushtime = nxReqTime();
+		nxReserveShmCmds(newsize, reply_needed);
+		UNLOCK(&nxGlobalLock);
+		return;
+	}
 #endif /* HAVE_SHAREDMEM_SUPPORT*/
 
-		/* Standard Socket transfer */
-		nxWriteSocket(buf,todo);
-		reqbuf.bufptr = reqbuf.buffer;
-	}
+	/* flush buffer if required, Standard Socket transfer*/
+	busy = nxReqTime() - rb->flushtime < REQFLUSHTIME;
+	nxWriteReqbuffer(rb);
 
-	/* allocate larger buffer for current request, if needed*/
-	if(reqbuf.bufptr + newsize >= reqbuf.bufmax) {
-		reqbuf.buffer = REALLOC(reqbuf.buffer, reqbuf.bufmax - reqbuf.buffer, newsize);
-		if(!reqbuf.buffer) {
-		       EPRINTF("nxFlushReq: Can't reallocate request buffer\n");
-			exit(1);
-		}
-		reqbuf.bufptr = reqbuf.buffer;
-		reqbuf.bufmax = reqbuf.buffer + newsize;
-	}
+	/* allocate larger buffer for current request if needed, and double
+	 * the buffer of clients that fill it within the flush time
+	 */
+	size = rb->bufmax - rb->buffer;
+	if(newsize && busy && size < SZREQBUFMAX)
+		newsize = MWMAX(newsize, MWMIN(size * 2, SZREQBUFMAX));
+	nxGrowReqbuffer(rb, newsize);
 	UNLOCK(&nxGlobalLock);
 }
 
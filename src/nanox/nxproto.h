@@ -76,9 +76,28 @@ typedef struct {
 /* get request total aligned length*/
 #define GetReqAlignedLen(req)	((GetReqLen(req) + (ALIGNSZ-1)) & ~(ALIGNSZ-1))
 
+/* per-thread client request buffers in threadsafe builds*/
+#if THREADSAFE && !__ECOS
+#define NXTHREADREQ	1
+#else
+#define NXTHREADREQ	0
+#endif
+
+/* lock held while encoding a request without reply*/
+#if NXTHREADREQ
+#define REQ_LOCK()	nxLockReq()
+#define REQ_UNLOCK()	nxUnlockReq()
+#else
+#define REQ_LOCK()	LOCK(&nxGlobalLock)
+#define REQ_UNLOCK()	UNLOCK(&nxGlobalLock)
+#endif
+
 void * 	nxAllocReq(int type, long size, long extra);
 void	nxFlushReq(long newsize, int reply_needed);
+void	nxLockReq(void);
+void	nxUnlockReq(void);
 void 	nxAssignReqbuffer(char *buffer, long size);
+void	nxAssignShmCmds(char *shm, long size);
 void 	nxWriteSocket(char *buf, int todo);
 int	nxCalcStringBytes(void *str, int count, GR_TEXTFLAGS flags);
 
@@ -664,8 +683,22 @@ typedef struct {
 	UINT16  length;
 	UINT32  size;
 	UINT32  reply;
+	UINT32  offset;		/* ring offset of first request*/
+	UINT32  end;		/* ring position after last request*/
 } nxShmCmdsFlushReq;
 
+/*
+ * The GrReqShmCmds segment starts with this header, followed by a ring
+ * of requests.  The client appends requests at increasing ring positions
+ * and passes each flushed range to the server with GrShmCmdsFlush.  After
+ * running a range, the server stores its end position in 'done', which
+ * frees that part of the ring for the client without a reply.
+ */
+typedef struct {
+	volatile UINT32 done;	/* ring position after last request run by server*/
+	UINT32  pad;
+} nxShmCmdsHeader;
+
 #define GrNumSetFontRotation    57
 typedef struct {
 	BYTE8	reqType;
@@ -1387,4 +1420,97 @@ typedef struct {
 	IDTYPE	imageid;
 } nxDrawImagePartToFitReq;
 
-#define GrTotalNumCalls         126
+#define GrNumNewSharedPixmap	126
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	INT16	width;
+	INT16	height;
+	UINT32	format;
+} nxNewSharedPixmapReq;
+
+#define GrNumGetServerStats	127
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	UINT16	reset;
+	UINT16	pad;
+} nxGetServerStatsReq;
+
+#define GrNumSetWindowOpacity	128
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	windowid;
+	UINT16	opacity;
+	UINT16	pad;
+} nxSetWindowOpacityReq;
+
+#define GrNumGetFontMetrics	129
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	fontid;
+	UINT32	firstchar;
+	UINT32	count;
+} nxGetFontMetricsReq;
+
+/* array drawing requests share nxPointsReq layout*/
+#define GrNumRects		130
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*GR_RECT recttable[];*/
+} nxRectsReq;
+
+#define GrNumFillRects		131
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*GR_RECT recttable[];*/
+} nxFillRectsReq;
+
+#define GrNumSegments		132
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*GR_SEGMENT segtable[];*/
+} nxSegmentsReq;
+
+#define GrNumArcs		133
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	IDTYPE	drawid;
+	IDTYPE	gcid;
+	/*GR_ARCANGLE arctable[];*/
+} nxArcsReq;
+
+#define GrNumAttachSharedPixmap	134
+typedef struct {
+	BYTE8	reqType;
+	BYTE8	hilength;
+	UINT16	length;
+	INT16	width;
+	INT16	height;
+	UINT32	format;
+	UINT32	shmid;
+	UINT32	offset;
+	UINT32	pitch;
+} nxAttachSharedPixmapReq;
+
+#define GrTotalNumCalls         135
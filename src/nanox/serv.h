@@ -54,6 +54,7 @@
 #define GrGetFocus              SVR_GrGetFocus
 #define GrGetFontInfo           SVR_GrGetFontInfo
 #define GrGetFontList		SVR_GrGetFontList        
+#define GrGetFontMetrics	SVR_GrGetFontMetrics
 #define GrGetGCInfo             SVR_GrGetGCInfo
 #define GrGetGCTextSize         SVR_GrGetGCTextSize
 #define GrGetImageInfo          SVR_GrGetImageInfo
@@ -86,6 +87,11 @@
 #define GrPeekEvent             SVR_GrPeekEvent
 #define GrPointInRegion         SVR_GrPointInRegion
 #define GrPoints                SVR_GrPoints
+#define GrRects			SVR_GrRects
+#define GrFillRects		SVR_GrFillRects
+#define GrSegments		SVR_GrSegments
+#define GrArcs			SVR_GrArcs
+#define GrAttachSharedPixmap	SVR_GrAttachSharedPixmap
 #define GrPoint                 SVR_GrPoint
 #define GrPoly                  SVR_GrPoly
 #define GrQueryTree		SVR_GrQueryTree          
@@ -163,6 +169,16 @@ typedef	int	GR_DRAW_TYPE;
 #define	GR_DRAW_TYPE_WINDOW	1	/* windows */
 #define	GR_DRAW_TYPE_PIXMAP	2	/* pixmaps */
 
+/*
+ * Resource types for id index.
+ */
+#define	GR_RESOURCE_WINDOW	0
+#define	GR_RESOURCE_PIXMAP	1
+#define	GR_RESOURCE_GC		2
+#define	GR_RESOURCE_REGION	3
+#define	GR_RESOURCE_FONT	4
+#define	GR_RESOURCE_CURSOR	5
+
 #define	GR_MAX_MODE		MWROP_MAX
 /*
  * List of elements for events.
@@ -188,6 +204,13 @@ struct gr_client {
 	int		shm_cmds_size;
 	int		shm_cmds_shmid;
 	int		processid;	/* client process id*/
+	char		*inbuf;		/* socket input buffer, allocated on first request*/
+	int		inlen;		/* bytes of partial request left in inbuf*/
+#if MW_FEATURE_STATS
+	uint64_t	stat_requests;	/* requests received*/
+	uint64_t	stat_bytesin;	/* bytes read from client*/
+	uint64_t	stat_bytesout;	/* bytes written to client*/
+#endif
 };
 
 /*
@@ -344,6 +367,10 @@ struct gr_window {
 	char		*title;		/* window title*/
 	MWCLIPREGION*clipregion;/* window clipping region */
 	GR_PIXMAP	*buffer;	/* window buffer pixmap*/
+	MWCLIPREGION*visregion;	/* cached visible region (DYNAMICREGIONS)*/
+	unsigned long visgen;	/* clipgeneration visregion valid for, 0 if invalid*/
+	int		visflags;	/* GR_MODE_EXCLUDECHILDREN when visregion calculated*/
+	int		opacity;	/* 255 opaque, less to composite buffer over windows below*/
 };
 
 /*
@@ -361,6 +388,8 @@ struct gr_pixmap {
 
 	GR_PIXMAP	*next;		/* next pixmap in list */
 	GR_CLIENT	*owner;		/* client that created it */
+	char		*shmaddr;	/* shared memory pixels or NULL*/
+	int		shmid;		/* shared memory segment id*/
 };
 
 /**
@@ -418,11 +447,21 @@ void		GsClearWindow(GR_WINDOW *wp, GR_COORD x, GR_COORD y,
 void		GsUnrealizeWindow(GR_WINDOW *wp, GR_BOOL temp_unmap);
 void		GsRealizeWindow(GR_WINDOW *wp, GR_BOOL temp);
 void		GsDestroyWindow(GR_WINDOW *wp);
+
+/* srvcomp.c*/
+void		GsSetWindowOpacity(GR_WINDOW *wp, int opacity);
+GR_BOOL		GsIsTranslucent(GR_WINDOW *wp);
+void		GsCompositeWindow(GR_WINDOW *wp, GR_COORD x, GR_COORD y,
+				GR_SIZE width, GR_SIZE height);
+void		GsCompositeAbove(GR_WINDOW *wp, GR_COORD x, GR_COORD y,
+				GR_SIZE width, GR_SIZE height);
+
 GR_WINDOW_ID	GsNewPixmap(GR_SIZE width, GR_SIZE height, int format, void *pixels);
 void		GsDestroyPixmap(GR_PIXMAP *pp);
 void		GsSetPortraitMode(int mode);
 void		GsSetPortraitModeFromXY(GR_COORD rootx, GR_COORD rooty);
 void		GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags);
+void		GsInvalidateClip(GR_WINDOW *wp);
 void		GsHandleMouseStatus(GR_COORD newx, GR_COORD newy, int newbuttons);
 void		GsFreePositionEvent(GR_CLIENT *client, GR_WINDOW_ID wid, GR_WINDOW_ID subwid);
 void		GsDeliverButtonEvent(GR_EVENT_TYPE type, int buttons, int changebuttons, int modifiers);
@@ -452,6 +491,9 @@ void		GsCheckFocusWindow(void);
 GR_DRAW_TYPE GsPrepareDrawing(GR_DRAW_ID id, GR_GC_ID gcid, GR_DRAWABLE **retdp);
 GR_BOOL		GsCheckOverlap(GR_WINDOW *topwp, GR_WINDOW *botwp);
 GR_EVENT	*GsAllocEvent(GR_CLIENT *client);
+void		GsAddResource(int type, GR_ID id, void *ptr);
+void		GsRemoveResource(int type, GR_ID id);
+void *		GsLookupResource(int type, GR_ID id);
 GR_WINDOW	*GsFindWindow(GR_WINDOW_ID id);
 GR_PIXMAP 	*GsFindPixmap(GR_WINDOW_ID id);
 GR_GC		*GsFindGC(GR_GC_ID gcid);
@@ -471,13 +513,22 @@ int		GsPutCh(int fd, unsigned char c);
 GR_CLIENT	*GsFindClient(int fd);
 void		GsDestroyClientResources(GR_CLIENT * client);
 void		GsDropClient(int fd);
-int		GsRead(int fd, void *buf, int c);
 int		GsWrite(int fd, void *buf, int c);
 void		GsHandleClient(int fd);
 void		GsResetScreenSaver(void);
 void		GsActivateScreenSaver(void *arg);
 void		GrGetNextEventWrapperFinish(int);
 
+#if MW_FEATURE_STATS
+/* srvstats.c*/
+uint64_t	GsStatTime(void);
+void		GsInitStats(void);
+void		GsStatRequest(int type, const char *name, uint64_t start);
+void		GsStatSelect(uint64_t start);
+void		GsGetStats(GR_SERVER_STATS *sp, int reset);
+void		GsPrintStats(void);
+#endif
+
 /*
  * External data definitions.
  */
@@ -498,6 +549,7 @@ extern	GR_WINDOW	*listwp;		/* list of all windows */
 extern	GR_PIXMAP	*listpp;		/* list of all pixmaps */
 extern	GR_WINDOW	*rootwp;		/* root window pointer */
 extern	GR_WINDOW	*clipwp;		/* window clipping is set for */
+extern	unsigned long	clipgeneration;		/* bumped to invalidate all visible regions */
 extern	GR_WINDOW	*focuswp;		/* focus window for keyboard */
 extern	GR_WINDOW	*mousewp;		/* window mouse is currently in */
 extern	GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
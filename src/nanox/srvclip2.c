@@ -8,15 +8,14 @@
 #include "serv.h"
 
 /*
- * Set the clip rectangles for a window taking into account other
+ * Calculate the visible region of a window taking into account other
  * windows that may be obscuring it.  The windows that may be obscuring
  * this one are the siblings of each direct ancestor which are higher
  * in priority than those ancestors.  Also, each parent limits the visible
- * area of the window.  The clipping is not done if it is already up to
- * date of if the window is not outputtable.
+ * area of the window.  Returns a newly allocated region in screen coordinates.
  */
-void
-GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
+static MWCLIPREGION *
+GsCalcVisRegion(GR_WINDOW *wp, int flags)
 {
 	GR_WINDOW	*orgwp;		/* original window pointer */
 	GR_WINDOW	*pwp;		/* parent window */
@@ -30,11 +29,6 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 	GR_COORD	x, y, width, height;
 	MWCLIPREGION	*vis, *r;
 
-	if (!wp->realized || !wp->output)
-		return;
-
-	clipwp = wp;
-
 	/*
 	 * Start with the rectangle for the complete window.
 	 * We will then cut pieces out of it as needed.
@@ -76,12 +70,10 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 
 	/*
 	 * If the window is completely clipped out of view, then
-	 * set the clipping region to indicate that.
+	 * return an empty region to indicate that.
 	 */
-	if (width <= 0 || height <= 0) {
-		GdSetClipRegion(clipwp->psd, NULL);
-		return;
-	}
+	if (width <= 0 || height <= 0)
+		return GdAllocRegion();
 
 	/*
 	 * Allocate region to clipped size of window,
@@ -183,6 +175,45 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 		}
 	}
 
+	/*
+	 * Destroy temp region
+	 */
+	GdDestroyRegion(r);
+
+	return vis;
+}
+
+/*
+ * Set the clip rectangles for a window from its visible region,
+ * intersected with the user clip region if set.  The visible region
+ * is cached in the window and only recalculated after GsInvalidateClip
+ * reports a change in the window tree affecting it, so switching
+ * drawing between windows doesn't rebuild the region each time.
+ * The clipping is not done if the window is not outputtable.
+ */
+void
+GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
+{
+	MWCLIPREGION	*vis;
+
+	if (!wp->realized || !wp->output)
+		return;
+
+	clipwp = wp;
+
+	/* recalculate cached visible region if out of date*/
+	flags &= GR_MODE_EXCLUDECHILDREN;
+	if (!wp->visregion || wp->visgen != clipgeneration || wp->visflags != flags) {
+		if (wp->visregion)
+			GdDestroyRegion(wp->visregion);
+		wp->visregion = GsCalcVisRegion(wp, flags);
+		wp->visgen = clipgeneration;
+		wp->visflags = flags;
+	}
+
+	vis = GdAllocRegion();
+	GdCopyRegion(vis, wp->visregion);
+
 	/*
 	 * Intersect with user region, if set.
 	 */
@@ -196,10 +227,5 @@ GsSetClipWindow(GR_WINDOW *wp, MWCLIPREGION *userregion, int flags)
 	/*
 	 * Set the clip region (later destroy handled by GdSetClipRegion)
 	 */
-	GdSetClipRegion(clipwp->psd, vis);
-
-	/*
-	 * Destroy temp region
-	 */
-	GdDestroyRegion(r);
+	GdSetClipRegion(wp->psd, vis);
 }
@@ -0,0 +1,337 @@
+/*
+ * Buffered window compositing
+ *
+ * Buffered windows whose opacity is set below 255 by GrSetWindowOpacity
+ * are drawn src-over whatever lies beneath them. The area under such a
+ * window is rebuilt offscreen from the cached buffers of the buffered
+ * windows below it and the backgrounds of the others, so compositing
+ * never sends expose events to clients. The window buffer, with its
+ * alpha scaled by the opacity, is then blended on top using the screen
+ * driver BlitSrcOverRGBA8888 blitter and the result copied to the screen
+ * through the window clip region.
+ *
+ * Unbuffered windows have no cached contents, so only their border and
+ * background show through translucent windows above them.
+ */
+#include <stdlib.h>
+#include "serv.h"
+#include "../drivers/genmem.h"
+
+static int	translucent;	/* number of windows with opacity < 255*/
+static PSD	underpsd;		/* screen format area beneath composited window*/
+static PSD	alphapsd;		/* RGBA opacity scaled copy of window buffer*/
+static int	abovefound;		/* GsCompositeAbove walk has passed changed window*/
+
+/* set window opacity and count translucent windows, caller redraws*/
+void
+GsSetWindowOpacity(GR_WINDOW *wp, int opacity)
+{
+	if (opacity < 0)
+		opacity = 0;
+	if (opacity > 255)
+		opacity = 255;
+	if (wp->opacity < 255)
+		translucent--;
+	if (opacity < 255)
+		translucent++;
+	wp->opacity = opacity;
+}
+
+/* return TRUE if window buffer is composited rather than copied to screen*/
+GR_BOOL
+GsIsTranslucent(GR_WINDOW *wp)
+{
+	int format;
+
+	if (wp->opacity == 255 || !wp->buffer)
+		return GR_FALSE;
+	if ((wp->props & (GR_WM_PROPS_BUFFERED|GR_WM_PROPS_DRAWING_DONE)) !=
+	    (GR_WM_PROPS_BUFFERED|GR_WM_PROPS_DRAWING_DONE))
+		return GR_FALSE;
+
+	/* only buffers with an alpha channel can be scaled by opacity*/
+	format = wp->buffer->psd->data_format;
+	return format == MWIF_RGBA8888 || format == MWIF_BGRA8888;
+}
+
+/* return scratch pixmap at least width x height, reallocating if smaller*/
+static PSD
+get_scratch(PSD *ppsd, int format, MWCOORD width, MWCOORD height)
+{
+	PSD psd = *ppsd;
+
+	if (psd && psd->xvirtres >= width && psd->yvirtres >= height)
+		return psd;
+
+	if (psd) {
+		width = MWMAX(width, psd->xvirtres);
+		height = MWMAX(height, psd->yvirtres);
+		psd->FreeMemGC(psd);
+	}
+	*ppsd = GdCreatePixmap(rootwp->psd, width, height, format, NULL, 0);
+	return *ppsd;
+}
+
+/* set single rectangle clip region on psd*/
+static void
+set_clip(PSD psd, MWCOORD x, MWCOORD y, MWCOORD width, MWCOORD height)
+{
+#if DYNAMICREGIONS
+	GdSetClipRegion(psd, GdAllocRectRegion(x, y, x + width, y + height));
+#else
+	MWCLIPRECT	cliprect;
+
+	cliprect.x = x;
+	cliprect.y = y;
+	cliprect.width = width;
+	cliprect.height = height;
+	GdSetClipRects(psd, 1, &cliprect);
+#endif
+}
+
+/* intersect rectangle with window area including border, return FALSE if empty*/
+static GR_BOOL
+clip_to_window(MWRECT *rc, MWRECT *in, GR_WINDOW *wp, GR_SIZE bs)
+{
+	rc->left = MWMAX(in->left, wp->x - bs);
+	rc->top = MWMAX(in->top, wp->y - bs);
+	rc->right = MWMIN(in->right, wp->x + wp->width + bs);
+	rc->bottom = MWMIN(in->bottom, wp->y + wp->height + bs);
+	return rc->left < rc->right && rc->top < rc->bottom;
+}
+
+/*
+ * Copy area of window buffer to alphapsd as RGBA with alpha scaled by opacity.
+ * Returns FALSE if the scratch pixmap couldn't be allocated.
+ */
+static GR_BOOL
+scale_alpha(GR_WINDOW *wp, MWCOORD srcx, MWCOORD srcy, MWCOORD width, MWCOORD height)
+{
+	PSD srcpsd = wp->buffer->psd;
+	unsigned int opacity = wp->opacity;
+	int swap = (srcpsd->data_format == MWIF_BGRA8888);
+	unsigned char *src, *dst;
+	int w;
+
+	if (srcx < 0 || srcy < 0 || srcx + width > srcpsd->xvirtres || srcy + height > srcpsd->yvirtres)
+		return GR_FALSE;
+	if (!get_scratch(&alphapsd, MWIF_RGBA8888, width, height))
+		return GR_FALSE;
+
+	src = (unsigned char *)srcpsd->addr + srcy * srcpsd->pitch + srcx * 4;
+	dst = alphapsd->addr;
+	while (--height >= 0) {
+		unsigned char *s = src;
+		unsigned char *d = dst;
+
+		for (w = width; --w >= 0; s += 4, d += 4) {
+			d[0] = s[swap? 2: 0];
+			d[1] = s[1];
+			d[2] = s[swap? 0: 2];
+			d[3] = ((opacity + 1) * s[3]) >> 8;
+		}
+		src += srcpsd->pitch;
+		dst += alphapsd->pitch;
+	}
+	return GR_TRUE;
+}
+
+/* draw window interior rectangle rc into underpsd, whose origin is area*/
+static void
+paint_interior(GR_WINDOW *wp, MWRECT *rc, MWRECT *area)
+{
+	MWCOORD x = rc->left - area->left;
+	MWCOORD y = rc->top - area->top;
+	MWCOORD width = rc->right - rc->left;
+	MWCOORD height = rc->bottom - rc->top;
+
+	if ((wp->props & (GR_WM_PROPS_BUFFERED|GR_WM_PROPS_DRAWING_DONE)) ==
+	    (GR_WM_PROPS_BUFFERED|GR_WM_PROPS_DRAWING_DONE) && wp->buffer) {
+		MWCOORD srcx = rc->left - wp->x;
+		MWCOORD srcy = rc->top - wp->y;
+
+		if (!GsIsTranslucent(wp))
+			GdBlit(underpsd, x, y, width, height, wp->buffer->psd, srcx, srcy, MWROP_COPY);
+		else if (scale_alpha(wp, srcx, srcy, width, height))
+			GdBlit(underpsd, x, y, width, height, alphapsd, 0, 0, MWROP_SRC_OVER);
+		return;
+	}
+
+	if (wp->props & GR_WM_PROPS_NOBACKGROUND)
+		return;
+
+	GdSetForegroundColor(underpsd, wp->background);
+	GdFillRect(underpsd, x, y, width, height);
+
+	if (wp->bgpixmap) {
+		/* draw background pixmap through a copy of the window moved onto underpsd*/
+		GR_WINDOW tmp = *wp;
+
+		tmp.psd = underpsd;
+		tmp.x = wp->x - area->left;
+		tmp.y = wp->y - area->top;
+		GsDrawBackgroundPixmap(&tmp, wp->bgpixmap, rc->left - wp->x, rc->top - wp->y,
+			width, height);
+	}
+}
+
+/* return TRUE if wp is topwp or one of its ancestors*/
+static GR_BOOL
+is_ancestor(GR_WINDOW *wp, GR_WINDOW *topwp)
+{
+	for (; topwp; topwp = topwp->parent)
+		if (topwp == wp)
+			return GR_TRUE;
+	return GR_FALSE;
+}
+
+static GR_BOOL paint_siblings(GR_WINDOW *wp, GR_WINDOW *topwp, MWRECT *parentrc, MWRECT *area);
+
+/*
+ * Paint window and its children into underpsd in stacking order, bottom first,
+ * clipped to parentrc. Returns TRUE once topwp is reached and painting stops.
+ */
+static GR_BOOL
+paint_below(GR_WINDOW *wp, GR_WINDOW *topwp, MWRECT *parentrc, MWRECT *area)
+{
+	MWRECT		outer, inner;
+	GR_SIZE		bs;
+
+	if (wp == topwp)
+		return GR_TRUE;
+	if (!wp->realized)
+		return GR_FALSE;
+
+	/* nothing to paint, but stop if topwp is inside*/
+	bs = wp->bordersize;
+	if (!clip_to_window(&outer, parentrc, wp, bs))
+		return is_ancestor(wp, topwp);
+
+	if (wp->output) {
+		if (bs > 0) {
+			GdSetForegroundColor(underpsd, wp->bordercolor);
+			GdFillRect(underpsd, outer.left - area->left, outer.top - area->top,
+				outer.right - outer.left, outer.bottom - outer.top);
+		}
+		if (clip_to_window(&inner, parentrc, wp, 0)) {
+			set_clip(underpsd, inner.left - area->left, inner.top - area->top,
+				inner.right - inner.left, inner.bottom - inner.top);
+			paint_interior(wp, &inner, area);
+			set_clip(underpsd, 0, 0, area->right - area->left, area->bottom - area->top);
+		}
+	}
+
+	/* children are clipped to parent interior*/
+	if (!clip_to_window(&inner, parentrc, wp, 0))
+		return is_ancestor(wp, topwp);
+	return paint_siblings(wp->children, topwp, &inner, area);
+}
+
+/* paint sibling list bottom first, the list is kept topmost first*/
+static GR_BOOL
+paint_siblings(GR_WINDOW *wp, GR_WINDOW *topwp, MWRECT *parentrc, MWRECT *area)
+{
+	if (!wp)
+		return GR_FALSE;
+	if (paint_siblings(wp->siblings, topwp, parentrc, area))
+		return GR_TRUE;
+	return paint_below(wp, topwp, parentrc, area);
+}
+
+/**
+ * Composite an area of a translucent buffered window onto the screen.
+ * The windows below are rebuilt offscreen, the window buffer is blended
+ * over them and the result copied through the window clip region.
+ *
+ * @param wp Translucent window, see GsIsTranslucent.
+ * @param x Left edge of area relative to window.
+ * @param y Top edge of area relative to window.
+ * @param width Width of area.
+ * @param height Height of area.
+ */
+void
+GsCompositeWindow(GR_WINDOW *wp, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height)
+{
+	MWRECT area, rc;
+
+	/* limit area to window and screen*/
+	rc.left = wp->x + x;
+	rc.top = wp->y + y;
+	rc.right = rc.left + width;
+	rc.bottom = rc.top + height;
+	area.left = MWMAX(rc.left, 0);
+	area.top = MWMAX(rc.top, 0);
+	area.right = MWMIN(rc.right, rootwp->width);
+	area.bottom = MWMIN(rc.bottom, rootwp->height);
+	if (!clip_to_window(&area, &area, wp, 0))
+		return;
+	width = area.right - area.left;
+	height = area.bottom - area.top;
+
+	if (!get_scratch(&underpsd, 0, width, height))
+		return;
+
+	/* invalidate gc and clip caches since we're changing color, mode and clipping*/
+	curgcp = NULL;
+	clipwp = NULL;
+	GdSetFillMode(GR_FILL_SOLID);
+	GdSetMode(GR_MODE_COPY);
+
+	/* rebuild what is beneath the window from buffers and backgrounds*/
+	set_clip(underpsd, 0, 0, width, height);
+	rc = area;
+	paint_below(rootwp, wp, &rc, &area);
+
+	/* blend window over it and copy to screen*/
+	if (scale_alpha(wp, area.left - wp->x, area.top - wp->y, width, height))
+		GdBlit(underpsd, 0, 0, width, height, alphapsd, 0, 0, MWROP_SRC_OVER);
+	GsSetClipWindow(wp, NULL, 0);
+	clipwp = NULL;
+	GdBlit(wp->psd, area.left, area.top, width, height, underpsd, 0, 0, MWROP_COPY);
+}
+
+/* recomposite translucent windows above changed window, walked bottom first*/
+static void
+composite_above(GR_WINDOW *wp, GR_WINDOW *changedwp, MWRECT *area)
+{
+	MWRECT rc;
+
+	if (!wp)
+		return;
+	composite_above(wp->siblings, changedwp, area);
+
+	if (!wp->realized)
+		return;
+	if (abovefound && GsIsTranslucent(wp) && clip_to_window(&rc, area, wp, 0))
+		GsCompositeWindow(wp, rc.left - wp->x, rc.top - wp->y,
+			rc.right - rc.left, rc.bottom - rc.top);
+	if (wp == changedwp)
+		abovefound = 1;
+	composite_above(wp->children, changedwp, area);
+}
+
+/**
+ * Recomposite translucent windows stacked above a window whose screen
+ * area has just been redrawn, as they were blended over its old contents.
+ *
+ * @param wp Window that was redrawn.
+ * @param x Left edge of redrawn area in root coordinates.
+ * @param y Top edge of redrawn area in root coordinates.
+ * @param width Width of area.
+ * @param height Height of area.
+ */
+void
+GsCompositeAbove(GR_WINDOW *wp, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height)
+{
+	MWRECT area;
+
+	if (!translucent)
+		return;
+
+	area.left = x;
+	area.top = y;
+	area.right = x + width;
+	area.bottom = y + height;
+	abovefound = (wp == rootwp);
+	composite_above(rootwp->children, wp, &area);
+}
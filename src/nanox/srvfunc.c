@@ -12,6 +12,11 @@
 #include "nanowm.h"
 #include "osdep.h"
 #include "../drivers/genmem.h"
+#if HAVE_SHAREDMEM_SUPPORT
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
 
 static int	nextid = GR_ROOT_WINDOW_ID + 1;
 
@@ -38,6 +43,22 @@ GrGetScreenInfo(GR_SCREEN_INFO *sip)
 	SERVER_UNLOCK();
 }
 
+/*
+ * Return request, client and drawing statistics, all zero if
+ * the server was built without MW_FEATURE_STATS.
+ */
+void
+GrGetServerStats(GR_SERVER_STATS *stats, GR_BOOL reset)
+{
+	SERVER_LOCK();
+#if MW_FEATURE_STATS
+	GsGetStats(stats, reset);
+#else
+	memset(stats, 0, sizeof(*stats));
+#endif
+	SERVER_UNLOCK();
+}
+
 /*
  * Return the size of a text string for the font in a graphics context.
  * This is the width of the string, the height of the string,
@@ -285,6 +306,9 @@ GrRaiseWindow(GR_WINDOW_ID wid)
 	wp->siblings = wp->parent->children;
 	wp->parent->children = wp;
 
+	/* window now obscures all its siblings*/
+	GsInvalidateClip(wp);
+
 	/*
 	 * Finally redraw the window if necessary.
 	 */
@@ -338,6 +362,9 @@ GrLowerWindow(GR_WINDOW_ID wid)
 	while (sibwp->siblings)
 		sibwp = sibwp->siblings;
 
+	/* siblings below this window will no longer be obscured by it*/
+	GsInvalidateClip(wp);
+
 	/*
 	 * Now unlink the window and relink it in at the end of the
 	 * sibling chain.
@@ -411,6 +438,46 @@ IsUnobscuredBySiblings(GR_WINDOW *wp)
 	return 1;
 }
 
+/*
+ * Expose the area a moved window covered at oldx,oldy but no longer
+ * covers, less any opaque windows stacked above it, rather than the
+ * bounding box of both positions.
+ */
+static void
+ExposeMovedArea(GR_WINDOW *wp, GR_COORD oldx, GR_COORD oldy)
+{
+	GR_WINDOW	*current, *parent, *child;
+	MWCLIPREGION	*damage, *r;
+	GR_SIZE		bs = wp->bordersize;
+	MWRECT		*rc;
+	int			i;
+
+	damage = GdAllocRectRegion(oldx - bs, oldy - bs,
+		oldx + wp->width + bs, oldy + wp->height + bs);
+	r = GdAllocRectRegion(wp->x - bs, wp->y - bs,
+		wp->x + wp->width + bs, wp->y + wp->height + bs);
+	GdSubtractRegion(damage, damage, r);
+	GdDestroyRegion(r);
+
+	for (current = wp; (parent = current->parent) != NULL; current = parent) {
+		for (child = parent->children; child && child != current; child = child->siblings) {
+			if (!child->realized || !child->output || child->clipregion ||
+			    GsIsTranslucent(child))
+				continue;
+			bs = child->bordersize;
+			r = GdAllocRectRegion(child->x - bs, child->y - bs,
+				child->x + child->width + bs, child->y + child->height + bs);
+			GdSubtractRegion(damage, damage, r);
+			GdDestroyRegion(r);
+		}
+	}
+
+	for (i = 0, rc = damage->rects; i < damage->numRects; i++, rc++)
+		GsExposeArea(rootwp, rc->left, rc->top, rc->right - rc->left,
+			rc->bottom - rc->top, wp);
+	GdDestroyRegion(damage);
+}
+
 /*
  * Move the window to the specified position relative to its parent.
  */
@@ -474,7 +541,7 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 		OffsetWindow(wp, offx, offy);
 
 		/* force recalc of clip region*/
-		clipwp = NULL;
+		GsInvalidateClip(wp);
 
 		/* copy window bits to new location*/
 		GrCopyArea(parent->id, gc, wp->x - parent->x, wp->y - parent->y,
@@ -493,14 +560,22 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 			stopwp = NULL;
 
 		/* 
-		 * Calculate bounded exposed area and
-		 * redraw anything lower than stopwp window.
+		 * Redraw anything lower than the window where it was uncovered,
+		 * or the bounded area including the window if coming onscreen.
 		 */
-		X = MWMIN(oldx, wp->x);
-		Y = MWMIN(oldy, wp->y);
-		W = MWMAX(oldx, wp->x) + wp->width - X;
-		H = MWMAX(oldy, wp->y) + wp->height - Y;
-		GsExposeArea(rootwp, X, Y, W, H, stopwp);
+		if (stopwp)
+			ExposeMovedArea(wp, oldx, oldy);
+		else {
+			X = MWMIN(oldx, wp->x);
+			Y = MWMIN(oldy, wp->y);
+			W = MWMAX(oldx, wp->x) + wp->width - X;
+			H = MWMAX(oldy, wp->y) + wp->height - Y;
+			GsExposeArea(rootwp, X, Y, W, H, stopwp);
+		}
+
+		/* copied bits were blended over the old position, composite again*/
+		if (GsIsTranslucent(wp))
+			GsClearWindow(wp, 0, 0, wp->width, wp->height, 0);
 
 		GdShowCursor(rootwp->psd);
 		GrDestroyGC(gc);
@@ -509,6 +584,25 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 		return;
 	}
 #endif
+
+	/*
+	 * Obscured buffered windows are redrawn from their buffer at the new
+	 * position, with only the uncovered area exposed below them.
+	 */
+	if (wp->realized && (wp->props & GR_WM_PROPS_BUFFERED) && !wp->clipregion) {
+		int	oldx = wp->x;
+		int	oldy = wp->y;
+		GR_SIZE	bs = wp->bordersize;
+
+		OffsetWindow(wp, offx, offy);
+		GsInvalidateClip(wp);
+		ExposeMovedArea(wp, oldx, oldy);
+		GsExposeArea(wp, wp->x - bs, wp->y - bs, wp->width + bs * 2,
+			wp->height + bs * 2, NULL);
+		DeliverUpdateMoveEventAndChildren(wp);
+		SERVER_UNLOCK();
+		return;
+	}
 #if 0
 	/* perform screen blit if topmost and mapped - no flicker!*/
 	if (wp->mapped && wp == wp->parent->children
@@ -541,7 +635,7 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 		OffsetWindow(wp, offx, offy);
 
 		/* force recalc of clip region*/
-		clipwp = NULL;
+		GsInvalidateClip(wp);
 
 		/* copy window bits to new location*/
 		GrCopyArea(GR_ROOT_WINDOW_ID, gc, wp->x, wp->y, wp->width,
@@ -586,7 +680,7 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 		OffsetWindow(wp, offx, offy);
 
 		/* force recalc of clip region*/
-		clipwp = NULL;
+		GsInvalidateClip(wp);
 
 		X = MWMIN(oldx, wp->x);
 		Y = MWMIN(oldy, wp->y);
@@ -604,6 +698,7 @@ GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
 	 */
 	GsUnrealizeWindow(wp, GR_TRUE);
 	OffsetWindow(wp, offx, offy);
+	GsInvalidateClip(wp);
 	GsRealizeWindow(wp, GR_FALSE);
 	DeliverUpdateMoveEventAndChildren(wp);
 
@@ -673,6 +768,7 @@ GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
 	if (!wp->realized || !wp->output) {
 		wp->width = width;
 		wp->height = height;
+		GsInvalidateClip(wp);
 		SERVER_UNLOCK();
 		return;
 	}
@@ -686,6 +782,7 @@ GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
 	GsUnrealizeWindow(wp, GR_TRUE);
 	wp->width = width;
 	wp->height = height;
+	GsInvalidateClip(wp);
 	/* send size update before expose event*/
 	GsDeliverUpdateEvent(wp, GR_UPDATE_SIZE, wp->x, wp->y, width, height);
 	GsRealizeWindow(wp, GR_FALSE);
@@ -695,6 +792,7 @@ GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
 	oldh = wp->height;
 	wp->width = width;
 	wp->height = height;
+	GsInvalidateClip(wp);
 
 	/* draw background and send expose events in resized window and all children*/
 	drawBackgroundAndExpose(wp);
@@ -768,6 +866,7 @@ GrReparentWindow(GR_WINDOW_ID wid, GR_WINDOW_ID pwid, GR_COORD x, GR_COORD y)
 
 	if (offx || offy)
 		OffsetWindow(wp, offx, offy);
+	GsInvalidateClip(wp);
 
 	/*
 	 * Realize window again. Window will become visible if
@@ -839,6 +938,7 @@ GrNewGC(void)
 	gcp->next = listgcp;
 
 	listgcp = gcp;
+	GsAddResource(GR_RESOURCE_GC, gcp->id, gcp);
 
 	SERVER_UNLOCK();
 
@@ -869,6 +969,7 @@ GrDestroyGC(GR_GC_ID gc)
 	if (gcp == curgcp)
 		curgcp = NULL;
 
+	GsRemoveResource(GR_RESOURCE_GC, gcp->id);
 	if (listgcp == gcp)
 		listgcp = gcp->next;
 	else {
@@ -923,6 +1024,7 @@ GrCopyGC(GR_GC_ID gc)
 	gcp->owner = curclient;
 	gcp->next = listgcp;
 	listgcp = gcp;
+	GsAddResource(GR_RESOURCE_GC, gcp->id, gcp);
 
 	SERVER_UNLOCK();
 
@@ -995,6 +1097,7 @@ GrNewRegion(void)
 	regionp->next = listregionp;
 
 	listregionp = regionp;
+	GsAddResource(GR_RESOURCE_REGION, regionp->id, regionp);
 
 	id = regionp->id;
 
@@ -1029,6 +1132,7 @@ GrNewPolygonRegion(int mode, GR_COUNT count, GR_POINT *points)
 	regionp->next = listregionp;
 
 	listregionp = regionp;
+	GsAddResource(GR_RESOURCE_REGION, regionp->id, regionp);
 
 	id = regionp->id;
 
@@ -1055,6 +1159,7 @@ GrDestroyRegion(GR_REGION_ID region)
 		return;
 	}
 
+	GsRemoveResource(GR_RESOURCE_REGION, regionp->id);
 	if (listregionp == regionp) {
 		listregionp = regionp->next;
 	} else {
@@ -1469,6 +1574,7 @@ GrCreateFontEx(const char *name, GR_COORD height, GR_COORD width, GR_LOGFONT *pl
 	fontp->next = listfontp;
 
 	listfontp = fontp;
+	GsAddResource(GR_RESOURCE_FONT, fontp->id, fontp);
 
 	SERVER_UNLOCK();
 	
@@ -1512,6 +1618,7 @@ GrCreateFontFromBuffer(const void *buffer, unsigned length, const char *format,
 	fontp->owner = curclient;
 	fontp->next = listfontp;
 	listfontp = fontp;
+	GsAddResource(GR_RESOURCE_FONT, fontp->id, fontp);
 
 	SERVER_UNLOCK();
 	return fontp->id;
@@ -1546,6 +1653,7 @@ GrCopyFont(GR_FONT_ID fontid, GR_COORD height, GR_COORD width)
 	fontp->owner = curclient;
 	fontp->next = listfontp;
 	listfontp = fontp;
+	GsAddResource(GR_RESOURCE_FONT, fontp->id, fontp);
 	
 	SERVER_UNLOCK();
 	return fontp->id;
@@ -1614,6 +1722,7 @@ GrDestroyFont(GR_FONT_ID fontid)
 		return;
 	}
 
+	GsRemoveResource(GR_RESOURCE_FONT, fontp->id);
 	if (listfontp == fontp)
 		listfontp = fontp->next;
 	else {
@@ -1657,6 +1766,35 @@ GrGetFontInfo(GR_FONT_ID font, GR_FONT_INFO *fip)
 	SERVER_UNLOCK();
 }
 
+/*
+ * Return the advance width and ink extents of count characters
+ * starting at unicode value firstchar.
+ * Font #0 returns metrics of the standard font.
+ */
+void
+GrGetFontMetrics(GR_FONT_ID font, int firstchar, int count, GR_CHAR_METRICS *metrics)
+{
+	GR_FONT	*fontp;
+	PMWFONT	pf;
+
+	SERVER_LOCK();
+
+	if (font == 0)
+		pf = stdfont;
+	else {
+		fontp = GsFindFont(font);
+		if (!fontp) {
+			memset(metrics, 0, count * sizeof(GR_CHAR_METRICS));
+			SERVER_UNLOCK();
+			return;
+		}
+		pf = fontp->pfont;
+	}
+	GdGetFontMetrics(pf, firstchar, count, metrics);
+
+	SERVER_UNLOCK();
+}
+
 /*
  * Select events for a window for this client.
  * The events are a bitmask for the events desired.
@@ -1778,9 +1916,14 @@ NewWindow(GR_WINDOW *pwp, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height,
 	wp->title = NULL;
 	wp->clipregion = NULL;
 	wp->buffer = NULL;
+	wp->visregion = NULL;
+	wp->visgen = 0;
+	wp->visflags = 0;
+	wp->opacity = 255;
 
 	pwp->children = wp;
 	listwp = wp;
+	GsAddResource(GR_RESOURCE_WINDOW, wp->id, wp);
 
 	return wp;
 }
@@ -1901,12 +2044,91 @@ GsNewPixmap(GR_SIZE width, GR_SIZE height, int format, void *pixels)
 	pp->width = width;
 	pp->height = height;
 	pp->owner = curclient;
+	pp->shmaddr = NULL;
+	pp->shmid = -1;
 	pp->next = listpp;
 	listpp = pp;
+	GsAddResource(GR_RESOURCE_PIXMAP, pp->id, pp);
 
 	return pp->id;
 }
 
+/*
+ * Create a pixmap whose pixels the application can write directly.
+ * When linked with the server the pixel memory is simply returned;
+ * the client/server wrapper places the pixels in shared memory instead.
+ */
+GR_WINDOW_ID
+GrNewSharedPixmap(GR_SIZE width, GR_SIZE height, int format, void **pixels,
+	int *pitch)
+{
+	GR_WINDOW_ID id;
+	GR_PIXMAP *pp;
+
+	SERVER_LOCK();
+	*pixels = NULL;
+	*pitch = 0;
+	id = GsNewPixmap(width, height, format, NULL);
+	if (id && (pp = GsFindPixmap(id)) != NULL) {
+		*pixels = pp->psd->addr;
+		*pitch = pp->psd->pitch;
+	}
+	SERVER_UNLOCK();
+
+	return id;
+}
+
+/*
+ * Create a pixmap whose pixels are in a shared memory segment created
+ * by the application, starting offset bytes into the segment with
+ * pitch bytes per line.  The segment remains owned by the application,
+ * the server detaches it when the pixmap is destroyed.
+ */
+GR_WINDOW_ID
+GrAttachSharedPixmap(GR_SIZE width, GR_SIZE height, int format, int shmid,
+	int offset, int pitch)
+{
+	GR_WINDOW_ID id = 0;
+#if HAVE_SHAREDMEM_SUPPORT
+	GR_PIXMAP *pp;
+	struct shmid_ds ds;
+	char *addr;
+
+	SERVER_LOCK();
+	if (width <= 0 || height <= 0 || offset < 0 || pitch <= 0 ||
+	    shmctl(shmid, IPC_STAT, &ds) < 0 ||
+	    (size_t)offset + (size_t)pitch * height > ds.shm_segsz) {
+		SERVER_UNLOCK();
+		return 0;
+	}
+	addr = shmat(shmid, 0, 0);
+	if (addr == (char *)-1) {
+		SERVER_UNLOCK();
+		return 0;
+	}
+
+	id = GsNewPixmap(width, height, format, addr + offset);
+	if (id && (pp = GsFindPixmap(id)) != NULL) {
+		if (pitch >= pp->psd->pitch) {
+			/* use application line size, shmid left -1 as segment isn't ours*/
+			pp->psd->pitch = pitch;
+			pp->psd->size = pitch * height;
+			pp->shmaddr = addr;
+			addr = NULL;
+		} else {
+			GsDestroyPixmap(pp);
+			id = 0;
+		}
+	} else
+		id = 0;
+	if (addr)
+		shmdt(addr);
+	SERVER_UNLOCK();
+#endif /* HAVE_SHAREDMEM_SUPPORT*/
+
+	return id;
+}
+
 /*
  * Map the window to make it (and possibly its children) visible on the screen.
  */
@@ -2074,6 +2296,7 @@ GrNewCursor(GR_SIZE width, GR_SIZE height, GR_COORD hotx, GR_COORD hoty,
 	cp->owner = curclient;
 	cp->next = listcursorp;
 	listcursorp = cp;
+	GsAddResource(GR_RESOURCE_CURSOR, cp->id, cp);
 
 	id = cp->id;
 	
@@ -2099,6 +2322,7 @@ GrDestroyCursor(GR_CURSOR_ID cid)
 		return;
 	}
 
+	GsRemoveResource(GR_RESOURCE_CURSOR, cursorp->id);
 	if (listcursorp == cursorp)
 		listcursorp = cursorp->next;
 	else {
@@ -2599,6 +2823,31 @@ GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2,
 	SERVER_UNLOCK();
 }
 
+/*
+ * Draw a table of unconnected lines in the specified drawable
+ * using the specified graphics context.
+ */
+void
+GrSegments(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_SEGMENT *segtable)
+{
+	GR_DRAWABLE	*dp;
+	GR_SEGMENT	*sp;
+	GR_COUNT	i;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawing(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		for (i = count, sp = segtable; i-- > 0; sp++)
+			GdLine(dp->psd, dp->x + sp->x1, dp->y + sp->y1,
+				dp->x + sp->x2, dp->y + sp->y2, TRUE);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
 /*
  * Draw the boundary of a rectangle in the specified drawable using the
  * specified graphics context.
@@ -2645,6 +2894,54 @@ GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 	SERVER_UNLOCK();
 }
 
+/*
+ * Draw the boundaries of a table of rectangles in the specified
+ * drawable using the specified graphics context.
+ */
+void
+GrRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	GR_DRAWABLE	*dp;
+	GR_RECT		*rp;
+	GR_COUNT	i;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawing(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		for (i = count, rp = recttable; i-- > 0; rp++)
+			GdRect(dp->psd, dp->x + rp->x, dp->y + rp->y, rp->width, rp->height);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
+/*
+ * Fill a table of rectangles in the specified drawable using the
+ * specified graphics context.
+ */
+void
+GrFillRects(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_RECT *recttable)
+{
+	GR_DRAWABLE	*dp;
+	GR_RECT		*rp;
+	GR_COUNT	i;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawing(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		for (i = count, rp = recttable; i-- > 0; rp++)
+			GdFillRect(dp->psd, dp->x + rp->x, dp->y + rp->y, rp->width, rp->height);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
+
 #if MW_FEATURE_SHAPES
 /*
  * Draw the boundary of an ellipse in the specified drawable with
@@ -2734,6 +3031,31 @@ GrArcAngle(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
 
 	SERVER_UNLOCK();
 }
+
+/*
+ * Draw a table of arcs or pies in the specified drawable using
+ * the specified graphics context.
+ */
+void
+GrArcs(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_ARCANGLE *arctable)
+{
+	GR_DRAWABLE	*dp;
+	GR_ARCANGLE	*ap;
+	GR_COUNT	i;
+
+	SERVER_LOCK();
+
+	switch (GsPrepareDrawing(id, gc, &dp)) {
+	case GR_DRAW_TYPE_WINDOW:
+	case GR_DRAW_TYPE_PIXMAP:
+		for (i = count, ap = arctable; i-- > 0; ap++)
+			GdArcAngle(dp->psd, dp->x + ap->x, dp->y + ap->y, ap->rx, ap->ry,
+				ap->angle1, ap->angle2, ap->type);
+		break;
+	}
+
+	SERVER_UNLOCK();
+}
 #endif /* MW_FEATURE_SHAPES*/
 
 #if MW_FEATURE_IMAGES
@@ -2835,6 +3157,7 @@ GrLoadImageFromFile(char *path, int flags)
 	pp->owner = curclient;
 	pp->next = listpp;
 	listpp = pp;
+	GsAddResource(GR_RESOURCE_PIXMAP, pp->id, pp);
 
 	SERVER_UNLOCK();
 	return pp->id;
@@ -2894,6 +3217,7 @@ GrLoadImageFromBuffer(void *buffer, int size, int flags)
 	pp->owner = curclient;
 	pp->next = listpp;
 	listpp = pp;
+	GsAddResource(GR_RESOURCE_PIXMAP, pp->id, pp);
 
 	SERVER_UNLOCK();
 	return pp->id;
@@ -4019,6 +4343,7 @@ GrNewBitmapRegion(GR_BITMAP *bitmap, GR_SIZE width, GR_SIZE height)
 	regionp->next = listregionp;
 
 	listregionp = regionp;
+	GsAddResource(GR_RESOURCE_REGION, regionp->id, regionp);
 	id = regionp->id;
 	
 	SERVER_UNLOCK();
@@ -4083,11 +4408,38 @@ GrSetWindowRegion(GR_WINDOW_ID wid, GR_REGION_ID rid, int type)
 	if (wp->clipregion)
 		GdDestroyRegion(wp->clipregion);
 	wp->clipregion = newregion;
+	GsInvalidateClip(wp);
 
 	SERVER_UNLOCK();
 #endif
 }
 
+/*
+ * Set the opacity of a buffered window, 255 is opaque.  Lower values
+ * composite the window buffer src-over the windows below it.
+ */
+void
+GrSetWindowOpacity(GR_WINDOW_ID wid, int opacity)
+{
+	GR_WINDOW *wp;
+
+	SERVER_LOCK();
+
+	if (!(wp = GsFindWindow(wid))) {
+		GsError(GR_ERROR_BAD_WINDOW_ID, wid);
+		SERVER_UNLOCK();
+		return;
+	}
+
+	GsSetWindowOpacity(wp, opacity);
+
+	/* redraw buffered window from its buffer, no exposure events*/
+	if ((wp->props & GR_WM_PROPS_BUFFERED) && wp->realized)
+		GsClearWindow(wp, 0, 0, wp->width, wp->height, 0);
+
+	SERVER_UNLOCK();
+}
+
 /**
  * This passes transform data to the mouse input engine.
  *
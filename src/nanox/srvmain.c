@@ -46,6 +46,7 @@ GR_CURSOR	*listcursorp;		/* list of all cursors */
 GR_CURSOR	*stdcursor;		/* root window cursor */
 GR_GC		*curgcp;		/* currently enabled gc */
 GR_WINDOW	*clipwp;		/* window clipping is set for */
+unsigned long	clipgeneration = 1;	/* bumped to invalidate all visible regions */
 GR_WINDOW	*focuswp;		/* focus window for keyboard */
 GR_WINDOW	*mousewp;		/* window mouse is currently in */
 GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
@@ -107,6 +108,9 @@ static void
 usage(void)
 {
 	EPRINTF("Usage: %s [-p] [-A] [-NLRD] [-x #] [-y #]"
+#if MW_FEATURE_IMAGES
+		" [-i <image-cache-kbytes>]"
+#endif
 #if FONTMAPPER
 		" [-c <fontconfig-file>"
 #endif
@@ -180,6 +184,15 @@ MAIN(int argc, char **argv)			/* ALLEGRO=real_main(), main() otherwise*/
 			++t;
 			continue;
 		}
+#if MW_FEATURE_IMAGES
+		if ( !strcmp("-i",argv[t]) ) {
+			if (++t >= argc)
+				usage();
+			GdSetImageCacheSize(atol(argv[t]) * 1024L);
+			++t;
+			continue;
+		}
+#endif
 #if FONTMAPPER
 		if ( !strcmp("-c",argv[t]) ) {
 			int read_configfile(char *file);
@@ -229,6 +242,12 @@ GsAcceptClientFd(int i)
 	client->prev = NULL;
 	client->waiting_for_event = FALSE;
 	client->shm_cmds = 0;
+	client->inbuf = NULL;
+	client->inlen = 0;
+#if MW_FEATURE_STATS
+	client->processid = 0;
+	client->stat_requests = client->stat_bytesin = client->stat_bytesout = 0;
+#endif
 
 	if(connectcount++ == 0)
 		root_client = client;
@@ -321,6 +340,9 @@ GrRegisterInput(int fd)
 	SERVER_LOCK();
 	FD_SET(fd, &regfdset);
 	if (fd >= regfdmax) regfdmax = fd + 1;
+#if HAVE_EPOLL
+	GdPollSet(fd, MWPOLL_READ);
+#endif
 	SERVER_UNLOCK();
 }
 
@@ -333,6 +355,11 @@ GrUnregisterInput(int fd)
 
 	/* unregister all inputs if the FD is -1 */
 	if (fd == -1) {
+#if HAVE_EPOLL
+		for (i = 0; i < regfdmax; i++)
+			if (FD_ISSET(i, &regfdset))
+				GdPollSet(i, 0);
+#endif
 		FD_ZERO(&regfdset);
 		regfdmax = -1;
 		SERVER_UNLOCK();
@@ -340,6 +367,9 @@ GrUnregisterInput(int fd)
 	}
 
 	FD_CLR(fd, &regfdset);
+#if HAVE_EPOLL
+	GdPollSet(fd, 0);
+#endif
 	/* recalculate the max file descriptor */
 	for (i = 0, max = regfdmax, regfdmax = -1; i < max; i++)
 		if (FD_ISSET(i, &regfdset))
@@ -378,6 +408,199 @@ GsPumpEvents(void)
 }
 #endif
 
+#if HAVE_EPOLL
+/*
+ * Linux epoll version of the main loop wait.  Input file descriptors
+ * are registered in the epoll set when opened or accepted and removed
+ * when closed, so only ready descriptors are examined on each pass.
+ */
+void
+GsSelect(GR_TIMEOUT timeout)
+{
+	MWPOLLEVENT events[MAXPOLLEVENTS];
+	int	i, n, fd;
+	int	timedout;
+	struct timeval tout;
+	struct timeval *to;
+#if !NONETWORK
+	int	newclient = 0;
+#endif
+#if MW_FEATURE_STATS
+	uint64_t waitstart;
+#endif
+
+	/* X11/SDL perform single update of aggregate screen update region*/
+	if (scrdev.PreSelect)
+	{
+		/* returns # pending events*/
+		if (scrdev.PreSelect(&scrdev))
+		{
+			/* poll for mouse data and service if found*/
+			while (GsCheckMouseEvent())
+				continue;
+
+			/* poll for keyboard data and service if found*/
+			while (GsCheckKeyboardEvent())
+				continue;
+
+			/* if events found, don't return unless polling, events handled below*/
+			if (timeout != GR_TIMEOUT_BLOCK)
+				return;
+		}
+	}
+
+#if !NONETWORK
+	/* return queued events to clients waiting in GrGetNextEvent*/
+	for (curclient = root_client; curclient; curclient = curclient->next)
+	{
+		if(curclient->waiting_for_event && curclient->eventhead)
+		{
+			curclient->waiting_for_event = FALSE;
+			GrGetNextEventWrapperFinish(curclient->id);
+			return;
+		}
+	}
+#endif
+
+	/* setup timeval struct for block or poll*/
+	tout.tv_sec = tout.tv_usec = 0;					/* setup for assumed poll*/
+	to = &tout;
+	int poll = (timeout == GR_TIMEOUT_POLL);
+	if (!poll)
+	{
+#if MW_FEATURE_TIMERS
+		/* get next timer or use passed timeout and convert to timeval struct*/
+		if (!GdGetNextTimeout(&tout, timeout))		/* no app timers or VTSWITCH?*/
+#else
+		if (timeout)								/* setup mwin poll timer*/
+		{
+			/* convert wait timeout to timeval struct*/
+			tout.tv_sec = timeout / 1000;
+			tout.tv_usec = (timeout % 1000) * 1000;
+		}
+		else
+#endif
+		{
+			to = NULL;								/* no timers, block*/
+		}
+	}
+
+	/* some drivers can't block as backend is poll based (SDL)*/
+	if (scrdev.flags & PSF_CANTBLOCK)
+	{
+#define WAITTIME	5000
+		/* check if would block permanently or timeout > WAITTIME*/
+		if (to == NULL || tout.tv_sec != 0 || tout.tv_usec > WAITTIME)
+		{
+			/* override timeouts and wait for max WAITTIME ms*/
+			to = &tout;
+			tout.tv_sec = 0;
+			tout.tv_usec = WAITTIME;
+		}
+	}
+
+	/* Wait for some input on any registered fd or a timeout*/
+#if NONETWORK
+again:
+	SERVER_UNLOCK();	/* allow other threads to run*/
+#endif
+#if MW_FEATURE_STATS
+	waitstart = GsStatTime();
+#endif
+	n = GdPollWait(events, MAXPOLLEVENTS, to);
+#if NONETWORK
+	SERVER_LOCK();
+#endif
+#if MW_FEATURE_STATS
+	GsStatSelect(waitstart);
+#endif
+	if (n < 0)
+	{
+		if (errno != EINTR)
+			EPRINTF("epoll_wait call in main failed\n");
+		return;
+	}
+
+	timedout = (n == 0);
+	for (i = 0; i < n; i++)
+	{
+		fd = events[i].fd;
+
+		if (events[i].events & MWPOLL_TIMER)
+			timedout = 1;
+
+		/* service mouse file descriptor*/
+		else if (fd == mouse_fd)
+			while(GsCheckMouseEvent())
+				continue;
+
+		/* service keyboard file descriptor*/
+		else if (fd == keyb_fd
+#if MW_FEATURE_TWO_KEYBOARDS
+		    || fd == keyb2_fd
+#endif
+		  )
+			while(GsCheckKeyboardEvent())
+				continue;
+
+#if NONETWORK
+		/* return input on registered file descriptors */
+		else if (fd < regfdmax && FD_ISSET(fd, &regfdset))
+		{
+			GR_EVENT_FDINPUT *	gp;
+
+			gp = (GR_EVENT_FDINPUT *)GsAllocEvent(curclient);
+			if(gp) {
+				gp->type = GR_EVENT_TYPE_FDINPUT;
+				gp->fd = fd;
+			}
+		}
+#else /* !NONETWORK */
+		/* accept connections after servicing clients, so a reused fd isn't mistaken*/
+		else if (fd == un_sock)
+			newclient = 1;
+
+		/* If a client is sending us a command, handle it, unless dropped earlier in this pass*/
+		else if ((curclient = GsFindClient(fd)) != NULL)
+			GsHandleClient(fd);
+#endif /* NONETWORK */
+	}
+
+#if !NONETWORK
+	/* If a client is trying to connect, accept it: */
+	if (newclient)
+		GsAcceptClient();
+#endif
+
+	if (timedout)
+	{
+#if NONETWORK
+		/* 
+		 * Timeout has occured. Currently return a timeout event
+		 * regardless of whether client has selected for it.
+		 */
+#if MW_FEATURE_TIMERS
+		if(GdTimeout())
+#endif
+		{
+			GR_EVENT_GENERAL *	gp;
+			if ((gp = (GR_EVENT_GENERAL *)GsAllocEvent(curclient)) != NULL)
+				gp->type = GR_EVENT_TYPE_TIMEOUT;
+		}
+		else if(!poll && timeout && (scrdev.flags & PSF_CANTBLOCK)) {
+			if (!GsPumpEvents())    /* process mouse/kbd events */
+				goto again;		/* retry until passed timeout */
+		}
+#else /* !NONETWORK */
+#if MW_FEATURE_TIMERS
+		/* check for timer timeouts and service if found*/
+		GdTimeout();
+#endif
+#endif /* NONETWORK */
+	}
+}
+
+#else /* !HAVE_EPOLL*/
 void
 GsSelect(GR_TIMEOUT timeout)
 {
@@ -389,6 +612,9 @@ GsSelect(GR_TIMEOUT timeout)
 #if NONETWORK
 	int	fd;
 #endif
+#if MW_FEATURE_STATS
+	uint64_t waitstart;
+#endif
 #if HAVE_VNCSERVER 
 #if VNCSERVER_PTHREADED
         int dummy;
@@ -543,10 +769,16 @@ GsSelect(GR_TIMEOUT timeout)
 #if NONETWORK
 again:
 	SERVER_UNLOCK();	/* allow other threads to run*/
+#endif
+#if MW_FEATURE_STATS
+	waitstart = GsStatTime();
 #endif
 	e = select(setsize+1, &rfds, NULL, NULL, to);
 #if NONETWORK
 	SERVER_LOCK();
+#endif
+#if MW_FEATURE_STATS
+	GsStatSelect(waitstart);
 #endif
 	if(e > 0)			/* input ready*/
 	{
@@ -640,6 +872,7 @@ again:
 	} else if(errno != EINTR)
 		EPRINTF("Select() call in main failed\n");
 }
+#endif /* HAVE_EPOLL*/
 
 /********************************************************************************/
 #elif RTEMS
@@ -979,6 +1212,11 @@ GsInitialize(void)
 	signal(SIGTERM, (void *)GsTerminate);
 #endif
 
+#if MW_FEATURE_STATS
+	/* start counting, SIGUSR1 writes statistics to stderr*/
+	GsInitStats();
+#endif
+
 #if MW_FEATURE_TIMERS
 	screensaver_delay = 0;
 #endif
@@ -1035,6 +1273,15 @@ GsInitialize(void)
 		return -1;
 	}
 
+#if HAVE_EPOLL
+	/* wait for mouse and keyboard input in the epoll set*/
+	GdPollSet(mouse_fd, MWPOLL_READ);
+	GdPollSet(keyb_fd, MWPOLL_READ);
+#if MW_FEATURE_TWO_KEYBOARDS
+	GdPollSet(keyb2_fd, MWPOLL_READ);
+#endif
+#endif
+
 #if HAVE_VNCSERVER
         if (!GdOpenVNC(psd, Argc, Argv)) {
                 EPRINTF("Cannot open VNC Socket\n");
@@ -1084,6 +1331,10 @@ GsInitialize(void)
 	wp->title = NULL;
 	wp->clipregion = NULL;
 	wp->buffer = NULL;
+	wp->visregion = NULL;
+	wp->visgen = 0;
+	wp->visflags = 0;
+	wp->opacity = 255;
 
 	listpp = NULL;
 	listwp = wp;
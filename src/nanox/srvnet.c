@@ -12,6 +12,9 @@
  * connections from clients, receives functions from them, and dispatches
  * events to them.
  */
+#if HAVE_SHAREDMEM_SUPPORT && defined(__linux__)
+#define _GNU_SOURCE		/* struct ucred for SO_PEERCRED*/
+#endif
 #include <stdlib.h>
 #include "uni_std.h"
 #include <errno.h>
@@ -40,6 +43,8 @@
 #define SOCK_STREAM	2	/* <asm/socket.h>*/
 #endif
 
+#define SZINBUF		(MAXREQUESTSZ * 2)	/* per-client socket input buffer size*/
+
 extern	int		un_sock;
 extern	GR_CLIENT	*root_client;
 extern	int		current_fd;
@@ -82,6 +87,17 @@ GrGetScreenInfoWrapper(void *r)
 	GsWrite(current_fd, &si, sizeof(si));
 }
 
+static void
+GrGetServerStatsWrapper(void *r)
+{
+	nxGetServerStatsReq *req = r;
+	static GR_SERVER_STATS stats;
+
+	GrGetServerStats(&stats, req->reset);
+	GsWriteType(current_fd, GrNumGetServerStats);
+	GsWrite(current_fd, &stats, sizeof(stats));
+}
+
 static void
 GrGetSysColorWrapper(void *r)
 {
@@ -421,6 +437,26 @@ GrGetFontInfoWrapper(void *r)
 	GsWrite(current_fd, &fi, sizeof(fi));
 }
 
+static void
+GrGetFontMetricsWrapper(void *r)
+{
+	nxGetFontMetricsReq *req = r;
+	GR_CHAR_METRICS	metrics[256];
+	int		firstchar = req->firstchar;
+	int		count = req->count;
+	int		n;
+
+	/* reply in chunks, client reads count entries*/
+	GsWriteType(current_fd,GrNumGetFontMetrics);
+	while (count > 0) {
+		n = MWMIN(count, 256);
+		GrGetFontMetrics(req->fontid, firstchar, n, metrics);
+		GsWrite(current_fd, metrics, n * sizeof(GR_CHAR_METRICS));
+		firstchar += n;
+		count -= n;
+	}
+}
+
 static void
 GrGetFocusWrapper(void *r)
 {
@@ -602,6 +638,36 @@ GrFillRectWrapper(void *r)
 		req->height);
 }
 
+static void
+GrRectsWrapper(void *r)
+{
+	nxRectsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_RECT);
+	GrRects(req->drawid, req->gcid, count, (GR_RECT *)GetReqData(req));
+}
+
+static void
+GrFillRectsWrapper(void *r)
+{
+	nxFillRectsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_RECT);
+	GrFillRects(req->drawid, req->gcid, count, (GR_RECT *)GetReqData(req));
+}
+
+static void
+GrSegmentsWrapper(void *r)
+{
+	nxSegmentsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_SEGMENT);
+	GrSegments(req->drawid, req->gcid, count, (GR_SEGMENT *)GetReqData(req));
+}
+
 static void
 GrPolyWrapper(void *r)
 {
@@ -657,6 +723,16 @@ GrArcAngleWrapper(void *r)
 		req->angle1, req->angle2, req->type);
 }
 
+static void
+GrArcsWrapper(void *r)
+{
+	nxArcsReq *req = r;
+	int        count;
+
+	count = GetReqVarLen(req) / sizeof(GR_ARCANGLE);
+	GrArcs(req->drawid, req->gcid, count, (GR_ARCANGLE *)GetReqData(req));
+}
+
 static void
 GrSetGCForegroundWrapper(void *r)
 {
@@ -1405,15 +1481,46 @@ GrQueryPointerWrapper(void *r)
 	GsWrite(current_fd, &bmask, sizeof(bmask));
 }
 
+#define SHMKEY_BASE 1000000
+#define SHMKEY_MAX 256
+
+#if HAVE_SHAREDMEM_SUPPORT
+/*
+ * Create and attach a new shared memory segment with an unused key.
+ * Returns the key for the client to attach to, or 0 on failure.
+ */
+static int
+GsAllocSharedMem(int size, int *pshmid, char **paddr)
+{
+	int 		key, shmid;
+	char 		*tmp;
+
+	for ( key=SHMKEY_BASE; key < SHMKEY_BASE+SHMKEY_MAX; key++ ) {
+		shmid = shmget(key,size,IPC_CREAT|IPC_EXCL|0666);
+		if ( shmid == -1 ) {
+			if ( errno != EEXIST )
+				return 0;
+		} else {
+			tmp = shmat(shmid,0,0);
+			if ( tmp == (char *)-1 ) {
+				shmctl(shmid,IPC_RMID,0);
+				return 0;
+			}
+			*pshmid = shmid;
+			*paddr = tmp;
+			return key;
+		}
+	}
+	return 0;
+}
+#endif /* HAVE_SHAREDMEM_SUPPORT*/
+
 /*
  * This function makes the Nano-X server set up a shared memory segment
  * that the client can use when feeding the Nano-X server with requests.
  * There is a corresponding GrShmCmdsFlush function that will make the
  * server execute the batched commands.
  */
-#define SHMKEY_BASE 1000000
-#define SHMKEY_MAX 256
-
 static void
 GrReqShmCmdsWrapper(void *r)
 {
@@ -1422,29 +1529,16 @@ GrReqShmCmdsWrapper(void *r)
 	int 		key, shmid;
 	char 		*tmp;
 
-	if ( curclient->shm_cmds != 0 )
-		goto bad;
-
-	for ( key=SHMKEY_BASE; key < SHMKEY_BASE+SHMKEY_MAX; key++ ) {
-		shmid = shmget(key,req->size,IPC_CREAT|IPC_EXCL|0666);
-		if ( shmid == -1 ) {
-			if ( errno != EEXIST )
-				goto bad;
-		} else {
-			tmp = shmat(shmid,0,0);
-			if ( tmp == (char *)-1 )
-				goto bad;
+	key = 0;
+	if ( curclient->shm_cmds == 0 ) {
+		key = GsAllocSharedMem(req->size, &shmid, &tmp);
+		if ( key ) {
 			curclient->shm_cmds = tmp;
 			curclient->shm_cmds_shmid = shmid;
 			curclient->shm_cmds_size = req->size;
-			goto finish;
 		}
 	}
 
- bad:
-	key = 0;
-
- finish:
 	DPRINTF("Shm: Request key granted=%d\n",key);
 	GsWrite(current_fd, &key, sizeof(key));
 #else
@@ -1454,6 +1548,84 @@ GrReqShmCmdsWrapper(void *r)
 #endif /* HAVE_SHAREDMEM_SUPPORT*/
 }
 
+/*
+ * Create a pixmap whose pixels live in a shared memory segment.
+ * The client attaches the returned key and draws into the pixels
+ * directly, then presents them with a single GrCopyArea.
+ * A zero id or key is returned if shared memory is unavailable.
+ */
+static void
+GrNewSharedPixmapWrapper(void *r)
+{
+	nxNewSharedPixmapReq *req = r;
+	GR_WINDOW_ID	id = 0;
+	int		key = 0;
+	int		size = 0;
+	int		pitch = 0;
+#if HAVE_SHAREDMEM_SUPPORT
+	GR_PIXMAP	*pp;
+	PSD		psd;
+	char		*addr;
+	int		shmid;
+
+	id = GsNewPixmap(req->width, req->height, req->format, NULL);
+	if (id && (pp = GsFindPixmap(id)) != NULL) {
+		psd = pp->psd;
+		key = GsAllocSharedMem(psd->size, &shmid, &addr);
+		if (key) {
+			/* replace malloc'd pixels with the shared segment*/
+			memcpy(addr, psd->addr, psd->size);
+			if (psd->flags & PSF_ADDRMALLOC)
+				free(psd->addr);
+			psd->addr = addr;
+			psd->flags &= ~PSF_ADDRMALLOC;
+			pp->shmaddr = addr;
+			pp->shmid = shmid;
+			size = psd->size;
+			pitch = psd->pitch;
+		} else {
+			GsDestroyPixmap(pp);
+			id = 0;
+		}
+	}
+	DPRINTF("Shm: pixmap %d key %d size %d\n", id, key, size);
+#endif /* HAVE_SHAREDMEM_SUPPORT*/
+
+	GsWriteType(current_fd, GrNumNewSharedPixmap);
+	GsWrite(current_fd, &id, sizeof(id));
+	GsWrite(current_fd, &key, sizeof(key));
+	GsWrite(current_fd, &size, sizeof(size));
+	GsWrite(current_fd, &pitch, sizeof(pitch));
+}
+
+/*
+ * Create a pixmap over a shared memory segment created by the client.
+ * Only segments owned by the client's user or readable and writable
+ * by all are accepted, so that clients can't use the server to access
+ * other users' memory.  A zero id is returned otherwise.
+ */
+static void
+GrAttachSharedPixmapWrapper(void *r)
+{
+	nxAttachSharedPixmapReq *req = r;
+	GR_WINDOW_ID	id = 0;
+#if HAVE_SHAREDMEM_SUPPORT && defined(SO_PEERCRED)
+	struct ucred	cred;
+	socklen_t	len = sizeof(cred);
+	struct shmid_ds	ds;
+
+	if (getsockopt(current_fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 &&
+	    shmctl((int)req->shmid, IPC_STAT, &ds) == 0 &&
+	    (cred.uid == 0 || cred.uid == ds.shm_perm.uid || cred.uid == ds.shm_perm.cuid ||
+	     (ds.shm_perm.mode & 0006) == 0006))
+		id = GrAttachSharedPixmap(req->width, req->height, req->format,
+			(int)req->shmid, req->offset, req->pitch);
+#endif
+
+	GsWriteType(current_fd, GrNumAttachSharedPixmap);
+	GsWrite(current_fd, &id, sizeof(id));
+}
+
 static void 
 GrGetFontListWrapper(void *r)
 {
@@ -1503,6 +1675,14 @@ GrSetWindowRegionWrapper(void *r)
 
 	GrSetWindowRegion(req->wid, req->rid, req->type);
 }
+
+static void
+GrSetWindowOpacityWrapper(void *r)
+{
+	nxSetWindowOpacityReq *req = r;
+
+	GrSetWindowOpacity(req->windowid, req->opacity);
+}
  
 static void
 GrStretchAreaWrapper(void *r)
@@ -1723,6 +1903,15 @@ static const struct GrFunction GrFunctions[] = {
 	/* 123 */ {GrCreateFontFromBufferWrapper, "GrCreateFontFromBuffer"},
 	/* 124 */ {GrCopyFontWrapper, "GrCopyFont"},
 	/* 125 */ {GrDrawImagePartToFitWrapper, "GrDrawImagePartToFit"},
+	/* 126 */ {GrNewSharedPixmapWrapper, "GrNewSharedPixmap"},
+	/* 127 */ {GrGetServerStatsWrapper, "GrGetServerStats"},
+	/* 128 */ {GrSetWindowOpacityWrapper, "GrSetWindowOpacity"},
+	/* 129 */ {GrGetFontMetricsWrapper, "GrGetFontMetrics"},
+	/* 130 */ {GrRectsWrapper, "GrRects"},
+	/* 131 */ {GrFillRectsWrapper, "GrFillRects"},
+	/* 132 */ {GrSegmentsWrapper, "GrSegments"},
+	/* 133 */ {GrArcsWrapper, "GrArcs"},
+	/* 134 */ {GrAttachSharedPixmapWrapper, "GrAttachSharedPixmap"},
 };
 
 void
@@ -1731,11 +1920,16 @@ GrShmCmdsFlushWrapper(void *r)
 	nxShmCmdsFlushReq *req = r;
 	unsigned char 	reply;
 #if HAVE_SHAREDMEM_SUPPORT
+	nxShmCmdsHeader	*hdr = (nxShmCmdsHeader *)current_shm_cmds;
+	GR_CLIENT	*client = curclient;
+	int		fd = current_fd;
 	nxReq 		*pr;
 	int 		length;
 	unsigned char 	*do_req, *do_req_last;
 
-	if ( current_shm_cmds == 0 || current_shm_cmds_size < req->size ) {
+	if ( current_shm_cmds == 0 ||
+	     current_shm_cmds_size < sizeof(nxShmCmdsHeader) + req->size ||
+	     req->offset > current_shm_cmds_size - sizeof(nxShmCmdsHeader) - req->size ) {
 		/* No or short shm present serverside, bug or mischief */
 		EPRINTF("nano-X: Ill behaved client assumes shm ok\n");
 		if ( req->reply ) {
@@ -1745,20 +1939,40 @@ GrShmCmdsFlushWrapper(void *r)
 		return;
 	}
 
-	do_req = (unsigned char *)current_shm_cmds;
-	do_req_last = (unsigned char *)current_shm_cmds + req->size;
+	do_req = (unsigned char *)current_shm_cmds + sizeof(nxShmCmdsHeader) + req->offset;
+	do_req_last = do_req + req->size;
 
 	while ( do_req < do_req_last ) {
 		pr = (nxReq *)do_req;
 		length = GetReqAlignedLen(pr);
 		if ( pr->reqType < GrTotalNumCalls ) {
+#if MW_FEATURE_STATS
+			/* request may detach the ring, don't read it afterwards*/
+			int type = pr->reqType;
+			uint64_t start = GsStatTime();
+
+			client->stat_requests++;
+			GrFunctions[type].func(pr);
+			GsStatRequest(type, GrFunctions[type].name, start);
+#else
 			GrFunctions[pr->reqType].func(pr);
+#endif
 		} else {
 			EPRINTF("nano-X: Error bad shm function!\n");
 		}
+
+		/* stop if request closed the connection and detached the ring*/
+		if (GsFindClient(fd) != client)
+			return;
 		do_req += length;
 	}
 
+	/* hand ring space back to client once all requests are read*/
+#if defined(__GNUC__)
+	__sync_synchronize();
+#endif
+	hdr->done = req->end;
+
 	if ( req->reply ) {
 		reply = 1;
 		GsWrite(current_fd, &reply, 1);
@@ -1828,6 +2042,9 @@ GsOpenSocket(void)
 	/* Start listening on the socket: */
 	if(listen(un_sock, 5) == -1)
 		return -1;
+#if HAVE_EPOLL
+	GdPollSet(un_sock, MWPOLL_READ);
+#endif
 	return 1;
 }
 
@@ -1860,6 +2077,9 @@ GsAcceptClient(void)
 		EPRINTF("nano-X: Error accept failed (%d)\n", errno);
 		return;
 	}
+#if HAVE_EPOLL
+	GdPollSet(i, MWPOLL_READ);
+#endif
 	GsAcceptClientFd(i);
 }
 
@@ -2074,6 +2294,9 @@ GsDropClient(int fd)
 	GR_CLIENT *client;
 
 	if((client = GsFindClient(fd))) { /* If it exists */
+#if HAVE_EPOLL
+		GdPollSet(fd, 0);	/* remove from epoll set before fd can be reused*/
+#endif
 		close(fd);	/* Close the socket */
 
 		GsDestroyClientResources(client);
@@ -2092,6 +2315,8 @@ GsDropClient(int fd)
 			shmdt(client->shm_cmds);
 		}
 #endif
+		if (client->inbuf)
+			free(client->inbuf);
 		GsPrintResources();
 
 		if (curclient == client)
@@ -2103,38 +2328,18 @@ GsDropClient(int fd)
 	} /*else EPRINTF("nano-X: trying to drop non-existent client %d.\n", fd);*/
 }
 
-/*
- * This is a wrapper to read() which handles error conditions, and
- * returns 0 for both error conditions and no data.
- */
-int
-GsRead(int fd, void *buf, int c)
-{
-	int e, n;
-
-	n = 0;
-
-	while(n < c) {
-		e = read(fd, ((char *)buf) + n, c - n);
-		if(e <= 0) {
-			if (e == 0)
-				EPRINTF("nano-X: client closed socket: %d\n", fd);
-			else EPRINTF("nano-X: GsRead failed %d %d: %d\r\n", e, n, errno);
-			GsClose(fd);
-			return -1;
-		}
-		n += e;
-	}
-
-	return 0;
-}
-
 /*
  * This is a wrapper to write().
  */
 int GsWrite(int fd, void *buf, int c)
 {
 	int e, n;
+#if MW_FEATURE_STATS
+	GR_CLIENT *client = (curclient && curclient->id == fd)? curclient: GsFindClient(fd);
+
+	if (client)
+		client->stat_bytesout += c;
+#endif
 
 	n = 0;
 
@@ -2158,43 +2363,87 @@ int GsWriteType(int fd, short type)
 
 /*
  * This function is used to parse and dispatch requests from the clients.
- * Note that the maximum request size is allocated from the stack
- * in this function.
+ * Each call reads whatever the client has sent so far into its input
+ * buffer with a single read, then runs all complete requests in it.
+ * A partial request at the end is kept for the next call.
  */
 void
 GsHandleClient(int fd)
 {
+	GR_CLIENT *client = curclient;
 	nxReq *	req;
 	long	len;
-	char	buf[MAXREQUESTSZ];
+	int	n, pos;
 
-	current_fd = fd;
-#if HAVE_SHAREDMEM_SUPPORT
-	current_shm_cmds = curclient->shm_cmds;
-	current_shm_cmds_size = curclient->shm_cmds_size;
-#endif
-	/* read request header*/
-	if(GsRead(fd, buf, sizeof(nxReq)))
+	/* allocate input buffer on first request*/
+	if (!client->inbuf && (client->inbuf = malloc(SZINBUF)) == NULL) {
+		EPRINTF("nano-X: GsHandleClient can't allocate input buffer\n");
+		GsClose(fd);
 		return;
+	}
 
-	len = GetReqAlignedLen((nxReq *)&buf[0]);
-	if(len > sizeof(nxReq)) {
+	/* read all data available, following any partial request*/
+	n = read(fd, client->inbuf + client->inlen, SZINBUF - client->inlen);
+	if (n <= 0) {
+		if (n < 0 && errno == EINTR)
+			return;
+		if (n == 0)
+			EPRINTF("nano-X: client closed socket: %d\n", fd);
+		else EPRINTF("nano-X: GsHandleClient read failed: %d\n", errno);
+		GsClose(fd);
+		return;
+	}
+	client->inlen += n;
+#if MW_FEATURE_STATS
+	client->stat_bytesin += n;
+#endif
+
+	/* dispatch each complete request*/
+	pos = 0;
+	while (client->inlen - pos >= (int)sizeof(nxReq)) {
+		req = (nxReq *)&client->inbuf[pos];
+		len = GetReqAlignedLen(req);
 		if(len > MAXREQUESTSZ) {
 			EPRINTF("nano-X: GsHandleClient request too large: %ld > %d\n",
 				len, MAXREQUESTSZ);
 			exit(1);
 		}
-		/* read additional request data*/
-		if(GsRead(fd, &buf[sizeof(nxReq)], len-sizeof(nxReq)))
+		if (client->inlen - pos < len)
+			break;
+		pos += len;
+
+		/* requests may change these, reset for each*/
+		curclient = client;
+		current_fd = fd;
+#if HAVE_SHAREDMEM_SUPPORT
+		current_shm_cmds = client->shm_cmds;
+		current_shm_cmds_size = client->shm_cmds_size;
+#endif
+		if(req->reqType < GrTotalNumCalls) {
+#if MW_FEATURE_STATS
+			/* request may free inbuf, don't read it afterwards*/
+			int type = req->reqType;
+			uint64_t start = GsStatTime();
+
+			client->stat_requests++;
+#endif
+			curfunc = (char *)GrFunctions[req->reqType].name;
+			/*DPRINTF("HandleClient %s\n", curfunc);*/
+			GrFunctions[req->reqType].func(req);
+#if MW_FEATURE_STATS
+			GsStatRequest(type, GrFunctions[type].name, start);
+#endif
+		} else {
+			EPRINTF("nano-X: GsHandleClient bad function\n");
+		}
+
+		/* stop if request closed the connection*/
+		if (GsFindClient(fd) != client)
 			return;
 	}
-	req = (nxReq *)&buf[0];
 
-	if(req->reqType < GrTotalNumCalls) {
-		curfunc = (char *)GrFunctions[req->reqType].name;
-		/*DPRINTF("HandleClient %s\n", curfunc);*/
-		GrFunctions[req->reqType].func(req);
-	} else {
-		EPRINTF("nano-X: GsHandleClient bad function\n");
-	}
+	/* move partial request to start of buffer*/
+	client->inlen -= pos;
+	if (client->inlen && pos)
+		memmove(client->inbuf, client->inbuf + pos, client->inlen);
 }
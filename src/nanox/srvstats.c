@@ -0,0 +1,230 @@
+/*
+ * Graphics server statistics
+ *
+ * When MW_FEATURE_STATS is set the server counts each request type with
+ * its total, longest and histogram of handling times, the requests and
+ * bytes exchanged with each client, and how long the main loop spends
+ * blocked in GsSelect versus handling input.  Together with the engine
+ * drawing counters they are returned by GrGetServerStats and written to
+ * stderr when the server receives SIGUSR1.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include "serv.h"
+#if HAVE_SIGNAL
+#include <signal.h>
+#endif
+
+#if MW_FEATURE_STATS /* whole file*/
+extern GR_CLIENT *root_client;
+
+static GR_REQUEST_STAT	reqstats[GR_STATS_MAXREQUESTS];
+static const char *		reqnames[GR_STATS_MAXREQUESTS];
+static uint64_t			starttime;	/* time of start or last reset*/
+static uint64_t			idletime;	/* time blocked in select*/
+static uint64_t			busytime;	/* time between selects*/
+static uint64_t			selects;	/* main loop wakeups*/
+static uint64_t			lastwake;	/* time last select returned*/
+#if HAVE_SIGNAL
+static volatile sig_atomic_t dumpstats;	/* SIGUSR1 received*/
+#endif
+
+/* return monotonic time in nanoseconds*/
+uint64_t
+GsStatTime(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+#if HAVE_SIGNAL
+static void
+GsStatSignal(int sig)
+{
+	dumpstats = 1;
+}
+#endif
+
+/* start counting, called once from GsInitialize*/
+void
+GsInitStats(void)
+{
+	starttime = lastwake = GsStatTime();
+#if HAVE_SIGNAL
+	signal(SIGUSR1, GsStatSignal);
+#endif
+}
+
+/**
+ * Count a request handled by the server.
+ *
+ * @param type Request number.
+ * @param name Request name.
+ * @param start Time request handling started, from GsStatTime.
+ */
+void
+GsStatRequest(int type, const char *name, uint64_t start)
+{
+	GR_REQUEST_STAT *rp;
+	uint64_t nsecs = GsStatTime() - start;
+	uint64_t usecs = nsecs / 1000;
+	int bucket = 0;
+
+	if ((unsigned)type >= GR_STATS_MAXREQUESTS)
+		return;
+	rp = &reqstats[type];
+	reqnames[type] = name;
+
+	/* bucket n counts requests under 4^n usecs*/
+	while (usecs && bucket < GR_STATS_BUCKETS - 1) {
+		bucket++;
+		usecs >>= 2;
+	}
+	rp->hist[bucket]++;
+	rp->count++;
+	rp->nsecs += nsecs;
+	if (nsecs > rp->maxnsecs)
+		rp->maxnsecs = nsecs;
+}
+
+/**
+ * Count a main loop wait, called when select returns.
+ * Time since the previous wait returned is counted as busy.
+ * Writes the statistics to stderr if SIGUSR1 arrived during the wait.
+ *
+ * @param start Time the wait started, from GsStatTime.
+ */
+void
+GsStatSelect(uint64_t start)
+{
+	uint64_t now = GsStatTime();
+
+	busytime += start - lastwake;
+	idletime += now - start;
+	lastwake = now;
+	selects++;
+
+#if HAVE_SIGNAL
+	if (dumpstats) {
+		dumpstats = 0;
+		GsPrintStats();
+	}
+#endif
+}
+
+/**
+ * Return the server and drawing statistics and optionally start counting again.
+ *
+ * @param sp Returned statistics.
+ * @param reset Nonzero to clear all counters after copying.
+ */
+void
+GsGetStats(GR_SERVER_STATS *sp, int reset)
+{
+	uint64_t now = GsStatTime();
+	int i, n;
+#if !NONETWORK
+	GR_CLIENT *client;
+#endif
+
+	memset(sp, 0, sizeof(*sp));
+	sp->elapsed = now - starttime;
+	sp->idle = idletime;
+	sp->busy = busytime + (now - lastwake);
+	sp->selects = selects;
+
+	for (i = 0, n = 0; i < GR_STATS_MAXREQUESTS; i++) {
+		if (!reqstats[i].count)
+			continue;
+		sp->request[n] = reqstats[i];
+		sp->request[n].opcode = i;
+		strncpy(sp->request[n].name, reqnames[i], sizeof(GR_FUNC_NAME) - 1);
+		n++;
+	}
+	sp->nrequests = n;
+
+#if !NONETWORK
+	for (client = root_client, n = 0; client && n < GR_STATS_MAXCLIENTS; client = client->next) {
+		GR_CLIENT_STAT *cp = &sp->client[n++];
+
+		cp->id = client->id;
+		cp->processid = client->processid;
+		cp->requests = client->stat_requests;
+		cp->bytesin = client->stat_bytesin;
+		cp->bytesout = client->stat_bytesout;
+		if (reset)
+			client->stat_requests = client->stat_bytesin = client->stat_bytesout = 0;
+	}
+	sp->nclients = n;
+#endif
+
+	GdGetDrawStats(&sp->draw, reset);
+
+	if (reset) {
+		memset(reqstats, 0, sizeof(reqstats));
+		idletime = busytime = selects = 0;
+		starttime = lastwake = now;
+	}
+}
+
+/* write statistics to stderr*/
+void
+GsPrintStats(void)
+{
+	static GR_SERVER_STATS stats;
+	GR_SERVER_STATS *sp = &stats;
+	int i, j;
+
+	GsGetStats(sp, 0);
+
+	fprintf(stderr, "nano-X stats: %.3fs elapsed, %.3fs idle, %.3fs busy, %llu wakeups\n",
+		sp->elapsed / 1e9, sp->idle / 1e9, sp->busy / 1e9, (unsigned long long)sp->selects);
+
+	fprintf(stderr, "%-24s %10s %10s %8s %8s  <1us..>=4ms\n",
+		"request", "count", "total ms", "avg us", "max us");
+	for (i = 0; i < sp->nrequests; i++) {
+		GR_REQUEST_STAT *rp = &sp->request[i];
+
+		fprintf(stderr, "%-24s %10llu %10.3f %8.2f %8.1f ", rp->name,
+			(unsigned long long)rp->count, rp->nsecs / 1e6,
+			rp->nsecs / 1e3 / rp->count, rp->maxnsecs / 1e3);
+		for (j = 0; j < GR_STATS_BUCKETS; j++)
+			fprintf(stderr, " %u", rp->hist[j]);
+		fprintf(stderr, "\n");
+	}
+
+	for (i = 0; i < sp->nclients; i++) {
+		GR_CLIENT_STAT *cp = &sp->client[i];
+
+		fprintf(stderr, "client fd %d pid %d: %llu requests, %llu bytes in, %llu bytes out\n",
+			cp->id, cp->processid, (unsigned long long)cp->requests,
+			(unsigned long long)cp->bytesin, (unsigned long long)cp->bytesout);
+	}
+
+	for (i = 0; i < sp->draw.nblits; i++) {
+		MWBLITSTAT *bp = &sp->draw.blit[i];
+
+		fprintf(stderr, "blit %08x -> %08x: %llu blits, %llu pixels\n",
+			bp->srcformat, bp->dstformat,
+			(unsigned long long)bp->count, (unsigned long long)bp->pixels);
+	}
+	fprintf(stderr, "%llu clip rects, %llu update rects, %llu update pixels\n",
+		(unsigned long long)sp->draw.cliprects, (unsigned long long)sp->draw.updates,
+		(unsigned long long)sp->draw.updatepixels);
+	fprintf(stderr, "image cache: %llu hits, %llu misses, %llu evictions, %llu images, %llu bytes\n",
+		(unsigned long long)sp->draw.imagehits, (unsigned long long)sp->draw.imagemisses,
+		(unsigned long long)sp->draw.imageevictions, (unsigned long long)sp->draw.imagecount,
+		(unsigned long long)sp->draw.imagebytes);
+}
+#endif /* MW_FEATURE_STATS*/
@@ -15,6 +15,11 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #endif
+#if HAVE_SHAREDMEM_SUPPORT
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
 
 /*
  * Redraw the screen completely.
@@ -87,6 +92,7 @@ GsUnrealizeWindow(GR_WINDOW *wp, GR_BOOL temp_unmap)
 
 	/* set window invisible flag*/
 	wp->realized = GR_FALSE;
+	GsInvalidateClip(wp);
 
 	for (childwp = wp->children; childwp; childwp = childwp->siblings)
 		GsUnrealizeWindow(childwp, temp_unmap);
@@ -188,6 +194,7 @@ wp->id, wp->mapped, wp->realized, wp->parent->realized);*/
 
 	/* set window visible flag*/
 	wp->realized = GR_TRUE;
+	GsInvalidateClip(wp);
 
 	if (!temp) {
 		GsCheckMouseWindow();
@@ -296,6 +303,7 @@ GsDestroyWindow(GR_WINDOW *wp)
 		prevwp->next = wp->next;
 	}
 	wp->next = NULL;
+	GsRemoveResource(GR_RESOURCE_WINDOW, wp->id);
 
 	/*
 	 * Forget various information if they related to this window.
@@ -303,6 +311,8 @@ GsDestroyWindow(GR_WINDOW *wp)
 	 */
 	if (wp == clipwp)
 		clipwp = NULL;
+	if (wp->opacity < 255)
+		GsSetWindowOpacity(wp, 255);
 	if (wp == grabbuttonwp)
 		grabbuttonwp = NULL;
 	if (wp == cachewp) {
@@ -329,6 +339,8 @@ GsDestroyWindow(GR_WINDOW *wp)
 #if DYNAMICREGIONS
 	if (wp->clipregion)
 		GdDestroyRegion(wp->clipregion);
+	if (wp->visregion)
+		GdDestroyRegion(wp->visregion);
 #endif
 
 	/* Remove any grabbed keys for this window. */
@@ -359,6 +371,15 @@ GsDestroyPixmap(GR_PIXMAP *pp)
 	/* deallocate mem gc*/
 	psd->FreeMemGC(psd);
 
+#if HAVE_SHAREDMEM_SUPPORT
+	/* release shared memory pixels, segment goes away when client detaches*/
+	if (pp->shmaddr) {
+		if (pp->shmid >= 0)
+			shmctl(pp->shmid, IPC_RMID, 0);
+		shmdt(pp->shmaddr);
+	}
+#endif
+
 	/*
 	 * Remove this pixmap from the complete list of pixmaps.
 	 */
@@ -370,6 +391,7 @@ GsDestroyPixmap(GR_PIXMAP *pp)
 			prevpp = prevpp->next;
 		prevpp->next = pp->next;
 	}
+	GsRemoveResource(GR_RESOURCE_PIXMAP, pp->id);
 
 	/*
 	 * Forget various information if they related to this
@@ -753,8 +775,14 @@ GdFillRect(wp->psd, wp->x+x, wp->y+y, width, height);
 usleep(500000);
 #endif
 
-		/* copy window pixmap buffer to window*/
-		GdBlit(wp->psd, wp->x + x, wp->y + y, width, height, wp->buffer->psd, x, y, MWROP_COPY);
+		/* copy or composite window pixmap buffer to window*/
+		if (GsIsTranslucent(wp))
+			GsCompositeWindow(wp, x, y, width, height);
+		else
+			GdBlit(wp->psd, wp->x + x, wp->y + y, width, height, wp->buffer->psd, x, y, MWROP_COPY);
+
+		/* translucent windows above were blended over the old contents*/
+		GsCompositeAbove(wp, wp->x + x, wp->y + y, width, height);
 		return;				/* don't deliver exposure events*/
 	}
 
@@ -887,7 +915,9 @@ GsDrawBorder(GR_WINDOW *wp)
 	wp->height += (bs * 2);
 	wp->bordersize = 0;
 
+	/* calc visible region for temporary window size, not cached*/
 	clipwp = NULL;
+	wp->visgen = 0;
 	/* FIXME: window clipregion will fail here */
 	GsSetClipWindow(wp, NULL, 0);
 	curgcp = NULL;
@@ -918,6 +948,44 @@ GsDrawBorder(GR_WINDOW *wp)
 	wp->height -= (bs * 2);
 	wp->bordersize = bs;
 	clipwp = NULL;
+	wp->visgen = 0;
+}
+
+/* Invalidate cached visible region of window and all its children.*/
+static void
+GsInvalidateClipTree(GR_WINDOW *wp)
+{
+	wp->visgen = 0;
+	for (wp = wp->children; wp; wp = wp->siblings)
+		GsInvalidateClipTree(wp);
+}
+
+/*
+ * Invalidate the cached visible regions affected by a change in a window's
+ * mapping, position, size, shape or stacking order.  These are the window
+ * and its children, its parent which excludes its children, and all lower
+ * siblings and their children.  Higher siblings and windows elsewhere in
+ * the tree keep their cached region.  Called after the change, except
+ * before lowering a window.
+ */
+void
+GsInvalidateClip(GR_WINDOW *wp)
+{
+	GR_WINDOW	*sibwp;
+
+	clipwp = NULL;
+
+	/* root window change invalidates all windows*/
+	if (!wp->parent) {
+		if (++clipgeneration == 0)
+			clipgeneration = 1;
+		return;
+	}
+
+	wp->parent->visgen = 0;
+	GsInvalidateClipTree(wp);
+	for (sibwp = wp->siblings; sibwp; sibwp = sibwp->siblings)
+		GsInvalidateClipTree(sibwp);
 }
 
 /*
@@ -957,6 +1025,117 @@ GsCheckOverlap(GR_WINDOW *topwp, GR_WINDOW *botwp)
 	return GR_TRUE;
 }
 
+/*
+ * Resource id index.
+ *
+ * All windows, pixmaps, gcs, regions, fonts and cursors are entered into
+ * a single chained hash table keyed by resource type and id, so that the
+ * GsFindXXX routines are O(1) regardless of how many resources are alive.
+ * The per-type linked lists are kept for walking all resources.
+ * Windows and pixmaps share an id space, other types have their own.
+ */
+#define IDHASH_INITSIZE	256		/* initial bucket count, power of two*/
+
+typedef struct gr_idhash_entry {
+	struct gr_idhash_entry *next;	/* next entry in bucket*/
+	GR_ID		id;					/* resource id*/
+	int			type;				/* GR_RESOURCE_xxx*/
+	void *		ptr;				/* resource structure*/
+} GR_IDHASH_ENTRY;
+
+static GR_IDHASH_ENTRY **idhash;	/* bucket array*/
+static unsigned int idhashsize;		/* # buckets*/
+static unsigned int idhashcount;	/* # entries*/
+
+#define IDHASH(type,id,size)	((((id) * 2654435761U) ^ (type)) & ((size) - 1))
+
+/* double bucket array size and rehash entries*/
+static void
+GsResizeIdHash(unsigned int newsize)
+{
+	GR_IDHASH_ENTRY **newhash;
+	GR_IDHASH_ENTRY *ep, *next;
+	unsigned int i;
+
+	newhash = calloc(newsize, sizeof(GR_IDHASH_ENTRY *));
+	if (!newhash)
+		return;				/* keep old table, chains just get longer*/
+
+	for (i = 0; i < idhashsize; i++) {
+		for (ep = idhash[i]; ep; ep = next) {
+			unsigned int h = IDHASH(ep->type, ep->id, newsize);
+			next = ep->next;
+			ep->next = newhash[h];
+			newhash[h] = ep;
+		}
+	}
+	free(idhash);
+	idhash = newhash;
+	idhashsize = newsize;
+}
+
+/* Enter a newly created resource into the id index.*/
+void
+GsAddResource(int type, GR_ID id, void *ptr)
+{
+	GR_IDHASH_ENTRY *ep;
+	unsigned int h;
+
+	if (!idhash)
+		GsResizeIdHash(IDHASH_INITSIZE);
+	else if (idhashcount >= idhashsize)
+		GsResizeIdHash(idhashsize << 1);
+	ep = idhash? malloc(sizeof(GR_IDHASH_ENTRY)): NULL;
+	if (!ep) {
+		EPRINTF("nano-X: out of memory for resource id %d\n", id);
+		return;
+	}
+	ep->id = id;
+	ep->type = type;
+	ep->ptr = ptr;
+
+	h = IDHASH(type, id, idhashsize);
+	ep->next = idhash[h];
+	idhash[h] = ep;
+	idhashcount++;
+}
+
+/* Remove a resource from the id index, called before it is freed.*/
+void
+GsRemoveResource(int type, GR_ID id)
+{
+	GR_IDHASH_ENTRY **epp;
+	GR_IDHASH_ENTRY *ep;
+
+	if (!idhash)
+		return;
+
+	for (epp = &idhash[IDHASH(type, id, idhashsize)]; (ep = *epp) != NULL; epp = &ep->next) {
+		if (ep->id == id && ep->type == type) {
+			*epp = ep->next;
+			free(ep);
+			idhashcount--;
+			return;
+		}
+	}
+}
+
+/* Return resource structure for type and id, or NULL if not found.*/
+void *
+GsLookupResource(int type, GR_ID id)
+{
+	GR_IDHASH_ENTRY *ep;
+
+	if (!idhash)
+		return NULL;
+
+	for (ep = idhash[IDHASH(type, id, idhashsize)]; ep; ep = ep->next) {
+		if (ep->id == id && ep->type == type)
+			return ep->ptr;
+	}
+	return NULL;
+}
+
 /*
  * Return a pointer to the window structure with the specified window id.
  * Returns NULL if the window does not exist.
@@ -976,17 +1155,14 @@ GsFindWindow(GR_WINDOW_ID id)
 		return cachewp;
 
 	/*
-	 * No, search for it and cache it for future calls.
+	 * No, look it up and cache it for future calls.
 	 */
-	for (wp = listwp; wp; wp = wp->next) {
-		if (wp->id == id) {
-			cachewindowid = id;
-			cachewp = wp;
-			return wp;
-		}
+	wp = GsLookupResource(GR_RESOURCE_WINDOW, id);
+	if (wp) {
+		cachewindowid = id;
+		cachewp = wp;
 	}
-
-	return NULL;
+	return wp;
 }
 
 
@@ -1004,17 +1180,14 @@ GsFindPixmap(GR_WINDOW_ID id)
 		return cachepp;
 
 	/*
-	 * No, search for it and cache it for future calls.
+	 * No, look it up and cache it for future calls.
 	 */
-	for (pp = listpp; pp; pp = pp->next) {
-		if (pp->id == id) {
-			cachepixmapid = id;
-			cachepp = pp;
-			return pp;
-		}
+	pp = GsLookupResource(GR_RESOURCE_PIXMAP, id);
+	if (pp) {
+		cachepixmapid = id;
+		cachepp = pp;
 	}
-
-	return NULL;
+	return pp;
 }
 
 
@@ -1035,14 +1208,13 @@ GsFindGC(GR_GC_ID gcid)
 		return cachegcp;
 
 	/*
-	 * No, search for it and cache it for future calls.
+	 * No, look it up and cache it for future calls.
 	 */
-	for (gcp = listgcp; gcp; gcp = gcp->next) {
-		if (gcp->id == gcid) {
-			cachegcid = gcid;
-			cachegcp = gcp;
-			return gcp;
-		}
+	gcp = GsLookupResource(GR_RESOURCE_GC, gcid);
+	if (gcp) {
+		cachegcid = gcid;
+		cachegcp = gcp;
+		return gcp;
 	}
 
 	GsError(GR_ERROR_BAD_GC_ID, gcid);
@@ -1054,41 +1226,21 @@ GsFindGC(GR_GC_ID gcid)
 GR_REGION *
 GsFindRegion(GR_REGION_ID regionid)
 {
-	GR_REGION	*regionp;	/* current region pointer */
-
-	for (regionp = listregionp; regionp; regionp = regionp->next) {
-		if (regionp->id == regionid) {
-			return regionp;
-		}
-	}
-
-	return NULL;
+	return GsLookupResource(GR_RESOURCE_REGION, regionid);
 }
 
 /* find a font with specified id*/
 GR_FONT *
 GsFindFont(GR_FONT_ID fontid)
 {
-	GR_FONT		*fontp;
-
-	for (fontp = listfontp; fontp; fontp = fontp->next) {
-		if (fontp->id == fontid)
-			return fontp;
-	}
-	return NULL;
+	return GsLookupResource(GR_RESOURCE_FONT, fontid);
 }
 
 /* find a cursor with specified id*/
 GR_CURSOR *
 GsFindCursor(GR_CURSOR_ID cursorid)
 {
-	GR_CURSOR	*cursorp;
-
-	for (cursorp = listcursorp; cursorp; cursorp = cursorp->next) {
-		if (cursorp->id == cursorid)
-			return cursorp;
-	}
-	return NULL;
+	return GsLookupResource(GR_RESOURCE_CURSOR, cursorid);
 }
 
 /*
@@ -1484,9 +1636,9 @@ GsSetPortraitMode(int mode)
 	GdRestrictMouse(0, 0, scrdev.xvirtres - 1, scrdev.yvirtres - 1);
 
 	/* reset clip and root window size*/
-	clipwp = NULL;
 	rootwp->width = scrdev.xvirtres;
 	rootwp->height = scrdev.yvirtres;
+	GsInvalidateClip(rootwp);
 
 	/* deliver portrait changed event to all windows selecting it*/
 	GsDeliverPortraitChangedEvent();
@@ -3,6 +3,10 @@
 int
 XSetWindowBorderWidth(Display *dpy, Window w, unsigned int width)
 {
+	nxWinInfo *wi;
+
 	GrSetWindowBorderSize(w, width);
+	if ((wi = _nxFindWinInfo(w)) != NULL)
+		wi->bordersize = width;
 	return 1;
 }
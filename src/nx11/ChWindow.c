@@ -3,7 +3,13 @@
 int
 XResizeWindow(Display *dpy, Window w, unsigned int width, unsigned int height)
 {
+	nxWinInfo *wi;
+
 	GrResizeWindow(w, width, height);
+	if ((wi = _nxFindWinInfo(w)) != NULL && (int)width > 0 && (int)height > 0) {
+		wi->width = width;
+		wi->height = height;
+	}
 	return 1;
 }
 
@@ -15,18 +21,25 @@ XResizeWindow(Display *dpy, Window w, unsigned int width, unsigned int height)
 
 int XConfigureWindow(Display *dpy, Window w, unsigned int mask, XWindowChanges *changes)
 {
-	GR_WINDOW_INFO wp;
-	GrGetWindowInfo(w, &wp);
+	nxWinInfo *wp = _nxGetWinInfo(w);
+	int x, y, width, height;
+
+	if (!wp)
+		return 0;
+	x = (mask & CWX)? changes->x: wp->x;
+	y = (mask & CWY)? changes->y: wp->y;
+	width = (mask & CWWidth)? changes->width: wp->width;
+	height = (mask & CWHeight)? changes->height: wp->height;
 
 	DPRINTF("XConfigureWindow called...");
 	//mask &= AllMaskBits;
 	if (mask & (CWX|CWY)) {
-		DPRINTF(" XY(%d,%d)", mask&CWX? changes->x: wp.x, mask&CWY? changes->y: wp.y);
-		GrMoveWindow(w, mask&CWX? changes->x: wp.x, mask&CWY? changes->y: wp.y);
+		DPRINTF(" XY(%d,%d)", x, y);
+		XMoveWindow(dpy, w, x, y);
 	}
 	if (mask & (CWWidth|CWHeight)) {
-		DPRINTF(" WH(%d,%d)", mask&CWWidth? changes->width: wp.width, mask&CWHeight? changes->height: wp.height);
-		GrResizeWindow(w, mask&CWWidth? changes->width: wp.width, mask&CWHeight? changes->height: wp.height);
+		DPRINTF(" WH(%d,%d)", width, height);
+		XResizeWindow(dpy, w, width, height);
 	}
 	if (mask & CWBorderWidth) {
 		DPRINTF(" BW(%d)", changes->border_width);
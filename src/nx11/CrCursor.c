@@ -46,17 +46,12 @@ XCreatePixmapCursor(Display * display, Pixmap source, Pixmap mask,
 {
 	Cursor ret;
 	GR_RECT cbb, mbb;
-	GR_WINDOW_INFO winfo;
 
-	GrGetWindowInfo(source, &winfo);
 	cbb.x = cbb.y = 0;
-	cbb.width = winfo.width;
-	cbb.height = winfo.height;
+	_nxGetDrawableSize(source, &cbb.width, &cbb.height);
 
-	GrGetWindowInfo(mask, &winfo);
 	mbb.x = mbb.y = 0;
-	mbb.width = winfo.width;
-	mbb.height = winfo.height;
+	_nxGetDrawableSize(mask, &mbb.width, &mbb.height);
 
 	ret = _nxCreateCursor(source, &cbb, mask, &mbb, x, y,
 		       GR_RGB(fg->red >> 8, fg->green >> 8, fg->blue >> 8),
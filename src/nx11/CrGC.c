@@ -304,23 +304,23 @@ XSetTSOrigin(Display * display, GC gc, int ts_x_origin, int ts_y_origin)
 int
 XSetTile(Display * display, GC gc, Pixmap tile)
 {
-	GR_WINDOW_INFO wi;
+	int width, height;
 
-	GrGetWindowInfo(tile, &wi);
-	GrSetGCTile(gc->gid, tile, wi.width, wi.height);
+	_nxGetDrawableSize(tile, &width, &height);
+	GrSetGCTile(gc->gid, tile, width, height);
 	return 1;
 }
 
 int
 XSetStipple(Display * display, GC gc, Pixmap stipple)
 {
-	GR_WINDOW_INFO wi;
+	int width, height;
 	GR_BITMAP *bitmap;
 
-	GrGetWindowInfo(stipple, &wi);
+	_nxGetDrawableSize(stipple, &width, &height);
 
-	bitmap = GrNewBitmapFromPixmap(stipple, 0, 0, wi.width, wi.height);
-	GrSetGCStipple(gc->gid, bitmap, wi.width, wi.height);
+	bitmap = GrNewBitmapFromPixmap(stipple, 0, 0, width, height);
+	GrSetGCStipple(gc->gid, bitmap, width, height);
 	free(bitmap);
 
 	return 1;
@@ -4,15 +4,20 @@ Pixmap
 XCreatePixmap(Display * dpy, Drawable d, unsigned int width,
 	unsigned int height, unsigned int depth)
 {
+	Pixmap pixmap;
+
 	/* Drawable ignored with nano-X */
 	// FIXME depth ignored in pixmap
 	if (depth == 1) DPRINTF("XCreatePixmap created with depth 1\n");
-	return GrNewPixmapEx(width, height, 0, NULL);
+	pixmap = GrNewPixmapEx(width, height, 0, NULL);
+	_nxNewWinInfo(pixmap, 0, 0, 0, width, height, 0);
+	return pixmap;
 }
 
 int
 XFreePixmap(Display * display, Pixmap pixmap)
 {
 	GrDestroyWindow(pixmap);
+	_nxDelWinInfo(pixmap);
 	return 1;
 }
@@ -6,10 +6,14 @@ XCreateSimpleWindow(Display * dpy, Window parent, int x, int y,
 	unsigned int borderWidth, unsigned long border,
 	unsigned long background)
 {
+	Window wid;
+
 	if (parent == 0)
 		parent = GR_ROOT_WINDOW_ID;
 
-	return GrNewWindow(parent, x, y, width, height, borderWidth,
+	wid = GrNewWindow(parent, x, y, width, height, borderWidth,
 		_nxColorvalFromPixelval(dpy, background),
 		_nxColorvalFromPixelval(dpy, border));
+	_nxNewWinInfo(wid, parent, x, y, width, height, borderWidth);
+	return wid;
 }
@@ -11,5 +11,6 @@ XDestroyWindow(Display * dpy, Window w)
 	_nxDelAllProperty(w);
 
 	GrDestroyWindow(w);
+	_nxDelWinInfo(w);
 	return 1;
 }
@@ -3,8 +3,9 @@
 #define FULLCIRCLE (360 * 64)
 
 /* X11 angle1=start, angle2=distance (negative=clockwise)*/
-static void
-drawArc(Drawable d, GC gc, int x, int y, int width, int height,
+/* convert to Nano-X arc, return 0 if no arc requested*/
+static int
+setArc(GR_ARCANGLE *ap, int x, int y, int width, int height,
 	int angle1, int angle2, int mode)
 {
 	int rx, ry;
@@ -12,7 +13,7 @@ drawArc(Drawable d, GC gc, int x, int y, int width, int height,
 
 	/* don't draw anything if no arc requested*/
 	if (angle2 == 0)
-		return;
+		return 0;
 
 #if 0
 	/*
@@ -57,7 +58,46 @@ drawArc(Drawable d, GC gc, int x, int y, int width, int height,
 		if (endAngle >= FULLCIRCLE)
 			endAngle = endAngle % FULLCIRCLE;
 	}
-	GrArcAngle(d, gc->gid, x+rx, y+ry, rx, ry, startAngle, endAngle, mode);
+	ap->x = x + rx;
+	ap->y = y + ry;
+	ap->rx = rx;
+	ap->ry = ry;
+	ap->angle1 = startAngle;
+	ap->angle2 = endAngle;
+	ap->type = mode;
+	return 1;
+}
+
+static void
+drawArc(Drawable d, GC gc, int x, int y, int width, int height,
+	int angle1, int angle2, int mode)
+{
+	GR_ARCANGLE arc;
+
+	if (setArc(&arc, x, y, width, height, angle1, angle2, mode))
+		GrArcAngle(d, gc->gid, arc.x, arc.y, arc.rx, arc.ry,
+			arc.angle1, arc.angle2, arc.type);
+}
+
+/* draw X11 arcs in batches*/
+static void
+drawArcs(Drawable d, GC gc, XArc *arcs, int narcs, int mode)
+{
+	GR_ARCANGLE gr_arcs[MAXBATCH];
+	int n = 0;
+
+	for (; narcs > 0; --narcs, ++arcs) {
+		/* X11 width/height is one less than Nano-X width/height*/
+		n += setArc(&gr_arcs[n], arcs->x, arcs->y,
+			arcs->width+1, arcs->height+1, arcs->angle1,
+			arcs->angle2, mode);
+		if (n == MAXBATCH) {
+			GrArcs(d, gc->gid, n, gr_arcs);
+			n = 0;
+		}
+	}
+	if (n)
+		GrArcs(d, gc->gid, n, gr_arcs);
 }
 
 int
@@ -73,15 +113,7 @@ XDrawArc(Display *display, Drawable d, GC gc, int x, int y,
 int
 XDrawArcs(Display *display, Drawable d, GC gc, XArc *arcs, int narcs)
 {
-	int i;
-
-	for (i = 0; i < narcs; i++) {
-		/* X11 width/height is one less than Nano-X width/height*/
-		drawArc(d, gc, arcs->x, arcs->y,
-			arcs->width+1, arcs->height+1, arcs->angle1,
-			arcs->angle2, GR_ARC);
-		++arcs;
-	}
+	drawArcs(d, gc, arcs, narcs, GR_ARC);
 	return 1;
 }
 
@@ -96,12 +128,6 @@ XFillArc(Display *display, Drawable d, GC gc, int x, int y,
 int
 XFillArcs(Display *display, Drawable d, GC gc, XArc *arcs, int narcs)
 {
-	int i;
-
-	for (i = 0; i < narcs; i++) {
-		drawArc(d, gc, arcs->x, arcs->y, arcs->width+1, arcs->height+1,
-			arcs->angle1, arcs->angle2, GR_PIE);
-		++arcs;
-	}
+	drawArcs(d, gc, arcs, narcs, GR_PIE);
 	return 1;
 }
@@ -4,11 +4,20 @@ int
 XDrawSegments(Display * dpy,
 	      Drawable d, GC gc, XSegment * segments, int nsegments)
 {
-	int i;
+	GR_SEGMENT gr_segs[MAXBATCH];
+	int i, n;
 
-	for (i = 0; i < nsegments; i++) {
-		GrLine(d, gc->gid, segments[i].x1, segments[i].y1,
-			segments[i].x2, segments[i].y2);
+	while (nsegments > 0) {
+		n = (nsegments < MAXBATCH)? nsegments: MAXBATCH;
+		for (i = 0; i < n; i++) {
+			gr_segs[i].x1 = segments->x1;
+			gr_segs[i].y1 = segments->y1;
+			gr_segs[i].x2 = segments->x2;
+			gr_segs[i].y2 = segments->y2;
+			++segments;
+		}
+		GrSegments(d, gc->gid, n, gr_segs);
+		nsegments -= n;
 	}
 
 	return 1;
@@ -11,23 +11,26 @@ int
 XDrawPoints(Display * display, Drawable d, GC gc,
 	    XPoint * points, int npoints, int mode)
 {
+	GR_POINT gr_points[MAXBATCH];
+	int i, n;
+	int prevx = 0, prevy = 0;
 
-	int i;
-
-	if (mode == CoordModeOrigin) {
-		for (i = 0; i < npoints; i++) {
-			GrPoint(d, gc->gid, points->x, points->y);
-			++points;
-		}
-	} else {
-		int prevx = 0, prevy = 0;
-
-		for (i = 0; i < npoints; i++) {
-			GrPoint(d, gc->gid, prevx + points->x, prevy + points->y);
-			prevx += points->x;
-			prevy += points->y;
+	while (npoints > 0) {
+		n = (npoints < MAXBATCH)? npoints: MAXBATCH;
+		for (i = 0; i < n; i++) {
+			if (mode == CoordModeOrigin) {
+				gr_points[i].x = points->x;
+				gr_points[i].y = points->y;
+			} else {
+				prevx += points->x;
+				prevy += points->y;
+				gr_points[i].x = prevx;
+				gr_points[i].y = prevy;
+			}
 			++points;
 		}
+		GrPoints(d, gc->gid, n, gr_points);
+		npoints -= n;
 	}
 
 	return 1;
@@ -13,13 +13,21 @@ int
 XDrawRectangles(Display *display, Drawable d, GC gc, XRectangle *rect,
 	int nrect)
 {
-	int i;
+	GR_RECT gr_rects[MAXBATCH];
+	int i, n;
 
-	for (i = 0; i < nrect; i++) {
-		/* X11 width/height is one less than Nano-X width/height*/
-		GrRect(d, gc->gid, rect->x, rect->y, rect->width+1,
-		       rect->height+1);
-		++rect;
+	while (nrect > 0) {
+		n = (nrect < MAXBATCH)? nrect: MAXBATCH;
+		for (i = 0; i < n; i++) {
+			/* X11 width/height is one less than Nano-X width/height*/
+			gr_rects[i].x = rect->x;
+			gr_rects[i].y = rect->y;
+			gr_rects[i].width = rect->width+1;
+			gr_rects[i].height = rect->height+1;
+			++rect;
+		}
+		GrRects(d, gc->gid, n, gr_rects);
+		nrect -= n;
 	}
 	return 1;
 }
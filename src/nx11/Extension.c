@@ -117,11 +117,6 @@ Bool XSyncQueryExtension(Display *dpy, int *event_base, int *error_base)
 	//*event_base = *error_base = 0; //segfault
 	return 0;
 }
-Bool XShmQueryExtension(Display *dpy, int *event_base, int *error_base)
-{
-	DPRINTF("XShmQueryExtension called\n");
-	return 0;
-}
 // required for qt4
 Bool XkbQueryExtension(Display *dpy, int *event_base, int *error_base)
 {
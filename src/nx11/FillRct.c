@@ -12,12 +12,21 @@ XFillRectangle(Display *xdpy, Drawable d, GC gc, int x, int y,
 
 int 
 XFillRectangles(Display *dpy, Drawable d, GC gc, XRectangle *rects, int nrects) {
-	int i;
+	GR_RECT gr_rects[MAXBATCH];
+	int i, n;
 
-	for(i = 0; i < nrects; i++) {
-		XFillRectangle(dpy, d, gc, rects->x, rects->y,
-				rects->width, rects->height);
-		++rects;
+	/* must copy since X rectangles are shorts, Nano-X are MWCOORDs (int) */
+	while (nrects > 0) {
+		n = (nrects < MAXBATCH)? nrects: MAXBATCH;
+		for(i = 0; i < n; i++) {
+			gr_rects[i].x = rects->x;
+			gr_rects[i].y = rects->y;
+			gr_rects[i].width = rects->width;
+			gr_rects[i].height = rects->height;
+			++rects;
+		}
+		GrFillRects(d, gc->gid, n, gr_rects);
+		nrects -= n;
 	}
 
 	return 1;
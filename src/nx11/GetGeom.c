@@ -5,19 +5,18 @@ XGetGeometry(Display *dpy, Drawable d, Window *root, int *x, int *y,
 	unsigned int *width, unsigned int *height, unsigned int *borderWidth,
 	unsigned int *depth)
 {
-	GR_WINDOW_INFO info;
-	GR_SCREEN_INFO sinfo;
+	nxWinInfo *wi = _nxGetWinInfo(d);
 
-	GrGetWindowInfo(d, &info);
-	GrGetScreenInfo(&sinfo);
+	if (!wi)
+		return 0;
 
 	*root = GR_ROOT_WINDOW_ID;
-	*x = info.x;
-	*y = info.y;
-	*width = info.width;
-	*height = info.height;
-	*borderWidth = info.bordersize;
-	*depth = sinfo.bpp;
+	*x = wi->x;
+	*y = wi->y;
+	*width = wi->width;
+	*height = wi->height;
+	*borderWidth = wi->bordersize;
+	*depth = XDefaultDepth(dpy, 0);
 
 	return 1;
 }
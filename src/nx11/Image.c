@@ -278,15 +278,15 @@ XGetImage(Display * display, Drawable d, int x, int y,
 	char *dst, *src, *buffer;
 	Visual *visual;
 	XImage *image;
-	GR_WINDOW_INFO winfo;
+	nxWinInfo *wi;
 
 	/* Ensure that the block is entirely within the drawable */
-	GrGetWindowInfo(d, &winfo);
-	if (x < 0 || (x + width) > winfo.width || y < 0 || (y + height) > winfo.height) {
+	wi = _nxGetWinInfo(d);
+	if (!wi || x < 0 || (x + width) > wi->width || y < 0 || (y + height) > wi->height) {
 		/* Error - BadMatch */
 		DPRINTF("XGetImage: Image out of bounds\n");
 		DPRINTF("    %d %d - %d %d is out of bounds on %d, %d - %d %d\n",
-		       x, y, width, height, 0, 0, winfo.width, winfo.height);
+		       x, y, width, height, 0, 0, wi? wi->width: 0, wi? wi->height: 0);
 		return NULL;
 	}
 
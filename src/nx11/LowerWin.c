@@ -4,5 +4,6 @@ int
 XLowerWindow(Display *dpy, Window w)
 {
 	GrLowerWindow(w);
+	_nxRestackWinInfo(w, GR_FALSE);
 	return 1;
 }
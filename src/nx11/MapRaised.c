@@ -3,7 +3,7 @@
 int
 XMapRaised (Display *dpy, Window w)
 {
-	GrMapWindow(w);
-	GrRaiseWindow(w);
+	XMapWindow(dpy, w);
+	XRaiseWindow(dpy, w);
 	return 1;
 }
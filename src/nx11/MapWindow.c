@@ -4,7 +4,11 @@
 int
 XMapWindow(Display *dpy, Window w)
 {
+	nxWinInfo *wi;
+
 	GrMapWindow(w);
+	if ((wi = _nxFindWinInfo(w)) != NULL)
+		wi->mapped = GR_TRUE;
 	return 1;
 }
 
@@ -15,11 +19,12 @@ XMapSubwindows(Display *dpy, Window w)
 	GR_WINDOW_ID	*child, *cp;
 	int		i, nchild;
 
+	/* other clients may have added children, so ask the server*/
 	GrQueryTree(w, &parent, &child, &nchild);
 
 	cp = child;
 	for (i=0; i<nchild; ++i)
-		GrMapWindow(*cp++);
+		XMapWindow(dpy, *cp++);
 
 	free(child);
 	return 1;
@@ -3,7 +3,13 @@
 int
 XMoveWindow(Display * dpy, Window w, int x, int y)
 {
+	nxWinInfo *wi;
+
 	GrMoveWindow(w, x, y);
+	if ((wi = _nxFindWinInfo(w)) != NULL) {
+		wi->x = x;
+		wi->y = y;
+	}
 	return 1;
 }
 
@@ -11,7 +17,7 @@ int
 XMoveResizeWindow(Display * display, Window w, int x, int y,
 		  unsigned int width, unsigned int height)
 {
-	GrMoveWindow(w, x, y);
-	GrResizeWindow(w, width, height);
+	XMoveWindow(display, w, x, y);
+	XResizeWindow(display, w, width, height);
 	return 1;
 }
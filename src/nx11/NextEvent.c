@@ -270,6 +270,7 @@ translateNXEvent(Display *dpy, GR_EVENT * ev, XEvent * event)
 		{
 			GR_EVENT_UPDATE *pev = (GR_EVENT_UPDATE *) ev;
 
+			_nxUpdateWinInfo(pev);
 			if (pev->utype == GR_UPDATE_MAP) {
 				event->type = MapNotify;
 				event->xmap.event = pev->wid;
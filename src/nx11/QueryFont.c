@@ -59,14 +59,24 @@ XQueryFont(Display * dpy, XID font_ID)
 	fs->per_char = cs = (XCharStruct *)Xmalloc(size * sizeof(XCharStruct));
 	if (cs) {
 		for (i=finfo.firstchar; i<=finfo.lastchar; ++i) {
+			GR_CHAR_METRICS *cm;
+
 			if (i-finfo.firstchar >= size)
 				break;
-			cs->lbearing = 0;
-			/* FIXME, we need a real widths table*/
-			cs->rbearing = (finfo.fixed || i>255)? finfo.maxwidth: finfo.widths[i];
-			cs->width = cs->rbearing;	/* FIXME*/
-			cs->ascent = finfo.baseline;
-			cs->descent = finfo.height - finfo.baseline;
+			/* use cached metrics shared with XTextExtents*/
+			if ((cm = _nxGetCharMetrics(font_ID, i)) != NULL) {
+				cs->lbearing = cm->lbearing;
+				cs->rbearing = cm->rbearing;
+				cs->width = cm->width;
+				cs->ascent = cm->ascent;
+				cs->descent = cm->descent;
+			} else {
+				cs->lbearing = 0;
+				cs->rbearing = (finfo.fixed || i>255)? finfo.maxwidth: finfo.widths[i];
+				cs->width = cs->rbearing;
+				cs->ascent = finfo.baseline;
+				cs->descent = finfo.height - finfo.baseline;
+			}
 			cs->attributes = 0;
 			++cs;
 		}
@@ -83,6 +93,7 @@ int
 XFreeFont(Display *display, XFontStruct *font_struct)
 {
 	GrDestroyFont(font_struct->fid);
+	_nxFreeFontMetrics(font_struct->fid);
 
 	if (font_struct->per_char)
 		Xfree(font_struct->per_char);
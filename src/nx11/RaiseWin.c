@@ -4,5 +4,6 @@ int
 XRaiseWindow (Display *dpy, Window w)
 {
 	GrRaiseWindow(w);
+	_nxRestackWinInfo(w, GR_TRUE);
 	return 1;
 }
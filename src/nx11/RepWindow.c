@@ -4,5 +4,6 @@ int
 XReparentWindow(Display *dpy, Window w, Window p, int x, int y)
 {
 	GrReparentWindow(w, p, x, y);
+	_nxReparentWinInfo(w, p, x, y);
 	return 1;
 }
@@ -18,7 +18,7 @@ int
 XSetClipMask(Display *display, GC gc, Pixmap mask)
 {
 	XGCValues *vp = (XGCValues *)gc->ext_data;
-	GR_WINDOW_INFO	info;
+	int		width, height;
 
 	/* avoid memory leak by deleting current gc region before new alloc*/
 	if (vp->clip_mask != None)
@@ -30,8 +30,8 @@ XSetClipMask(Display *display, GC gc, Pixmap mask)
 		return 1;
 	}
 
-	GrGetWindowInfo(mask, &info);
-	vp->clip_mask = GrNewRegionFromPixmap(mask, 0, 0, info.width, info.height);
+	_nxGetDrawableSize(mask, &width, &height);
+	vp->clip_mask = GrNewRegionFromPixmap(mask, 0, 0, width, height);
 	GrSetGCRegion(gc->gid, vp->clip_mask);
 
 	return 1;
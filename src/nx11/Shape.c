@@ -7,7 +7,7 @@ XShapeCombineMask(Display *dpy, Window dest, int destKind, int xOff, int yOff,
 	Pixmap src, int op)
 {
 	GR_REGION_ID	mask;
-	GR_WINDOW_INFO	info;
+	int		width, height;
 
 	if (destKind != ShapeBounding || op != ShapeSet)
 	//if (destKind != ShapeClip || op != ShapeSet)
@@ -18,8 +18,8 @@ XShapeCombineMask(Display *dpy, Window dest, int destKind, int xOff, int yOff,
 		return;
 	}
 
-	GrGetWindowInfo(src, &info);
-	mask = GrNewRegionFromPixmap(src, 0, 0, info.width, info.height);
+	_nxGetDrawableSize(src, &width, &height);
+	mask = GrNewRegionFromPixmap(src, 0, 0, width, height);
 	GrSetWindowRegion(dest, mask, mask);
 	GrDestroyRegion(mask);
 }
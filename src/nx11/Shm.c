@@ -0,0 +1,298 @@
+/*
+ * MIT-SHM extension
+ *
+ * Segments attached with XShmAttach are drawn through nano-X pixmaps
+ * created over the same segment with GrAttachSharedPixmap.  XShmPutImage
+ * is then a single GrCopyArea from the segment and XShmGetImage a
+ * GrCopyArea into it, without copying any pixels through the request
+ * stream.  Images not in screen pixel format, and servers without
+ * shared memory support, fall back to XPutImage and XGetImage.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nxlib.h"
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#define SHM_EVENT_BASE	LASTEvent	/* ShmCompletion event number*/
+#define SHM_REQCODE	128		/* major opcode reported in events*/
+#ifndef X_ShmPutImage
+#define X_ShmPutImage	3
+#endif
+
+/* nano-X pixmap over an image in an attached segment*/
+typedef struct _nxShmPixmap {
+	struct _nxShmPixmap *	next;
+	GR_WINDOW_ID		pixmap;		/* 0 if server can't attach*/
+	int			offset;		/* image data offset in segment*/
+	int			width;
+	int			height;
+	int			pitch;
+} nxShmPixmap;
+
+/* segment attached by XShmAttach*/
+typedef struct _nxShmSeg {
+	struct _nxShmSeg *	next;
+	ShmSeg			shmseg;
+	int			shmid;
+	char *			shmaddr;
+	nxShmPixmap *		pixmaps;
+} nxShmSeg;
+
+static nxShmSeg *shmsegs;
+static ShmSeg nextshmseg = 1;
+static GR_GC_ID shmgc;		/* gc for XShmGetImage*/
+static int shmpending;		/* XShmPutImage not yet known complete*/
+
+static nxShmSeg *
+findShmSeg(ShmSeg shmseg)
+{
+	nxShmSeg *sp;
+
+	for (sp = shmsegs; sp; sp = sp->next)
+		if (sp->shmseg == shmseg)
+			return sp;
+	return NULL;
+}
+
+/* return pixmap over shared memory image, 0 if image must be copied*/
+static GR_WINDOW_ID
+getShmPixmap(Display *dpy, XImage *image)
+{
+	XShmSegmentInfo *shminfo = (XShmSegmentInfo *)image->obdata;
+	nxShmSeg *sp;
+	nxShmPixmap *pp;
+	int offset;
+
+	/* only screen format truecolor images can be blitted directly*/
+	if (!shminfo || image->format != ZPixmap || image->depth == 1 ||
+	    dpy->screens[0].root_visual->class != TrueColor ||
+	    image->bits_per_pixel != dpy->screens[0].root_depth)
+		return 0;
+
+	if ((sp = findShmSeg(shminfo->shmseg)) == NULL)
+		return 0;
+	offset = image->data - sp->shmaddr;
+
+	for (pp = sp->pixmaps; pp; pp = pp->next) {
+		if (pp->offset == offset && pp->width == image->width &&
+		    pp->height == image->height && pp->pitch == image->bytes_per_line)
+			return pp->pixmap;
+	}
+
+	/* remember failures too, so fallback doesn't cost a round trip each time*/
+	if ((pp = (nxShmPixmap *)Xmalloc(sizeof(nxShmPixmap))) == NULL)
+		return 0;
+	pp->pixmap = GrAttachSharedPixmap(image->width, image->height, 0,
+		sp->shmid, offset, image->bytes_per_line);
+	pp->offset = offset;
+	pp->width = image->width;
+	pp->height = image->height;
+	pp->pitch = image->bytes_per_line;
+	pp->next = sp->pixmaps;
+	sp->pixmaps = pp;
+
+	DPRINTF("XShm: pixmap %d for %dx%d image at offset %d\n", pp->pixmap,
+		image->width, image->height, offset);
+	return pp->pixmap;
+}
+
+/* wait for server to complete XShmPutImage, called from XSync*/
+void
+_nxShmSync(void)
+{
+	GR_SCREEN_INFO si;
+
+	if (shmpending) {
+		GrGetScreenInfo(&si);		/* round trip*/
+		shmpending = 0;
+	}
+}
+
+Bool
+XShmQueryExtension(Display *dpy)
+{
+#if HAVE_SHAREDMEM_SUPPORT
+	return True;
+#else
+	return False;
+#endif
+}
+
+int
+XShmGetEventBase(Display *dpy)
+{
+	return SHM_EVENT_BASE;
+}
+
+Bool
+XShmQueryVersion(Display *dpy, int *majorVersion, int *minorVersion,
+	Bool *sharedPixmaps)
+{
+	*majorVersion = SHM_MAJOR_VERSION;
+	*minorVersion = SHM_MINOR_VERSION;
+	*sharedPixmaps = XShmQueryExtension(dpy);
+	return XShmQueryExtension(dpy);
+}
+
+int
+XShmPixmapFormat(Display *dpy)
+{
+	return ZPixmap;
+}
+
+Bool
+XShmAttach(Display *dpy, XShmSegmentInfo *shminfo)
+{
+	nxShmSeg *sp;
+	GR_WINDOW_ID probe;
+
+	/* check server can attach segment, so application can fall back*/
+	probe = GrAttachSharedPixmap(1, 1, 0, shminfo->shmid, 0, sizeof(uint32_t));
+	if (!probe) {
+		DPRINTF("XShmAttach: server can't attach shmid %d\n", shminfo->shmid);
+		return False;
+	}
+	GrDestroyWindow(probe);
+
+	if ((sp = (nxShmSeg *)Xcalloc(1, sizeof(nxShmSeg))) == NULL)
+		return False;
+	sp->shmseg = shminfo->shmseg = nextshmseg++;
+	sp->shmid = shminfo->shmid;
+	sp->shmaddr = shminfo->shmaddr;
+	sp->next = shmsegs;
+	shmsegs = sp;
+	return True;
+}
+
+Bool
+XShmDetach(Display *dpy, XShmSegmentInfo *shminfo)
+{
+	nxShmSeg *sp, **prev;
+	nxShmPixmap *pp;
+
+	for (prev = &shmsegs; (sp = *prev) != NULL; prev = &sp->next) {
+		if (sp->shmseg == shminfo->shmseg) {
+			*prev = sp->next;
+			while ((pp = sp->pixmaps) != NULL) {
+				sp->pixmaps = pp->next;
+				if (pp->pixmap)
+					GrDestroyWindow(pp->pixmap);
+				Xfree(pp);
+			}
+			Xfree(sp);
+
+			/* server detaches on pixmap destroy, complete before segment is removed*/
+			shmpending = 1;
+			_nxShmSync();
+			return True;
+		}
+	}
+	return False;
+}
+
+/* image data is in shared memory, only free structure*/
+static int
+destroyShmImage(XImage *image)
+{
+	Xfree(image);
+	return 1;
+}
+
+XImage *
+XShmCreateImage(Display *dpy, Visual *visual, unsigned int depth, int format,
+	char *data, XShmSegmentInfo *shminfo, unsigned int width, unsigned int height)
+{
+	XImage *image;
+
+	image = XCreateImage(dpy, visual, depth, format, 0, data, width, height, 32, 0);
+	if (image) {
+		image->obdata = (char *)shminfo;
+		image->f.destroy_image = destroyShmImage;
+	}
+	return image;
+}
+
+Bool
+XShmPutImage(Display *dpy, Drawable d, GC gc, XImage *image, int src_x,
+	int src_y, int dst_x, int dst_y, unsigned int src_width,
+	unsigned int src_height, Bool send_event)
+{
+	GR_WINDOW_ID pixmap = getShmPixmap(dpy, image);
+
+	if (pixmap) {
+		XGCValues *vp = (XGCValues *)gc->ext_data;
+
+		GrCopyArea(d, gc->gid, dst_x, dst_y, src_width, src_height,
+			pixmap, src_x, src_y, _nxConvertROP(vp->function));
+		shmpending = 1;
+	} else
+		XPutImage(dpy, d, gc, image, src_x, src_y, dst_x, dst_y,
+			src_width, src_height);
+
+	/* segment may be reused once completion event is received*/
+	if (send_event) {
+		XShmSegmentInfo *shminfo = (XShmSegmentInfo *)image->obdata;
+		XShmCompletionEvent ev;
+
+		_nxShmSync();
+		memset(&ev, 0, sizeof(ev));
+		ev.type = SHM_EVENT_BASE + ShmCompletion;
+		ev.display = dpy;
+		ev.drawable = d;
+		ev.major_code = SHM_REQCODE;
+		ev.minor_code = X_ShmPutImage;
+		if (shminfo) {
+			ev.shmseg = shminfo->shmseg;
+			ev.offset = image->data - shminfo->shmaddr;
+		}
+		XPutBackEvent(dpy, (XEvent *)&ev);
+	}
+	return True;
+}
+
+Bool
+XShmGetImage(Display *dpy, Drawable d, XImage *image, int x, int y,
+	unsigned long plane_mask)
+{
+	GR_WINDOW_ID pixmap = getShmPixmap(dpy, image);
+	GR_SCREEN_INFO si;
+	XImage *tmp;
+	int i, j;
+
+	if (pixmap) {
+		if (!shmgc)
+			shmgc = GrNewGC();
+		GrCopyArea(pixmap, shmgc, 0, 0, image->width, image->height,
+			d, x, y, MWROP_COPY);
+		GrGetScreenInfo(&si);		/* round trip, image is read on return*/
+		shmpending = 0;
+		return True;
+	}
+
+	/* copy through GR_PIXELVAL image*/
+	tmp = XGetImage(dpy, d, x, y, image->width, image->height, plane_mask, ZPixmap);
+	if (!tmp)
+		return False;
+	for (j = 0; j < image->height; j++)
+		for (i = 0; i < image->width; i++)
+			XPutPixel(image, i, j, XGetPixel(tmp, i, j));
+	XDestroyImage(tmp);
+	return True;
+}
+
+Pixmap
+XShmCreatePixmap(Display *dpy, Drawable d, char *data, XShmSegmentInfo *shminfo,
+	unsigned int width, unsigned int height, unsigned int depth)
+{
+	int bpp = dpy->screens[0].root_depth;
+
+	/* only screen format pixmaps can share pixels with the server*/
+	if (depth != bpp && !(depth == 24 && bpp == 32))
+		return 0;
+
+	/* ZPixmap lines are padded to 32 bits*/
+	return GrAttachSharedPixmap(width, height, 0, shminfo->shmid,
+		data - shminfo->shmaddr, ((width * bpp + 31) >> 5) << 2);
+}
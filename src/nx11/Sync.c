@@ -4,6 +4,7 @@
 int
 XSync(Display *dpy, Bool discard)
 {
+	_nxShmSync();		/* wait for shared memory images*/
 	GrFlush();
 
 	if (discard) {
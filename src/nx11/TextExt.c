@@ -1,17 +1,92 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "nxlib.h"
 
+/*
+ * Character metrics are cached per font in pages of 256 characters,
+ * fetched from the server on first use, so text can be measured
+ * without a round trip per string.
+ */
+#define METRICS_PAGESIZE	256
+#define METRICS_NUMPAGES	256		/* 16 bit character set*/
+
+typedef struct _nxFontMetrics {
+	struct _nxFontMetrics *	next;
+	Font			fid;
+	GR_CHAR_METRICS *	page[METRICS_NUMPAGES];
+} nxFontMetrics;
+
+static nxFontMetrics *fontmetrics;
+
+/* return cached metrics of character, fetching its page on first use*/
+GR_CHAR_METRICS *
+_nxGetCharMetrics(Font fid, unsigned int ch)
+{
+	nxFontMetrics *fm;
+	unsigned int p = (ch / METRICS_PAGESIZE) % METRICS_NUMPAGES;
+
+	for (fm = fontmetrics; fm; fm = fm->next)
+		if (fm->fid == fid)
+			break;
+	if (!fm) {
+		if (!(fm = (nxFontMetrics *)Xcalloc(1, sizeof(nxFontMetrics))))
+			return NULL;
+		fm->fid = fid;
+		fm->next = fontmetrics;
+		fontmetrics = fm;
+	}
+
+	if (!fm->page[p]) {
+		fm->page[p] = (GR_CHAR_METRICS *)Xmalloc(METRICS_PAGESIZE * sizeof(GR_CHAR_METRICS));
+		if (!fm->page[p])
+			return NULL;
+		GrGetFontMetrics(fid, p * METRICS_PAGESIZE, METRICS_PAGESIZE, fm->page[p]);
+	}
+	return &fm->page[p][ch % METRICS_PAGESIZE];
+}
+
+/* discard cached metrics when font is unloaded*/
+void
+_nxFreeFontMetrics(Font fid)
+{
+	nxFontMetrics *fm, **prev;
+	int i;
+
+	for (prev = &fontmetrics; (fm = *prev) != NULL; prev = &fm->next) {
+		if (fm->fid == fid) {
+			*prev = fm->next;
+			for (i = 0; i < METRICS_NUMPAGES; i++)
+				if (fm->page[i])
+					Xfree(fm->page[i]);
+			Xfree(fm);
+			return;
+		}
+	}
+}
+
+/* return character code of string position, 16 bit strings are XChar2b*/
+static unsigned int
+_nxCharAt(void *string, int i, int flag)
+{
+	if (flag == GR_TFXCHAR2B) {
+		XChar2b *s = (XChar2b *) string;
+		return (s[i].byte1 << 8) | s[i].byte2;
+	}
+	return ((unsigned char *) string)[i];
+}
+
 static int
 _nxTextWidth(XFontStruct * font, void *string, int count, int flag)
 {
-	int w, h, b;
-	GR_GC_ID local = GrNewGC();
-	GrSetGCFont(local, font->fid);
+	GR_CHAR_METRICS *cm;
+	int i, w = 0;
 
-	GrGetGCTextSize(local, (void *) string, count, flag, &w, &h, &b);
-
-	GrDestroyGC(local);
+	for (i = 0; i < count; i++) {
+		cm = _nxGetCharMetrics(font->fid, _nxCharAt(string, i, flag));
+		if (cm)
+			w += cm->width;
+	}
 	return (w);
 }
 
@@ -31,22 +106,36 @@ static int
 _nxTextExtents(XFontStruct * font, void *string, int count,
 	int *dir, int *ascent, int *descent, XCharStruct * overall, int flag)
 {
-	int w, h, b;
-	GR_GC_ID local = GrNewGC();
-
-	GrSetGCFont(local, font->fid);
-	GrGetGCTextSize(local, (void *) string, count, flag, &w, &h, &b);
-	GrDestroyGC(local);
+	GR_CHAR_METRICS *cm;
+	int i, x = 0;
 
-	*ascent = b;
-	*descent = h - b;
+	*ascent = font->ascent;
+	*descent = font->descent;
 	*dir = FontLeftToRight;
 
-	overall->lbearing = 0;	/* Figure this out */
-	overall->rbearing = w;	/* Figure this out */
-	overall->width = w;
-	overall->ascent = b;
-	overall->descent = *descent;
+	memset(overall, 0, sizeof(XCharStruct));
+	for (i = 0; i < count; i++) {
+		cm = _nxGetCharMetrics(font->fid, _nxCharAt(string, i, flag));
+		if (!cm)
+			continue;
+		if (i == 0) {
+			overall->lbearing = cm->lbearing;
+			overall->rbearing = cm->rbearing;
+			overall->ascent = cm->ascent;
+			overall->descent = cm->descent;
+		} else {
+			if (x + cm->lbearing < overall->lbearing)
+				overall->lbearing = x + cm->lbearing;
+			if (x + cm->rbearing > overall->rbearing)
+				overall->rbearing = x + cm->rbearing;
+			if (cm->ascent > overall->ascent)
+				overall->ascent = cm->ascent;
+			if (cm->descent > overall->descent)
+				overall->descent = cm->descent;
+		}
+		x += cm->width;
+	}
+	overall->width = x;
 	overall->attributes = 0;	/* FIXME? */
 	return 1;
 }
@@ -4,5 +4,6 @@ int
 XUnloadFont(Display *dpy, Font font)
 {
 	GrDestroyFont(font);
+	_nxFreeFontMetrics(font);
 	return 1;
 }
@@ -3,13 +3,16 @@
 int
 XUnmapWindow (Display *dpy, Window w)
 {
+	nxWinInfo *wi;
+
 	GrUnmapWindow(w);
+	if ((wi = _nxFindWinInfo(w)) != NULL)
+		wi->mapped = GR_FALSE;
 	return 1;
 }
 
 Status
 XWithdrawWindow(Display * display, Window w, int screen_number)
 {
-	GrUnmapWindow(w);
-	return 1;
+	return XUnmapWindow(display, w);
 }
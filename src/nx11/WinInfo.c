@@ -0,0 +1,261 @@
+/*
+ * Client side window geometry
+ *
+ * Position, size, parent and mapped state of windows and pixmaps are
+ * kept here so XGetGeometry, XQueryPointer, XTranslateCoordinates and
+ * friends don't need a GrGetWindowInfo round trip per window.
+ *
+ * Windows created by this client below another of its windows, and
+ * pixmaps, can only change through nx11, which updates the entries as
+ * it sends the requests. Top level windows may be moved or reparented
+ * by the window manager, and other clients' windows by anyone, so
+ * their entries are refetched on each use. Update events for a window
+ * that disagree with its entry mark it for refetching too.
+ *
+ * The child and sibling links only chain windows this client created
+ * under its own windows.  Other clients can add children to our
+ * windows without us seeing it, so code needing all children of a
+ * window must still ask the server with GrQueryTree.
+ */
+#include <stdlib.h>
+#include "nxlib.h"
+
+#define WININFO_HASHSIZE	64		/* power of two*/
+#define WININFO_HASH(wid)	((wid) & (WININFO_HASHSIZE - 1))
+
+static nxWinInfo *wininfo[WININFO_HASHSIZE];
+
+nxWinInfo *
+_nxFindWinInfo(GR_WINDOW_ID wid)
+{
+	nxWinInfo *wi;
+
+	for (wi = wininfo[WININFO_HASH(wid)]; wi; wi = wi->next)
+		if (wi->wid == wid)
+			return wi;
+	return NULL;
+}
+
+/* geometry stays current without round trips if only this client changes it*/
+static GR_BOOL
+isStable(nxWinInfo *wi)
+{
+	nxWinInfo *pp;
+
+	if (wi->parent == 0)		/* pixmaps never change size*/
+		return wi->wid != GR_ROOT_WINDOW_ID;
+	pp = _nxFindWinInfo(wi->parent);
+	return wi->owned && pp && pp->owned;
+}
+
+/* remove window from its parent's child list*/
+static void
+unlinkWin(nxWinInfo *wi)
+{
+	nxWinInfo *pp = _nxFindWinInfo(wi->parent);
+	nxWinInfo *sp;
+	GR_WINDOW_ID *link;
+
+	if (pp) {
+		for (link = &pp->child; *link; link = &sp->sibling) {
+			if (*link == wi->wid) {
+				*link = wi->sibling;
+				break;
+			}
+			if ((sp = _nxFindWinInfo(*link)) == NULL)
+				break;
+		}
+	}
+	wi->sibling = 0;
+}
+
+/* add window to its parent's child list, on top or bottom of its siblings*/
+static void
+linkWin(nxWinInfo *wi, GR_BOOL top)
+{
+	nxWinInfo *pp = _nxFindWinInfo(wi->parent);
+	nxWinInfo *sp;
+	GR_WINDOW_ID *link;
+
+	/* only windows we create are kept in child lists*/
+	if (!wi->owned || !pp || !pp->owned)
+		return;
+
+	link = &pp->child;
+	if (!top) {
+		while (*link && (sp = _nxFindWinInfo(*link)) != NULL)
+			link = &sp->sibling;
+	}
+	wi->sibling = *link;
+	*link = wi->wid;
+}
+
+/* return window or pixmap info, fetching it from server if not current*/
+nxWinInfo *
+_nxGetWinInfo(GR_WINDOW_ID wid)
+{
+	nxWinInfo *wi = _nxFindWinInfo(wid);
+	GR_WINDOW_INFO info;
+
+	if (wi && wi->valid)
+		return wi;
+
+	GrGetWindowInfo(wid, &info);
+	if (info.wid == 0) {		/* no such window*/
+		if (wi)
+			_nxDelWinInfo(wid);
+		return NULL;
+	}
+
+	if (!wi) {
+		if ((wi = (nxWinInfo *)Xcalloc(1, sizeof(nxWinInfo))) == NULL)
+			return NULL;
+		wi->wid = wid;
+		wi->next = wininfo[WININFO_HASH(wid)];
+		wininfo[WININFO_HASH(wid)] = wi;
+	}
+	if (wi->parent != info.parent) {
+		unlinkWin(wi);
+		wi->parent = info.parent;
+		linkWin(wi, GR_TRUE);
+	}
+	wi->x = info.x;
+	wi->y = info.y;
+	wi->width = info.width;
+	wi->height = info.height;
+	wi->bordersize = info.bordersize;
+	wi->mapped = info.mapped;
+	wi->valid = isStable(wi);
+	return wi;
+}
+
+/* add window or pixmap (parent 0) just created by this client*/
+void
+_nxNewWinInfo(GR_WINDOW_ID wid, GR_WINDOW_ID parent, int x, int y,
+	int width, int height, int bordersize)
+{
+	nxWinInfo *wi;
+
+	if (!wid || (wi = (nxWinInfo *)Xcalloc(1, sizeof(nxWinInfo))) == NULL)
+		return;
+	wi->wid = wid;
+	wi->parent = parent;
+	wi->x = x;
+	wi->y = y;
+	wi->width = width;
+	wi->height = height;
+	wi->bordersize = bordersize;
+	wi->mapped = GR_FALSE;
+	wi->owned = GR_TRUE;
+	wi->next = wininfo[WININFO_HASH(wid)];
+	wininfo[WININFO_HASH(wid)] = wi;
+	linkWin(wi, GR_TRUE);
+	wi->valid = isStable(wi);
+}
+
+/* remove destroyed window and its children*/
+void
+_nxDelWinInfo(GR_WINDOW_ID wid)
+{
+	nxWinInfo *wi, **prev;
+
+	if ((wi = _nxFindWinInfo(wid)) == NULL)
+		return;
+	while (wi->child && _nxFindWinInfo(wi->child))
+		_nxDelWinInfo(wi->child);
+	unlinkWin(wi);
+
+	for (prev = &wininfo[WININFO_HASH(wid)]; *prev; prev = &(*prev)->next) {
+		if (*prev == wi) {
+			*prev = wi->next;
+			break;
+		}
+	}
+	Xfree(wi);
+}
+
+void
+_nxReparentWinInfo(GR_WINDOW_ID wid, GR_WINDOW_ID parent, int x, int y)
+{
+	nxWinInfo *wi = _nxFindWinInfo(wid);
+
+	if (wi) {
+		unlinkWin(wi);
+		wi->parent = parent;
+		wi->x = x;
+		wi->y = y;
+		linkWin(wi, GR_TRUE);
+		wi->valid = wi->valid && isStable(wi);
+	}
+}
+
+/* move window to top or bottom of its siblings*/
+void
+_nxRestackWinInfo(GR_WINDOW_ID wid, GR_BOOL raise)
+{
+	nxWinInfo *wi = _nxFindWinInfo(wid);
+
+	if (wi) {
+		unlinkWin(wi);
+		linkWin(wi, raise);
+	}
+}
+
+/* check window info against update event, refetch if changed elsewhere*/
+void
+_nxUpdateWinInfo(GR_EVENT_UPDATE *ep)
+{
+	nxWinInfo *wi = _nxFindWinInfo(ep->subwid);
+
+	if (!wi)
+		return;
+
+	switch (ep->utype) {
+	case GR_UPDATE_MOVE:
+	case GR_UPDATE_SIZE:
+		if (ep->x != wi->x || ep->y != wi->y ||
+		    ep->width != wi->width || ep->height != wi->height)
+			wi->valid = GR_FALSE;
+		break;
+	case GR_UPDATE_MAP:
+	case GR_UPDATE_UNMAP:
+		if (wi->mapped != (ep->utype == GR_UPDATE_MAP))
+			wi->valid = GR_FALSE;
+		break;
+	case GR_UPDATE_REPARENT:
+		wi->valid = GR_FALSE;
+		break;
+	case GR_UPDATE_DESTROY:
+		_nxDelWinInfo(ep->subwid);
+		break;
+	}
+}
+
+/* return window position relative to root window*/
+Bool
+_nxGetWinOrigin(GR_WINDOW_ID wid, int *x, int *y)
+{
+	nxWinInfo *wi;
+
+	*x = *y = 0;
+	while (wid != GR_ROOT_WINDOW_ID) {
+		if ((wi = _nxGetWinInfo(wid)) == NULL)
+			return False;
+		*x += wi->x;
+		*y += wi->y;
+		if (wi->parent == 0)	/* pixmap*/
+			break;
+		wid = wi->parent;
+	}
+	return True;
+}
+
+/* return size of window or pixmap, 0 if none*/
+void
+_nxGetDrawableSize(GR_WINDOW_ID wid, int *width, int *height)
+{
+	nxWinInfo *wi = _nxGetWinInfo(wid);
+
+	*width = wi? wi->width: 0;
+	*height = wi? wi->height: 0;
+}
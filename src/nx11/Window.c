@@ -36,6 +36,8 @@ XCreateWindow(Display *dpy, Window parent, int x, int y,
 	}
 	if (!wid)
 		return 0;
+	_nxNewWinInfo(wid, parent, x, y, width, height,
+		(class == InputOnly)? 0: borderWidth);
 
 	/* if override_redirect set, assume popup-style window*/
 	if ((valuemask & CWOverrideRedirect) && attributes->override_redirect) {
@@ -38,6 +38,9 @@
 #endif
 #define Xfree(ptr) free((ptr))
 
+/* max X11 primitives converted on the stack for each nano-X table drawing call*/
+#define MAXBATCH	256
+
 /* defines for unmodified (Xrm) Xlib routines...*/
 //#define bzero(mem, size)	memset(mem, 0, size)
 #define LockDisplay(dpy)
@@ -106,4 +109,39 @@ extern Font _nxCursorFont;
 /* CrGC.c*/
 int _nxConvertROP(int Xrop);
 
+/* TextExt.c*/
+GR_CHAR_METRICS *_nxGetCharMetrics(Font fid, unsigned int ch);
+void _nxFreeFontMetrics(Font fid);
+
+/* Shm.c*/
+void _nxShmSync(void);
+
+/* WinInfo.c*/
+typedef struct _nxWinInfo {
+	struct _nxWinInfo *	next;		/* hash chain*/
+	GR_WINDOW_ID		wid;
+	GR_WINDOW_ID		parent;		/* 0 for pixmaps*/
+	GR_WINDOW_ID		child;		/* topmost owned child, others not listed*/
+	GR_WINDOW_ID		sibling;	/* next lower owned sibling*/
+	GR_COORD		x;		/* parent relative position*/
+	GR_COORD		y;
+	GR_SIZE			width;
+	GR_SIZE			height;
+	GR_SIZE			bordersize;
+	GR_BOOL			mapped;
+	GR_BOOL			owned;		/* created by this client*/
+	GR_BOOL			valid;		/* current without round trip*/
+} nxWinInfo;
+
+nxWinInfo *_nxFindWinInfo(GR_WINDOW_ID wid);
+nxWinInfo *_nxGetWinInfo(GR_WINDOW_ID wid);
+void _nxNewWinInfo(GR_WINDOW_ID wid, GR_WINDOW_ID parent, int x, int y,
+	int width, int height, int bordersize);
+void _nxDelWinInfo(GR_WINDOW_ID wid);
+void _nxReparentWinInfo(GR_WINDOW_ID wid, GR_WINDOW_ID parent, int x, int y);
+void _nxRestackWinInfo(GR_WINDOW_ID wid, GR_BOOL raise);
+void _nxUpdateWinInfo(GR_EVENT_UPDATE *ep);
+Bool _nxGetWinOrigin(GR_WINDOW_ID wid, int *x, int *y);
+void _nxGetDrawableSize(GR_WINDOW_ID wid, int *width, int *height);
+
 #endif /* _NXLIB_H_*/